@@ -21,7 +21,7 @@
 struct HSpectrumHeaderStruct
 {
     uint64_t fHeaderSize; //size of the header struct in bytes
-    char fVersionFlag[HFLAG_WIDTH]; //version, format code (also indicates what type (e.g. double, float) the spectrum data is stored in)
+    char fVersionFlag[HFLAG_WIDTH]; //version, format code (also indicates what type (e.g. double, float) the spectrum data is stored in, an 'S' after the type indicates the Stokes I, Q, U, V spectra one after the other)
     char fSidebandFlag[HFLAG_WIDTH]; //flag indicating the sideband
     char fPolarizationFlag[HFLAG_WIDTH]; //flag indicating the polarization recorded
     uint64_t fStartTime; //acquisition start time in seconds since epoch
@@ -0,0 +1,357 @@
+#ifndef HArrayExpression_HH__
+#define HArrayExpression_HH__
+
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "HArrayWrapper.hh"
+#include "HArrayView.hh"
+#include "HArrayPacket.hh"
+
+namespace hose{
+
+/**
+*
+*@file HArrayExpression.hh
+*@class HArrayExpression
+*@brief expression templates for element-wise arithmetic on HArrayWrapper (and raw) arrays and 1D HArrayViews
+*@details writing (a + b)*0.5 or Sqrt(a*a + b*b), with a and b arrays, builds a lightweight tree of nodes instead
+* of computing anything, the tree is evaluated later by HArrayExpressionEngine in a single pass over the data,
+* (so a chain of operations costs one read of each input and one write of the output, with no temporaries).
+* Arrays are treated as flat sequences of elements (the dimensions are ignored, only the total size must agree).
+* Each node provides the element at an index (Get), and if every operation in the tree has a SIMD form and the
+* element type has SIMD registers (see HArrayPacket), a whole register of elements at once (GetPacket).
+* Scalars take the element type of the array they are combined with, so a float array times 0.5 stays float.
+*
+*/
+
+//base of all the expression nodes (curiously recurring template pattern)
+template< typename XDerived >
+class HArrayExpression
+{
+    public:
+        const XDerived& Derived() const {return static_cast<const XDerived&>(*this);}
+};
+
+//leaf node, a contiguous array of elements
+template< typename XValueType >
+class HArrayTerminal: public HArrayExpression< HArrayTerminal< XValueType > >
+{
+    public:
+        typedef XValueType value_type;
+        typedef HArrayPacket< XValueType > packet;
+        static const bool is_vectorizable = packet::is_simd;
+
+        HArrayTerminal(const XValueType* data, std::size_t size):fData(data),fSize(size){};
+
+        std::size_t GetSize() const {return fSize;}
+        bool CheckSize(std::size_t size) const {return fSize == size;}
+
+        XValueType Get(std::size_t i) const {return fData[i];}
+        typename packet::type GetPacket(std::size_t i) const {return packet::Load(fData + i);}
+
+    private:
+        const XValueType* fData;
+        std::size_t fSize;
+};
+
+//leaf node, a strided one dimensional view (evaluated element by element)
+template< typename XValueType >
+class HArrayStridedTerminal: public HArrayExpression< HArrayStridedTerminal< XValueType > >
+{
+    public:
+        typedef XValueType value_type;
+        typedef HArrayPacket< XValueType > packet;
+        static const bool is_vectorizable = false;
+
+        HArrayStridedTerminal(const XValueType* data, std::size_t size, std::size_t stride):fData(data),fSize(size),fStride(stride){};
+
+        std::size_t GetSize() const {return fSize;}
+        bool CheckSize(std::size_t size) const {return fSize == size;}
+
+        XValueType Get(std::size_t i) const {return fData[i*fStride];}
+
+    private:
+        const XValueType* fData;
+        std::size_t fSize;
+        std::size_t fStride;
+};
+
+//leaf node, a single value broadcast to every index
+template< typename XValueType >
+class HArrayScalar: public HArrayExpression< HArrayScalar< XValueType > >
+{
+    public:
+        typedef XValueType value_type;
+        typedef HArrayPacket< XValueType > packet;
+        static const bool is_vectorizable = packet::is_simd;
+
+        HArrayScalar(const XValueType& value):fValue(value){};
+
+        std::size_t GetSize() const {return 0;} //compatible with any size
+        bool CheckSize(std::size_t) const {return true;}
+
+        XValueType Get(std::size_t) const {return fValue;}
+        typename packet::type GetPacket(std::size_t) const {return packet::Set1(fValue);}
+
+    private:
+        XValueType fValue;
+};
+
+template< typename XLeft, typename XRight, typename XOperation >
+class HArrayBinaryExpression: public HArrayExpression< HArrayBinaryExpression< XLeft, XRight, XOperation > >
+{
+    public:
+        typedef typename std::common_type< typename XLeft::value_type, typename XRight::value_type >::type value_type;
+        typedef HArrayPacket< value_type > packet;
+        static const bool is_vectorizable = XLeft::is_vectorizable && XRight::is_vectorizable && XOperation::is_vectorizable &&
+                                            std::is_same< typename XLeft::value_type, typename XRight::value_type >::value;
+
+        HArrayBinaryExpression(const XLeft& left, const XRight& right):fLeft(left),fRight(right){};
+
+        std::size_t GetSize() const {return (fLeft.GetSize() != 0) ? fLeft.GetSize() : fRight.GetSize();}
+        bool CheckSize(std::size_t size) const {return fLeft.CheckSize(size) && fRight.CheckSize(size);}
+
+        value_type Get(std::size_t i) const
+        {
+            return XOperation::Apply( static_cast<value_type>( fLeft.Get(i) ), static_cast<value_type>( fRight.Get(i) ) );
+        }
+
+        typename packet::type GetPacket(std::size_t i) const
+        {
+            return XOperation::template ApplyPacket< value_type >( fLeft.GetPacket(i), fRight.GetPacket(i) );
+        }
+
+    private:
+        XLeft fLeft;
+        XRight fRight;
+};
+
+template< typename XArgument, typename XOperation >
+class HArrayUnaryExpression: public HArrayExpression< HArrayUnaryExpression< XArgument, XOperation > >
+{
+    public:
+        typedef typename XArgument::value_type value_type;
+        typedef HArrayPacket< value_type > packet;
+        static const bool is_vectorizable = XArgument::is_vectorizable && XOperation::is_vectorizable;
+
+        HArrayUnaryExpression(const XArgument& arg):fArgument(arg){};
+
+        std::size_t GetSize() const {return fArgument.GetSize();}
+        bool CheckSize(std::size_t size) const {return fArgument.CheckSize(size);}
+
+        value_type Get(std::size_t i) const {return XOperation::Apply( fArgument.Get(i) );}
+
+        typename packet::type GetPacket(std::size_t i) const
+        {
+            return XOperation::template ApplyPacket< value_type >( fArgument.GetPacket(i) );
+        }
+
+    private:
+        XArgument fArgument;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//element-wise operations (Apply on single elements, ApplyPacket on SIMD registers)
+
+#define HARRAY_BINARY_OPERATION(NAME, SCALAR_EXPR, PACKET_FUNC) \
+struct NAME \
+{ \
+    static const bool is_vectorizable = true; \
+    template< typename T > static T Apply(const T& a, const T& b){return SCALAR_EXPR;} \
+    template< typename T > static typename HArrayPacket<T>::type \
+    ApplyPacket(const typename HArrayPacket<T>::type& a, const typename HArrayPacket<T>::type& b){return HArrayPacket<T>::PACKET_FUNC(a,b);} \
+};
+
+HARRAY_BINARY_OPERATION(HArrayAddOperation, a + b, Add)
+HARRAY_BINARY_OPERATION(HArraySubtractOperation, a - b, Subtract)
+HARRAY_BINARY_OPERATION(HArrayMultiplyOperation, a*b, Multiply)
+HARRAY_BINARY_OPERATION(HArrayDivideOperation, a/b, Divide)
+HARRAY_BINARY_OPERATION(HArrayMinimumOperation, (b < a) ? b : a, Minimum)
+HARRAY_BINARY_OPERATION(HArrayMaximumOperation, (a < b) ? b : a, Maximum)
+
+#undef HARRAY_BINARY_OPERATION
+
+struct HArrayNegateOperation
+{
+    static const bool is_vectorizable = true;
+    template< typename T > static T Apply(const T& a){return -a;}
+    template< typename T > static typename HArrayPacket<T>::type ApplyPacket(const typename HArrayPacket<T>::type& a)
+    {
+        return HArrayPacket<T>::Subtract( HArrayPacket<T>::Set1( T(0) ), a);
+    }
+};
+
+struct HArraySquareOperation
+{
+    static const bool is_vectorizable = true;
+    template< typename T > static T Apply(const T& a){return a*a;}
+    template< typename T > static typename HArrayPacket<T>::type ApplyPacket(const typename HArrayPacket<T>::type& a)
+    {
+        return HArrayPacket<T>::Multiply(a, a);
+    }
+};
+
+struct HArraySqrtOperation
+{
+    static const bool is_vectorizable = true;
+    template< typename T > static T Apply(const T& a){return std::sqrt(a);}
+    template< typename T > static typename HArrayPacket<T>::type ApplyPacket(const typename HArrayPacket<T>::type& a)
+    {
+        return HArrayPacket<T>::Sqrt(a);
+    }
+};
+
+struct HArrayAbsOperation
+{
+    static const bool is_vectorizable = true;
+    template< typename T > static T Apply(const T& a){return std::abs(a);}
+    template< typename T > static typename HArrayPacket<T>::type ApplyPacket(const typename HArrayPacket<T>::type& a)
+    {
+        return HArrayPacket<T>::Abs(a);
+    }
+};
+
+//transcendental functions have no SIMD form here, expressions containing them are evaluated element by element
+struct HArrayExpOperation
+{
+    static const bool is_vectorizable = false;
+    template< typename T > static T Apply(const T& a){return std::exp(a);}
+};
+
+struct HArrayLogOperation
+{
+    static const bool is_vectorizable = false;
+    template< typename T > static T Apply(const T& a){return std::log(a);}
+};
+
+struct HArrayLog10Operation
+{
+    static const bool is_vectorizable = false;
+    template< typename T > static T Apply(const T& a){return std::log10(a);}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//operands, anything which converts to an expression node (arrays and nodes themselves)
+
+template< typename XValueType, std::size_t NDIM >
+HArrayTerminal< XValueType > HArrayOperand(const HArrayWrapper< XValueType, NDIM >& arr)
+{
+    return HArrayTerminal< XValueType >(arr.GetData(), arr.GetArraySize());
+}
+
+template< typename XValueType >
+HArrayStridedTerminal< typename std::remove_const< XValueType >::type > HArrayOperand(const HArrayView< XValueType, 1 >& view)
+{
+    return HArrayStridedTerminal< typename std::remove_const< XValueType >::type >(view.GetData(), view.GetArraySize(), view.GetStride(0) );
+}
+
+template< typename XDerived >
+XDerived HArrayOperand(const HArrayExpression< XDerived >& expr)
+{
+    return expr.Derived();
+}
+
+//a raw array of elements, for use in an expression
+template< typename XValueType >
+HArrayTerminal< XValueType > HArrayRef(const XValueType* data, std::size_t size)
+{
+    return HArrayTerminal< XValueType >(data, size);
+}
+
+template< typename T > struct HArrayVoid { typedef void type; };
+
+template< typename X, typename XEnable = void >
+struct HArrayIsOperand: std::false_type {};
+
+template< typename X >
+struct HArrayIsOperand< X, typename HArrayVoid< decltype( HArrayOperand( std::declval<const X&>() ) ) >::type >: std::true_type
+{
+    typedef decltype( HArrayOperand( std::declval<const X&>() ) ) type;
+};
+
+//result of combining two operands, or an operand and an arithmetic scalar (which takes the operand's element type),
+//there is no 'type' for any other combination, so the operators below do not take part in overload resolution
+template< typename XLeft, typename XRight, typename XOperation,
+          int XKind = HArrayIsOperand<XLeft>::value ? ( HArrayIsOperand<XRight>::value ? 3 : (std::is_arithmetic<XRight>::value ? 1 : 0) )
+                                                    : ( (HArrayIsOperand<XRight>::value && std::is_arithmetic<XLeft>::value) ? 2 : 0) >
+struct HArrayBinaryResult {};
+
+template< typename XLeft, typename XRight, typename XOperation >
+struct HArrayBinaryResult< XLeft, XRight, XOperation, 1 >
+{
+    typedef typename HArrayIsOperand<XLeft>::type left_type;
+    typedef HArrayScalar< typename left_type::value_type > right_type;
+    typedef HArrayBinaryExpression< left_type, right_type, XOperation > type;
+    static type Make(const XLeft& l, const XRight& r){return type( HArrayOperand(l), right_type(r) );}
+};
+
+template< typename XLeft, typename XRight, typename XOperation >
+struct HArrayBinaryResult< XLeft, XRight, XOperation, 2 >
+{
+    typedef typename HArrayIsOperand<XRight>::type right_type;
+    typedef HArrayScalar< typename right_type::value_type > left_type;
+    typedef HArrayBinaryExpression< left_type, right_type, XOperation > type;
+    static type Make(const XLeft& l, const XRight& r){return type( left_type(l), HArrayOperand(r) );}
+};
+
+template< typename XLeft, typename XRight, typename XOperation >
+struct HArrayBinaryResult< XLeft, XRight, XOperation, 3 >
+{
+    typedef typename HArrayIsOperand<XLeft>::type left_type;
+    typedef typename HArrayIsOperand<XRight>::type right_type;
+    typedef HArrayBinaryExpression< left_type, right_type, XOperation > type;
+    static type Make(const XLeft& l, const XRight& r){return type( HArrayOperand(l), HArrayOperand(r) );}
+};
+
+template< typename XArgument, typename XOperation, bool XIsOperand = HArrayIsOperand<XArgument>::value >
+struct HArrayUnaryResult {};
+
+template< typename XArgument, typename XOperation >
+struct HArrayUnaryResult< XArgument, XOperation, true >
+{
+    typedef HArrayUnaryExpression< typename HArrayIsOperand<XArgument>::type, XOperation > type;
+    static type Make(const XArgument& a){return type( HArrayOperand(a) );}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//operators and functions
+
+#define HARRAY_BINARY_FUNCTION(FUNC, OPERATION) \
+template< typename XLeft, typename XRight > \
+typename HArrayBinaryResult< XLeft, XRight, OPERATION >::type FUNC(const XLeft& l, const XRight& r) \
+{ \
+    return HArrayBinaryResult< XLeft, XRight, OPERATION >::Make(l, r); \
+}
+
+HARRAY_BINARY_FUNCTION(operator+, HArrayAddOperation)
+HARRAY_BINARY_FUNCTION(operator-, HArraySubtractOperation)
+HARRAY_BINARY_FUNCTION(operator*, HArrayMultiplyOperation)
+HARRAY_BINARY_FUNCTION(operator/, HArrayDivideOperation)
+HARRAY_BINARY_FUNCTION(Min, HArrayMinimumOperation)
+HARRAY_BINARY_FUNCTION(Max, HArrayMaximumOperation)
+
+#undef HARRAY_BINARY_FUNCTION
+
+#define HARRAY_UNARY_FUNCTION(FUNC, OPERATION) \
+template< typename XArgument > \
+typename HArrayUnaryResult< XArgument, OPERATION >::type FUNC(const XArgument& a) \
+{ \
+    return HArrayUnaryResult< XArgument, OPERATION >::Make(a); \
+}
+
+HARRAY_UNARY_FUNCTION(operator-, HArrayNegateOperation)
+HARRAY_UNARY_FUNCTION(Square, HArraySquareOperation)
+HARRAY_UNARY_FUNCTION(Sqrt, HArraySqrtOperation)
+HARRAY_UNARY_FUNCTION(Abs, HArrayAbsOperation)
+HARRAY_UNARY_FUNCTION(Exp, HArrayExpOperation)
+HARRAY_UNARY_FUNCTION(Log, HArrayLogOperation)
+HARRAY_UNARY_FUNCTION(Log10, HArrayLog10Operation)
+
+#undef HARRAY_UNARY_FUNCTION
+
+}//end of namespace
+
+#endif /* HArrayExpression_H__ */
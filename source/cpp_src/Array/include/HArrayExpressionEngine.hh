@@ -0,0 +1,301 @@
+#ifndef HArrayExpressionEngine_HH__
+#define HArrayExpressionEngine_HH__
+
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "HArrayExpression.hh"
+
+namespace hose{
+
+/**
+*
+*@file HArrayExpressionEngine.hh
+*@class HArrayExpressionEngine
+*@brief evaluates array expressions (see HArrayExpression.hh) into an output array, or reduces them to a value
+*@details each function makes a single pass over its inputs, with SIMD registers when the whole expression allows it.
+* The overloads taking an executor split the work into chunks of at least min_elements_per_task elements and run
+* them through its ParallelFor(n, task) (e.g. the HTaskScheduler, passed as HTaskScheduler::GetInstance()), small
+* arrays are done by the calling thread. Element-wise assignment may alias its inputs (e.g. Assign(a, a*2.0)).
+*
+*   HArrayExpressionEngine::Assign(ave, sum/n_spectra);
+*   double total = HArrayExpressionEngine::Sum(Square(x - mean), HTaskScheduler::GetInstance());
+*   HArrayExpressionEngine::Rebin(coarse, (on - off)/off, 16);
+*
+*/
+
+class HArrayExpressionEngine
+{
+    public:
+
+        static const std::size_t DefaultMinElementsPerTask = 65536;
+
+        ////////////////////////////////////////////////////////////////////////
+        //out[i] = expr[i], expr must have the same number of elements as out
+
+        template< typename XValueType, std::size_t NDIM, typename XExpression >
+        static void Assign(HArrayWrapper< XValueType, NDIM >& out, const XExpression& expr)
+        {
+            Assign(out.GetData(), out.GetArraySize(), expr);
+        }
+
+        //strided output
+        template< typename XValueType, typename XExpression >
+        static void Assign(const HArrayView< XValueType, 1 >& out, const XExpression& expr)
+        {
+            if(out.GetStride(0) == 1){Assign(out.GetData(), out.GetArraySize(), expr); return;}
+
+            typedef typename HArrayIsOperand< XExpression >::type node_type;
+            node_type node = HArrayOperand(expr);
+            std::size_t size = out.GetArraySize();
+            if( !node.CheckSize(size) )
+            {
+                std::cout<<"HArrayExpressionEngine::Assign: Error, expression size does not match the output size: "<<size<<std::endl;
+                return;
+            }
+            std::size_t stride = out.GetStride(0);
+            XValueType* data = out.GetData();
+            for(std::size_t i=0; i<size; i++){data[i*stride] = static_cast<XValueType>( node.Get(i) );}
+        }
+
+        template< typename XValueType, typename XExpression >
+        static void Assign(XValueType* out, std::size_t size, const XExpression& expr)
+        {
+            Assign(out, size, expr, static_cast<HSerialExecutor*>(nullptr), 0);
+        }
+
+        template< typename XValueType, std::size_t NDIM, typename XExpression, typename XExecutor >
+        static void Assign(HArrayWrapper< XValueType, NDIM >& out, const XExpression& expr, XExecutor* executor,
+                           std::size_t min_elements_per_task = DefaultMinElementsPerTask)
+        {
+            Assign(out.GetData(), out.GetArraySize(), expr, executor, min_elements_per_task);
+        }
+
+        template< typename XValueType, typename XExpression, typename XExecutor >
+        static void Assign(XValueType* out, std::size_t size, const XExpression& expr, XExecutor* executor,
+                           std::size_t min_elements_per_task = DefaultMinElementsPerTask)
+        {
+            typedef typename HArrayIsOperand< XExpression >::type node_type;
+            node_type node = HArrayOperand(expr);
+            if( !node.CheckSize(size) )
+            {
+                std::cout<<"HArrayExpressionEngine::Assign: Error, expression size does not match the output size: "<<size<<std::endl;
+                return;
+            }
+
+            typedef std::integral_constant< bool, node_type::is_vectorizable &&
+                                                  std::is_same< XValueType, typename node_type::value_type >::value > vectorize;
+            std::size_t chunk = ChunkSize(size, HArrayPacket< XValueType >::width, executor, min_elements_per_task);
+            if(chunk >= size)
+            {
+                AssignRange(out, node, 0, size, vectorize());
+                return;
+            }
+            executor->ParallelFor( (size + chunk - 1)/chunk, [&](std::size_t c)
+            {
+                AssignRange(out, node, c*chunk, std::min(size, (c+1)*chunk), vectorize());
+            });
+        }
+
+        ////////////////////////////////////////////////////////////////////////
+        //reductions over all of the elements of an expression
+
+        template< typename XExpression >
+        static typename HArrayIsOperand< XExpression >::type::value_type Sum(const XExpression& expr)
+        {
+            return Sum(expr, static_cast<HSerialExecutor*>(nullptr), 0);
+        }
+
+        template< typename XExpression, typename XExecutor >
+        static typename HArrayIsOperand< XExpression >::type::value_type
+        Sum(const XExpression& expr, XExecutor* executor, std::size_t min_elements_per_task = DefaultMinElementsPerTask)
+        {
+            return Reduce< HArrayAddOperation >(expr, executor, min_elements_per_task);
+        }
+
+        template< typename XExpression >
+        static typename HArrayIsOperand< XExpression >::type::value_type Minimum(const XExpression& expr)
+        {
+            return Minimum(expr, static_cast<HSerialExecutor*>(nullptr), 0);
+        }
+
+        template< typename XExpression, typename XExecutor >
+        static typename HArrayIsOperand< XExpression >::type::value_type
+        Minimum(const XExpression& expr, XExecutor* executor, std::size_t min_elements_per_task = DefaultMinElementsPerTask)
+        {
+            return Reduce< HArrayMinimumOperation >(expr, executor, min_elements_per_task);
+        }
+
+        template< typename XExpression >
+        static typename HArrayIsOperand< XExpression >::type::value_type Maximum(const XExpression& expr)
+        {
+            return Maximum(expr, static_cast<HSerialExecutor*>(nullptr), 0);
+        }
+
+        template< typename XExpression, typename XExecutor >
+        static typename HArrayIsOperand< XExpression >::type::value_type
+        Maximum(const XExpression& expr, XExecutor* executor, std::size_t min_elements_per_task = DefaultMinElementsPerTask)
+        {
+            return Reduce< HArrayMaximumOperation >(expr, executor, min_elements_per_task);
+        }
+
+        ////////////////////////////////////////////////////////////////////////
+        //out[j] = sum of expr[j*factor] to expr[(j+1)*factor - 1], divided by factor if average is true,
+        //out must have space for (the number of elements in expr)/factor values, any remainder is dropped
+
+        template< typename XValueType, std::size_t NDIM, typename XExpression >
+        static void Rebin(HArrayWrapper< XValueType, NDIM >& out, const XExpression& expr, std::size_t factor, bool average = true)
+        {
+            Rebin(out.GetData(), out.GetArraySize(), expr, factor, average, static_cast<HSerialExecutor*>(nullptr), 0);
+        }
+
+        template< typename XValueType, typename XExpression >
+        static void Rebin(XValueType* out, std::size_t size, const XExpression& expr, std::size_t factor, bool average = true)
+        {
+            Rebin(out, size, expr, factor, average, static_cast<HSerialExecutor*>(nullptr), 0);
+        }
+
+        template< typename XValueType, typename XExpression, typename XExecutor >
+        static void Rebin(XValueType* out, std::size_t size, const XExpression& expr, std::size_t factor, bool average,
+                          XExecutor* executor, std::size_t min_elements_per_task = DefaultMinElementsPerTask)
+        {
+            typedef typename HArrayIsOperand< XExpression >::type node_type;
+            typedef typename node_type::value_type value_type;
+            node_type node = HArrayOperand(expr);
+            std::size_t n_in = node.GetSize();
+            if(factor == 0 || !node.CheckSize(n_in) || size < n_in/factor)
+            {
+                std::cout<<"HArrayExpressionEngine::Rebin: Error, cannot rebin "<<n_in<<" elements by a factor of "<<factor
+                         <<" into an array of size "<<size<<std::endl;
+                return;
+            }
+
+            std::size_t n_out = n_in/factor;
+            value_type norm = average ? static_cast<value_type>( 1.0/(double)factor ) : static_cast<value_type>(1);
+            std::size_t chunk = ChunkSize(n_out, 1, executor, (min_elements_per_task + factor - 1)/factor);
+            auto task = [&](std::size_t c)
+            {
+                std::size_t stop = std::min(n_out, (c+1)*chunk);
+                for(std::size_t j=c*chunk; j<stop; j++)
+                {
+                    out[j] = static_cast<XValueType>( norm*ReduceRange< HArrayAddOperation >(node, j*factor, (j+1)*factor, Vectorize<node_type>() ) );
+                }
+            };
+            if(chunk >= n_out){task(0); return;}
+            executor->ParallelFor( (n_out + chunk - 1)/chunk, task);
+        }
+
+    private:
+
+        //stands in for an executor when there is only the calling thread
+        struct HSerialExecutor
+        {
+            template< typename XTask > void ParallelFor(std::size_t n, const XTask& task){for(std::size_t i=0; i<n; i++){task(i);} }
+        };
+
+        template< typename XNode >
+        struct Vectorize: std::integral_constant< bool, XNode::is_vectorizable > {};
+
+        //elements per task, a multiple of the SIMD width, or the whole array if it is not worth splitting
+        template< typename XExecutor >
+        static std::size_t ChunkSize(std::size_t size, std::size_t width, XExecutor* executor, std::size_t min_elements_per_task)
+        {
+            if(executor == nullptr || min_elements_per_task == 0 || size < 2*min_elements_per_task){return size;}
+            return ( (min_elements_per_task + width - 1)/width )*width;
+        }
+
+        template< typename XValueType, typename XNode >
+        static void AssignRange(XValueType* out, const XNode& node, std::size_t begin, std::size_t end, std::true_type)
+        {
+            typedef typename XNode::packet packet;
+            std::size_t stop = begin + ( (end - begin)/packet::width )*packet::width;
+            for(std::size_t i=begin; i<stop; i += packet::width){packet::Store(out + i, node.GetPacket(i) );}
+            for(std::size_t i=stop; i<end; i++){out[i] = node.Get(i);}
+        }
+
+        template< typename XValueType, typename XNode >
+        static void AssignRange(XValueType* out, const XNode& node, std::size_t begin, std::size_t end, std::false_type)
+        {
+            for(std::size_t i=begin; i<end; i++){out[i] = static_cast<XValueType>( node.Get(i) );}
+        }
+
+        template< typename XOperation, typename XNode >
+        static typename XNode::value_type ReduceRange(const XNode& node, std::size_t begin, std::size_t end, std::true_type)
+        {
+            typedef typename XNode::packet packet;
+            typedef typename XNode::value_type value_type;
+            if(end - begin < 2*packet::width){return ReduceRange< XOperation >(node, begin, end, std::false_type() );}
+
+            //two independent accumulators, to hide the latency of the operation
+            typename packet::type acc0 = node.GetPacket(begin);
+            typename packet::type acc1 = node.GetPacket(begin + packet::width);
+            std::size_t i = begin + 2*packet::width;
+            for(; i + 2*packet::width <= end; i += 2*packet::width)
+            {
+                acc0 = XOperation::template ApplyPacket< value_type >(acc0, node.GetPacket(i) );
+                acc1 = XOperation::template ApplyPacket< value_type >(acc1, node.GetPacket(i + packet::width) );
+            }
+            value_type result = Horizontal< XOperation, packet >( XOperation::template ApplyPacket< value_type >(acc0, acc1) );
+            for(; i<end; i++){result = XOperation::Apply(result, node.Get(i) );}
+            return result;
+        }
+
+        template< typename XOperation, typename XNode >
+        static typename XNode::value_type ReduceRange(const XNode& node, std::size_t begin, std::size_t end, std::false_type)
+        {
+            typedef typename XNode::value_type value_type;
+            if(end <= begin){return Identity< XOperation, value_type >();}
+            value_type result = node.Get(begin);
+            for(std::size_t i=begin+1; i<end; i++){result = XOperation::Apply(result, node.Get(i) );}
+            return result;
+        }
+
+        template< typename XOperation, typename XExpression, typename XExecutor >
+        static typename HArrayIsOperand< XExpression >::type::value_type
+        Reduce(const XExpression& expr, XExecutor* executor, std::size_t min_elements_per_task)
+        {
+            typedef typename HArrayIsOperand< XExpression >::type node_type;
+            typedef typename node_type::value_type value_type;
+            node_type node = HArrayOperand(expr);
+            std::size_t size = node.GetSize();
+
+            std::size_t chunk = ChunkSize(size, node_type::packet::width, executor, min_elements_per_task);
+            if(chunk >= size){return ReduceRange< XOperation >(node, 0, size, Vectorize<node_type>() );}
+
+            //partial results for each chunk, combined in order (so the result does not depend on the thread count)
+            std::size_t n_chunks = (size + chunk - 1)/chunk;
+            std::vector< value_type > partial(n_chunks);
+            executor->ParallelFor(n_chunks, [&](std::size_t c)
+            {
+                partial[c] = ReduceRange< XOperation >(node, c*chunk, std::min(size, (c+1)*chunk), Vectorize<node_type>() );
+            });
+            value_type result = partial[0];
+            for(std::size_t c=1; c<n_chunks; c++){result = XOperation::Apply(result, partial[c]);}
+            return result;
+        }
+
+        //value of an empty reduction
+        template< typename XOperation, typename XValueType >
+        static XValueType Identity()
+        {
+            if(std::is_same< XOperation, HArrayMinimumOperation >::value){return std::numeric_limits< XValueType >::max();}
+            if(std::is_same< XOperation, HArrayMaximumOperation >::value){return std::numeric_limits< XValueType >::lowest();}
+            return XValueType(0);
+        }
+
+        //combines the lanes of a SIMD register
+        template< typename XOperation, typename XPacket >
+        static auto Horizontal(const typename XPacket::type& a) -> decltype( XPacket::HorizontalSum(a) )
+        {
+            if(std::is_same< XOperation, HArrayMinimumOperation >::value){return XPacket::HorizontalMinimum(a);}
+            if(std::is_same< XOperation, HArrayMaximumOperation >::value){return XPacket::HorizontalMaximum(a);}
+            return XPacket::HorizontalSum(a);
+        }
+};
+
+}//end of namespace
+
+#endif /* HArrayExpressionEngine_H__ */
@@ -0,0 +1,212 @@
+#ifndef HArrayPacket_HH__
+#define HArrayPacket_HH__
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+#if defined(__AVX__) || defined(__AVX512F__)
+    #include <immintrin.h>
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+namespace hose{
+
+/**
+*
+*@file HArrayPacket.hh
+*@class HArrayPacket
+*@brief the SIMD register type and operations used to evaluate array expressions on a given element type
+*@details the widest of AVX-512F, AVX or SSE2 which the compiler targets is used for float and double, other
+* element types (and builds without SIMD) get a 'packet' of a single element with the plain scalar operations,
+* so expressions can be written once against this interface
+*
+*/
+
+template< typename XValueType >
+struct HArrayPacket
+{
+    static const bool is_simd = false;
+    static const std::size_t width = 1;
+    typedef XValueType type;
+
+    static type Load(const XValueType* ptr){return *ptr;}
+    static void Store(XValueType* ptr, const type& a){*ptr = a;}
+    static type Set1(const XValueType& a){return a;}
+
+    static type Add(const type& a, const type& b){return a + b;}
+    static type Subtract(const type& a, const type& b){return a - b;}
+    static type Multiply(const type& a, const type& b){return a*b;}
+    static type Divide(const type& a, const type& b){return a/b;}
+    static type Minimum(const type& a, const type& b){return std::min(a,b);}
+    static type Maximum(const type& a, const type& b){return std::max(a,b);}
+    static type Sqrt(const type& a){return std::sqrt(a);}
+    static type Abs(const type& a){return std::abs(a);}
+
+    static XValueType HorizontalSum(const type& a){return a;}
+    static XValueType HorizontalMinimum(const type& a){return a;}
+    static XValueType HorizontalMaximum(const type& a){return a;}
+};
+
+#if defined(__AVX512F__)
+
+template<>
+struct HArrayPacket< float >
+{
+    static const bool is_simd = true;
+    static const std::size_t width = 16;
+    typedef __m512 type;
+
+    static type Load(const float* ptr){return _mm512_loadu_ps(ptr);}
+    static void Store(float* ptr, const type& a){_mm512_storeu_ps(ptr, a);}
+    static type Set1(float a){return _mm512_set1_ps(a);}
+
+    static type Add(const type& a, const type& b){return _mm512_add_ps(a,b);}
+    static type Subtract(const type& a, const type& b){return _mm512_sub_ps(a,b);}
+    static type Multiply(const type& a, const type& b){return _mm512_mul_ps(a,b);}
+    static type Divide(const type& a, const type& b){return _mm512_div_ps(a,b);}
+    static type Minimum(const type& a, const type& b){return _mm512_min_ps(a,b);}
+    static type Maximum(const type& a, const type& b){return _mm512_max_ps(a,b);}
+    static type Sqrt(const type& a){return _mm512_sqrt_ps(a);}
+    static type Abs(const type& a){return _mm512_abs_ps(a);}
+
+    static float HorizontalSum(const type& a){return _mm512_reduce_add_ps(a);}
+    static float HorizontalMinimum(const type& a){return _mm512_reduce_min_ps(a);}
+    static float HorizontalMaximum(const type& a){return _mm512_reduce_max_ps(a);}
+};
+
+template<>
+struct HArrayPacket< double >
+{
+    static const bool is_simd = true;
+    static const std::size_t width = 8;
+    typedef __m512d type;
+
+    static type Load(const double* ptr){return _mm512_loadu_pd(ptr);}
+    static void Store(double* ptr, const type& a){_mm512_storeu_pd(ptr, a);}
+    static type Set1(double a){return _mm512_set1_pd(a);}
+
+    static type Add(const type& a, const type& b){return _mm512_add_pd(a,b);}
+    static type Subtract(const type& a, const type& b){return _mm512_sub_pd(a,b);}
+    static type Multiply(const type& a, const type& b){return _mm512_mul_pd(a,b);}
+    static type Divide(const type& a, const type& b){return _mm512_div_pd(a,b);}
+    static type Minimum(const type& a, const type& b){return _mm512_min_pd(a,b);}
+    static type Maximum(const type& a, const type& b){return _mm512_max_pd(a,b);}
+    static type Sqrt(const type& a){return _mm512_sqrt_pd(a);}
+    static type Abs(const type& a){return _mm512_abs_pd(a);}
+
+    static double HorizontalSum(const type& a){return _mm512_reduce_add_pd(a);}
+    static double HorizontalMinimum(const type& a){return _mm512_reduce_min_pd(a);}
+    static double HorizontalMaximum(const type& a){return _mm512_reduce_max_pd(a);}
+};
+
+#elif defined(__AVX__)
+
+template<>
+struct HArrayPacket< float >
+{
+    static const bool is_simd = true;
+    static const std::size_t width = 8;
+    typedef __m256 type;
+
+    static type Load(const float* ptr){return _mm256_loadu_ps(ptr);}
+    static void Store(float* ptr, const type& a){_mm256_storeu_ps(ptr, a);}
+    static type Set1(float a){return _mm256_set1_ps(a);}
+
+    static type Add(const type& a, const type& b){return _mm256_add_ps(a,b);}
+    static type Subtract(const type& a, const type& b){return _mm256_sub_ps(a,b);}
+    static type Multiply(const type& a, const type& b){return _mm256_mul_ps(a,b);}
+    static type Divide(const type& a, const type& b){return _mm256_div_ps(a,b);}
+    static type Minimum(const type& a, const type& b){return _mm256_min_ps(a,b);}
+    static type Maximum(const type& a, const type& b){return _mm256_max_ps(a,b);}
+    static type Sqrt(const type& a){return _mm256_sqrt_ps(a);}
+    static type Abs(const type& a){return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a);}
+
+    static float HorizontalSum(const type& a){float v[8]; _mm256_storeu_ps(v, a); return ( (v[0] + v[4]) + (v[1] + v[5]) ) + ( (v[2] + v[6]) + (v[3] + v[7]) );}
+    static float HorizontalMinimum(const type& a){float v[8]; _mm256_storeu_ps(v, a); return *std::min_element(v, v+8);}
+    static float HorizontalMaximum(const type& a){float v[8]; _mm256_storeu_ps(v, a); return *std::max_element(v, v+8);}
+};
+
+template<>
+struct HArrayPacket< double >
+{
+    static const bool is_simd = true;
+    static const std::size_t width = 4;
+    typedef __m256d type;
+
+    static type Load(const double* ptr){return _mm256_loadu_pd(ptr);}
+    static void Store(double* ptr, const type& a){_mm256_storeu_pd(ptr, a);}
+    static type Set1(double a){return _mm256_set1_pd(a);}
+
+    static type Add(const type& a, const type& b){return _mm256_add_pd(a,b);}
+    static type Subtract(const type& a, const type& b){return _mm256_sub_pd(a,b);}
+    static type Multiply(const type& a, const type& b){return _mm256_mul_pd(a,b);}
+    static type Divide(const type& a, const type& b){return _mm256_div_pd(a,b);}
+    static type Minimum(const type& a, const type& b){return _mm256_min_pd(a,b);}
+    static type Maximum(const type& a, const type& b){return _mm256_max_pd(a,b);}
+    static type Sqrt(const type& a){return _mm256_sqrt_pd(a);}
+    static type Abs(const type& a){return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a);}
+
+    static double HorizontalSum(const type& a){double v[4]; _mm256_storeu_pd(v, a); return (v[0] + v[2]) + (v[1] + v[3]);}
+    static double HorizontalMinimum(const type& a){double v[4]; _mm256_storeu_pd(v, a); return *std::min_element(v, v+4);}
+    static double HorizontalMaximum(const type& a){double v[4]; _mm256_storeu_pd(v, a); return *std::max_element(v, v+4);}
+};
+
+#elif defined(__SSE2__)
+
+template<>
+struct HArrayPacket< float >
+{
+    static const bool is_simd = true;
+    static const std::size_t width = 4;
+    typedef __m128 type;
+
+    static type Load(const float* ptr){return _mm_loadu_ps(ptr);}
+    static void Store(float* ptr, const type& a){_mm_storeu_ps(ptr, a);}
+    static type Set1(float a){return _mm_set1_ps(a);}
+
+    static type Add(const type& a, const type& b){return _mm_add_ps(a,b);}
+    static type Subtract(const type& a, const type& b){return _mm_sub_ps(a,b);}
+    static type Multiply(const type& a, const type& b){return _mm_mul_ps(a,b);}
+    static type Divide(const type& a, const type& b){return _mm_div_ps(a,b);}
+    static type Minimum(const type& a, const type& b){return _mm_min_ps(a,b);}
+    static type Maximum(const type& a, const type& b){return _mm_max_ps(a,b);}
+    static type Sqrt(const type& a){return _mm_sqrt_ps(a);}
+    static type Abs(const type& a){return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);}
+
+    static float HorizontalSum(const type& a){float v[4]; _mm_storeu_ps(v, a); return (v[0] + v[2]) + (v[1] + v[3]);}
+    static float HorizontalMinimum(const type& a){float v[4]; _mm_storeu_ps(v, a); return *std::min_element(v, v+4);}
+    static float HorizontalMaximum(const type& a){float v[4]; _mm_storeu_ps(v, a); return *std::max_element(v, v+4);}
+};
+
+template<>
+struct HArrayPacket< double >
+{
+    static const bool is_simd = true;
+    static const std::size_t width = 2;
+    typedef __m128d type;
+
+    static type Load(const double* ptr){return _mm_loadu_pd(ptr);}
+    static void Store(double* ptr, const type& a){_mm_storeu_pd(ptr, a);}
+    static type Set1(double a){return _mm_set1_pd(a);}
+
+    static type Add(const type& a, const type& b){return _mm_add_pd(a,b);}
+    static type Subtract(const type& a, const type& b){return _mm_sub_pd(a,b);}
+    static type Multiply(const type& a, const type& b){return _mm_mul_pd(a,b);}
+    static type Divide(const type& a, const type& b){return _mm_div_pd(a,b);}
+    static type Minimum(const type& a, const type& b){return _mm_min_pd(a,b);}
+    static type Maximum(const type& a, const type& b){return _mm_max_pd(a,b);}
+    static type Sqrt(const type& a){return _mm_sqrt_pd(a);}
+    static type Abs(const type& a){return _mm_andnot_pd(_mm_set1_pd(-0.0), a);}
+
+    static double HorizontalSum(const type& a){double v[2]; _mm_storeu_pd(v, a); return v[0] + v[1];}
+    static double HorizontalMinimum(const type& a){double v[2]; _mm_storeu_pd(v, a); return std::min(v[0], v[1]);}
+    static double HorizontalMaximum(const type& a){double v[2]; _mm_storeu_pd(v, a); return std::max(v[0], v[1]);}
+};
+
+#endif
+
+}//end of namespace
+
+#endif /* HArrayPacket_H__ */
@@ -0,0 +1,242 @@
+#ifndef HArrayView_HH__
+#define HArrayView_HH__
+
+#include <cstddef>
+#include <iostream>
+#include <utility>
+
+#include "HArrayWrapper.hh"
+
+namespace hose{
+
+/**
+*
+*@file HArrayView.hh
+*@class HArrayView
+*@brief non-owning, possibly strided, view of a multidimensional array
+*@details the rank is fixed at compile time, the dimensions and the stride (in elements) of each dimension are set
+* at run time, so sub-blocks, rows and columns (Slice), lower rank sections (Fix) and transposes of an array are
+* all views of the same data, and nothing is copied. A view of a whole HArrayWrapper has row major strides.
+* ForEach visits the elements in row major order of the view, with the innermost dimension as the inner loop,
+* (a plain loop over a pointer when that dimension is contiguous, which the compiler can vectorise).
+* Use HArrayView< const T, NDIM > for read-only access.
+*
+*/
+
+template< typename XValueType, std::size_t NDIM >
+class HArrayView
+{
+    public:
+
+        HArrayView():fData(nullptr)
+        {
+            for(std::size_t i=0; i<NDIM; i++)
+            {
+                fDimensions[i] = 0;
+                fStrides[i] = 0;
+            }
+        }
+
+        //contiguous row major array
+        HArrayView(XValueType* data, const std::size_t* dim):fData(data)
+        {
+            SetRowMajor(dim);
+        }
+
+        HArrayView(XValueType* data, const std::size_t* dim, const std::size_t* stride):fData(data)
+        {
+            for(std::size_t i=0; i<NDIM; i++)
+            {
+                fDimensions[i] = dim[i];
+                fStrides[i] = stride[i];
+            }
+        }
+
+        //the whole of an array
+        template< typename XOtherType >
+        HArrayView(HArrayWrapper< XOtherType, NDIM >& arr):fData(arr.GetData())
+        {
+            SetRowMajor( arr.GetArrayDimensions() );
+        }
+
+        template< typename XOtherType >
+        HArrayView(const HArrayWrapper< XOtherType, NDIM >& arr):fData(arr.GetData())
+        {
+            SetRowMajor( arr.GetArrayDimensions() );
+        }
+
+        //e.g. HArrayView< T, NDIM > to HArrayView< const T, NDIM >
+        template< typename XOtherType >
+        HArrayView(const HArrayView< XOtherType, NDIM >& view):fData(view.GetData())
+        {
+            for(std::size_t i=0; i<NDIM; i++)
+            {
+                fDimensions[i] = view.GetArrayDimension(i);
+                fStrides[i] = view.GetStride(i);
+            }
+        }
+
+        XValueType* GetData() const {return fData;};
+
+        const std::size_t* GetArrayDimensions() const {return fDimensions;};
+        std::size_t GetArrayDimension(std::size_t dim_index) const {return fDimensions[dim_index];};
+
+        const std::size_t* GetStrides() const {return fStrides;};
+        std::size_t GetStride(std::size_t dim_index) const {return fStrides[dim_index];};
+
+        std::size_t GetArraySize() const {return HArrayMath::TotalArraySize<NDIM>(fDimensions);};
+
+        //true if the elements are laid out as a row major array with no gaps
+        bool IsContiguous() const
+        {
+            std::size_t expected = 1;
+            for(std::size_t i=NDIM; i>0; i--)
+            {
+                if(fDimensions[i-1] != 1 && fStrides[i-1] != expected){return false;}
+                expected *= fDimensions[i-1];
+            }
+            return true;
+        }
+
+        std::size_t GetOffsetForIndices(const std::size_t* index) const
+        {
+            std::size_t offset = 0;
+            for(std::size_t i=0; i<NDIM; i++){offset += index[i]*fStrides[i];}
+            return offset;
+        }
+
+        XValueType& operator()(const std::size_t* index) const {return fData[ GetOffsetForIndices(index) ];};
+
+        //element at the given indices, e.g. view.At(i,j) for a 2D view
+        template< typename... XIndexTypes >
+        XValueType& At(XIndexTypes... index) const
+        {
+            static_assert(sizeof...(XIndexTypes) == NDIM, "HArrayView::At: number of indices must equal the rank");
+            const std::size_t idx[NDIM] = { static_cast<std::size_t>(index)... };
+            return fData[ GetOffsetForIndices(idx) ];
+        }
+
+        //elements begin, begin+step, ... (< end) of dimension d
+        HArrayView Slice(std::size_t d, std::size_t begin, std::size_t end, std::size_t step = 1) const
+        {
+            HArrayView view(*this);
+            if(d >= NDIM || step == 0 || begin > end || end > fDimensions[d])
+            {
+                std::cout<<"HArrayView::Slice: Error, invalid range ["<<begin<<", "<<end<<") with step "<<step<<" in dimension "<<d<<std::endl;
+                return HArrayView();
+            }
+            view.fData = fData + begin*fStrides[d];
+            view.fDimensions[d] = (end - begin + step - 1)/step;
+            view.fStrides[d] = fStrides[d]*step;
+            return view;
+        }
+
+        //section with dimension d held at a fixed index (e.g. row i of a 2D view is Fix(0,i), column j is Fix(1,j))
+        HArrayView< XValueType, (NDIM > 1) ? NDIM - 1 : 1 > Fix(std::size_t d, std::size_t index) const
+        {
+            static_assert(NDIM > 1, "HArrayView::Fix: a one dimensional view cannot be reduced in rank");
+            std::size_t dim[NDIM];
+            std::size_t stride[NDIM];
+            std::size_t count = 0;
+            for(std::size_t i=0; i<NDIM; i++)
+            {
+                if(i == d){continue;}
+                dim[count] = fDimensions[i];
+                stride[count] = fStrides[i];
+                count++;
+            }
+            return HArrayView< XValueType, (NDIM > 1) ? NDIM - 1 : 1 >(fData + index*fStrides[d], dim, stride);
+        }
+
+        //view with dimensions d1 and d2 exchanged
+        HArrayView Transpose(std::size_t d1, std::size_t d2) const
+        {
+            HArrayView view(*this);
+            std::swap(view.fDimensions[d1], view.fDimensions[d2]);
+            std::swap(view.fStrides[d1], view.fStrides[d2]);
+            return view;
+        }
+
+        //calls f(element) for every element
+        template< typename XFunction >
+        void ForEach(XFunction f) const
+        {
+            std::size_t n = fDimensions[NDIM-1];
+            std::size_t s = fStrides[NDIM-1];
+            std::size_t n_rows = (n == 0) ? 0 : GetArraySize()/n;
+            std::size_t index[NDIM];
+            for(std::size_t i=0; i<NDIM; i++){index[i] = 0;}
+            for(std::size_t r=0; r<n_rows; r++)
+            {
+                XValueType* row = fData + GetOffsetForIndices(index);
+                if(s == 1){for(std::size_t i=0; i<n; i++){f(row[i]);} }
+                else{for(std::size_t i=0; i<n; i++){f(row[i*s]);} }
+                NextRow(index, fDimensions);
+            }
+        }
+
+        //calls f(element, other_element) for every pair of corresponding elements, the dimensions must match
+        template< typename XOtherType, typename XFunction >
+        void ForEach(const HArrayView< XOtherType, NDIM >& other, XFunction f) const
+        {
+            for(std::size_t i=0; i<NDIM; i++)
+            {
+                if(fDimensions[i] != other.GetArrayDimension(i))
+                {
+                    std::cout<<"HArrayView::ForEach: Error, views have different dimensions."<<std::endl;
+                    return;
+                }
+            }
+
+            std::size_t n = fDimensions[NDIM-1];
+            std::size_t s = fStrides[NDIM-1];
+            std::size_t t = other.GetStride(NDIM-1);
+            std::size_t n_rows = (n == 0) ? 0 : GetArraySize()/n;
+            std::size_t index[NDIM];
+            for(std::size_t i=0; i<NDIM; i++){index[i] = 0;}
+            for(std::size_t r=0; r<n_rows; r++)
+            {
+                XValueType* row = fData + GetOffsetForIndices(index);
+                XOtherType* other_row = other.GetData() + other.GetOffsetForIndices(index);
+                if(s == 1 && t == 1){for(std::size_t i=0; i<n; i++){f(row[i], other_row[i]);} }
+                else{for(std::size_t i=0; i<n; i++){f(row[i*s], other_row[i*t]);} }
+                NextRow(index, fDimensions);
+            }
+        }
+
+        //copies the elements of another view (of the same dimensions) into this one
+        template< typename XOtherType >
+        void CopyFrom(const HArrayView< XOtherType, NDIM >& other) const
+        {
+            ForEach(other, [](XValueType& a, const XOtherType& b){a = b;});
+        }
+
+    private:
+
+        void SetRowMajor(const std::size_t* dim)
+        {
+            for(std::size_t i=0; i<NDIM; i++)
+            {
+                fDimensions[i] = dim[i];
+                fStrides[i] = HArrayMath::StrideFromRowMajorIndex<NDIM>(i, dim);
+            }
+        }
+
+        //advances the indices of all but the last dimension (odometer order)
+        static void NextRow(std::size_t* index, const std::size_t* dim)
+        {
+            for(std::size_t i=NDIM-1; i>0; i--)
+            {
+                if(++index[i-1] < dim[i-1]){return;}
+                index[i-1] = 0;
+            }
+        }
+
+        XValueType* fData;
+        std::size_t fDimensions[NDIM];
+        std::size_t fStrides[NDIM];
+};
+
+}//end of namespace
+
+#endif /* HArrayView_H__ */
@@ -53,6 +53,8 @@ typedef struct spectrometer_datatr_s
   cufftComplex *d_z_out;
   float *d_spectrum;
   float *spectrum;
+  float *d_spectrum2;
+  float *spectrum2;
   float *d_window;
   float *window;
   cufftHandle plan;
@@ -65,19 +67,30 @@ typedef struct spectrometer_datatr_s
   float sum;
   float sum2;
   int validity_flag;
+  int kurtosis_flag;
+  int overlap_factor; /* 1 (no overlap), 2 (50%) or 4 (75%) */
+  int n_batch; /* number of (overlapping) frames transformed per buffer */
+  SAMPLE_TYPE *tail; /* host, last spectrum_length - spectrum_length/overlap_factor samples of the previous buffer, or NULL */
 } spectrometer_data;
 
 
 __global__ void short_to_float(uint16_t *ds, float *df, int n_spectra, int spectrum_length);
 __global__ void short_to_float_s(int16_t *ds, float *df, int n_spectra, int spectrum_length);
 __global__ void apply_weights(float *df, float *w, int n_spectra, int spectrum_length);
+__global__ void short_to_float_overlap(uint16_t *ds, float *df, float *w, int n_frames, int spectrum_length, int hop);
+__global__ void short_to_float_overlap_s(int16_t *ds, float *df, float *w, int n_frames, int spectrum_length, int hop);
 __global__ void square_and_accumulate_sum(cufftComplex *z, float *spectrum);
+__global__ void square_and_accumulate_sum_sum2(const cufftComplex* z, float *spectrum, float *spectrum2, const unsigned n_spectra, const unsigned spectrum_length);
 
 /* calculate spectra and pwr */
 extern "C" void process_vector_no_output(SAMPLE_TYPE *d_in, spectrometer_data *d);
 /* do_squared_pwr=1 also estimated power with \sum_n x_n**2 */
+/* if d->kurtosis_flag=1 the sum of |X|^4 is also accumulated for each channel (in spectrum2) */
+/* if d->overlap_factor > 1, the sum over the overlapping frames (fewer if d->tail is NULL) is scaled to be equivalent to the */
+/* sum over data_length/spectrum_length non-overlapping frames, and d->n_spectra is set to that non-overlapping count */
 extern "C" void process_vector_no_output_(SAMPLE_TYPE *d_in, spectrometer_data *d, int do_squared_pwr);
 extern "C" spectrometer_data *new_spectrometer_data(int data_length, int spectrum_length, int window_flag);
+extern "C" spectrometer_data *new_spectrometer_data_overlap(int data_length, int spectrum_length, int window_flag, int overlap_factor);
 extern "C" void free_spectrometer_data(spectrometer_data *d);
 
 extern "C" void blackmann_harris( float* pOut, unsigned int num );
@@ -5,6 +5,8 @@
    Cory Cotter (optimization of square and accumulate sum)
    John Barrett (added support for signed/unsigned int, stripped down code to minimal library) 2019
    John Barrett (added noise power calculation, re-org to clean up code) 2021
+   John Barrett (added |X|^4 accumulation for spectral kurtosis)
+   John Barrett (added overlapped frames, carrying the tail of the previous buffer)
 */
 
 
@@ -126,19 +128,42 @@ void wrapped_cuda_free(void* ptr)
 }
 
 extern "C" spectrometer_data* new_spectrometer_data(int data_length, int spectrum_length, int window_flag)
+{
+    return new_spectrometer_data_overlap(data_length, spectrum_length, window_flag, 1);
+}
+
+/*
+  with overlap_factor > 1 consecutive frames start spectrum_length/overlap_factor samples apart,
+  so there are data_length/hop of them per buffer (the first few include the tail of the previous buffer)
+ */
+extern "C" spectrometer_data* new_spectrometer_data_overlap(int data_length, int spectrum_length, int window_flag, int overlap_factor)
 {
     spectrometer_data *d;
     int n_spectra;
+    int n_batch;
+    int hop;
+    if(overlap_factor < 1 || spectrum_length % overlap_factor != 0)
+    {
+        fprintf(stderr, "Spectrometer error: invalid overlap factor %d, using no overlap\n", overlap_factor);
+        overlap_factor = 1;
+    }
+    hop = spectrum_length/overlap_factor;
     n_spectra = data_length/spectrum_length;
+    n_batch = data_length/hop;
     print_cuda_meminfo();
 
     d = (spectrometer_data *) malloc(sizeof(spectrometer_data));
 
     // result on the cpu
     d->spectrum = (float*) malloc( (spectrum_length/2+1) * sizeof(float));
+    d->spectrum2 = (float*) malloc( (spectrum_length/2+1) * sizeof(float));
+    d->kurtosis_flag = 0;
     d->data_length = data_length;
     d->spectrum_length = spectrum_length;
     d->n_spectra = n_spectra;
+    d->overlap_factor = overlap_factor;
+    d->n_batch = n_batch;
+    d->tail = NULL;
     d->window = (float*) malloc(spectrum_length*sizeof(float));
 
     if(window_flag == BOXCAR_WIN)
@@ -158,11 +183,11 @@ extern "C" spectrometer_data* new_spectrometer_data(int data_length, int spectru
 
     // allocating device memory to the above pointers
     // reserve extra for +1 in place transforms
-    unsigned long want =  sizeof(cufftComplex)*n_spectra*(spectrum_length/2 + 1);
+    unsigned long want =  sizeof(cufftComplex)*n_batch*(spectrum_length/2 + 1);
     printf("required gpu buff size = %lu \n", want);
 
     //allocate space for FFT input
-    wrapped_cuda_malloc( (void **) &d->d_in, sizeof(cufftComplex)*n_spectra*(spectrum_length/2 + 1) );
+    wrapped_cuda_malloc( (void **) &d->d_in, sizeof(cufftComplex)*n_batch*(spectrum_length/2 + 1) );
 
     print_cuda_meminfo();
     //space for the noise power data accumulation
@@ -175,7 +200,7 @@ extern "C" spectrometer_data* new_spectrometer_data(int data_length, int spectru
     //allocate space for the x-formed spectra output
     // in-place seems to have a bug that causes the end to be garbled.
     //  d->d_z_out =(cufftComplex *) d->d_in;
-    wrapped_cuda_malloc( (void **) &d->d_z_out, sizeof(cufftComplex)*n_spectra*(spectrum_length/2 + 1));
+    wrapped_cuda_malloc( (void **) &d->d_z_out, sizeof(cufftComplex)*n_batch*(spectrum_length/2 + 1));
     print_cuda_meminfo();
 
     //allocate space for BH-window weights
@@ -184,22 +209,26 @@ extern "C" spectrometer_data* new_spectrometer_data(int data_length, int spectru
     wrapped_cuda_malloc( (void **) &d->d_window, sizeof(float)*spectrum_length);
     print_cuda_meminfo();
 
-    //allocate space to store the digitizer samples
-    wrapped_cuda_malloc( (void **) &d->ds_in,sizeof(SAMPLE_TYPE)*data_length );
+    //allocate space to store the digitizer samples (preceded by the tail of the previous buffer when overlapping)
+    wrapped_cuda_malloc( (void **) &d->ds_in,sizeof(SAMPLE_TYPE)*(data_length + spectrum_length - hop) );
     print_cuda_meminfo();
 
     //allocate space for the power spectrum
     wrapped_cuda_malloc( (void **) &d->d_spectrum,sizeof(float)*(spectrum_length/2+1) );
     print_cuda_meminfo();
 
+    //allocate space for the sum of |X|^4 (only filled in if the kurtosis flag is set)
+    wrapped_cuda_malloc( (void **) &d->d_spectrum2,sizeof(float)*(spectrum_length/2+1) );
+    print_cuda_meminfo();
+
     // initializing 1D FFT plan, this will tell cufft execution how to operate
     // cufft is well optimized and will run with different parameters than above
     //    cufftHandle plan;
 
-    if (cufftPlan1d(&d->plan, spectrum_length, CUFFT_R2C, n_spectra) != CUFFT_SUCCESS)
+    if (cufftPlan1d(&d->plan, spectrum_length, CUFFT_R2C, n_batch) != CUFFT_SUCCESS)
     {
         fprintf(stderr, "CUFFT error: Plan creation failed\n");
-        fprintf(stderr, "spec len, n spec = %d, %d", spectrum_length, n_spectra);
+        fprintf(stderr, "spec len, n spec = %d, %d", spectrum_length, n_batch);
         exit(EXIT_FAILURE);
     }
 
@@ -216,6 +245,7 @@ extern "C" void free_spectrometer_data(spectrometer_data *d)
 {
     free(d->window);
     free(d->spectrum);
+    free(d->spectrum2);
     wrapped_cuda_free(d->d_in);
     wrapped_cuda_free(d->d_window);
     wrapped_cuda_free(d->d_z_out);
@@ -225,6 +255,7 @@ extern "C" void free_spectrometer_data(spectrometer_data *d)
     wrapped_cuda_free(d->f_out);
     wrapped_cuda_free(d->f_out2);
     wrapped_cuda_free(d->d_spectrum);
+    wrapped_cuda_free(d->d_spectrum2);
 
     if (cufftDestroy(d->plan) != CUFFT_SUCCESS)
     {
@@ -258,6 +289,34 @@ __global__ void square_and_accumulate_sum(const cufftComplex* d_in,
     }
 }
 
+/*
+  average spectra, and also accumulate the sum of the squared power (|X|^4) in each channel,
+  the pair of moments is what is needed to compute the spectral kurtosis
+ */
+__global__ void square_and_accumulate_sum_sum2(const cufftComplex* d_in,
+                                               float* d_out,
+                                               float* d_out2,
+                                               const unsigned n_spectra,
+                                               const unsigned spectrum_length)
+{
+    unsigned idx = threadIdx.x + blockDim.x*blockIdx.x;
+    while (idx < spectrum_length)
+    {
+        float result = 0.0;
+        float result2 = 0.0;
+        for (int i = 0; i < n_spectra; i++)
+        {
+            int d_idx = i * spectrum_length + idx;
+            float pwr = d_in[d_idx].x * d_in[d_idx].x + d_in[d_idx].y * d_in[d_idx].y;
+            result += pwr;
+            result2 += pwr*pwr;
+        }
+        d_out[idx] = result;
+        d_out2[idx] = result2;
+        idx += gridDim.x * blockDim.x;
+    }
+}
+
 /*
   convert int16_t data vector into single precision floating point (original range is -32768 to 32767)
   also apply window function *w
@@ -306,6 +365,34 @@ __global__ void apply_weights(float *df, float *w, int n_spectra, int spectrum_l
     }
 }
 
+/*
+  gather overlapping frames (starting hop samples apart) from uint16_t data, convert to floating point and apply the window
+ */
+__global__ void short_to_float_overlap(uint16_t *ds, float *df, float *w, int n_frames, int spectrum_length, int hop)
+{
+    for(int spec_idx=blockIdx.x; spec_idx < n_frames ; spec_idx+=N_BLOCKS)
+    {
+        for(int freq_idx=threadIdx.x; freq_idx < spectrum_length ; freq_idx+=N_THREADS)
+        {
+            df[spec_idx*spectrum_length + freq_idx] = w[freq_idx]*( ( (float)ds[spec_idx*hop + freq_idx] - 32768.0) / 65535.0 );
+        }
+    }
+}
+
+/*
+  gather overlapping frames (starting hop samples apart) from int16_t data, convert to floating point and apply the window
+ */
+__global__ void short_to_float_overlap_s(int16_t *ds, float *df, float *w, int n_frames, int spectrum_length, int hop)
+{
+    for(int spec_idx=blockIdx.x; spec_idx < n_frames ; spec_idx+=N_BLOCKS)
+    {
+        for(int freq_idx=threadIdx.x; freq_idx < spectrum_length ; freq_idx+=N_THREADS)
+        {
+            df[spec_idx*spectrum_length + freq_idx] = w[freq_idx]*( ( (float)ds[spec_idx*hop + freq_idx] ) / 65535.0 );
+        }
+    }
+}
+
 void process_vector_no_output(SAMPLE_TYPE *d_in, spectrometer_data *d)
 {
   process_vector_no_output_(d_in, d, 1);
@@ -323,6 +410,13 @@ void process_vector_no_output_(SAMPLE_TYPE *d_in, spectrometer_data *d, int do_s
     data_length=d->data_length;
     spectrum_length=d->spectrum_length;
 
+    //the non-overlapped case needs no gather step
+    int overlap_factor = d->overlap_factor;
+    if(overlap_factor < 1){overlap_factor = 1;}
+    int hop = spectrum_length/overlap_factor;
+    int prefix_length = spectrum_length - hop; //samples carried over from the previous buffer
+    if(overlap_factor != 1){n_spectra = data_length/spectrum_length;}
+
     // ensure empty device spectrum
     if (cudaMemsetAsync(d->d_spectrum, 0, sizeof(float)*(spectrum_length/2 + 1)) != cudaSuccess)
     {
@@ -344,20 +438,30 @@ void process_vector_no_output_(SAMPLE_TYPE *d_in, spectrometer_data *d, int do_s
         exit(EXIT_FAILURE);
     }
 
-    // copy mem to device
-    if (cudaMemcpyAsync(d->ds_in, d_in, sizeof(SAMPLE_TYPE)*data_length, cudaMemcpyHostToDevice) != cudaSuccess)
+    // copy mem to device (after the space reserved for the tail of the previous buffer)
+    if (cudaMemcpyAsync(d->ds_in + prefix_length, d_in, sizeof(SAMPLE_TYPE)*data_length, cudaMemcpyHostToDevice) != cudaSuccess)
     {
       fprintf(stderr, "Cuda error: Memory copy failed\n");
       exit(EXIT_FAILURE);
     }
 
-    //convert datatype using GPU
+    int have_tail = (prefix_length != 0 && d->tail != NULL);
+    if(have_tail)
+    {
+        if (cudaMemcpyAsync(d->ds_in, d->tail, sizeof(SAMPLE_TYPE)*prefix_length, cudaMemcpyHostToDevice) != cudaSuccess)
+        {
+          fprintf(stderr, "Cuda error: Memory copy failed, tail\n");
+          exit(EXIT_FAILURE);
+        }
+    }
+
+    //convert datatype using GPU (the new samples only, in contiguous frames, for the noise statistics)
     #ifdef HOSE_USE_ADQ7
     //convert signed ints to floats
-    short_to_float_s<<< N_BLOCKS, N_THREADS >>>(d->ds_in, d->d_in, n_spectra, spectrum_length);
+    short_to_float_s<<< N_BLOCKS, N_THREADS >>>(d->ds_in + prefix_length, d->d_in, n_spectra, spectrum_length);
     #else
     //convert unsigned ints to floats
-    short_to_float<<< N_BLOCKS, N_THREADS >>>(d->ds_in, d->d_in, n_spectra, spectrum_length);
+    short_to_float<<< N_BLOCKS, N_THREADS >>>(d->ds_in + prefix_length, d->d_in, n_spectra, spectrum_length);
     #endif
 
     if(do_squared_pwr == 1){    
@@ -375,8 +479,27 @@ void process_vector_no_output_(SAMPLE_TYPE *d_in, spectrometer_data *d, int do_s
     cudaMemcpy(&d->sum2, d->f_out2, sizeof(float), cudaMemcpyDeviceToHost );
 
 
-    //have to apply the Blackman-Harris window function to the data now
-    apply_weights<<< N_BLOCKS, N_THREADS >>>(d->d_in, d->d_window, n_spectra, spectrum_length);
+    //without a tail, the first overlap_factor-1 frames would reach back before the start of this buffer, so they are skipped
+    int n_batch = n_spectra;
+    int n_skip = 0;
+    if(overlap_factor == 1)
+    {
+        //have to apply the Blackman-Harris window function to the data now
+        apply_weights<<< N_BLOCKS, N_THREADS >>>(d->d_in, d->d_window, n_spectra, spectrum_length);
+    }
+    else
+    {
+        //re-read the samples as overlapping frames (overwriting the contiguous ones), with the window applied
+        n_batch = d->n_batch;
+        if(!have_tail){n_skip = overlap_factor - 1;}
+        #ifdef HOSE_USE_ADQ7
+        short_to_float_overlap_s<<< N_BLOCKS, N_THREADS >>>(d->ds_in, d->d_in, d->d_window, n_batch, spectrum_length, hop);
+        #else
+        short_to_float_overlap<<< N_BLOCKS, N_THREADS >>>(d->ds_in, d->d_in, d->d_window, n_batch, spectrum_length, hop);
+        #endif
+    }
+    cufftComplex* z_out = d->d_z_out + n_skip*(spectrum_length/2 + 1);
+    int n_accumulate = n_batch - n_skip;
 
     // cufft kernel execution
     if (cufftExecR2C(d->plan, (float *)d->d_in, (cufftComplex *)d->d_z_out)	!= CUFFT_SUCCESS)
@@ -386,7 +509,14 @@ void process_vector_no_output_(SAMPLE_TYPE *d_in, spectrometer_data *d, int do_s
     }
 
     // this needs to be faster:
-    square_and_accumulate_sum<<< 1, N_THREADS >>>(d->d_z_out, d->d_spectrum, n_spectra, spectrum_length/2+1);
+    if(d->kurtosis_flag == 1)
+    {
+        square_and_accumulate_sum_sum2<<< 1, N_THREADS >>>(z_out, d->d_spectrum, d->d_spectrum2, n_accumulate, spectrum_length/2+1);
+    }
+    else
+    {
+        square_and_accumulate_sum<<< 1, N_THREADS >>>(z_out, d->d_spectrum, n_accumulate, spectrum_length/2+1);
+    }
     if (cudaGetLastError() != cudaSuccess)
     {
         fprintf(stderr, "Cuda error: Kernel failure, square_and_accumulate_sum\n");
@@ -400,4 +530,27 @@ void process_vector_no_output_(SAMPLE_TYPE *d_in, spectrometer_data *d, int do_s
         exit(EXIT_FAILURE);
     }
 
+    if(d->kurtosis_flag == 1)
+    {
+        if (cudaMemcpy(d->spectrum2, d->d_spectrum2, sizeof(float) * (spectrum_length/2+1), cudaMemcpyDeviceToHost) != cudaSuccess)
+        {
+            fprintf(stderr, "Cuda error: Memory copy failed, spectrum2 DtH\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if(overlap_factor != 1)
+    {
+        //scale the sum over the overlapping frames so that it is equivalent to the sum over n_spectra
+        //non-overlapping frames (so the output level does not depend on the overlap), and report n_spectra
+        //as the count, so that the sum and the count agree (the spectral kurtosis estimate is unchanged by this)
+        float scale = ( (float) n_spectra )/( (float) n_accumulate );
+        for(int i=0; i<spectrum_length/2+1; i++){d->spectrum[i] *= scale;}
+        if(d->kurtosis_flag == 1)
+        {
+            for(int i=0; i<spectrum_length/2+1; i++){d->spectrum2[i] *= scale;}
+        }
+        d->n_spectra = n_spectra;
+    }
+
 }
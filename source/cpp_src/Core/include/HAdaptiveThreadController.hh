@@ -0,0 +1,79 @@
+#ifndef HAdaptiveThreadController_HH__
+#define HAdaptiveThreadController_HH__
+
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "HThreadPool.hh"
+
+namespace hose
+{
+
+/*
+*File: HAdaptiveThreadController.hh
+*Class: HAdaptiveThreadController
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: periodically samples the backlog (number of buffers waiting) and the idle fraction of
+* a set of running thread pools, and adds or removes one thread at a time when these stay outside
+* their thresholds over a decision window. Each stage is kept between its own min/max thread counts.
+*/
+
+class HAdaptiveThreadController
+{
+    public:
+        HAdaptiveThreadController();
+        virtual ~HAdaptiveThreadController();
+
+        //backlog should return the number of buffers currently waiting to be processed by the stage
+        void AddStage(HThreadPool* stage, std::function< std::size_t() > backlog, unsigned int min_threads, unsigned int max_threads);
+
+        //time between samples, and number of samples averaged before each decision
+        void SetSamplePeriodMilliseconds(unsigned int ms){fSamplePeriodMilliseconds = ms;};
+        void SetNSamplesPerDecision(unsigned int n){fNSamplesPerDecision = (n == 0) ? 1 : n;};
+
+        //grow when the mean backlog is at least this large and the threads are (nearly) never idle
+        void SetGrowThresholds(double backlog, double idle_fraction){fGrowBacklog = backlog; fGrowIdleFraction = idle_fraction;};
+
+        //shrink when the mean backlog is below this and the threads spend at least this fraction idle
+        void SetShrinkThresholds(double backlog, double idle_fraction){fShrinkBacklog = backlog; fShrinkIdleFraction = idle_fraction;};
+
+        void Start();
+        void Stop();
+
+    private:
+
+        struct HStageControl
+        {
+            HThreadPool* fStage;
+            std::function< std::size_t() > fBacklog;
+            unsigned int fMinThreads;
+            unsigned int fMaxThreads;
+            double fBacklogSum;
+            double fIdleSum;
+            unsigned int fNSamples;
+        };
+
+        void ControlLoop();
+        void Sample(HStageControl& control);
+
+        unsigned int fSamplePeriodMilliseconds;
+        unsigned int fNSamplesPerDecision;
+        double fGrowBacklog;
+        double fGrowIdleFraction;
+        double fShrinkBacklog;
+        double fShrinkIdleFraction;
+
+        volatile bool fStop;
+        bool fRunning;
+        std::thread fControlThread;
+        std::mutex fMutex;
+        std::vector< HStageControl > fStages;
+};
+
+}
+
+#endif /* end of include guard: HAdaptiveThreadController */
@@ -0,0 +1,106 @@
+#ifndef HBackPressurePolicy_HH__
+#define HBackPressurePolicy_HH__
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+
+namespace hose
+{
+
+/*
+*File: HBackPressurePolicy.hh
+*Class: HBackPressurePolicy
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: decides whether a consumer stage should process or shed the next buffer,
+* given the number of buffers currently waiting in its queue (the backlog).
+* Dropped buffers are counted so that any data loss can be reported.
+*/
+
+enum class HBackPressureAction: int
+{
+    block = 0, //process every buffer, no matter how far behind we are (default)
+    drop, //skip every buffer which arrives while the backlog is at or above the threshold
+    decimate, //while the backlog is at or above the threshold, only process every N-th buffer
+    pause //once the backlog reaches the threshold, skip everything until the queue has fully drained
+};
+
+class HBackPressurePolicy
+{
+    public:
+
+        HBackPressurePolicy():
+            fAction(HBackPressureAction::block),
+            fBacklogThreshold(1),
+            fDecimationFactor(1),
+            fPaused(false),
+            fNDecimationCount(0),
+            fNAccepted(0),
+            fNDropped(0)
+        {};
+
+        virtual ~HBackPressurePolicy(){};
+
+        void SetAction(HBackPressureAction action){fAction = action;};
+        HBackPressureAction GetAction() const {return fAction;};
+
+        void SetBacklogThreshold(std::size_t n){fBacklogThreshold = (n == 0) ? 1 : n;};
+        std::size_t GetBacklogThreshold() const {return fBacklogThreshold;};
+
+        void SetDecimationFactor(unsigned int n){fDecimationFactor = (n == 0) ? 1 : n;};
+        unsigned int GetDecimationFactor() const {return fDecimationFactor;};
+
+        //returns true if the buffer should be processed, false if it should be dropped
+        bool Accept(std::size_t backlog)
+        {
+            bool accept = true;
+            switch(fAction)
+            {
+                case HBackPressureAction::drop:
+                    accept = (backlog < fBacklogThreshold);
+                break;
+                case HBackPressureAction::decimate:
+                    if(backlog < fBacklogThreshold)
+                    {
+                        fNDecimationCount = 0;
+                    }
+                    else
+                    {
+                        accept = ( (fNDecimationCount++)%fDecimationFactor == 0 );
+                    }
+                break;
+                case HBackPressureAction::pause:
+                    if(backlog >= fBacklogThreshold){fPaused = true;}
+                    else if(backlog == 0){fPaused = false;}
+                    accept = !fPaused;
+                break;
+                default:
+                break;
+            };
+
+            if(accept){fNAccepted++;}
+            else{fNDropped++;}
+            return accept;
+        }
+
+        uint64_t GetNAccepted() const {return fNAccepted;};
+        uint64_t GetNDropped() const {return fNDropped;};
+        void ResetCounters(){fNAccepted = 0; fNDropped = 0;};
+
+    private:
+
+        HBackPressureAction fAction;
+        std::size_t fBacklogThreshold;
+        unsigned int fDecimationFactor;
+
+        std::atomic<bool> fPaused;
+        std::atomic<uint64_t> fNDecimationCount;
+        std::atomic<uint64_t> fNAccepted;
+        std::atomic<uint64_t> fNDropped;
+};
+
+}
+
+#endif /* end of include guard: HBackPressurePolicy */
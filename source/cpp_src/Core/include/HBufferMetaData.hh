@@ -35,7 +35,9 @@ class HBufferMetaData
             fNoiseDiodeBlankingPeriod(0.0),
             fNTotalSamplesCollected(0),
             fNTotalSpectrum(0),
-            fPowerSpectrumLength(0)
+            fPowerSpectrumLength(0),
+            fValiditySampleLength(0),
+            fNBlankedSamples(0)
         {};
 
         virtual ~HBufferMetaData(){};
@@ -85,6 +87,22 @@ class HBufferMetaData
         uint64_t GetPowerSpectrumLength() const {return fPowerSpectrumLength;};
         void SetPowerSpectrumLength( const uint64_t& power_spectrum_length){fPowerSpectrumLength = power_spectrum_length;};
 
+        //for averaged data, one flag for each consecutive block of input samples (of length sample_length)
+        //starting at the leading sample index, 1 if the block contributed to the average, 0 if it was missing
+        void ClearValidityMask(){fValidityMask.clear(); fValiditySampleLength = 0;};
+        void SetValidityMask(const std::vector< uint8_t >& mask, const uint64_t& sample_length){fValidityMask = mask; fValiditySampleLength = sample_length;};
+        const std::vector< uint8_t >* GetValidityMask() const {return &fValidityMask;};
+        uint64_t GetValiditySampleLength() const {return fValiditySampleLength;};
+
+        //number of samples which were zeroed by the time-domain RFI blanking (summed over an average)
+        uint64_t GetNBlankedSamples() const {return fNBlankedSamples;};
+        void SetNBlankedSamples(const uint64_t& n_blanked){fNBlankedSamples = n_blanked;};
+
+        //for averaged spectra, one flag for each channel, 1 if the channel is contaminated by RFI (empty if not computed)
+        void ClearRFIMask(){fRFIMask.clear();};
+        std::vector< uint8_t >* GetRFIMask(){return &fRFIMask;};
+        const std::vector< uint8_t >* GetRFIMask() const {return &fRFIMask;};
+
         void ClearAccumulation(){fAccumulations.clear();};
         void AppendAccumulation( struct HDataAccumulationStruct accum){ fAccumulations.push_back(accum); };
         void ExtendAccumulation( const std::vector< struct HDataAccumulationStruct >* accum_vec)
@@ -110,6 +128,10 @@ class HBufferMetaData
                 fNTotalSamplesCollected = rhs.fNTotalSamplesCollected;
                 fNTotalSpectrum = rhs.fNTotalSpectrum;
                 fPowerSpectrumLength = rhs.fPowerSpectrumLength;
+                fValiditySampleLength = rhs.fValiditySampleLength;
+                fValidityMask = rhs.fValidityMask;
+                fNBlankedSamples = rhs.fNBlankedSamples;
+                fRFIMask = rhs.fRFIMask;
             }
             return *this;
         }
@@ -137,7 +159,15 @@ class HBufferMetaData
         uint64_t fNTotalSamplesCollected;
         uint64_t fNTotalSpectrum;
         uint64_t fPowerSpectrumLength;
-    
+
+        //which blocks of samples contributed to an average
+        uint64_t fValiditySampleLength;
+        std::vector< uint8_t > fValidityMask;
+
+        uint64_t fNBlankedSamples;
+
+        //which channels of a spectrum have been flagged as RFI
+        std::vector< uint8_t > fRFIMask;
 
         //data statistics (for noise diode)
         std::vector< struct HDataAccumulationStruct > fAccumulations;
@@ -8,6 +8,7 @@
 #include <mutex>
 #include <iostream>
 #include <stdexcept>
+#include <stdint.h>
 
 #include "HLinearBuffer.hh"
 #include "HBufferAllocatorBase.hh"
@@ -22,7 +23,10 @@ namespace hose {
 *Author: J. Barrett
 *Email: barrettj@mit.edu
 *Date: Sat Feb 10 02:01:00 EST 2018
-*Description: ring of data buffers to be shared between a single producer and multiple (sequential) consumers
+*Description: ring of data buffers to be shared between a single producer and multiple consumers
+* by default buffers are handed from one consumer to the next in sequence, in fan-out mode every (read-only)
+* consumer receives the same buffer concurrently, and the buffer is returned to the producer once the last
+* reference to it is released. Consumers flagged as best-effort are skipped when their queue is backed up.
 */
 
 template< typename XBufferItemType >
@@ -35,11 +39,15 @@ class HBufferPool: public HRegisteringBufferPool
             fAllocator(allocator),
             fNChunks(0),
             fNItemsPerChunk(0),
+            fNItemsAllocatedPerChunk(0),
             fTotalItems(0),
-            fAllocated(false)
+            fAllocated(false),
+            fFanOut(false),
+            fBestEffortQueueLimit(1)
         {
             //make sure we have at least 1 consumer queue
             fConsumerQueueVector.resize(1);
+            fNSkippedBuffers.resize(1,0);
         };
 
         HBufferPool(HBufferAllocatorBase< XBufferItemType >* allocator, std::size_t n_chunks, std::size_t items_per_chunk):
@@ -47,11 +55,15 @@ class HBufferPool: public HRegisteringBufferPool
             fAllocator(allocator),
             fNChunks(n_chunks),
             fNItemsPerChunk(items_per_chunk),
+            fNItemsAllocatedPerChunk(0),
             fTotalItems(n_chunks*items_per_chunk),
-            fAllocated(false)
+            fAllocated(false),
+            fFanOut(false),
+            fBestEffortQueueLimit(1)
         {
             Allocate(fNChunks, fNItemsPerChunk);
             fConsumerQueueVector.resize(1);
+            fNSkippedBuffers.resize(1,0);
         };
 
         virtual ~HBufferPool()
@@ -67,49 +79,57 @@ class HBufferPool: public HRegisteringBufferPool
             }
 
             std::lock_guard<std::mutex> lock(fMutex);
-            if(fAllocated){Deallocate();}
+            if(fAllocated){FreeChunks();}
+            AllocateChunks(n_chunks, items_per_chunk);
+        }
 
-            fNChunks = n_chunks;
-            fNItemsPerChunk = items_per_chunk;
-            fTotalItems = fNChunks*fNItemsPerChunk;
+        void Deallocate()
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            if(fAllocated){FreeChunks();}
+        }
 
-            //for each chunk, call the allocator and create a linear buffer
-            fChunks.resize(0);
-            for(size_t i=0; i<fNChunks; i++ )
+        //change the number of buffers and/or their length, this may only be done while the pool is idle
+        //(every buffer is back in the producer queue), if the number of buffers is unchanged and the new length
+        //fits in the memory already allocated the buffers are re-used (only their length changes), otherwise they
+        //are freed and allocated again, returns false (and leaves the pool as it was) if it is not idle
+        bool Resize(std::size_t n_chunks, std::size_t items_per_chunk)
+        {
+            if( n_chunks < 1)
             {
-                auto chunk = fAllocator->allocate( fNItemsPerChunk ); //TODO, deal with exceptions
-                if(chunk != nullptr)
-                {
-                    fChunks.push_back( new HLinearBuffer< XBufferItemType >( chunk, fNItemsPerChunk) );
-                }
+                throw std::runtime_error("HBufferPool::Resize(): Cannot allocate a ring buffer with less than one element.");
             }
 
-            if(fChunks.size() != 0)
-            {
-                fAllocated = true;
-            }
+            std::lock_guard<std::mutex> lock(fMutex);
+            if(fProducerQueue.size() != fChunks.size()){return false;}
 
-            for(size_t i=0; i<fChunks.size(); i++ )
+            if(fAllocated && n_chunks == fChunks.size() && items_per_chunk <= fNItemsAllocatedPerChunk)
             {
-                fProducerQueue.push( fChunks[i] );
+                fNItemsPerChunk = items_per_chunk;
+                fTotalItems = fNChunks*fNItemsPerChunk;
+                for(size_t i=0; i<fChunks.size(); i++)
+                {
+                    fChunks[i]->SetArrayDimensions(&items_per_chunk);
+                    *(fChunks[i]->GetMetaData()) = HBufferMetaData();
+                }
+                return true;
             }
 
+            if(fAllocated){FreeChunks();}
+            AllocateChunks(n_chunks, items_per_chunk);
+            return true;
         }
 
-        void Deallocate()
+        //true if none of the buffers are in use (they have all been returned to the producer)
+        bool IsIdle() const
         {
             std::lock_guard<std::mutex> lock(fMutex);
-            if(fAllocated)
-            {
-                for(size_t i=0; i<fChunks.size(); i++)
-                {
-                    fAllocator->deallocate( fChunks[i]->GetData(), fNItemsPerChunk);
-                }
-                fChunks.resize(0);
-            }
-            fAllocated = false;
+            return ( fProducerQueue.size() == fChunks.size() );
         }
 
+        std::size_t GetNChunks() const {return fNChunks;};
+        std::size_t GetNItemsPerChunk() const {return fNItemsPerChunk;};
+
         bool IsAllocated() const { return fAllocated; }
 
         virtual void Initialize() override
@@ -118,10 +138,29 @@ class HBufferPool: public HRegisteringBufferPool
             if(fNRegisteredConsumers >= 1)
             {
                 fConsumerQueueVector.resize( fNRegisteredConsumers );
+                fNSkippedBuffers.resize( fNRegisteredConsumers, 0 );
             }
             //std::cout<<"number of consumer = "<<fConsumerQueueVector.size()<<std::endl;
         }
 
+        //in fan-out mode all consumers receive each buffer concurrently (and must not modify it)
+        //this should be set before any buffers are handed to the consumers
+        void EnableFanOut(){fFanOut = true;};
+        void DisableFanOut(){fFanOut = false;};
+        bool IsFanOutEnabled() const {return fFanOut;};
+
+        //max number of buffers which may be waiting on a best-effort consumer before it is skipped
+        void SetBestEffortQueueLimit(size_t limit){fBestEffortQueueLimit = limit;};
+        size_t GetBestEffortQueueLimit() const {return fBestEffortQueueLimit;};
+
+        //number of buffers a (best-effort) consumer has missed because it fell behind
+        uint64_t GetNSkippedBuffers(unsigned int id = 0) const
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            if(id < fNSkippedBuffers.size()){return fNSkippedBuffers[id];}
+            return 0;
+        }
+
         size_t GetNumberOfConsumerPools() const
         {
             return fConsumerQueueVector.size();
@@ -156,6 +195,13 @@ class HBufferPool: public HRegisteringBufferPool
         //return a buffer to the producer queue
         void PushProducerBuffer(HLinearBuffer< XBufferItemType >* buff)
         {
+            //a shared buffer can only go back to the producer once all of its readers are done with it
+            if(fFanOut && buff != nullptr && buff->GetReferenceCount() != 0)
+            {
+                ReleaseReference(buff);
+                return;
+            }
+
             //lock the buffer pool, so more than one thread modify the queue
             std::lock_guard<std::mutex> lock(fMutex);
             if(buff != nullptr)
@@ -171,7 +217,7 @@ class HBufferPool: public HRegisteringBufferPool
             //lock the buffer pool, so more than one thread cannot grab the same buffer
             std::lock_guard<std::mutex> lock(fMutex);
             HLinearBuffer< XBufferItemType >* buff = nullptr;
-            if(id < fConsumerQueueVector[id].size() )
+            if(id < fConsumerQueueVector.size() && fConsumerQueueVector[id].size() != 0 )
             {
                 buff = fConsumerQueueVector[id].front();
                 fConsumerQueueVector[id].pop();
@@ -181,10 +227,34 @@ class HBufferPool: public HRegisteringBufferPool
 
         //return a buffer to the (next available consumer w/ id) queue
         //if there is no next consumer, then push to the producer
+        //in fan-out mode the id is ignored, a fresh buffer is handed to all consumers
+        //and a buffer which is already shared has one of its references released
         void PushConsumerBuffer(HLinearBuffer< XBufferItemType >* buff, unsigned int id=0)
         {
+            if(fFanOut)
+            {
+                if(buff != nullptr && buff->GetReferenceCount() != 0)
+                {
+                    ReleaseReference(buff);
+                }
+                else
+                {
+                    std::lock_guard<std::mutex> lock(fMutex);
+                    DistributeBuffer(buff);
+                }
+                return;
+            }
+
             //lock the buffer pool, so more than one thread can't modify the queue
             std::lock_guard<std::mutex> lock(fMutex);
+
+            //pass over any best-effort consumers which are backed up
+            while(id < fConsumerQueueVector.size() && IsSkipped(id))
+            {
+                fNSkippedBuffers[id]++;
+                id++;
+            }
+
             if(id < fConsumerQueueVector.size())
             {
                 fConsumerQueueVector[id].push(buff);
@@ -195,14 +265,127 @@ class HBufferPool: public HRegisteringBufferPool
             }
         }
 
+        //remove an unconsumed buffer from a consumer queue so it can be re-used by the producer
+        //in fan-out mode this only returns the buffer if no other consumer still holds a reference to it
+        //otherwise nullptr is returned (and the buffer will come back when the last reference is released)
+        HLinearBuffer< XBufferItemType >* StealConsumerBuffer(unsigned int id=0)
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            HLinearBuffer< XBufferItemType >* buff = nullptr;
+            if(id < fConsumerQueueVector.size() && fConsumerQueueVector[id].size() != 0 )
+            {
+                buff = fConsumerQueueVector[id].front();
+                fConsumerQueueVector[id].pop();
+                if(fFanOut && buff->GetReferenceCount() != 0)
+                {
+                    if(buff->DecrementReferenceCount() != 0){buff = nullptr;}
+                }
+            }
+            return buff;
+        }
+
     protected:
 
+        //should only be called while the pool is locked
+        void AllocateChunks(std::size_t n_chunks, std::size_t items_per_chunk)
+        {
+            fNChunks = n_chunks;
+            fNItemsPerChunk = items_per_chunk;
+            fNItemsAllocatedPerChunk = items_per_chunk;
+            fTotalItems = fNChunks*fNItemsPerChunk;
+
+            //for each chunk, call the allocator and create a linear buffer
+            fChunks.resize(0);
+            for(size_t i=0; i<fNChunks; i++ )
+            {
+                auto chunk = fAllocator->allocate( fNItemsPerChunk ); //TODO, deal with exceptions
+                if(chunk != nullptr)
+                {
+                    fChunks.push_back( new HLinearBuffer< XBufferItemType >( chunk, fNItemsPerChunk) );
+                }
+            }
+
+            if(fChunks.size() != 0)
+            {
+                fAllocated = true;
+            }
+
+            for(size_t i=0; i<fChunks.size(); i++ )
+            {
+                fProducerQueue.push( fChunks[i] );
+            }
+        }
+
+        //should only be called while the pool is locked
+        void FreeChunks()
+        {
+            for(size_t i=0; i<fChunks.size(); i++)
+            {
+                fAllocator->deallocate( fChunks[i]->GetData(), fNItemsAllocatedPerChunk);
+                delete fChunks[i];
+            }
+            fChunks.resize(0);
+
+            //none of the queues may keep pointers to the buffers which are gone
+            fProducerQueue = std::queue< HLinearBuffer< XBufferItemType >* >();
+            for(size_t i=0; i<fConsumerQueueVector.size(); i++)
+            {
+                fConsumerQueueVector[i] = std::queue< HLinearBuffer< XBufferItemType >* >();
+            }
+            fAllocated = false;
+        }
+
+        //should only be called while the pool is locked
+        bool IsSkipped(unsigned int id) const
+        {
+            return ( IsBestEffortConsumer(id) && fConsumerQueueVector[id].size() >= fBestEffortQueueLimit );
+        }
+
+        //hand a freshly produced buffer to every consumer queue, should only be called while the pool is locked
+        void DistributeBuffer(HLinearBuffer< XBufferItemType >* buff)
+        {
+            if(buff == nullptr){return;}
+
+            unsigned int n_references = 0;
+            for(unsigned int i=0; i<fConsumerQueueVector.size(); i++)
+            {
+                if( !IsSkipped(i) ){n_references++;}
+            }
+
+            if(n_references == 0)
+            {
+                //everyone is too busy, this buffer goes straight back to the producer
+                for(unsigned int i=0; i<fConsumerQueueVector.size(); i++){fNSkippedBuffers[i]++;}
+                fProducerQueue.push(buff);
+                return;
+            }
+
+            //the count must be set before any consumer can see the buffer
+            buff->SetReferenceCount(n_references);
+            for(unsigned int i=0; i<fConsumerQueueVector.size(); i++)
+            {
+                if( IsSkipped(i) ){fNSkippedBuffers[i]++;}
+                else{fConsumerQueueVector[i].push(buff);}
+            }
+        }
+
+        //release one reference to a shared buffer, the last one out returns it to the producer
+        void ReleaseReference(HLinearBuffer< XBufferItemType >* buff)
+        {
+            if(buff->DecrementReferenceCount() == 0)
+            {
+                std::lock_guard<std::mutex> lock(fMutex);
+                fProducerQueue.push(buff);
+            }
+        }
+
         //allocator
         HBufferAllocatorBase< XBufferItemType >* fAllocator;
 
         //data
         std::size_t fNChunks;
         std::size_t fNItemsPerChunk;
+        std::size_t fNItemsAllocatedPerChunk; //may be more than the length in use, after a resize
         std::size_t fTotalItems;
         bool fAllocated;
 
@@ -213,6 +396,11 @@ class HBufferPool: public HRegisteringBufferPool
         std::queue< HLinearBuffer< XBufferItemType >* > fProducerQueue;
         std::vector< std::queue< HLinearBuffer< XBufferItemType >* > > fConsumerQueueVector;
 
+        //fan-out/best-effort configuration and the count of buffers each consumer has missed
+        bool fFanOut;
+        size_t fBestEffortQueueLimit;
+        std::vector< uint64_t > fNSkippedBuffers;
+
         //modification mutex
         mutable std::mutex fMutex;
 
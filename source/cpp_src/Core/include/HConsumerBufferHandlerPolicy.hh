@@ -164,7 +164,7 @@ class HConsumerBufferHandler_WaitWithTimeout: public HConsumerBufferReleaser< XB
                 //last attempt to grab buffer
                 if(pool->GetConsumerPoolSize(id) != 0)
                 {
-                    buffer = pool->PopConsumerBuffer();
+                    buffer = pool->PopConsumerBuffer(id);
                     return HConsumerBufferPolicyCode::success;
                 }
                 else
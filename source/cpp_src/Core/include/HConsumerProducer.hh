@@ -55,6 +55,9 @@ class HConsumerProducer: public HRegisteredConsumer, public HThreadPool
         HBufferPool<XSinkBufferItemType>* GetSinkBufferPool() {return fSinkBufferPool;};
         const HBufferPool<XSinkBufferItemType>* GetSinkBufferPool() const {return fSinkBufferPool;};
 
+        //access to the buffer handler used to reserve sink buffers (e.g. to read its counters)
+        const XConsumerSourceBufferHandlerPolicyType& GetSinkBufferHandler() const {return fSinkBufferHandler;};
+
         //start the producer running (in a separate thread in the background)
         void StartConsumptionProduction()
         {
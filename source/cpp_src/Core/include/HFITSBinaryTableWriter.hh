@@ -0,0 +1,104 @@
+#ifndef HFITSBinaryTableWriter_HH__
+#define HFITSBinaryTableWriter_HH__
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdint.h>
+
+namespace hose
+{
+
+/*
+*File: HFITSBinaryTableWriter.hh
+*Class: HFITSBinaryTableWriter
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: minimal writer for a FITS file made of an (empty) primary HDU followed by a single
+* binary table extension. Header cards are formatted the same way astropy.io.fits writes them.
+* Rows are streamed to the file as they are produced, so the table does not have to fit in memory;
+* the row count (NAXIS2) is filled in when the file is closed.
+* Rows are packed by the caller into buffers of GetRowSize() bytes with the (const, thread safe)
+* SetField methods, which handle the big-endian encoding. Supported column types (TFORM) are
+* rA (characters), rI, rJ, rK (16, 32, 64 bit integers), rE and rD (32 and 64 bit floats).
+*/
+
+class HFITSBinaryTableWriter
+{
+    public:
+        HFITSBinaryTableWriter();
+        virtual ~HFITSBinaryTableWriter();
+
+        //keyword cards, the key is truncated/padded to 8 characters and the card to 80
+        static std::string FormatStringCard(const std::string& key, const std::string& value, const std::string& comment = "");
+        static std::string FormatIntegerCard(const std::string& key, int64_t value, const std::string& comment = "");
+        static std::string FormatFloatCard(const std::string& key, double value, const std::string& comment = "");
+        static std::string FormatLogicalCard(const std::string& key, bool value, const std::string& comment = "");
+
+        //floating point value as written by astropy (shortest round trip representation)
+        static std::string FormatFloatValue(double value);
+
+        //cards following the mandatory keywords of the primary HDU
+        void AddPrimaryCard(const std::string& card){fPrimaryCards.push_back(card);};
+
+        //cards following the column definitions of the table
+        void AddTableCard(const std::string& card){fTableCards.push_back(card);};
+
+        //returns the column index, or -1 if the format is not supported (must be called before Open)
+        int AddColumn(const std::string& name, const std::string& format, const std::string& unit = "");
+
+        unsigned int GetNColumns() const {return fColumns.size();};
+        size_t GetRowSize() const {return fRowSize;};
+        size_t GetColumnOffset(unsigned int col) const {return fColumns[col].fOffset;};
+        size_t GetColumnRepeat(unsigned int col) const {return fColumns[col].fRepeat;};
+
+        //write the primary HDU and the table header
+        bool Open(const std::string& filename);
+
+        //append n_rows rows, packed one after the other
+        bool WriteRows(const char* rows, size_t n_rows);
+
+        //pad the data to a whole number of FITS blocks and fill in the row count
+        bool Close();
+
+        uint64_t GetNRows() const {return fNRows;};
+
+        //encode values into a row buffer, numeric values are converted to the column type
+        //strings are truncated to the column width and padded with NUL characters
+        void SetField(char* row, unsigned int col, const std::string& value) const;
+        void SetField(char* row, unsigned int col, double value, size_t index = 0) const;
+        void SetField(char* row, unsigned int col, const float* values, size_t n) const;
+        void SetField(char* row, unsigned int col, const double* values, size_t n) const;
+
+    protected:
+
+        struct HColumn
+        {
+            std::string fName;
+            std::string fFormat;
+            std::string fUnit;
+            char fType;
+            size_t fRepeat;
+            size_t fWidth; //bytes per element
+            size_t fOffset; //byte offset in the row
+        };
+
+        bool WriteHeader(const std::vector< std::string >& cards);
+        bool PadBlock(char fill);
+
+        std::vector< std::string > fPrimaryCards;
+        std::vector< std::string > fTableCards;
+        std::vector< HColumn > fColumns;
+        size_t fRowSize;
+
+        std::ofstream fFile;
+        std::string fFilename;
+        std::streamoff fNRowsCardPosition;
+        uint64_t fNRows;
+        uint64_t fNBytes; //bytes written to the current HDU
+};
+
+}//end of namespace
+
+#endif /* end of include guard: HFITSBinaryTableWriter_HH__ */
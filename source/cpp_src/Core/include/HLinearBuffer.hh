@@ -2,6 +2,7 @@
 #define HLinearBuffer_HH__
 
 #include <mutex>
+#include <atomic>
 #include <stack>
 #include <stdint.h>
 
@@ -23,8 +24,8 @@ template< typename XBufferItemType >
 class HLinearBuffer: public HArrayWrapper< XBufferItemType, 1 >
 {
     public:
-        HLinearBuffer():HArrayWrapper<XBufferItemType, 1>(){};
-        HLinearBuffer(XBufferItemType* data, std::size_t length):HArrayWrapper<XBufferItemType, 1>(data, &length){};
+        HLinearBuffer():HArrayWrapper<XBufferItemType, 1>(),fReferenceCount(0){};
+        HLinearBuffer(XBufferItemType* data, std::size_t length):HArrayWrapper<XBufferItemType, 1>(data, &length),fReferenceCount(0){};
 
         virtual ~HLinearBuffer(){};
 
@@ -33,6 +34,13 @@ class HLinearBuffer: public HArrayWrapper< XBufferItemType, 1 >
         //access to the buffer meta data
         HBufferMetaData* GetMetaData() {return &fMetaData;};
 
+        //number of (fan-out) consumers which still hold a reference to this buffer
+        unsigned int GetReferenceCount() const {return fReferenceCount.load();};
+        void SetReferenceCount(unsigned int count){fReferenceCount.store(count);};
+
+        //returns the number of references remaining after the decrement
+        unsigned int DecrementReferenceCount(){return --fReferenceCount;};
+
     public:
 
         std::mutex fMutex;
@@ -40,6 +48,7 @@ class HLinearBuffer: public HArrayWrapper< XBufferItemType, 1 >
     protected:
 
         HBufferMetaData fMetaData;
+        std::atomic<unsigned int> fReferenceCount;
 
 };
 
@@ -0,0 +1,74 @@
+#ifndef HObservingGeometry_HH__
+#define HObservingGeometry_HH__
+
+#include <stdint.h>
+
+namespace hose
+{
+
+/*
+*File: HObservingGeometry.hh
+*Class: HObservingGeometry
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: compact (no external ephemeris or IERS tables) astrometry for tagging spectra:
+* local mean sidereal time, conversion of encoder az/el to J2000/ICRS ra/dec, and the barycentric
+* and LSR radial velocity corrections. Precession (IAU 1976), the leading nutation terms (IAU 1980),
+* annual and diurnal aberration and an analytic (Keplerian) barycentric earth velocity are used.
+* UT1 is taken to be UTC and refraction, polar motion and light deflection are ignored, so
+* positions are good to a few arcseconds and velocities to a few m/s.
+*/
+
+class HObservingGeometry
+{
+    public:
+        HObservingGeometry();
+        virtual ~HObservingGeometry();
+
+        //geodetic (WGS84) location, longitude is east positive, angles in degrees, elevation in meters
+        void SetSiteLocation(double longitude, double latitude, double elevation);
+
+        //time of the observation in UTC seconds since the unix epoch (computes everything time dependent)
+        void SetTime(double utc_epoch_sec);
+
+        //local mean sidereal time in seconds [0, 86400)
+        double GetLocalMeanSiderealTime() const {return fLocalMeanSiderealTime;};
+
+        //az (from north through east) and el in degrees to J2000 ra/dec in degrees
+        void ConvertAzElToRADec(double az, double el, double& ra, double& dec) const;
+
+        //velocity correction (m/s) to be added to a measured radial velocity towards ra/dec (degrees)
+        double GetBarycentricCorrection(double ra, double dec) const;
+
+        //J2000 ra/dec to galactic longitude/latitude, degrees
+        static void ConvertRADecToGalactic(double ra, double dec, double& l, double& b);
+
+        //projection (m/s) of the standard solar motion w.r.t the LSR (Kerr & Lynden-Bell 1986)
+        static double GetLSRCorrection(double ra, double dec);
+
+    protected:
+
+        static void Rotate(const double m[3][3], const double in[3], double out[3]);
+        static void RotateInverse(const double m[3][3], const double in[3], double out[3]);
+
+        //heliocentric position (AU) and velocity (AU/day), J2000 equatorial, of a planet/EMB from mean elements
+        static void GetPlanetState(unsigned int planet, double t, double pos[3], double vel[3]);
+
+        //geocentric position of the moon (AU), J2000 equatorial
+        static void GetMoonPosition(double t, double pos[3]);
+
+        double fLongitude;
+        double fLatitude;
+        double fSitePosition[3]; //earth fixed, meters
+
+        double fLocalMeanSiderealTime;
+        double fLocalApparentSiderealTime; //radians
+        double fPrecessionNutation[3][3]; //J2000 to true equator and equinox of date
+        double fObserverVelocity[3]; //barycentric, J2000, m/s
+        double fGravitationalRedshift; //m/s
+};
+
+}//end of namespace
+
+#endif /* end of include guard: HObservingGeometry_HH__ */
@@ -39,6 +39,9 @@ class HProducer: public HThreadPool
         HBufferPool<XBufferItemType>* GetBufferPool() {return fBufferPool;};
         const HBufferPool<XBufferItemType>* GetBufferPool() const {return fBufferPool;};
 
+        //access to the buffer handler (e.g. to read its counters)
+        const XProducerBufferHandlerPolicyType& GetBufferHandler() const {return fBufferHandler;};
+
         //start the producer running (in a separate thread in the background)
         void StartProduction()
         {
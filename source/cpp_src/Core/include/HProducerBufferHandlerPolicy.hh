@@ -1,6 +1,7 @@
 #ifndef HProducerBufferHandlerPolicy_HH__
 #define HProducerBufferHandlerPolicy_HH__
 
+#include <atomic>
 #include <chrono>
 #include <thread>
 #include <type_traits>
@@ -44,9 +45,13 @@ template< typename XBufferItemType >
 class HProducerBufferReleaser
 {
     public:
-        HProducerBufferReleaser(){;};
+        HProducerBufferReleaser():fNStolenBuffers(0){;};
         virtual ~HProducerBufferReleaser(){;};
 
+        //number of unconsumed buffers taken back from the consumers (i.e. data which was lost)
+        uint64_t GetNStolenBuffers() const {return fNStolenBuffers;};
+        void ResetNStolenBuffers(){fNStolenBuffers = 0;};
+
         HProducerBufferPolicyCode ReleaseBufferToProducer(HBufferPool<XBufferItemType>* pool, HLinearBuffer<XBufferItemType>*& buffer)
         {
             pool->PushProducerBuffer(buffer);
@@ -58,6 +63,10 @@ class HProducerBufferReleaser
             pool->PushConsumerBuffer(buffer,id);
             return HProducerBufferPolicyCode::success;
         }
+
+    protected:
+
+        std::atomic<uint64_t> fNStolenBuffers;
 };
 
 
@@ -128,11 +137,15 @@ class HProducerBufferHandler_Steal: public HProducerBufferReleaser< XBufferItemT
                 for(size_t n=0; n<consumer_pools; n++)
                 {
                     //steal a buffer from the first non-empty consumer pool (working backwards from the end)
-                    if(pool->GetConsumerPoolSize( (consumer_pools-1)-n ) != 0)
+                    //(in fan-out mode a buffer which is still held by another consumer cannot be taken, so keep looking)
+                    while(pool->GetConsumerPoolSize( (consumer_pools-1)-n ) != 0)
                     {
-                        buffer = pool->PopConsumerBuffer( (consumer_pools-1)-n );
-                        std::cout<<"STOLEN "<<std::endl;
-                        return HProducerBufferPolicyCode::stolen;
+                        buffer = pool->StealConsumerBuffer( (consumer_pools-1)-n );
+                        if(buffer != nullptr)
+                        {
+                            this->fNStolenBuffers++;
+                            return HProducerBufferPolicyCode::stolen;
+                        }
                     }
                 }
             }
@@ -229,13 +242,16 @@ class HProducerBufferHandler_ForceFlush: public HProducerBufferReleaser< XBuffer
                 {
                     while( pool->GetConsumerPoolSize(n) != 0 )
                     {
-                        HLinearBuffer< XBufferItemType >* temp_buffer = pool->PopConsumerBuffer(n);
-                        pool->PushProducerBuffer(temp_buffer);
-                        count++;
+                        HLinearBuffer< XBufferItemType >* temp_buffer = pool->StealConsumerBuffer(n);
+                        if(temp_buffer != nullptr)
+                        {
+                            pool->PushProducerBuffer(temp_buffer);
+                            count++;
+                        }
                     };
                 }
 
-                std::cout<<"FLUSHED "<<count<<" buffers!!!!!!!!"<<std::endl;
+                this->fNStolenBuffers += count;
 
                 //producer pool should be full now, so grab buffer
                 if(pool->GetProducerPoolSize() != 0)
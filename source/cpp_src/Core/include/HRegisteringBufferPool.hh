@@ -1,6 +1,8 @@
 #ifndef HRegisteringBufferPool_HH__
 #define HRegisteringBufferPool_HH__
 
+#include <vector>
+
 
 namespace hose
 {
@@ -20,18 +22,23 @@ class HRegisteringBufferPool;
 class HRegisteredConsumer
 {
     public:
-        HRegisteredConsumer():fID(0){};
+        HRegisteredConsumer():fID(0),fBestEffort(false){};
         virtual ~HRegisteredConsumer(){};
 
         unsigned int GetConsumerID() const {return fID;};
         
         unsigned int GetNextConsumerID() const {return fID+1;};
 
+        //a best-effort consumer is skipped (rather than waited on) when it falls behind
+        void SetBestEffort(bool best_effort){fBestEffort = best_effort;};
+        bool IsBestEffort() const {return fBestEffort;};
+
     private:
         friend class HRegisteringBufferPool;
 
     protected:
         unsigned int fID;
+        bool fBestEffort;
 };
 
 
@@ -65,6 +72,12 @@ class HRegisteringBufferPool
             fNRegisteredConsumers = fConsumerList.size();
         }
 
+        bool IsBestEffortConsumer(unsigned int id) const
+        {
+            if(id < fConsumerList.size()){return fConsumerList[id]->IsBestEffort();}
+            return false;
+        }
+
     protected:
 
         std::vector<HRegisteredConsumer*> fConsumerList;
@@ -0,0 +1,115 @@
+#ifndef HTaskScheduler_HH__
+#define HTaskScheduler_HH__
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hose
+{
+
+/*
+*File: HTaskScheduler.hh
+*Class: HTaskScheduler
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: process-wide work-stealing executor shared by the pipeline stages.
+* Each worker owns a deque of one-off tasks (pops from the back, steals from the front of the others),
+* and when there are no one-off tasks it runs a unit of work (ExecuteThreadTask) of whichever registered
+* stage has work present, in order of stage priority and subject to each stage's concurrency limit.
+* So idle cores help out whichever stage is currently the bottleneck.
+*/
+
+class HThreadPool;
+
+class HTaskScheduler
+{
+    public:
+
+        //there is only one scheduler per process
+        static HTaskScheduler* GetInstance();
+
+        //number of worker threads, can only be set before launch (default is the number of cores)
+        void SetNThreads(unsigned int n);
+        unsigned int GetNThreads() const {return fNThreads;};
+
+        //time a worker sleeps when it finds nothing to do
+        void SetIdleSleepMicroSeconds(unsigned int us){fIdleSleepMicroSeconds = us;};
+
+        void Launch();
+        void Terminate(); //stops and joins the workers (tasks still queued are discarded)
+        bool IsRunning() const {return fRunning;};
+
+        //queue a one-off task, if called from a worker it is placed on that worker's own deque
+        void Submit(const std::function< void() >& task);
+
+        //run task(i) for i in [0,n) on the workers, the calling thread participates and
+        //this returns once all indices are complete (runs serially if the scheduler is not running)
+        void ParallelFor(std::size_t n, const std::function< void(std::size_t) >& task);
+
+        //stages with a higher priority are polled for work first, no more than max_concurrency
+        //workers will execute tasks for a given stage at the same time
+        void RegisterStage(HThreadPool* stage, int priority, unsigned int max_concurrency);
+        void SetStageConcurrency(HThreadPool* stage, unsigned int max_concurrency);
+
+        //returns once no worker is executing a task for this stage
+        void UnregisterStage(HThreadPool* stage);
+
+        bool IsRegistered(const HThreadPool* stage);
+        unsigned int GetNActiveStageTasks(const HThreadPool* stage);
+
+    private:
+
+        HTaskScheduler();
+        virtual ~HTaskScheduler();
+
+        HTaskScheduler(const HTaskScheduler&) = delete;
+        HTaskScheduler& operator=(const HTaskScheduler&) = delete;
+
+        struct HStageEntry
+        {
+            HThreadPool* fStage;
+            int fPriority;
+            std::atomic<unsigned int> fMaxConcurrency;
+            std::atomic<unsigned int> fNActive;
+            std::atomic<bool> fEnabled;
+        };
+
+        struct HWorkerQueue
+        {
+            std::mutex fMutex;
+            std::deque< std::function< void() > > fTasks;
+        };
+
+        void WorkerLoop(unsigned int worker_id);
+        bool PopTask(unsigned int worker_id, std::function< void() >& task);
+        bool StealTask(unsigned int worker_id, std::function< void() >& task);
+        bool RunStageTask(unsigned int worker_id, std::vector< std::shared_ptr< HStageEntry > >& stages, unsigned int& generation);
+        std::shared_ptr< HStageEntry > FindStage(const HThreadPool* stage);
+
+        unsigned int fNThreads;
+        unsigned int fIdleSleepMicroSeconds;
+        volatile bool fRunning;
+        std::atomic<bool> fStop;
+        std::mutex fLaunchMutex;
+
+        //one-off task deques, one for each worker
+        std::vector< std::unique_ptr< HWorkerQueue > > fQueues;
+        std::vector< std::thread > fWorkers;
+        std::atomic<unsigned int> fNextQueue;
+
+        //registered stages (sorted by decreasing priority), workers keep a copy
+        //which they refresh whenever the generation count changes
+        std::mutex fStageMutex;
+        std::vector< std::shared_ptr< HStageEntry > > fStages;
+        std::atomic<unsigned int> fStageGeneration;
+};
+
+}
+
+#endif /* end of include guard: HTaskScheduler */
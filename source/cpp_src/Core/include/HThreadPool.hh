@@ -2,10 +2,12 @@
 #define HThreadPool_HH__
 
 #include <mutex>
+#include <atomic>
 #include <thread>
 #include <vector>
 #include <set>
 #include <map>
+#include <memory>
 #include <utility>
 
 #include <unistd.h>
@@ -19,9 +21,15 @@ namespace hose
 *Author: J. Barrett
 *Email: barrettj@mit.edu
 *Date:
-*Description:
+*Description: Pool of threads which repeatedly execute a unit of work while work is present.
+* The number of threads may be changed while running, each thread has its own stop flag
+* so it can be retired (and joined) once it has finished its current task.
+* Alternatively, the pool can hand its work to the process-wide HTaskScheduler, in which case
+* it owns no threads and the number of threads acts as the stage's concurrency limit.
 */
 
+class HTaskScheduler;
+
 class HThreadPool
 {
     public:
@@ -39,6 +47,7 @@ class HThreadPool
         void Join();
 
         //thread <-> CPU affinity settings
+        //the number of threads can be changed after launch, threads which are removed finish their current task first
         virtual void SetNThreads(unsigned int n);
         unsigned int GetNThreads() const {return fNThreads;};
 
@@ -49,9 +58,24 @@ class HThreadPool
 
         bool AllThreadsAreIdle();
 
+        //fraction of the threads which are currently waiting for work
+        double GetIdleFraction();
+
+        //run this pool's work on the shared scheduler instead of its own threads (must be set before launch)
+        void SetUseSharedScheduler(bool use_scheduler);
+        bool GetUseSharedScheduler() const {return fUseSharedScheduler;};
+
+        //stages with a higher priority are given work first by the shared scheduler
+        void SetSchedulerPriority(int priority){fSchedulerPriority = priority;};
+        int GetSchedulerPriority() const {return fSchedulerPriority;};
+
     protected:
 
-        void ProcessLoop();
+        friend class HTaskScheduler;
+
+        void ProcessLoop(std::atomic<bool>* stop_flag);
+        void LaunchThread();
+        void RetireThread(std::vector< std::thread >& retired_threads, std::vector< std::unique_ptr< std::atomic<bool> > >& retired_flags);
 
         virtual void ExecuteThreadTask() = 0; //derived class must define work to be done
         virtual bool WorkPresent() = 0; //derived class must provide an indicator if there is useful work to be done
@@ -68,9 +92,15 @@ class HThreadPool
         volatile bool fSignalTerminate;
         volatile bool fForceTerminate;
         std::vector< std::thread > fThreads;
+        std::vector< std::unique_ptr< std::atomic<bool> > > fThreadStopFlags; //one per thread (allocated separately so flags never move)
+        std::mutex fResizeMutex;
         std::mutex fIdleMutex;
         std::map< std::thread::id, bool > fThreadIdleMap;
 
+        //shared scheduler settings
+        bool fUseSharedScheduler;
+        int fSchedulerPriority;
+
 };
 
 }
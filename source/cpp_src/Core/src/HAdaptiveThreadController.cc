@@ -0,0 +1,111 @@
+#include "HAdaptiveThreadController.hh"
+
+#include <chrono>
+#include <iostream>
+
+namespace hose
+{
+
+HAdaptiveThreadController::HAdaptiveThreadController():
+    fSamplePeriodMilliseconds(100),
+    fNSamplesPerDecision(10),
+    fGrowBacklog(2.0),
+    fGrowIdleFraction(0.1),
+    fShrinkBacklog(0.5),
+    fShrinkIdleFraction(0.5),
+    fStop(false),
+    fRunning(false)
+{}
+
+HAdaptiveThreadController::~HAdaptiveThreadController()
+{
+    Stop();
+}
+
+void
+HAdaptiveThreadController::AddStage(HThreadPool* stage, std::function< std::size_t() > backlog, unsigned int min_threads, unsigned int max_threads)
+{
+    if(stage == nullptr){return;}
+    if(min_threads == 0){min_threads = 1;}
+    if(max_threads < min_threads){max_threads = min_threads;}
+
+    HStageControl control;
+    control.fStage = stage;
+    control.fBacklog = backlog;
+    control.fMinThreads = min_threads;
+    control.fMaxThreads = max_threads;
+    control.fBacklogSum = 0;
+    control.fIdleSum = 0;
+    control.fNSamples = 0;
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStages.push_back(control);
+}
+
+void
+HAdaptiveThreadController::Start()
+{
+    if(!fRunning)
+    {
+        fStop = false;
+        fControlThread = std::thread( &HAdaptiveThreadController::ControlLoop, this );
+        fRunning = true;
+    }
+}
+
+void
+HAdaptiveThreadController::Stop()
+{
+    if(fRunning)
+    {
+        fStop = true;
+        fControlThread.join();
+        fRunning = false;
+    }
+}
+
+void
+HAdaptiveThreadController::ControlLoop()
+{
+    while(!fStop)
+    {
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            for(unsigned int i=0; i<fStages.size(); i++)
+            {
+                Sample(fStages[i]);
+            }
+        }
+        std::this_thread::sleep_for( std::chrono::milliseconds(fSamplePeriodMilliseconds) );
+    }
+}
+
+void
+HAdaptiveThreadController::Sample(HStageControl& control)
+{
+    control.fBacklogSum += control.fBacklog();
+    control.fIdleSum += control.fStage->GetIdleFraction();
+    control.fNSamples++;
+
+    if(control.fNSamples < fNSamplesPerDecision){return;}
+
+    double mean_backlog = control.fBacklogSum/control.fNSamples;
+    double mean_idle = control.fIdleSum/control.fNSamples;
+    control.fBacklogSum = 0;
+    control.fIdleSum = 0;
+    control.fNSamples = 0;
+
+    unsigned int n_threads = control.fStage->GetNThreads();
+    if(mean_backlog >= fGrowBacklog && mean_idle <= fGrowIdleFraction && n_threads < control.fMaxThreads)
+    {
+        std::cout<<"HAdaptiveThreadController::Sample: backlog of "<<mean_backlog<<" buffers, increasing threads to "<<n_threads+1<<"."<<std::endl;
+        control.fStage->SetNThreads(n_threads+1);
+    }
+    else if(mean_backlog < fShrinkBacklog && mean_idle >= fShrinkIdleFraction && n_threads > control.fMinThreads)
+    {
+        std::cout<<"HAdaptiveThreadController::Sample: idle fraction of "<<mean_idle<<", decreasing threads to "<<n_threads-1<<"."<<std::endl;
+        control.fStage->SetNThreads(n_threads-1);
+    }
+}
+
+}
@@ -0,0 +1,358 @@
+#include "HFITSBinaryTableWriter.hh"
+
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+//size of a FITS logical record and of a header card
+#define HFITS_BLOCK_SIZE 2880
+#define HFITS_CARD_SIZE 80
+
+namespace hose
+{
+
+//FITS stores all numeric values big-endian
+static inline void EncodeBigEndian(uint64_t bits, size_t width, char* dest)
+{
+    for(size_t i=0; i<width; i++){dest[i] = (char) ( (bits >> (8*(width - 1 - i))) & 0xFF );}
+}
+
+static inline void EncodeFloat(float value, char* dest)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(float));
+    EncodeBigEndian(bits, 4, dest);
+}
+
+static inline void EncodeDouble(double value, char* dest)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(double));
+    EncodeBigEndian(bits, 8, dest);
+}
+
+static std::string FinishCard(const std::string& key, const std::string& value, const std::string& comment)
+{
+    std::string card = key.substr(0,8);
+    card.resize(8, ' ');
+    card += "= " + value;
+    if(comment != ""){card += " / " + comment;}
+    card.resize(HFITS_CARD_SIZE, ' ');
+    return card;
+}
+
+static std::string RightJustify(const std::string& value)
+{
+    if(value.size() >= 20){return value;}
+    return std::string(20 - value.size(), ' ') + value;
+}
+
+HFITSBinaryTableWriter::HFITSBinaryTableWriter():
+    fRowSize(0),
+    fFilename(""),
+    fNRowsCardPosition(0),
+    fNRows(0),
+    fNBytes(0)
+{};
+
+HFITSBinaryTableWriter::~HFITSBinaryTableWriter()
+{
+    if(fFile.is_open()){Close();}
+};
+
+std::string
+HFITSBinaryTableWriter::FormatStringCard(const std::string& key, const std::string& value, const std::string& comment)
+{
+    //single quotes are escaped by doubling them, the quoted value is at least 8 characters
+    std::string escaped;
+    for(size_t i=0; i<value.size(); i++)
+    {
+        escaped += value[i];
+        if(value[i] == '\''){escaped += '\'';}
+    }
+    if(escaped.size() < 8){escaped.resize(8, ' ');}
+    std::string quoted = "'" + escaped + "'";
+    if(quoted.size() < 20){quoted.resize(20, ' ');}
+    return FinishCard(key, quoted, comment);
+}
+
+std::string
+HFITSBinaryTableWriter::FormatIntegerCard(const std::string& key, int64_t value, const std::string& comment)
+{
+    std::stringstream ss;
+    ss << value;
+    return FinishCard(key, RightJustify(ss.str()), comment);
+}
+
+std::string
+HFITSBinaryTableWriter::FormatFloatCard(const std::string& key, double value, const std::string& comment)
+{
+    return FinishCard(key, RightJustify(FormatFloatValue(value)), comment);
+}
+
+std::string
+HFITSBinaryTableWriter::FormatLogicalCard(const std::string& key, bool value, const std::string& comment)
+{
+    return FinishCard(key, RightJustify(value ? "T" : "F"), comment);
+}
+
+std::string
+HFITSBinaryTableWriter::FormatFloatValue(double value)
+{
+    //find the fewest significant digits which reproduce the value exactly
+    char buff[64];
+    for(int prec=1; prec<=17; prec++)
+    {
+        std::snprintf(buff, 64, "%.*e", prec-1, value);
+        if(std::strtod(buff, NULL) == value){break;}
+    }
+
+    std::string sval(buff);
+    bool negative = (sval[0] == '-');
+    if(negative){sval = sval.substr(1);}
+    size_t exp_pos = sval.find('e');
+    int exponent = std::atoi( sval.c_str() + exp_pos + 1);
+    std::string digits;
+    for(size_t i=0; i<exp_pos; i++){ if(sval[i] != '.'){digits += sval[i];} }
+    while(digits.size() > 1 && digits[digits.size()-1] == '0'){digits.erase(digits.size()-1);}
+
+    //positional notation for exponents in [-4,16), otherwise scientific (python's repr)
+    std::string out;
+    int n_digits = digits.size();
+    if(exponent >= 16 || exponent < -4)
+    {
+        out = digits.substr(0,1);
+        if(n_digits > 1){out += "." + digits.substr(1);}
+        std::snprintf(buff, 64, "E%c%02d", (exponent < 0) ? '-' : '+', std::abs(exponent) );
+        out += buff;
+    }
+    else if(exponent < 0)
+    {
+        out = "0." + std::string(-exponent-1, '0') + digits;
+    }
+    else if(n_digits <= exponent + 1)
+    {
+        out = digits + std::string(exponent + 1 - n_digits, '0') + ".0";
+    }
+    else
+    {
+        out = digits.substr(0, exponent+1) + "." + digits.substr(exponent+1);
+    }
+    if(negative){out = "-" + out;}
+
+    //a value is limited to 20 characters, drop digits of the significand if necessary
+    if(out.size() > 20)
+    {
+        size_t e_pos = out.find('E');
+        if(e_pos == std::string::npos){out = out.substr(0,20);}
+        else{out = out.substr(0, 20 - (out.size() - e_pos)) + out.substr(e_pos);}
+    }
+    return out;
+}
+
+int
+HFITSBinaryTableWriter::AddColumn(const std::string& name, const std::string& format, const std::string& unit)
+{
+    if(fFile.is_open())
+    {
+        std::cout<<"HFITSBinaryTableWriter::AddColumn: Error, columns must be defined before the file is opened."<<std::endl;
+        return -1;
+    }
+
+    HColumn column;
+    column.fName = name;
+    column.fFormat = format;
+    column.fUnit = unit;
+
+    size_t type_pos = format.find_first_not_of("0123456789");
+    if(type_pos == std::string::npos || type_pos + 1 != format.size() )
+    {
+        std::cout<<"HFITSBinaryTableWriter::AddColumn: Error, cannot parse column format: "<<format<<std::endl;
+        return -1;
+    }
+    column.fRepeat = (type_pos == 0) ? 1 : std::strtoull(format.substr(0, type_pos).c_str(), NULL, 10);
+    column.fType = format[type_pos];
+    switch(column.fType)
+    {
+        case 'A': column.fWidth = 1; break;
+        case 'I': column.fWidth = 2; break;
+        case 'J': column.fWidth = 4; break;
+        case 'K': column.fWidth = 8; break;
+        case 'E': column.fWidth = 4; break;
+        case 'D': column.fWidth = 8; break;
+        default:
+            std::cout<<"HFITSBinaryTableWriter::AddColumn: Error, unsupported column type: "<<column.fType<<std::endl;
+            return -1;
+    }
+    column.fOffset = fRowSize;
+    fRowSize += column.fRepeat*column.fWidth;
+    fColumns.push_back(column);
+    return fColumns.size() - 1;
+}
+
+bool
+HFITSBinaryTableWriter::Open(const std::string& filename)
+{
+    if(fColumns.size() == 0)
+    {
+        std::cout<<"HFITSBinaryTableWriter::Open: Error, no columns have been defined."<<std::endl;
+        return false;
+    }
+
+    fFilename = filename;
+    fFile.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!fFile.is_open())
+    {
+        std::cout<<"HFITSBinaryTableWriter::Open: Error, could not open file: "<<filename<<std::endl;
+        return false;
+    }
+    fNRows = 0;
+
+    std::vector< std::string > primary;
+    primary.push_back( FormatLogicalCard("SIMPLE", true, "conforms to FITS standard") );
+    primary.push_back( FormatIntegerCard("BITPIX", 8, "array data type") );
+    primary.push_back( FormatIntegerCard("NAXIS", 0, "number of array dimensions") );
+    primary.push_back( FormatLogicalCard("EXTEND", true) );
+    primary.insert(primary.end(), fPrimaryCards.begin(), fPrimaryCards.end() );
+    if(!WriteHeader(primary)){return false;}
+
+    //the row count is not known yet, remember where its card goes
+    fNRowsCardPosition = fFile.tellp() + (std::streamoff) (4*HFITS_CARD_SIZE);
+
+    std::vector< std::string > table;
+    table.push_back( FormatStringCard("XTENSION", "BINTABLE", "binary table extension") );
+    table.push_back( FormatIntegerCard("BITPIX", 8, "array data type") );
+    table.push_back( FormatIntegerCard("NAXIS", 2, "number of array dimensions") );
+    table.push_back( FormatIntegerCard("NAXIS1", fRowSize, "length of dimension 1") );
+    table.push_back( FormatIntegerCard("NAXIS2", 0, "length of dimension 2") );
+    table.push_back( FormatIntegerCard("PCOUNT", 0, "number of group parameters") );
+    table.push_back( FormatIntegerCard("GCOUNT", 1, "number of groups") );
+    table.push_back( FormatIntegerCard("TFIELDS", fColumns.size(), "number of table fields") );
+    for(size_t i=0; i<fColumns.size(); i++)
+    {
+        std::stringstream ss;
+        ss << (i+1);
+        table.push_back( FormatStringCard("TTYPE" + ss.str(), fColumns[i].fName) );
+        table.push_back( FormatStringCard("TFORM" + ss.str(), fColumns[i].fFormat) );
+        if(fColumns[i].fUnit != ""){table.push_back( FormatStringCard("TUNIT" + ss.str(), fColumns[i].fUnit) );}
+    }
+    table.insert(table.end(), fTableCards.begin(), fTableCards.end() );
+    return WriteHeader(table);
+}
+
+bool
+HFITSBinaryTableWriter::WriteRows(const char* rows, size_t n_rows)
+{
+    if(!fFile.is_open()){return false;}
+    fFile.write(rows, (std::streamsize) (n_rows*fRowSize) );
+    if(!fFile.good())
+    {
+        std::cout<<"HFITSBinaryTableWriter::WriteRows: Error, failed to write to file: "<<fFilename<<std::endl;
+        return false;
+    }
+    fNRows += n_rows;
+    fNBytes += n_rows*fRowSize;
+    return true;
+}
+
+bool
+HFITSBinaryTableWriter::Close()
+{
+    if(!fFile.is_open()){return false;}
+
+    bool ok = PadBlock('\0');
+    fFile.seekp(fNRowsCardPosition);
+    std::string card = FormatIntegerCard("NAXIS2", fNRows, "length of dimension 2");
+    fFile.write(card.c_str(), HFITS_CARD_SIZE);
+    ok = ok && fFile.good();
+    fFile.close();
+
+    if(!ok){std::cout<<"HFITSBinaryTableWriter::Close: Error, failed to write to file: "<<fFilename<<std::endl;}
+    return ok;
+}
+
+bool
+HFITSBinaryTableWriter::WriteHeader(const std::vector< std::string >& cards)
+{
+    fNBytes = 0;
+    for(size_t i=0; i<cards.size(); i++)
+    {
+        std::string card = cards[i];
+        card.resize(HFITS_CARD_SIZE, ' ');
+        fFile.write(card.c_str(), HFITS_CARD_SIZE);
+        fNBytes += HFITS_CARD_SIZE;
+    }
+    std::string end_card = "END";
+    end_card.resize(HFITS_CARD_SIZE, ' ');
+    fFile.write(end_card.c_str(), HFITS_CARD_SIZE);
+    fNBytes += HFITS_CARD_SIZE;
+    bool ok = PadBlock(' ');
+    fNBytes = 0;
+
+    if(!ok){std::cout<<"HFITSBinaryTableWriter::WriteHeader: Error, failed to write to file: "<<fFilename<<std::endl;}
+    return ok;
+}
+
+bool
+HFITSBinaryTableWriter::PadBlock(char fill)
+{
+    size_t remainder = fNBytes % HFITS_BLOCK_SIZE;
+    if(remainder != 0)
+    {
+        std::string padding(HFITS_BLOCK_SIZE - remainder, fill);
+        fFile.write(padding.c_str(), padding.size());
+        fNBytes += padding.size();
+    }
+    return fFile.good();
+}
+
+void
+HFITSBinaryTableWriter::SetField(char* row, unsigned int col, const std::string& value) const
+{
+    const HColumn& column = fColumns[col];
+    char* dest = row + column.fOffset;
+    for(size_t i=0; i<column.fRepeat*column.fWidth; i++){dest[i] = (i < value.size()) ? value[i] : '\0';}
+}
+
+void
+HFITSBinaryTableWriter::SetField(char* row, unsigned int col, double value, size_t index) const
+{
+    const HColumn& column = fColumns[col];
+    if(index >= column.fRepeat){return;}
+    char* dest = row + column.fOffset + index*column.fWidth;
+    switch(column.fType)
+    {
+        case 'I': EncodeBigEndian( (uint16_t) ( (int16_t) std::llround(value) ), 2, dest); break;
+        case 'J': EncodeBigEndian( (uint32_t) ( (int32_t) std::llround(value) ), 4, dest); break;
+        case 'K': EncodeBigEndian( (uint64_t) ( (int64_t) std::llround(value) ), 8, dest); break;
+        case 'E': EncodeFloat( (float) value, dest); break;
+        case 'D': EncodeDouble(value, dest); break;
+        default: break;
+    }
+}
+
+void
+HFITSBinaryTableWriter::SetField(char* row, unsigned int col, const float* values, size_t n) const
+{
+    const HColumn& column = fColumns[col];
+    if(column.fType == 'E')
+    {
+        char* dest = row + column.fOffset;
+        for(size_t i=0; i<n && i<column.fRepeat; i++){EncodeFloat(values[i], dest + 4*i);}
+    }
+    else
+    {
+        for(size_t i=0; i<n && i<column.fRepeat; i++){SetField(row, col, (double) values[i], i);}
+    }
+}
+
+void
+HFITSBinaryTableWriter::SetField(char* row, unsigned int col, const double* values, size_t n) const
+{
+    for(size_t i=0; i<n && i<fColumns[col].fRepeat; i++){SetField(row, col, values[i], i);}
+}
+
+}//end of namespace
@@ -0,0 +1,430 @@
+#include "HObservingGeometry.hh"
+
+#include <cmath>
+#include <algorithm>
+
+namespace hose
+{
+
+static const double kDeg = M_PI/180.0;
+static const double kArcSec = kDeg/3600.0;
+static const double kTwoPi = 2.0*M_PI;
+static const double kSpeedOfLight = 299792458.0; //m/s
+static const double kAU = 149597870700.0; //m
+static const double kDaysPerCentury = 36525.0;
+static const double kUnixEpochDaysFromJ2000 = -10957.5; //JD 2440587.5 - JD 2451545.0
+static const double kTTMinusUTC = 69.184; //seconds, 32.184 + 37 leap seconds (valid from 2017)
+static const double kObliquityJ2000 = 23.43928*kDeg; //obliquity of the J2000 ecliptic
+
+//WGS84 ellipsoid and earth rotation rate
+static const double kEarthRadius = 6378137.0;
+static const double kEarthFlattening = 1.0/298.257223563;
+static const double kEarthRotationRate = kTwoPi*1.00273781191135448/86400.0;
+
+//gravitational parameters (m^3/s^2) of the bodies contributing to the gravitational redshift
+static const double kGMSun = 1.3271244e20;
+static const double kGMJupiter = 1.2668653e17;
+static const double kGMMoon = 4.9041e12;
+static const double kGMEarth = 3.986004e14;
+static const double kMoonEarthMassRatio = 0.0123000371;
+
+//mean orbital elements of the planets and the earth-moon barycenter w.r.t. the mean ecliptic and equinox of J2000
+//(Standish, valid 1800-2050) a (AU), e, I, L, long. perihelion, long. ascending node (degrees) and their rates per century
+static const unsigned int kNPlanets = 8;
+static const unsigned int kEarthMoonBarycenter = 2;
+static const unsigned int kJupiter = 4;
+static const double kPlanetElements[kNPlanets][6] =
+{
+    { 0.38709927, 0.20563593,  7.00497902, 252.25032350,  77.45779628,  48.33076593},
+    { 0.72333566, 0.00677672,  3.39467605, 181.97909950, 131.60246718,  76.67984255},
+    { 1.00000261, 0.01671123, -0.00001531, 100.46457166, 102.93768193,   0.0       },
+    { 1.52371034, 0.09339410,  1.84969142,  -4.55343205, -23.94362959,  49.55953891},
+    { 5.20288700, 0.04838624,  1.30439695,  34.39644051,  14.72847983, 100.47390909},
+    { 9.53667594, 0.05386179,  2.48599187,  49.95424423,  92.59887831, 113.66242448},
+    {19.18916464, 0.04725744,  0.77263783, 313.23810451, 170.95427630,  74.01692503},
+    {30.06992276, 0.00859048,  1.77004347, -55.12002969,  44.96476227, 131.78422574}
+};
+static const double kPlanetRates[kNPlanets][6] =
+{
+    { 0.00000037,  0.00001906, -0.00594749, 149472.67411175,  0.16047689, -0.12534081},
+    { 0.00000390, -0.00004107, -0.00078890,  58517.81538729,  0.00268329, -0.27769418},
+    { 0.00000562, -0.00004392, -0.01294668,  35999.37244981,  0.32327364,  0.0       },
+    { 0.00001847,  0.00007882, -0.00813131,  19140.30268499,  0.44441088, -0.29257343},
+    {-0.00011607, -0.00013253, -0.00183714,   3034.74612775,  0.21252668,  0.20469106},
+    {-0.00125060,  0.00050991,  0.00193609,   1222.49362201, -0.41897216, -0.28867794},
+    {-0.00196176, -0.00004397, -0.00242939,    428.48202785,  0.40805281,  0.04240589},
+    { 0.00026291,  0.00005105,  0.00035372,    218.45945325, -0.32241464, -0.00508664}
+};
+
+//planet (and earth+moon) to sun mass ratios
+static const double kPlanetMassRatios[kNPlanets] =
+{
+    1.0/6023600.0, 1.0/408523.71, 1.0/328900.56, 1.0/3098708.0,
+    1.0/1047.3486, 1.0/3497.898, 1.0/22902.98, 1.0/19412.24
+};
+
+//largest terms of the IAU 1980 nutation series, multipliers of D, M, M', F, Omega
+//and the coefficients of dpsi and deps (units of 0.0001 arcsec, and per century)
+static const unsigned int kNNutationTerms = 13;
+static const double kNutationTerms[kNNutationTerms][9] =
+{
+    { 0,  0,  0,  0, 1, -171996.0, -174.2, 92025.0,  8.9},
+    {-2,  0,  0,  2, 2,  -13187.0,   -1.6,  5736.0, -3.1},
+    { 0,  0,  0,  2, 2,   -2274.0,   -0.2,   977.0, -0.5},
+    { 0,  0,  0,  0, 2,    2062.0,    0.2,  -895.0,  0.5},
+    { 0,  1,  0,  0, 0,    1426.0,   -3.4,    54.0, -0.1},
+    { 0,  0,  1,  0, 0,     712.0,    0.1,    -7.0,  0.0},
+    {-2,  1,  0,  2, 2,    -517.0,    1.2,   224.0, -0.6},
+    { 0,  0,  0,  2, 1,    -386.0,   -0.4,   200.0,  0.0},
+    { 0,  0,  1,  2, 2,    -301.0,    0.0,   129.0, -0.1},
+    {-2, -1,  0,  2, 2,     217.0,   -0.5,   -95.0,  0.3},
+    {-2,  0,  1,  0, 0,    -158.0,    0.0,     0.0,  0.0},
+    {-2,  0,  0,  2, 1,     129.0,    0.1,   -70.0,  0.0},
+    { 0,  0, -1,  2, 2,     123.0,    0.0,   -53.0,  0.0}
+};
+
+//rotation matrices (of the coordinate frame) about the x, y, z axes
+static void RotationMatrix(unsigned int axis, double angle, double m[3][3])
+{
+    double c = std::cos(angle);
+    double s = std::sin(angle);
+    unsigned int i = (axis + 1) % 3;
+    unsigned int j = (axis + 2) % 3;
+    for(unsigned int r=0; r<3; r++){for(unsigned int k=0; k<3; k++){m[r][k] = (r == k) ? 1.0 : 0.0;}}
+    m[i][i] = c; m[i][j] = s;
+    m[j][i] = -s; m[j][j] = c;
+}
+
+//a = b*a
+static void MultiplyInPlace(const double b[3][3], double a[3][3])
+{
+    double tmp[3][3];
+    for(unsigned int r=0; r<3; r++)
+    {
+        for(unsigned int k=0; k<3; k++){tmp[r][k] = b[r][0]*a[0][k] + b[r][1]*a[1][k] + b[r][2]*a[2][k];}
+    }
+    for(unsigned int r=0; r<3; r++){for(unsigned int k=0; k<3; k++){a[r][k] = tmp[r][k];}}
+}
+
+static double Norm(const double v[3])
+{
+    return std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+}
+
+static double Distance(const double a[3], const double b[3])
+{
+    double d[3] = {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+    return Norm(d);
+}
+
+static double WrapTwoPi(double angle)
+{
+    angle = std::fmod(angle, kTwoPi);
+    if(angle < 0){angle += kTwoPi;}
+    return angle;
+}
+
+//ecliptic (J2000) to equatorial (J2000)
+static void EclipticToEquatorial(const double ecl[3], double eq[3])
+{
+    double c = std::cos(kObliquityJ2000);
+    double s = std::sin(kObliquityJ2000);
+    eq[0] = ecl[0];
+    eq[1] = c*ecl[1] - s*ecl[2];
+    eq[2] = s*ecl[1] + c*ecl[2];
+}
+
+HObservingGeometry::HObservingGeometry():
+    fLongitude(0.0),
+    fLatitude(0.0),
+    fLocalMeanSiderealTime(0.0),
+    fLocalApparentSiderealTime(0.0),
+    fGravitationalRedshift(0.0)
+{
+    for(unsigned int i=0; i<3; i++)
+    {
+        fSitePosition[i] = 0.0;
+        fObserverVelocity[i] = 0.0;
+        for(unsigned int j=0; j<3; j++){fPrecessionNutation[i][j] = (i == j) ? 1.0 : 0.0;}
+    }
+    SetSiteLocation(0.0, 0.0, 0.0);
+};
+
+HObservingGeometry::~HObservingGeometry(){};
+
+void
+HObservingGeometry::SetSiteLocation(double longitude, double latitude, double elevation)
+{
+    fLongitude = longitude*kDeg;
+    fLatitude = latitude*kDeg;
+    double e2 = kEarthFlattening*(2.0 - kEarthFlattening);
+    double n = kEarthRadius/std::sqrt(1.0 - e2*std::sin(fLatitude)*std::sin(fLatitude));
+    fSitePosition[0] = (n + elevation)*std::cos(fLatitude)*std::cos(fLongitude);
+    fSitePosition[1] = (n + elevation)*std::cos(fLatitude)*std::sin(fLongitude);
+    fSitePosition[2] = (n*(1.0 - e2) + elevation)*std::sin(fLatitude);
+}
+
+void
+HObservingGeometry::SetTime(double utc_epoch_sec)
+{
+    //days since J2000 (UT1 = UTC) and centuries since J2000 (TT, also used for TDB)
+    double du = utc_epoch_sec/86400.0 + kUnixEpochDaysFromJ2000;
+    double t = (du + kTTMinusUTC/86400.0)/kDaysPerCentury;
+
+    //mean sidereal time from the earth rotation angle (IAU 2006)
+    double era = kTwoPi*( (du - std::floor(du)) + 0.7790572732640 + 0.00273781191135448*du );
+    double gmst = era + (0.014506 + t*(4612.156534 + t*(1.3915817 + t*(-0.00000044 + t*(-0.000029956)))))*kArcSec;
+    double lmst = WrapTwoPi(gmst + fLongitude);
+    fLocalMeanSiderealTime = 86400.0*lmst/kTwoPi;
+
+    //nutation
+    double d = (297.85036 + 445267.111480*t)*kDeg;
+    double m = (357.52772 + 35999.050340*t)*kDeg;
+    double mp = (134.96298 + 477198.867398*t)*kDeg;
+    double f = (93.27191 + 483202.017538*t)*kDeg;
+    double om = (125.04452 - 1934.136261*t)*kDeg;
+    double dpsi = 0.0;
+    double deps = 0.0;
+    for(unsigned int i=0; i<kNNutationTerms; i++)
+    {
+        const double* c = kNutationTerms[i];
+        double arg = c[0]*d + c[1]*m + c[2]*mp + c[3]*f + c[4]*om;
+        dpsi += (c[5] + c[6]*t)*std::sin(arg);
+        deps += (c[7] + c[8]*t)*std::cos(arg);
+    }
+    dpsi *= 1e-4*kArcSec;
+    deps *= 1e-4*kArcSec;
+    double eps0 = (84381.448 + t*(-46.8150 + t*(-0.00059 + t*0.001813)))*kArcSec;
+
+    double gast = gmst + dpsi*std::cos(eps0 + deps);
+    fLocalApparentSiderealTime = WrapTwoPi(gast + fLongitude);
+
+    //precession (IAU 1976) followed by nutation, J2000 -> true of date
+    double zeta = (2306.2181*t + 0.30188*t*t + 0.017998*t*t*t)*kArcSec;
+    double z = (2306.2181*t + 1.09468*t*t + 0.018203*t*t*t)*kArcSec;
+    double theta = (2004.3109*t - 0.42665*t*t - 0.041833*t*t*t)*kArcSec;
+    double r[3][3];
+    RotationMatrix(2, -zeta, fPrecessionNutation);
+    RotationMatrix(1, theta, r); MultiplyInPlace(r, fPrecessionNutation);
+    RotationMatrix(2, -z, r); MultiplyInPlace(r, fPrecessionNutation);
+    RotationMatrix(0, eps0, r); MultiplyInPlace(r, fPrecessionNutation);
+    RotationMatrix(2, -dpsi, r); MultiplyInPlace(r, fPrecessionNutation);
+    RotationMatrix(0, -(eps0 + deps), r); MultiplyInPlace(r, fPrecessionNutation);
+
+    //barycentric state of the sun, from the reflex motion due to the planets
+    double pos[3], vel[3];
+    double sun_pos[3] = {0.0, 0.0, 0.0};
+    double sun_vel[3] = {0.0, 0.0, 0.0};
+    double emb_pos[3] = {0.0, 0.0, 0.0};
+    double emb_vel[3] = {0.0, 0.0, 0.0};
+    double jupiter_pos[3] = {0.0, 0.0, 0.0};
+    double total_mass = 1.0;
+    for(unsigned int p=0; p<kNPlanets; p++)
+    {
+        GetPlanetState(p, t, pos, vel);
+        for(unsigned int i=0; i<3; i++)
+        {
+            sun_pos[i] -= kPlanetMassRatios[p]*pos[i];
+            sun_vel[i] -= kPlanetMassRatios[p]*vel[i];
+            if(p == kEarthMoonBarycenter){emb_pos[i] = pos[i]; emb_vel[i] = vel[i];}
+            if(p == kJupiter){jupiter_pos[i] = pos[i];}
+        }
+        total_mass += kPlanetMassRatios[p];
+    }
+
+    //the earth is offset from the earth-moon barycenter (moon velocity by finite difference)
+    double moon_pos[3], moon_plus[3], moon_minus[3];
+    double h = 0.01; //days
+    GetMoonPosition(t, moon_pos);
+    GetMoonPosition(t + h/kDaysPerCentury, moon_plus);
+    GetMoonPosition(t - h/kDaysPerCentury, moon_minus);
+    double mu = kMoonEarthMassRatio/(1.0 + kMoonEarthMassRatio);
+
+    double earth_pos[3], earth_vel[3], sun_bary[3], jupiter_bary[3];
+    for(unsigned int i=0; i<3; i++)
+    {
+        sun_bary[i] = sun_pos[i]/total_mass;
+        jupiter_bary[i] = sun_bary[i] + jupiter_pos[i];
+        earth_pos[i] = sun_bary[i] + emb_pos[i] - mu*moon_pos[i];
+        earth_vel[i] = sun_vel[i]/total_mass + emb_vel[i] - mu*(moon_plus[i] - moon_minus[i])/(2.0*h);
+    }
+
+    //velocity of the site due to the earth's rotation, true of date -> J2000
+    double c = std::cos(gast);
+    double s = std::sin(gast);
+    double site_tod[3] = {c*fSitePosition[0] - s*fSitePosition[1], s*fSitePosition[0] + c*fSitePosition[1], fSitePosition[2]};
+    double rot_vel_tod[3] = {-kEarthRotationRate*site_tod[1], kEarthRotationRate*site_tod[0], 0.0};
+    double rot_vel[3];
+    RotateInverse(fPrecessionNutation, rot_vel_tod, rot_vel);
+    for(unsigned int i=0; i<3; i++){fObserverVelocity[i] = earth_vel[i]*kAU/86400.0 + rot_vel[i];}
+
+    //gravitational redshift due to the sun, jupiter, moon and earth
+    fGravitationalRedshift = -( kGMSun/(Distance(earth_pos, sun_bary)*kAU) + kGMJupiter/(Distance(earth_pos, jupiter_bary)*kAU)
+                              + kGMMoon/(Norm(moon_pos)*kAU) + kGMEarth/Norm(fSitePosition) )/kSpeedOfLight;
+}
+
+void
+HObservingGeometry::ConvertAzElToRADec(double az, double el, double& ra, double& dec) const
+{
+    //horizon to hour angle/declination (true equator of date)
+    double sa = std::sin(az*kDeg);
+    double ca = std::cos(az*kDeg);
+    double se = std::sin(el*kDeg);
+    double ce = std::cos(el*kDeg);
+    double sl = std::sin(fLatitude);
+    double cl = std::cos(fLatitude);
+    double sin_dec = sl*se + cl*ce*ca;
+    double hour_angle = std::atan2(-sa*ce, se*cl - ce*ca*sl);
+    double app_dec = std::asin( std::max(-1.0, std::min(1.0, sin_dec) ) );
+    double app_ra = fLocalApparentSiderealTime - hour_angle;
+
+    //to J2000
+    double p_tod[3] = {std::cos(app_dec)*std::cos(app_ra), std::cos(app_dec)*std::sin(app_ra), std::sin(app_dec)};
+    double p[3];
+    RotateInverse(fPrecessionNutation, p_tod, p);
+
+    //remove the (annual + diurnal) aberration
+    double beta[3];
+    for(unsigned int i=0; i<3; i++){beta[i] = fObserverVelocity[i]/kSpeedOfLight;}
+    double pb = p[0]*beta[0] + p[1]*beta[1] + p[2]*beta[2];
+    for(unsigned int i=0; i<3; i++){p[i] = p[i] - beta[i] + pb*p[i];}
+    double norm = Norm(p);
+
+    ra = WrapTwoPi(std::atan2(p[1], p[0]))/kDeg;
+    dec = std::asin(p[2]/norm)/kDeg;
+}
+
+double
+HObservingGeometry::GetBarycentricCorrection(double ra, double dec) const
+{
+    //eq. 28 of Wright & Eastman (2014), neglecting the Shapiro delay and the motion of the source
+    double n[3] = {std::cos(dec*kDeg)*std::cos(ra*kDeg), std::cos(dec*kDeg)*std::sin(ra*kDeg), std::sin(dec*kDeg)};
+    double beta_n = 0.0;
+    double beta2 = 0.0;
+    for(unsigned int i=0; i<3; i++)
+    {
+        double beta = fObserverVelocity[i]/kSpeedOfLight;
+        beta_n += beta*n[i];
+        beta2 += beta*beta;
+    }
+    double gamma = 1.0/std::sqrt(1.0 - beta2);
+    double zb = gamma*(1.0 + beta_n)/(1.0 + fGravitationalRedshift/kSpeedOfLight);
+    return kSpeedOfLight*(zb - 1.0);
+}
+
+void
+HObservingGeometry::ConvertRADecToGalactic(double ra, double dec, double& l, double& b)
+{
+    static const double icrs_to_galactic[3][3] =
+    {
+        {-0.0548755604162154, -0.8734370902348850, -0.4838350155487132},
+        { 0.4941094278755837, -0.4448296299600112,  0.7469822444972189},
+        {-0.8676661490190047, -0.1980763734312015,  0.4559837761750669}
+    };
+    double p[3] = {std::cos(dec*kDeg)*std::cos(ra*kDeg), std::cos(dec*kDeg)*std::sin(ra*kDeg), std::sin(dec*kDeg)};
+    double g[3];
+    Rotate(icrs_to_galactic, p, g);
+    l = WrapTwoPi(std::atan2(g[1], g[0]))/kDeg;
+    b = std::asin( std::max(-1.0, std::min(1.0, g[2]) ) )/kDeg;
+}
+
+double
+HObservingGeometry::GetLSRCorrection(double ra, double dec)
+{
+    //solar motion (U,V,W) = (10.0, 15.4, 7.8) km/s
+    double l, b;
+    ConvertRADecToGalactic(ra, dec, l, b);
+    double cl = std::cos(l*kDeg);
+    double sl = std::sin(l*kDeg);
+    double cb = std::cos(b*kDeg);
+    double sb = std::sin(b*kDeg);
+    return 1000.0*(cb*cl*10.0 + cb*sl*15.4 + sb*7.8);
+}
+
+void
+HObservingGeometry::Rotate(const double m[3][3], const double in[3], double out[3])
+{
+    for(unsigned int i=0; i<3; i++){out[i] = m[i][0]*in[0] + m[i][1]*in[1] + m[i][2]*in[2];}
+}
+
+void
+HObservingGeometry::RotateInverse(const double m[3][3], const double in[3], double out[3])
+{
+    for(unsigned int i=0; i<3; i++){out[i] = m[0][i]*in[0] + m[1][i]*in[1] + m[2][i]*in[2];}
+}
+
+void
+HObservingGeometry::GetPlanetState(unsigned int planet, double t, double pos[3], double vel[3])
+{
+    const double* el = kPlanetElements[planet];
+    const double* rate = kPlanetRates[planet];
+    double a = el[0] + rate[0]*t;
+    double e = el[1] + rate[1]*t;
+    double inc = (el[2] + rate[2]*t)*kDeg;
+    double mean_long = (el[3] + rate[3]*t)*kDeg;
+    double peri = (el[4] + rate[4]*t)*kDeg;
+    double node = (el[5] + rate[5]*t)*kDeg;
+    double arg_peri = peri - node;
+    double mean_anomaly = std::remainder(mean_long - peri, kTwoPi);
+    double mean_motion = rate[3]*kDeg/kDaysPerCentury; //radians per day
+
+    //Kepler's equation
+    double ecc_anomaly = mean_anomaly + e*std::sin(mean_anomaly);
+    for(unsigned int i=0; i<10; i++)
+    {
+        ecc_anomaly -= (ecc_anomaly - e*std::sin(ecc_anomaly) - mean_anomaly)/(1.0 - e*std::cos(ecc_anomaly));
+    }
+    double ce = std::cos(ecc_anomaly);
+    double se = std::sin(ecc_anomaly);
+    double q = std::sqrt(1.0 - e*e);
+    double ecc_rate = mean_motion/(1.0 - e*ce);
+    double orb_pos[2] = {a*(ce - e), a*q*se};
+    double orb_vel[2] = {-a*se*ecc_rate, a*q*ce*ecc_rate};
+
+    //orbital plane to the ecliptic
+    double cw = std::cos(arg_peri);
+    double sw = std::sin(arg_peri);
+    double cn = std::cos(node);
+    double sn = std::sin(node);
+    double ci = std::cos(inc);
+    double si = std::sin(inc);
+    double m[3][2] =
+    {
+        {cw*cn - sw*sn*ci, -sw*cn - cw*sn*ci},
+        {cw*sn + sw*cn*ci, -sw*sn + cw*cn*ci},
+        {sw*si, cw*si}
+    };
+    double ecl_pos[3], ecl_vel[3];
+    for(unsigned int i=0; i<3; i++)
+    {
+        ecl_pos[i] = m[i][0]*orb_pos[0] + m[i][1]*orb_pos[1];
+        ecl_vel[i] = m[i][0]*orb_vel[0] + m[i][1]*orb_vel[1];
+    }
+    EclipticToEquatorial(ecl_pos, pos);
+    EclipticToEquatorial(ecl_vel, vel);
+}
+
+void
+HObservingGeometry::GetMoonPosition(double t, double pos[3])
+{
+    //low precision lunar ephemeris (Astronomical Almanac), about 0.3 degrees
+    double lambda = 218.32 + 481267.881*t
+                  + 6.29*std::sin((135.0 + 477198.87*t)*kDeg) - 1.27*std::sin((259.3 - 413335.36*t)*kDeg)
+                  + 0.66*std::sin((235.7 + 890534.22*t)*kDeg) + 0.21*std::sin((269.9 + 954397.74*t)*kDeg)
+                  - 0.19*std::sin((357.5 + 35999.05*t)*kDeg) - 0.11*std::sin((186.5 + 966404.03*t)*kDeg);
+    double beta = 5.13*std::sin((93.3 + 483202.02*t)*kDeg) + 0.28*std::sin((228.2 + 960400.89*t)*kDeg)
+                - 0.28*std::sin((318.3 + 6003.15*t)*kDeg) - 0.17*std::sin((217.6 - 407332.21*t)*kDeg);
+    double parallax = 0.9508 + 0.0518*std::cos((135.0 + 477198.87*t)*kDeg) + 0.0095*std::cos((259.3 - 413335.36*t)*kDeg)
+                    + 0.0078*std::cos((235.7 + 890534.22*t)*kDeg) + 0.0028*std::cos((269.9 + 954397.74*t)*kDeg);
+    double dist = kEarthRadius/std::sin(parallax*kDeg)/kAU;
+
+    double ecl[3] =
+    {
+        dist*std::cos(beta*kDeg)*std::cos(lambda*kDeg),
+        dist*std::cos(beta*kDeg)*std::sin(lambda*kDeg),
+        dist*std::sin(beta*kDeg)
+    };
+    EclipticToEquatorial(ecl, pos);
+}
+
+}//end of namespace
@@ -0,0 +1,367 @@
+#include "HTaskScheduler.hh"
+#include "HThreadPool.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <unistd.h>
+
+namespace hose
+{
+
+//index of the worker owned by the calling thread (-1 if it is not a scheduler worker)
+static thread_local int tWorkerIndex = -1;
+
+HTaskScheduler*
+HTaskScheduler::GetInstance()
+{
+    static HTaskScheduler instance;
+    return &instance;
+}
+
+HTaskScheduler::HTaskScheduler():
+    fNThreads(1),
+    fIdleSleepMicroSeconds(10),
+    fRunning(false),
+    fStop(false),
+    fNextQueue(0),
+    fStageGeneration(0)
+{
+    unsigned int n_cores = std::thread::hardware_concurrency();
+    if(n_cores != 0){fNThreads = n_cores;}
+}
+
+HTaskScheduler::~HTaskScheduler()
+{
+    Terminate();
+}
+
+void
+HTaskScheduler::SetNThreads(unsigned int n)
+{
+    std::lock_guard<std::mutex> lock(fLaunchMutex);
+    if(!fRunning)
+    {
+        if(n != 0){fNThreads = n;}
+    }
+    else
+    {
+        std::cout<<"HTaskScheduler::SetNThreads: Error, cannot change the number of workers after launch."<<std::endl;
+    }
+}
+
+void
+HTaskScheduler::Launch()
+{
+    std::lock_guard<std::mutex> lock(fLaunchMutex);
+    if(!fRunning)
+    {
+        fStop = false;
+        fQueues.clear();
+        for(unsigned int i=0; i<fNThreads; i++)
+        {
+            fQueues.push_back( std::unique_ptr< HWorkerQueue >( new HWorkerQueue() ) );
+        }
+        for(unsigned int i=0; i<fNThreads; i++)
+        {
+            fWorkers.push_back( std::thread( &HTaskScheduler::WorkerLoop, this, i ) );
+        }
+        fRunning = true;
+    }
+}
+
+void
+HTaskScheduler::Terminate()
+{
+    std::lock_guard<std::mutex> lock(fLaunchMutex);
+    if(fRunning)
+    {
+        fStop = true;
+        for(unsigned int i=0; i<fWorkers.size(); i++)
+        {
+            fWorkers[i].join();
+        }
+        fWorkers.clear();
+        fQueues.clear();
+        fRunning = false;
+    }
+}
+
+void
+HTaskScheduler::Submit(const std::function< void() >& task)
+{
+    if(!fRunning)
+    {
+        //nobody to hand it to, just do it now
+        task();
+        return;
+    }
+
+    unsigned int index;
+    if(tWorkerIndex >= 0 && tWorkerIndex < (int)fQueues.size())
+    {
+        index = tWorkerIndex;
+    }
+    else
+    {
+        index = (fNextQueue++)%fQueues.size();
+    }
+
+    std::lock_guard<std::mutex> lock(fQueues[index]->fMutex);
+    fQueues[index]->fTasks.push_back(task);
+}
+
+void
+HTaskScheduler::ParallelFor(std::size_t n, const std::function< void(std::size_t) >& task)
+{
+    if(n == 0){return;}
+
+    if(!fRunning || n == 1)
+    {
+        for(std::size_t i=0; i<n; i++){task(i);}
+        return;
+    }
+
+    //indices are handed out dynamically, so faster workers take more of them
+    struct HLoopState
+    {
+        std::atomic<std::size_t> fNext;
+        std::atomic<std::size_t> fNDone;
+    };
+    std::shared_ptr< HLoopState > state = std::make_shared< HLoopState >();
+    state->fNext = 0;
+    state->fNDone = 0;
+
+    //the task is only touched while there are indices left, which cannot outlive this call
+    const std::function< void(std::size_t) >* task_ptr = &task;
+    std::function< void() > body = [state, n, task_ptr]()
+    {
+        std::size_t i;
+        while( (i = state->fNext++) < n )
+        {
+            (*task_ptr)(i);
+            state->fNDone++;
+        }
+    };
+
+    std::size_t n_helpers = std::min< std::size_t >(n-1, fNThreads);
+    for(std::size_t i=0; i<n_helpers; i++){Submit(body);}
+
+    //do our share, then help out with any other queued work while the rest finishes
+    body();
+    unsigned int worker_id = (tWorkerIndex >= 0) ? tWorkerIndex : 0;
+    std::function< void() > other;
+    while(state->fNDone < n)
+    {
+        if( (tWorkerIndex >= 0 && PopTask(worker_id, other)) || StealTask(worker_id, other) )
+        {
+            other();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void
+HTaskScheduler::RegisterStage(HThreadPool* stage, int priority, unsigned int max_concurrency)
+{
+    if(stage == nullptr){return;}
+
+    {
+        std::lock_guard<std::mutex> lock(fStageMutex);
+        for(unsigned int i=0; i<fStages.size(); i++)
+        {
+            if(fStages[i]->fStage == stage)
+            {
+                std::cout<<"HTaskScheduler::RegisterStage: Warning, stage already registered."<<std::endl;
+                return;
+            }
+        }
+
+        std::shared_ptr< HStageEntry > entry = std::make_shared< HStageEntry >();
+        entry->fStage = stage;
+        entry->fPriority = priority;
+        entry->fMaxConcurrency = std::max(1u, max_concurrency);
+        entry->fNActive = 0;
+        entry->fEnabled = true;
+
+        //keep the list sorted by decreasing priority (stable w.r.t. order of registration)
+        auto pos = std::upper_bound(fStages.begin(), fStages.end(), entry,
+            [](const std::shared_ptr< HStageEntry >& a, const std::shared_ptr< HStageEntry >& b){return a->fPriority > b->fPriority;} );
+        fStages.insert(pos, entry);
+        fStageGeneration++;
+    }
+
+    //stages need somebody to run them
+    if(!fRunning){Launch();}
+}
+
+void
+HTaskScheduler::SetStageConcurrency(HThreadPool* stage, unsigned int max_concurrency)
+{
+    std::shared_ptr< HStageEntry > entry = FindStage(stage);
+    if(entry){entry->fMaxConcurrency = std::max(1u, max_concurrency);}
+}
+
+void
+HTaskScheduler::UnregisterStage(HThreadPool* stage)
+{
+    std::shared_ptr< HStageEntry > entry;
+    {
+        std::lock_guard<std::mutex> lock(fStageMutex);
+        for(auto it = fStages.begin(); it != fStages.end(); it++)
+        {
+            if( (*it)->fStage == stage )
+            {
+                entry = *it;
+                fStages.erase(it);
+                fStageGeneration++;
+                break;
+            }
+        }
+    }
+
+    if(entry)
+    {
+        //workers claim a slot before checking the enabled flag, so once the active count
+        //drops to zero after disabling, no new task for this stage can start
+        entry->fEnabled = false;
+        while(entry->fNActive != 0)
+        {
+            usleep(fIdleSleepMicroSeconds);
+        }
+    }
+}
+
+bool
+HTaskScheduler::IsRegistered(const HThreadPool* stage)
+{
+    return (bool) FindStage(stage);
+}
+
+unsigned int
+HTaskScheduler::GetNActiveStageTasks(const HThreadPool* stage)
+{
+    std::shared_ptr< HStageEntry > entry = FindStage(stage);
+    if(entry){return entry->fNActive;}
+    return 0;
+}
+
+std::shared_ptr< HTaskScheduler::HStageEntry >
+HTaskScheduler::FindStage(const HThreadPool* stage)
+{
+    std::lock_guard<std::mutex> lock(fStageMutex);
+    for(unsigned int i=0; i<fStages.size(); i++)
+    {
+        if(fStages[i]->fStage == stage){return fStages[i];}
+    }
+    return std::shared_ptr< HStageEntry >();
+}
+
+void
+HTaskScheduler::WorkerLoop(unsigned int worker_id)
+{
+    tWorkerIndex = worker_id;
+
+    std::vector< std::shared_ptr< HStageEntry > > stages;
+    unsigned int generation = fStageGeneration - 1; //force an initial copy
+
+    std::function< void() > task;
+    while(!fStop)
+    {
+        //one-off tasks first (somebody is usually waiting on them), then stage work
+        if( PopTask(worker_id, task) || StealTask(worker_id, task) )
+        {
+            task();
+        }
+        else if( !RunStageTask(worker_id, stages, generation) )
+        {
+            usleep(fIdleSleepMicroSeconds);
+        }
+    }
+
+    tWorkerIndex = -1;
+}
+
+bool
+HTaskScheduler::PopTask(unsigned int worker_id, std::function< void() >& task)
+{
+    HWorkerQueue* queue = fQueues[worker_id].get();
+    std::lock_guard<std::mutex> lock(queue->fMutex);
+    if(queue->fTasks.size() != 0)
+    {
+        task = queue->fTasks.back();
+        queue->fTasks.pop_back();
+        return true;
+    }
+    return false;
+}
+
+bool
+HTaskScheduler::StealTask(unsigned int worker_id, std::function< void() >& task)
+{
+    unsigned int n_queues = fQueues.size();
+    for(unsigned int i=1; i<=n_queues; i++)
+    {
+        HWorkerQueue* queue = fQueues[ (worker_id + i)%n_queues ].get();
+        std::lock_guard<std::mutex> lock(queue->fMutex);
+        if(queue->fTasks.size() != 0)
+        {
+            task = queue->fTasks.front();
+            queue->fTasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+HTaskScheduler::RunStageTask(unsigned int worker_id, std::vector< std::shared_ptr< HStageEntry > >& stages, unsigned int& generation)
+{
+    if(generation != fStageGeneration)
+    {
+        std::lock_guard<std::mutex> lock(fStageMutex);
+        stages = fStages;
+        generation = fStageGeneration;
+    }
+
+    unsigned int n_stages = stages.size();
+    unsigned int start = 0;
+    while(start < n_stages)
+    {
+        //stages of equal priority are polled starting from a different one on each worker
+        unsigned int end = start;
+        while(end < n_stages && stages[end]->fPriority == stages[start]->fPriority){end++;}
+        unsigned int n_equal = end - start;
+
+        for(unsigned int j=0; j<n_equal; j++)
+        {
+            HStageEntry* entry = stages[start + (worker_id + j)%n_equal].get();
+            if(entry->fNActive >= entry->fMaxConcurrency){continue;}
+
+            //claim a slot before touching the stage, and give it back if we lost the race for it,
+            //or if the stage is being unregistered (it may be destroyed as soon as the count is zero)
+            if( ++(entry->fNActive) > entry->fMaxConcurrency || !entry->fEnabled )
+            {
+                entry->fNActive--;
+                continue;
+            }
+
+            HThreadPool* stage = entry->fStage;
+            if(stage->fForceTerminate || !stage->WorkPresent())
+            {
+                entry->fNActive--;
+                continue;
+            }
+
+            stage->ExecuteThreadTask();
+            entry->fNActive--;
+            return true;
+        }
+        start = end;
+    }
+    return false;
+}
+
+}
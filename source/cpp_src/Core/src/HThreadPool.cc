@@ -1,4 +1,5 @@
 #include "HThreadPool.hh"
+#include "HTaskScheduler.hh"
 
 //need pthreads for thread native_handle (setting cpu affinity)
 #include <pthread.h>
@@ -12,7 +13,9 @@ HThreadPool::HThreadPool():
     fNThreads(1),
     fNPhysicalCores(1),
     fSignalTerminate(false),
-    fForceTerminate(false)
+    fForceTerminate(false),
+    fUseSharedScheduler(false),
+    fSchedulerPriority(0)
 {
     fNPhysicalCores = std::thread::hardware_concurrency();
 }
@@ -25,14 +28,29 @@ HThreadPool::~HThreadPool()
 void
 HThreadPool::Launch()
 {
-    if(fThreads.size() == 0 || fHasLaunched)
+    if(fUseSharedScheduler)
     {
+        //no threads of our own, the scheduler runs our tasks (at most fNThreads at a time),
+        //so private threads are never started in this mode
+        if(fHasLaunched)
+        {
+            std::cout<<"HThreadPool::Launch: Warning, threads already launched."<<std::endl;
+            return;
+        }
+        fSignalTerminate = false;
+        fForceTerminate = false;
+        HTaskScheduler::GetInstance()->RegisterStage(this, fSchedulerPriority, fNThreads);
+        fHasLaunched = true;
+    }
+    else if(fThreads.size() == 0 || fHasLaunched)
+    {
+        std::lock_guard< std::mutex > lock(fResizeMutex);
         fThreadIdleMap.clear();
         fSignalTerminate = false;
         fForceTerminate = false;
         for(unsigned int i=0; i<fNThreads; i++)
         {
-            fThreads.push_back( std::thread( &HThreadPool::ProcessLoop, this ) );
+            LaunchThread();
         }
         fHasLaunched = true;
     }
@@ -57,32 +75,26 @@ HThreadPool::ForceTermination()
 void
 HThreadPool::Join()
 {
-    unsigned int n_threads = fThreads.size();
-    unsigned int n_stopped = 0;
-    std::vector<unsigned int> stopped_ids;
-    while(n_stopped != n_threads)
+    if(fUseSharedScheduler)
     {
-        for(unsigned int i=0; i<n_threads; i++)
+        //wait for the remaining work to be done (unless we have been told to quit now)
+        while(fHasLaunched && !fForceTerminate && WorkPresent())
         {
-            bool have_already_stopped = false;
-            for(unsigned int j=0; j<stopped_ids.size(); j++)
-            {
-                if(stopped_ids[j] == i){have_already_stopped = true;};
-            }
-
-            if(!have_already_stopped)
-            {
-                auto It = fThreadIdleMap.find( fThreads[i].get_id() );
-                if(It->second)
-                {
-                    fThreads[i].join();
-                    n_stopped++;
-                    stopped_ids.push_back(i);
-                }
-            }
+            usleep(10);
         }
+        HTaskScheduler::GetInstance()->UnregisterStage(this);
+        fHasLaunched = false;
+        return;
     }
 
+    //threads exit the process loop on their own once signaled to terminate
+    std::lock_guard< std::mutex > lock(fResizeMutex);
+    for(unsigned int i=0; i<fThreads.size(); i++)
+    {
+        fThreads[i].join();
+    }
+
+    fThreadStopFlags.clear();
     fThreads.clear();
     fThreadIdleMap.clear();
     fHasLaunched = false;
@@ -94,14 +106,72 @@ void HThreadPool::SetNThreads(unsigned int n)
     {
         fNThreads = n;
     }
+    else if(fUseSharedScheduler)
+    {
+        //only the concurrency limit changes
+        fNThreads = n;
+        HTaskScheduler::GetInstance()->SetStageConcurrency(this, n);
+    }
     else
     {
-        //issue warning, cannot change the number of threads after we have launched them
+        if(n == 0)
+        {
+            std::cout<<"HThreadPool::SetNThreads: Error, cannot remove all threads after launch."<<std::endl;
+            return;
+        }
 
-        //TODO...could relax this restriction with some changes, adding more threads is no problem but reducing
-        //requires individual kill flags for each thread, so we can signal it to die when idle
+        std::vector< std::thread > retired_threads;
+        std::vector< std::unique_ptr< std::atomic<bool> > > retired_flags;
+        {
+            std::lock_guard< std::mutex > lock(fResizeMutex);
+            while(fThreads.size() < n){LaunchThread();}
+            while(fThreads.size() > n){RetireThread(retired_threads, retired_flags);}
+            fNThreads = n;
+        }
 
-        std::cout<<"HThreadPool::SetNThreads: Error, cannot change the number of threads after launch."<<std::endl;
+        //the retired threads finish their current task and are joined without holding the resize mutex,
+        //so a long task does not stall the resize (or the adaptive thread controller)
+        for(unsigned int i=0; i<retired_threads.size(); i++)
+        {
+            std::thread::id id = retired_threads[i].get_id();
+            retired_threads[i].join();
+            std::lock_guard< std::mutex > lock(fIdleMutex);
+            fThreadIdleMap.erase(id);
+        }
+    }
+}
+
+//should only be called while holding the resize mutex
+void
+HThreadPool::LaunchThread()
+{
+    fThreadStopFlags.push_back( std::unique_ptr< std::atomic<bool> >( new std::atomic<bool>(false) ) );
+    fThreads.push_back( std::thread( &HThreadPool::ProcessLoop, this, fThreadStopFlags.back().get() ) );
+}
+
+//signal the most recently launched thread to stop after its current task, and hand it (and its stop flag,
+//which it reads until it exits) to the caller, to be joined once the resize mutex is released
+//should only be called while holding the resize mutex
+void
+HThreadPool::RetireThread(std::vector< std::thread >& retired_threads, std::vector< std::unique_ptr< std::atomic<bool> > >& retired_flags)
+{
+    *(fThreadStopFlags.back()) = true;
+    retired_threads.push_back( std::move(fThreads.back()) );
+    retired_flags.push_back( std::move(fThreadStopFlags.back()) );
+    fThreads.pop_back();
+    fThreadStopFlags.pop_back();
+}
+
+void
+HThreadPool::SetUseSharedScheduler(bool use_scheduler)
+{
+    if(!fHasLaunched)
+    {
+        fUseSharedScheduler = use_scheduler;
+    }
+    else
+    {
+        std::cout<<"HThreadPool::SetUseSharedScheduler: Error, cannot change the scheduler after launch."<<std::endl;
     }
 }
 
@@ -130,7 +200,8 @@ HThreadPool::AssociateThreadWithProcessorSet(unsigned int local_thread_id, const
 {
     if(fHasLaunched)
     {
-        if(local_thread_id < fNThreads)
+        std::lock_guard< std::mutex > lock(fResizeMutex);
+        if(local_thread_id < fThreads.size())
         {
             //construct the cpu_set
             cpu_set_t cpuset;
@@ -168,7 +239,8 @@ HThreadPool::AssociateThreadWithSingleProcessor(unsigned int local_thread_id, un
 {
     if(fHasLaunched)
     {
-        if(local_thread_id < fNThreads)
+        std::lock_guard< std::mutex > lock(fResizeMutex);
+        if(local_thread_id < fThreads.size())
         {
             //construct the cpu_set
             cpu_set_t cpuset;
@@ -224,6 +296,11 @@ HThreadPool::SetIdleIndicatorTrue()
 bool
 HThreadPool::AllThreadsAreIdle()
 {
+    if(fUseSharedScheduler)
+    {
+        return (HTaskScheduler::GetInstance()->GetNActiveStageTasks(this) == 0);
+    }
+
     std::lock_guard< std::mutex > lock(fIdleMutex);
     for(auto it=fThreadIdleMap.begin(); it != fThreadIdleMap.end(); it++)
     {
@@ -235,8 +312,28 @@ HThreadPool::AllThreadsAreIdle()
     return true;
 }
 
+double
+HThreadPool::GetIdleFraction()
+{
+    if(fUseSharedScheduler)
+    {
+        if(fNThreads == 0){return 1.0;}
+        double n_active = HTaskScheduler::GetInstance()->GetNActiveStageTasks(this);
+        return 1.0 - n_active/fNThreads;
+    }
+
+    std::lock_guard< std::mutex > lock(fIdleMutex);
+    if(fThreadIdleMap.size() == 0){return 1.0;}
+    double n_idle = 0;
+    for(auto it=fThreadIdleMap.begin(); it != fThreadIdleMap.end(); it++)
+    {
+        if(it->second){n_idle += 1.0;}
+    }
+    return n_idle/fThreadIdleMap.size();
+}
+
 void
-HThreadPool::ProcessLoop()
+HThreadPool::ProcessLoop(std::atomic<bool>* stop_flag)
 {
     //basic processing loop...we assume the derived class has put all actual work
     //into the virtual function ExecuteThreadTask()
@@ -246,7 +343,7 @@ HThreadPool::ProcessLoop()
     SetIdleIndicatorTrue();
 
     //loop until we are done
-    while( !fForceTerminate && (!fSignalTerminate || WorkPresent() ) )
+    while( !fForceTerminate && !(*stop_flag) && (!fSignalTerminate || WorkPresent() ) )
     {
         if( WorkPresent() )
         {
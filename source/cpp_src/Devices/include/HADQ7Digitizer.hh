@@ -58,6 +58,11 @@ class HADQ7Digitizer:  public HDigitizer< adq_sample_t, HADQ7Digitizer >,  publi
 
         void SetSampleSkipFactor(unsigned int factor);
 
+        //select the inputs to stream (A only by default), with both enabled the buffers hold the samples of both
+        //channels interleaved, and the sample index counts the samples of one channel
+        void SetChannelMask(bool enable_a, bool enable_b);
+        unsigned int GetNEnabledChannels() const {return fEnableA + fEnableB;};
+
         double GetSamplingFrequency() const {return fAcquisitionRateMHz*1e6;};
 
         bool IsInitialized() const {return fInitialized;};
@@ -51,6 +51,22 @@ HADQ7Digitizer::SetSampleSkipFactor(unsigned int factor)
     }
 }
 
+void
+HADQ7Digitizer::SetChannelMask(bool enable_a, bool enable_b)
+{
+    if(enable_a || enable_b)
+    {
+        fEnableA = enable_a ? 1 : 0;
+        fEnableB = enable_b ? 1 : 0;
+    }
+    else
+    {
+        std::cout<<"HADQ7Digitizer::SetChannelMask: Error, at least one channel must be enabled. Using channel A."<<std::endl;
+        fEnableA = 1;
+        fEnableB = 0;
+    }
+}
+
 bool HADQ7Digitizer::InitializeImpl()
 {
     if(!fInitialized)
@@ -243,8 +259,8 @@ HADQ7Digitizer::FinalizeImpl()
             else{ threads_busy = true; }
         }
 
-        //increment the sample counter
-        fCounter += this->fBuffer->GetArrayDimension(0);
+        //increment the sample counter (per channel)
+        fCounter += this->fBuffer->GetArrayDimension(0)/GetNEnabledChannels();
 
         //return any error codes which might have arisen during streaming
         //if were buffer overflows/page errors we need to stop and restart the acquisition
@@ -24,6 +24,8 @@ extern "C"
 }
 
 #include "HSpectrumFileStructWrapper.hh"
+#include "HArrayExpression.hh"
+#include "HArrayExpressionEngine.hh"
 using namespace hose;
 
 #include "TCanvas.h"
@@ -359,11 +361,10 @@ bool ReadDataDirectory
             average_spectrum.resize(spec_length, 0);
         }
 
+        //here spec_data is actually the average of 32 complete'gpu-spectra', where gpu-spectra are accumulations of 16 FFT's worth of data
         float* spec_data = tempFile.GetSpectrumData();
-        for(size_t j=0; j<spec_length; j++)
-        {
-             average_spectrum[j] += spec_data[j]; //here spec_data is actually the average of 32 complete'gpu-spectra', where gpu-spectra are accumulations of 16 FFT's worth of data
-        }
+        HArrayTerminal<double> sum = HArrayRef(&(average_spectrum[0]), spec_length);
+        HArrayExpressionEngine::Assign(&(average_spectrum[0]), spec_length, sum + HArrayRef(spec_data, spec_length) );
         spec_count += 1.0;
     }
 
@@ -371,10 +372,8 @@ bool ReadDataDirectory
     //TODO FIXME...this is because of the 1st pass accumulation on the GPU, (no averaging/normalization is done)
     //HARD_CODED, number of accumulations we didn't normalize for in GPU code:
     double gpu_ave_factor = 16.0;
-    for(size_t j=0; j<spec_length; j++)
-    {
-         average_spectrum[j] *= (1.0/gpu_ave_factor)*(1.0/spec_count);
-    }
+    HArrayTerminal<double> ave = HArrayRef(&(average_spectrum[0]), spec_length);
+    HArrayExpressionEngine::Assign(&(average_spectrum[0]), spec_length, ave*( (1.0/gpu_ave_factor)*(1.0/spec_count) ) );
 
     //export some meta data
     meta_data.fSpectrumLength = spec_length;
@@ -415,10 +414,7 @@ bool ReadDataDirectory
     std::cout<<"ENBW = NENBW*f_res = "<< (meta_data.fSampleRate)*(s2/(s1*s1))<<std::endl;
 
     //this normalizes for the FFT, to give the power spectrum
-    for(size_t j=0; j<spec_length; j++)
-    {
-         average_spectrum[j] *= 2.0/(s1*s1);
-    }
+    HArrayExpressionEngine::Assign(&(average_spectrum[0]), spec_length, ave*( 2.0/(s1*s1) ) );
 
     return true;
 
@@ -460,18 +456,8 @@ int RebinSpectra(bool toggle,
     rebinned_spec.resize(new_spec_length, 0);
     rebinned_freq_axis.resize(new_spec_length, 0);
     std::cout<<"new spectra length = "<<new_spec_length<<std::endl;
-    for(size_t j=0; j<new_spec_length; j++)
-    {
-        rebinned_spec[j] = 0;
-        rebinned_freq_axis[j] = 0;
-        for(size_t k=0; k<n_to_merge; k++)
-        {
-            rebinned_spec[j] += raw_accumulated_spec[j*n_to_merge + k];
-            rebinned_freq_axis[j] += raw_freq_axis[j*n_to_merge + k];
-        }
-        rebinned_spec[j] /= (double)n_to_merge;
-        rebinned_freq_axis[j] /= (double)n_to_merge;
-    }
+    HArrayExpressionEngine::Rebin(&(rebinned_spec[0]), new_spec_length, HArrayRef(&(raw_accumulated_spec[0]), spec_length), n_to_merge);
+    HArrayExpressionEngine::Rebin(&(rebinned_freq_axis[0]), new_spec_length, HArrayRef(&(raw_freq_axis[0]), spec_length), n_to_merge);
     return n_to_merge;
 }
 
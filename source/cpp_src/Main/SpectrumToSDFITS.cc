@@ -0,0 +1,560 @@
+#include <dirent.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <climits>
+#include <stdint.h>
+#include <getopt.h>
+#include <thread>
+
+extern "C"
+{
+    #include "HBasicDefines.h"
+    #include "HSpectrumFile.h"
+}
+
+#include "HTaskScheduler.hh"
+#include "HFITSBinaryTableWriter.hh"
+#include "HObservingGeometry.hh"
+#include "HScanMetaData.hh"
+
+using namespace hose;
+
+//site and instrument information written by gpu_sdfits.py
+static const double kSiteLongitude = -71.48833333;
+static const double kSiteLatitude = 42.62333333;
+static const int kSiteElevation = 131;
+static const char* kOrigin = "Haystack Observatory";
+static const char* kTelescope = "Westford";
+static const char* kInstrument = "GPU spectrometer";
+static const char* kFirmwareVersion = "2019 Aug 01";
+
+//table columns, in the order they are written (alphabetical by gpu_sdfits.py's internal names)
+enum
+{
+    COL_AZIMUTH = 0, COL_BARYCORR, COL_DATE_OBS, COL_ELEVATIO, COL_ENCDEC, COL_ENCRA, COL_CDELT1, COL_CRPIX1, COL_CRVAL1,
+    COL_IMAGFREQ, COL_VLSRCORR, COL_LST, COL_MH2O, COL_OBJECT, COL_OBSTIME, COL_PRESSURE, COL_SCAN, COL_SPECTRUM, COL_SUBSCAN,
+    COL_SRCDEC, COL_CRVAL3, COL_SRCID, COL_SRCRA, COL_CRVAL2, COL_TAU_ATM, COL_TCHOP, COL_TSYS, COL_UT
+};
+
+struct less_than_spec
+{
+    inline bool operator() (const std::pair< std::string, std::pair<uint64_t, uint64_t > >& file_int1, const std::pair< std::string, std::pair<uint64_t, uint64_t > >& file_int2)
+    {
+        if(file_int1.second != file_int2.second){return file_int1.second < file_int2.second;}
+        return file_int1.first < file_int2.first;
+    }
+};
+
+//spectrum files are named <acquisition second>_<leading sample index>_<sideband flag><polarization flag>.spec
+void
+get_time_stamped_files(std::string fext, const std::vector<std::string>& file_list, std::vector< std::pair< std::string, std::pair< uint64_t, uint64_t > > >& stamped_files)
+{
+    for(auto it = file_list.begin(); it != file_list.end(); it++)
+    {
+        std::string fname = it->substr(it->find_last_of("\\/")+1);
+        if(fname.size() <= fext.size() || fname.compare(fname.size() - fext.size(), fext.size(), fext) != 0){continue;}
+        size_t first_delim = fname.find("_");
+        if(first_delim == std::string::npos){continue;}
+        size_t second_delim = fname.find("_", first_delim+1);
+        if(second_delim == std::string::npos){continue;}
+
+        std::stringstream ss1(fname.substr(0, first_delim));
+        std::stringstream ss2(fname.substr(first_delim+1, second_delim - first_delim - 1));
+        uint64_t val_sec;
+        uint64_t val_si;
+        if( (ss1 >> val_sec) && (ss2 >> val_si) )
+        {
+            stamped_files.push_back( std::make_pair(*it, std::make_pair(val_sec, val_si) ) );
+        }
+    }
+}
+
+//start of the spectrum in microseconds since the epoch
+int64_t
+spectrum_start_time(const struct HSpectrumFileStruct& spec)
+{
+    double offset = ( (double) spec.fHeader.fLeadingSampleIndex )/( (double) spec.fHeader.fSampleRate );
+    return ( (int64_t) spec.fHeader.fStartTime )*1000000 + std::llround(offset*1e6);
+}
+
+//ISO 8601 without a time zone, the fraction is omitted when it is zero (python's isoformat)
+std::string
+iso_date(int64_t time_usec)
+{
+    std::time_t time_point = time_usec/1000000;
+    int usec = time_usec % 1000000;
+    std::tm time_stamp;
+    gmtime_r(&time_point, &time_stamp);
+    char buff[64];
+    std::strftime(buff, 64, "%Y-%m-%dT%H:%M:%S", &time_stamp);
+    std::string date(buff);
+    if(usec != 0)
+    {
+        std::snprintf(buff, 64, ".%06d", usec);
+        date += buff;
+    }
+    return date;
+}
+
+//the scan number is the scan name if it is an integer, otherwise 1
+int
+scan_number(const std::string& scan_name)
+{
+    const char* begin = scan_name.c_str();
+    char* end = NULL;
+    long val = std::strtol(begin, &end, 10);
+    if(end == begin){return 1;}
+    while(*end == ' ' || *end == '\t' || *end == '\n'){end++;}
+    if(*end != '\0' || val > INT_MAX || val < INT_MIN){return 1;}
+    return (int) val;
+}
+
+//HHMMSS.SS to degrees
+double
+ra_to_degrees(const std::string& ra)
+{
+    if(ra.size() < 4){return 0.0;}
+    return ( std::atof(ra.substr(0,2).c_str()) + ( std::atof(ra.substr(2,2).c_str()) + std::atof(ra.substr(4).c_str())/60.0 )/60.0 )*15.0;
+}
+
+//+DDMMSS.S to degrees
+double
+dec_to_degrees(const std::string& dec)
+{
+    if(dec.size() < 5){return 0.0;}
+    double deg = std::atof(dec.substr(1,2).c_str()) + ( std::atof(dec.substr(3,2).c_str()) + std::atof(dec.substr(5).c_str())/60.0 )/60.0;
+    if(dec[0] == '-'){deg = -1.0*deg;}
+    return deg;
+}
+
+//pointing and frequency information from the meta data (or the defaults if there is none)
+struct scan_status
+{
+    double fRefFrequency;
+    double fRefBinIndex;
+    double fFrequencyDelta;
+    bool fHaveFrequencyMap;
+    std::string fSource;
+    std::string fRA;
+    std::string fDec;
+};
+
+void
+get_scan_status(const HScanMetaData& meta, int64_t time_usec, scan_status& status)
+{
+    status.fHaveFrequencyMap = meta.GetFrequencyMap(time_usec, status.fRefFrequency, status.fRefBinIndex, status.fFrequencyDelta);
+    if(!status.fHaveFrequencyMap)
+    {
+        status.fRefFrequency = 1.0;
+        status.fRefBinIndex = 1.0;
+        status.fFrequencyDelta = 1.0;
+    }
+    if(!meta.GetSourceStatus(time_usec, status.fSource, status.fRA, status.fDec))
+    {
+        status.fSource = "SourceID";
+        status.fRA = "000000.00";
+        status.fDec = "+000000.0";
+    }
+}
+
+//reads the n_average consecutive spectrum files which make up one row of the table and fills it in
+bool
+fill_row(const HFITSBinaryTableWriter& writer, const HScanMetaData& meta, const std::vector< std::string >& files,
+         uint64_t spec_length, int subscan, char* row)
+{
+    std::vector< double > spectrum(spec_length, 0.0);
+    struct HSpectrumFileStruct spec;
+    InitializeSpectrumFileStruct(&spec);
+
+    int64_t start_time = 0;
+    std::string source_name;
+    std::string scan_name;
+    double obstime = 0.0;
+    double az_sum = 0.0;
+    double el_sum = 0.0;
+    for(size_t i=0; i<files.size(); i++)
+    {
+        int code = ReadSpectrumFile(files[i].c_str(), &spec);
+        if(code != HSUCCESS || spec.fHeader.fSpectrumLength != spec_length || spec.fHeader.fSpectrumDataTypeSize != sizeof(float) || spec.fHeader.fSampleRate == 0)
+        {
+            std::cout<<"file: "<<files[i]<<" could not be read or does not match the first spectrum, skipping."<<std::endl;
+            ClearSpectrumFileStruct(&spec);
+            return false;
+        }
+
+        int64_t time_usec = spectrum_start_time(spec);
+        if(i == 0)
+        {
+            start_time = time_usec;
+            source_name = std::string(spec.fHeader.fSourceName, strnlen(spec.fHeader.fSourceName, HNAME_WIDTH));
+            scan_name = std::string(spec.fHeader.fScanName, strnlen(spec.fHeader.fScanName, HNAME_WIDTH));
+        }
+        obstime += ( (double) spec.fHeader.fSampleLength )/( (double) spec.fHeader.fSampleRate );
+
+        double az = -1.0;
+        double el = -1.0;
+        meta.GetAntennaPosition(time_usec, az, el);
+        az_sum += az;
+        el_sum += el;
+
+        const float* data = reinterpret_cast< const float* >(spec.fRawSpectrumData);
+        if(files.size() == 1)
+        {
+            writer.SetField(row, COL_SPECTRUM, data, spec_length);
+        }
+        else
+        {
+            for(size_t k=0; k<spec_length; k++){spectrum[k] += data[k];}
+        }
+        ClearSpectrumFileStruct(&spec);
+    }
+
+    double n = files.size();
+    if(files.size() > 1)
+    {
+        for(size_t k=0; k<spec_length; k++){spectrum[k] /= n;}
+        writer.SetField(row, COL_SPECTRUM, &(spectrum[0]), spec_length);
+    }
+    double az = az_sum/n;
+    double el = el_sum/n;
+
+    //pointing and velocity corrections at the start of the row
+    HObservingGeometry geometry;
+    geometry.SetSiteLocation(kSiteLongitude, kSiteLatitude, kSiteElevation);
+    geometry.SetTime( start_time/1000000 + (start_time % 1000000)*1e-6 );
+    double enc_ra, enc_dec;
+    geometry.ConvertAzElToRADec(az, el, enc_ra, enc_dec);
+
+    scan_status status;
+    get_scan_status(meta, start_time, status);
+
+    writer.SetField(row, COL_AZIMUTH, az);
+    writer.SetField(row, COL_BARYCORR, geometry.GetBarycentricCorrection(enc_ra, enc_dec) );
+    writer.SetField(row, COL_DATE_OBS, iso_date(start_time) );
+    writer.SetField(row, COL_ELEVATIO, el);
+    writer.SetField(row, COL_ENCDEC, enc_dec);
+    writer.SetField(row, COL_ENCRA, enc_ra);
+    writer.SetField(row, COL_CDELT1, status.fFrequencyDelta);
+    writer.SetField(row, COL_CRPIX1, status.fRefBinIndex);
+    writer.SetField(row, COL_CRVAL1, status.fRefFrequency);
+    writer.SetField(row, COL_VLSRCORR, HObservingGeometry::GetLSRCorrection(enc_ra, enc_dec) );
+    writer.SetField(row, COL_LST, geometry.GetLocalMeanSiderealTime() );
+    writer.SetField(row, COL_OBJECT, source_name);
+    writer.SetField(row, COL_OBSTIME, obstime);
+    writer.SetField(row, COL_SCAN, scan_number(scan_name) );
+    writer.SetField(row, COL_SUBSCAN, subscan);
+    writer.SetField(row, COL_SRCDEC, status.fDec);
+    writer.SetField(row, COL_CRVAL3, dec_to_degrees(status.fDec) );
+    writer.SetField(row, COL_SRCID, status.fSource);
+    writer.SetField(row, COL_SRCRA, status.fRA);
+    writer.SetField(row, COL_CRVAL2, ra_to_degrees(status.fRA) );
+    writer.SetField(row, COL_TSYS, 1.0); //placeholder until the noise diode calibration is applied
+    writer.SetField(row, COL_UT, ( (double) ( (start_time/1000000) % 86400 ) ) + (start_time % 1000000)/1000000.0 );
+    return true;
+}
+
+//columns and header keywords of the SDFITS file, reference values are taken from the first spectrum
+void
+configure_writer(HFITSBinaryTableWriter& writer, uint64_t spec_length, const scan_status& first)
+{
+    std::stringstream ss;
+    ss << spec_length << "E";
+
+    writer.AddColumn("AZIMUTH", "1E", "DEGREES");
+    writer.AddColumn("BARYCORR", "1E", "M/S");
+    writer.AddColumn("DATE-OBS", "26A");
+    writer.AddColumn("ELEVATIO", "1E", "DEGREES");
+    writer.AddColumn("ENCDEC", "1E", "DEGREES");
+    writer.AddColumn("ENCRA", "1E", "DEGREES");
+    writer.AddColumn("CDELT1", "1E", "HZ");
+    writer.AddColumn("CRPIX1", "1E", "PIXEL");
+    writer.AddColumn("CRVAL1", "1E", "HZ");
+    writer.AddColumn("IMAGFREQ", "1E", "HZ");
+    writer.AddColumn("VLSRCORR", "1E", "M/S");
+    writer.AddColumn("LST", "1D");
+    writer.AddColumn("MH2O", "1E");
+    writer.AddColumn("OBJECT", "12A");
+    writer.AddColumn("OBSTIME", "1E", "SECONDS");
+    writer.AddColumn("PRESSURE", "1E", "hPa");
+    writer.AddColumn("SCAN", "1J");
+    writer.AddColumn("SPECTRUM", ss.str(), "POWER");
+    writer.AddColumn("SUBSCAN", "1J");
+    writer.AddColumn("SRCDEC", "9A");
+    writer.AddColumn("CRVAL3", "1E", "DEGREES");
+    writer.AddColumn("SRCID", "12A");
+    writer.AddColumn("SRCRA", "9A");
+    writer.AddColumn("CRVAL2", "1E", "DEGREES");
+    writer.AddColumn("TAU_ATM", "1E");
+    writer.AddColumn("TCHOP", "1E", "K");
+    writer.AddColumn("TSYS", "1E", "K");
+    writer.AddColumn("UT", "1D");
+
+    char date[64];
+    std::time_t now = std::time(nullptr);
+    std::tm now_tm;
+    gmtime_r(&now, &now_tm);
+    std::strftime(date, 64, "%Y-%m-%dT%H:%M:%S", &now_tm);
+
+    writer.AddPrimaryCard( HFITSBinaryTableWriter::FormatStringCard("ORIGIN", kOrigin) );
+    writer.AddPrimaryCard( HFITSBinaryTableWriter::FormatStringCard("DATE", date) );
+    writer.AddPrimaryCard( HFITSBinaryTableWriter::FormatStringCard("OBJECT", "OBJECTID") );
+    writer.AddPrimaryCard( HFITSBinaryTableWriter::FormatStringCard("TELESCOP", kTelescope) );
+    writer.AddPrimaryCard( HFITSBinaryTableWriter::FormatStringCard("INSTRUME", kInstrument) );
+    writer.AddPrimaryCard( HFITSBinaryTableWriter::FormatStringCard("FWVER", kFirmwareVersion) );
+
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatStringCard("EXTNAME", "SINGLE DISH") );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatIntegerCard("EXTVER", 1) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatIntegerCard("NMATRIX", 1) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatIntegerCard("MAXIS", 4) );
+
+    //the (virtual) data matrix axes: frequency, ra, dec, stokes
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatIntegerCard("MAXIS1", spec_length) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatStringCard("CTYPE1", "FREQ") );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("CRVAL1", first.fRefFrequency) );
+    if(first.fHaveFrequencyMap && first.fRefBinIndex == std::floor(first.fRefBinIndex) )
+    {
+        writer.AddTableCard( HFITSBinaryTableWriter::FormatIntegerCard("CRPIX1", (int64_t) first.fRefBinIndex) );
+    }
+    else
+    {
+        writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("CRPIX1", first.fRefBinIndex) );
+    }
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("CDELT1", first.fFrequencyDelta) );
+    const char* axis_names[3] = {"RA", "DEC", "STOKES"};
+    double axis_values[3] = {ra_to_degrees(first.fRA), dec_to_degrees(first.fDec), 0.0};
+    for(unsigned int i=0; i<3; i++)
+    {
+        std::stringstream ax;
+        ax << (i+2);
+        writer.AddTableCard( HFITSBinaryTableWriter::FormatIntegerCard("MAXIS" + ax.str(), 1) );
+        writer.AddTableCard( HFITSBinaryTableWriter::FormatStringCard("CTYPE" + ax.str(), axis_names[i]) );
+        if(i < 2){writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("CRVAL" + ax.str(), axis_values[i]) );}
+        else{writer.AddTableCard( HFITSBinaryTableWriter::FormatIntegerCard("CRVAL" + ax.str(), 1) );}
+        writer.AddTableCard( HFITSBinaryTableWriter::FormatIntegerCard("CDELT" + ax.str(), 1) );
+        writer.AddTableCard( HFITSBinaryTableWriter::FormatIntegerCard("CRPIX" + ax.str(), 1) );
+    }
+
+    //site, velocity and (default) weather information
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatStringCard("TELESCOP", kTelescope) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatStringCard("INSTRUME", kInstrument) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("SITELONG", kSiteLongitude) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("SITELAT", kSiteLatitude) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatIntegerCard("SITEELEV", kSiteElevation) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("FOFFSET", 0.0) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("RESTFREQ", 1.0) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatStringCard("VELDEF", "RADI-LSR    ") );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("DELTAV", 0.0) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("BEAMEFF", 1.0) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("FORWEFF", 1.0) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("EQUINOX", 2000.0) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("DEWPOINT", 273.15) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("HUMIDITY", 0.5) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("PRESSURE", 1013.25) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("TAU_ATM", 0.0) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("TOUTSIDE", 293.15) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("WINDDIRE", 0.0) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatFloatCard("WINDSPEE", 0.0) );
+    writer.AddTableCard( HFITSBinaryTableWriter::FormatStringCard("OBSMODE", "LINEPSSW") );
+}
+
+int main(int argc, char** argv)
+{
+    std::string usage =
+    "\n"
+    "Usage: SpectrumToSDFITS <options>\n"
+    "\n"
+    "Convert the spectrum (.spec) files of a scan directory and its meta data (.json) into a single\n"
+    "SDFITS file, with the same layout as gpu_sdfits.py. Spectrum files are read in parallel and rows\n"
+    "are written to the output as they are completed.\n"
+    "\tOptions:\n"
+    "\t -h, --help               (shows this message and exits)\n"
+    "\t -d, --data-dir           (path to the scan directory, mandatory)\n"
+    "\t -o, --output             (path to the output file, default is <data-dir>/<scan>.fits)\n"
+    "\t -n, --n-average          (number of consecutive spectra averaged into each row, default 1)\n"
+    "\t -t, --threads            (number of threads, default is the number of cores)\n"
+    "\t -f, --force              (convert the directory even if it already contains a FITS file)\n"
+    ;
+
+    //set defaults
+    std::string data_dir = "";
+    std::string output_file = "";
+    size_t n_average = 1;
+    unsigned int n_threads = std::max(1u, std::thread::hardware_concurrency());
+    bool force = false;
+
+    static struct option longOptions[] =
+    {
+        {"help", no_argument, 0, 'h'},
+        {"data-dir", required_argument, 0, 'd'},
+        {"output", required_argument, 0, 'o'},
+        {"n-average", required_argument, 0, 'n'},
+        {"threads", required_argument, 0, 't'},
+        {"force", no_argument, 0, 'f'},
+        {0, 0, 0, 0}
+    };
+
+    static const char *optString = "hd:o:n:t:f";
+
+    while(1)
+    {
+        int optId = getopt_long(argc, argv, optString, longOptions, NULL);
+        if(optId == -1) break;
+        switch(optId)
+        {
+            case('h'): // help
+            std::cout<<usage<<std::endl;
+            return 0;
+            case('d'):
+            data_dir = std::string(optarg);
+            break;
+            case('o'):
+            output_file = std::string(optarg);
+            break;
+            case('n'):
+            n_average = std::max(1, std::atoi(optarg));
+            break;
+            case('t'):
+            n_threads = std::max(1, std::atoi(optarg));
+            break;
+            case('f'):
+            force = true;
+            break;
+            default:
+                std::cout<<usage<<std::endl;
+            return 1;
+        }
+    }
+
+    if(data_dir == "")
+    {
+        std::cout<<"Data directory argument is mandatory."<<std::endl;
+        std::cout<<usage<<std::endl;
+        return 1;
+    }
+
+    //get list of all files in the directory
+    std::vector< std::string > allFiles;
+    DIR *dpdf = opendir(data_dir.c_str());
+    if(dpdf == NULL)
+    {
+        std::cout<<"Error: could not open directory: "<<data_dir<<std::endl;
+        return 1;
+    }
+    struct dirent* epdf = NULL;
+    while( (epdf = readdir(dpdf)) != NULL ){allFiles.push_back( data_dir + "/" + std::string(epdf->d_name) );}
+    closedir(dpdf);
+
+    //spectrum files in time order, the meta data file, and any existing FITS file
+    std::vector< std::pair< std::string, std::pair< uint64_t, uint64_t > > > specFiles;
+    get_time_stamped_files(".spec", allFiles, specFiles);
+    std::sort(specFiles.begin(), specFiles.end(), less_than_spec());
+
+    std::string metaDataFile = "";
+    bool have_fits = false;
+    for(auto it = allFiles.begin(); it != allFiles.end(); it++)
+    {
+        std::string fname = it->substr(it->find_last_of("\\/")+1);
+        if(fname.size() > 5 && fname.substr(fname.size() - 5) == ".json" && (metaDataFile == "" || fname == "meta_data.json") ){metaDataFile = *it;}
+        if(fname.size() > 5 && fname.substr(fname.size() - 5) == ".fits"){have_fits = true;}
+    }
+
+    if(have_fits && !force)
+    {
+        std::cout<<"Found a FITS file in directory: "<<data_dir<<", skipping it (use --force to convert anyway)."<<std::endl;
+        return 0;
+    }
+
+    size_t n_rows = specFiles.size()/n_average;
+    if(n_rows == 0)
+    {
+        std::cout<<"Error: could not locate enough spectrum files in directory: "<<data_dir<<std::endl;
+        return 1;
+    }
+
+    HScanMetaData meta;
+    if(metaDataFile == ""){std::cout<<"No meta data file in directory: "<<data_dir<<", using defaults."<<std::endl;}
+    else
+    {
+        std::cout<<"meta data file = "<<metaDataFile<<std::endl;
+        meta.ReadFile(metaDataFile);
+    }
+
+    if(output_file == "")
+    {
+        //named after the scan directory
+        std::string scan = data_dir;
+        char* real_dir = realpath(data_dir.c_str(), NULL);
+        if(real_dir != NULL){scan = std::string(real_dir); free(real_dir);}
+        while(scan.size() > 1 && scan[scan.size()-1] == '/'){scan.erase(scan.size()-1);}
+        scan = scan.substr(scan.find_last_of("/")+1);
+        output_file = data_dir + "/" + scan + ".fits";
+    }
+
+    //the first spectrum sets the spectrum length and the reference values in the table header
+    struct HSpectrumFileStruct first_spec;
+    InitializeSpectrumFileStruct(&first_spec);
+    if(ReadSpectrumFile(specFiles[0].first.c_str(), &first_spec) != HSUCCESS || first_spec.fHeader.fSampleRate == 0)
+    {
+        std::cout<<"Error: could not read spectrum file: "<<specFiles[0].first<<std::endl;
+        ClearSpectrumFileStruct(&first_spec);
+        return 1;
+    }
+    uint64_t spec_length = first_spec.fHeader.fSpectrumLength;
+    scan_status first_status;
+    get_scan_status(meta, spectrum_start_time(first_spec), first_status);
+    ClearSpectrumFileStruct(&first_spec);
+
+    HFITSBinaryTableWriter writer;
+    configure_writer(writer, spec_length, first_status);
+    if(!writer.Open(output_file)){return 1;}
+
+    //the main thread works alongside the scheduler's workers
+    HTaskScheduler* scheduler = HTaskScheduler::GetInstance();
+    if(n_threads > 1)
+    {
+        scheduler->SetNThreads(n_threads - 1);
+        scheduler->Launch();
+    }
+
+    //rows are produced in batches (limited to ~256MB) and written in order
+    size_t row_size = writer.GetRowSize();
+    size_t batch_size = std::max<size_t>(n_threads, std::min<size_t>(64*n_threads, (256 << 20)/row_size) );
+    std::vector< char > rows(batch_size*row_size);
+    std::vector< char > row_ok(batch_size);
+    size_t n_skipped = 0;
+    int status = 0;
+    for(size_t batch_start = 0; batch_start < n_rows && status == 0; batch_start += batch_size)
+    {
+        size_t n_batch = std::min(batch_size, n_rows - batch_start);
+        std::fill(rows.begin(), rows.end(), 0);
+        scheduler->ParallelFor(n_batch, [&](std::size_t i)
+        {
+            size_t first = (batch_start + i)*n_average;
+            std::vector< std::string > files;
+            for(size_t k=0; k<n_average; k++){files.push_back(specFiles[first + k].first);}
+            row_ok[i] = fill_row(writer, meta, files, spec_length, first + 1, &(rows[i*row_size]));
+        });
+
+        for(size_t i=0; i<n_batch; i++)
+        {
+            if(!row_ok[i]){n_skipped++; continue;}
+            if(!writer.WriteRows(&(rows[i*row_size]), 1)){status = 1; break;}
+        }
+    }
+
+    if(!writer.Close()){status = 1;}
+    if(scheduler->IsRunning()){scheduler->Terminate();}
+
+    std::cout<<"wrote "<<writer.GetNRows()<<" rows ("<<specFiles.size()<<" spectrum files";
+    if(n_skipped != 0){std::cout<<", "<<n_skipped<<" rows skipped";}
+    std::cout<<") to: "<<output_file<<std::endl;
+
+    return status;
+}
@@ -0,0 +1,223 @@
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <stdint.h>
+#include <getopt.h>
+#include <thread>
+
+extern "C"
+{
+    #include "HBasicDefines.h"
+    #include "HSpectrumFile.h"
+}
+
+#include "HTaskScheduler.hh"
+#include "HWelchPowerSpectralDensity.hh"
+
+using namespace hose;
+
+//raw dumps are named <acquisition second>_<leading sample index>_<sideband flag><polarization flag>.bin
+bool
+parse_raw_file_name(const std::string& filename, uint64_t& acq_second, uint64_t& sample_index, char& sideband, char& pol)
+{
+    std::string fname = filename.substr(filename.find_last_of("\\/")+1);
+    size_t first_delim = fname.find("_");
+    if(first_delim == std::string::npos){return false;}
+    size_t second_delim = fname.find("_", first_delim+1);
+    if(second_delim == std::string::npos || second_delim + 2 >= fname.size() ){return false;}
+
+    std::stringstream ss1(fname.substr(0, first_delim));
+    std::stringstream ss2(fname.substr(first_delim+1, second_delim - first_delim - 1));
+    if( !(ss1 >> acq_second) || !(ss2 >> sample_index) ){return false;}
+    sideband = fname[second_delim+1];
+    pol = fname[second_delim+2];
+    return true;
+}
+
+template< typename XSampleType >
+int
+compute_psd(HWelchPowerSpectralDensity< XSampleType >& welch, const std::string& input_file, const std::string& output_file, bool density)
+{
+    if(!welch.Initialize()){return 1;}
+    if(!welch.ProcessFile(input_file)){return 1;}
+    if(welch.GetNAverages() == 0)
+    {
+        std::cout<<"file: "<<input_file<<" is shorter than one segment"<<std::endl;
+        return 1;
+    }
+    std::cout<<"averaged "<<welch.GetNAverages()<<" segments ("<<welch.GetNSamplesUsed()<<" samples)"<<std::endl;
+    if(!welch.WriteToFile(output_file, density)){return 1;}
+    std::cout<<"wrote: "<<output_file<<std::endl;
+    return 0;
+}
+
+template< typename XSampleType >
+void
+configure_psd(HWelchPowerSpectralDensity< XSampleType >& welch, size_t segment_length, size_t overlap, int window, uint64_t n_averages,
+              uint64_t sample_rate, HTaskScheduler* scheduler, const std::string& input_file)
+{
+    welch.SetSegmentLength(segment_length);
+    welch.SetOverlap(overlap);
+    welch.SetWindowFunction(window);
+    welch.SetMaxAverages(n_averages);
+    welch.SetSampleRate(sample_rate);
+    welch.SetTaskScheduler(scheduler);
+
+    uint64_t acq_second = 0;
+    uint64_t sample_index = 0;
+    char sideband = '\0';
+    char pol = '\0';
+    if(parse_raw_file_name(input_file, acq_second, sample_index, sideband, pol))
+    {
+        welch.SetStartTime(acq_second);
+        welch.SetLeadingSampleIndex(sample_index);
+        welch.SetSidebandFlag(sideband);
+        welch.SetPolarizationFlag(pol);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string usage =
+    "\n"
+    "Usage: WelchPSD <options>\n"
+    "\n"
+    "Compute the (Welch) averaged power spectrum of a raw data (.bin) file and write it as a .spec file.\n"
+    "The file is read in chunks, so it may be larger than the available memory.\n"
+    "\tOptions:\n"
+    "\t -h, --help               (shows this message and exits)\n"
+    "\t -i, --input              (path to the raw data file, mandatory)\n"
+    "\t -o, --output             (path to the output file, default is the input file with the extension .spec)\n"
+    "\t -n, --segment-length     (number of samples per segment/FFT, default 4096)\n"
+    "\t -v, --overlap            (number of samples shared by consecutive segments, default half the segment length)\n"
+    "\t -w, --window             (window function, 0 = none, 1 = blackman-harris, 2 = hann, default 2)\n"
+    "\t -a, --averages           (maximum number of segments to average, default 0 = all)\n"
+    "\t -r, --sample-rate        (sample rate in Hz, default 1250000000)\n"
+    "\t -t, --threads            (number of threads, default is the number of cores)\n"
+    "\t -u, --unsigned           (samples are unsigned (offset binary) 16 bit integers, default is signed)\n"
+    "\t -d, --density            (write the one-sided power spectral density in units^2/Hz, rather than the averaged power)\n"
+    ;
+
+    //set defaults
+    std::string input_file = "";
+    std::string output_file = "";
+    size_t segment_length = 4096;
+    bool have_overlap = false;
+    size_t overlap = 0;
+    int window = 2;
+    uint64_t n_averages = 0;
+    uint64_t sample_rate = 1250000000;
+    unsigned int n_threads = std::max(1u, std::thread::hardware_concurrency());
+    bool is_unsigned = false;
+    bool density = false;
+
+    static struct option longOptions[] =
+    {
+        {"help", no_argument, 0, 'h'},
+        {"input", required_argument, 0, 'i'},
+        {"output", required_argument, 0, 'o'},
+        {"segment-length", required_argument, 0, 'n'},
+        {"overlap", required_argument, 0, 'v'},
+        {"window", required_argument, 0, 'w'},
+        {"averages", required_argument, 0, 'a'},
+        {"sample-rate", required_argument, 0, 'r'},
+        {"threads", required_argument, 0, 't'},
+        {"unsigned", no_argument, 0, 'u'},
+        {"density", no_argument, 0, 'd'},
+        {0, 0, 0, 0}
+    };
+
+    static const char *optString = "hi:o:n:v:w:a:r:t:ud";
+
+    while(1)
+    {
+        int optId = getopt_long(argc, argv, optString, longOptions, NULL);
+        if(optId == -1) break;
+        switch(optId)
+        {
+            case('h'): // help
+            std::cout<<usage<<std::endl;
+            return 0;
+            case('i'):
+            input_file = std::string(optarg);
+            break;
+            case('o'):
+            output_file = std::string(optarg);
+            break;
+            case('n'):
+            segment_length = std::strtoull(optarg, NULL, 10);
+            break;
+            case('v'):
+            overlap = std::strtoull(optarg, NULL, 10);
+            have_overlap = true;
+            break;
+            case('w'):
+            window = std::atoi(optarg);
+            break;
+            case('a'):
+            n_averages = std::strtoull(optarg, NULL, 10);
+            break;
+            case('r'):
+            sample_rate = (uint64_t) std::atof(optarg);
+            break;
+            case('t'):
+            n_threads = std::max(1, std::atoi(optarg));
+            break;
+            case('u'):
+            is_unsigned = true;
+            break;
+            case('d'):
+            density = true;
+            break;
+            default:
+                std::cout<<usage<<std::endl;
+            return 1;
+        }
+    }
+
+    if(input_file == "")
+    {
+        std::cout<<"Input file argument is mandatory."<<std::endl;
+        std::cout<<usage<<std::endl;
+        return 1;
+    }
+
+    if(!have_overlap){overlap = segment_length/2;}
+
+    if(output_file == "")
+    {
+        output_file = input_file;
+        size_t ext_loc = output_file.rfind(".bin");
+        if(ext_loc != std::string::npos){output_file = output_file.substr(0, ext_loc);}
+        output_file += ".spec";
+    }
+
+    //the main thread works alongside the scheduler's workers
+    HTaskScheduler* scheduler = HTaskScheduler::GetInstance();
+    if(n_threads > 1)
+    {
+        scheduler->SetNThreads(n_threads - 1);
+        scheduler->Launch();
+    }
+
+    int status = 0;
+    if(is_unsigned)
+    {
+        HWelchPowerSpectralDensity< uint16_t > welch;
+        configure_psd(welch, segment_length, overlap, window, n_averages, sample_rate, scheduler, input_file);
+        status = compute_psd(welch, input_file, output_file, density);
+    }
+    else
+    {
+        HWelchPowerSpectralDensity< int16_t > welch;
+        configure_psd(welch, segment_length, overlap, window, n_averages, sample_rate, scheduler, input_file);
+        status = compute_psd(welch, input_file, output_file, density);
+    }
+
+    if(scheduler->IsRunning()){scheduler->Terminate();}
+
+    return status;
+}
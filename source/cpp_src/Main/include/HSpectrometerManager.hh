@@ -8,12 +8,14 @@
 #include <fstream>
 #include <sstream>
 #include <thread>
+#include <chrono>
 #include <unistd.h>
 #include <dirent.h>
 #include <signal.h>
 #include <ctime>
 #include <cstdio>
 #include <cmath>
+#include <algorithm>
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -34,6 +36,8 @@ extern "C"
 #include "HBufferAllocatorNew.hh"
 
 #include "HBufferPool.hh"
+#include "HTaskScheduler.hh"
+#include "HAdaptiveThreadController.hh"
 #include "HSpectrometerCUDA.hh"
 #include "HSpectrumAverager.hh"
 #include "HCudaHostBufferAllocator.hh"
@@ -42,7 +46,13 @@ extern "C"
 #include "HDataAccumulationWriter.hh"
 #include "HSimpleMultiThreadedSpectrumDataWriter.hh"
 #include "HAveragedMultiThreadedSpectrumDataWriter.hh"
+#include "HSpectralKurtosisFlagger.hh"
 #include "HRawDataDumper.hh"
+#include "HImpulsiveRFIBlanker.hh"
+#include "HZoomSpectrometer.hh"
+#include "HMultiResolutionSpectrometer.hh"
+#include "HStokesSpectrometer.hh"
+#include "HPhaseCalibrationMonitor.hh"
 
 #include "HApplicationBackend.hh"
 #include "HServer.hh"
@@ -84,6 +94,7 @@ extern "C"
 #define QUERY 4
 #define SHUTDOWN 5
 #define SET_POWER_BINS 6
+#define CONFIGURE 7
 
 //recording states
 #define RECORDING_UNTIL_OFF 1
@@ -97,6 +108,9 @@ extern "C"
 #define TIME_PENDING 1
 #define TIME_AFTER 2
 
+//longest wait (ms) for each buffer pool to empty when the spectrometer is reconfigured
+#define RECONFIGURE_DRAIN_TIMEOUT_MS 2000
+
 namespace hose
 {
 
@@ -133,12 +147,25 @@ class HSpectrometerManager: public HApplicationBackend
             fSpectrometerBufferAllocator(nullptr),
             fSpectrometer(nullptr),
             fDumper(nullptr),
+            fBlanker(nullptr),
             fDigitizerSourcePool(nullptr),
             fSpectrometerSinkPool(nullptr),
             fSpectrumAveragingBufferAllocator(nullptr),
             fSpectrumAveragingBufferPool(nullptr),
             fSpectrumAverager(nullptr),
-            fAveragedSpectrumWriter(nullptr)
+            fAveragedSpectrumWriter(nullptr),
+            fSpectralKurtosisFlagger(nullptr),
+            fZoomSpectrometer(nullptr),
+            fZoomBufferAllocator(nullptr),
+            fZoomBufferPool(nullptr),
+            fZoomSpectrumWriter(nullptr),
+            fMultiResolutionSpectrometer(nullptr),
+            fStokesSpectrometer(nullptr),
+            fStokesBufferAllocator(nullptr),
+            fStokesBufferPool(nullptr),
+            fStokesSpectrumWriter(nullptr),
+            fPhaseCalibrationMonitor(nullptr),
+            fThreadController(nullptr)
             #ifdef HOSE_USE_SPDLOG
             ,fSink(nullptr),
             fStatusLogger(nullptr),
@@ -147,10 +174,61 @@ class HSpectrometerManager: public HApplicationBackend
         {
             fCannedStopCommand = "record=off";
             fWindowFlag = NO_WIN;
+            fWindowName = "none";
+            fWindowS1 = 0.0;
+            fWindowS2 = 0.0;
+            fOverlapIndependentFraction = 1.0;
             fParameters.Initialize();
             
             fEnableSpectrumWriteToFile=1;
             fEnableNoisePowerWriteToFile=0;
+            fEnableDigitizerFanOut=0;
+            fEnableDumperBestEffort=0;
+            fNSchedulerThreads=0;
+            fEnableAdaptiveThreads=0;
+            fNSpectrometerThreadsMax=1;
+            fDumperBackPressureThreshold=0;
+            fWriterBackPressureThreshold=0;
+            fWriterDecimationFactor=1;
+            fPipelineStatusInterval=0;
+            fFlushPartialAverages=0;
+            fPartialAverageTimeout=0;
+            fNSpectrumAveragerThreads=1;
+            fEnableSpectralKurtosis=0;
+            fSKThresholdSigma=3.0;
+            fFFTOverlap=1;
+            fEnableRFIBlanking=0;
+            fRFIBlankingBlockSize=1024;
+            fRFIBlankingThreshold=6;
+            fNBlankerThreads=1;
+            fEnableZoom=0;
+            fZoomCenterFrequency=0;
+            fZoomDecimation=64;
+            fZoomTapsPerPhase=16;
+            fZoomFFTSize=4096;
+            fNZoomThreads=1;
+            fNZoomPoolSize=16;
+            fZoomBackPressureThreshold=2;
+            fNMultiResolutionThreads=1;
+            fNMultiResolutionPoolSize=16;
+            fMultiResolutionBackPressureThreshold=2;
+            fEnableDualChannel=0;
+            fDualChannelInterleaveBlock=1;
+            fStokesFFTSize=65536;
+            fNStokesAverages=4;
+            fNStokesThreads=2;
+            fNStokesPoolSize=8;
+            fStokesBackPressureThreshold=4;
+            fEnablePhaseCalibration=0;
+            fPhaseCalibrationFirstTone=10000;
+            fPhaseCalibrationToneSpacing=1000000;
+            fNPhaseCalibrationTones=0;
+            fNPhaseCalibrationBuffers=16;
+            fNPhaseCalibrationThreads=1;
+            fPhaseCalibrationBackPressureThreshold=4;
+            fLastPipelineStatusTime=0;
+            fSpectrumAveragerFirstCore=0;
+            fSpectrometerFirstCore=0;
         }
 
         virtual ~HSpectrometerManager()
@@ -159,14 +237,30 @@ class HSpectrometerManager: public HApplicationBackend
             delete fDigitizer;
             delete fSpectrometer;
             delete fDumper;
+            delete fBlanker;
             delete fDigitizerSourcePool;
             delete fSpectrometerSinkPool;
             delete fCUDABufferAllocator;
             delete fSpectrometerBufferAllocator;
-            delete fSpectrumAveragingBufferAllocator;
             delete fSpectrumAveragingBufferPool;
+            delete fSpectrumAveragingBufferAllocator;
             delete fSpectrumAverager;
             delete fAveragedSpectrumWriter;
+            delete fSpectralKurtosisFlagger;
+            delete fZoomSpectrometer;
+            delete fZoomSpectrumWriter;
+            delete fZoomBufferPool;
+            delete fZoomBufferAllocator;
+            delete fMultiResolutionSpectrometer;
+            for(size_t i=0; i<fMultiResolutionWriters.size(); i++){delete fMultiResolutionWriters[i];}
+            for(size_t i=0; i<fMultiResolutionBufferPools.size(); i++){delete fMultiResolutionBufferPools[i];}
+            for(size_t i=0; i<fMultiResolutionBufferAllocators.size(); i++){delete fMultiResolutionBufferAllocators[i];}
+            delete fStokesSpectrometer;
+            delete fStokesSpectrumWriter;
+            delete fStokesBufferPool;
+            delete fStokesBufferAllocator;
+            delete fPhaseCalibrationMonitor;
+            delete fThreadController;
         }
 
         void SetServerIP(std::string ip){fIP = ip;};
@@ -203,10 +297,10 @@ class HSpectrometerManager: public HApplicationBackend
                     fEnableSpectrumWriteToFile = fParameters.GetIntegerParameter("enable_spectrum_write_to_file");
                     fEnableNoisePowerWriteToFile = fParameters.GetIntegerParameter("enable_noise_power_write_to_file");
 
-                    std::string aWindowName = fParameters.GetStringParameter("window_type");
-                    if(aWindowName == "none"){fWindowFlag = NO_WIN;}
-                    if(aWindowName == "blackman_harris"){fWindowFlag = BH_WIN;}
-                    if(aWindowName == "hann"){fWindowFlag = HANN_WIN;}
+                    fWindowName = fParameters.GetStringParameter("window_type");
+                    if(fWindowName == "none"){fWindowFlag = NO_WIN;}
+                    if(fWindowName == "blackman_harris"){fWindowFlag = BH_WIN;}
+                    if(fWindowName == "hann"){fWindowFlag = HANN_WIN;}
 
                     fUDPNoisePowerPort = fParameters.GetStringParameter("noise_power_port");
                     fUDPNoisePowerIP = fParameters.GetStringParameter("noise_power_ip_address");
@@ -228,10 +322,119 @@ class HSpectrometerManager: public HApplicationBackend
                     fNSpectrumAveragesCPU = fParameters.GetIntegerParameter("n_ave_spectra_cpu");
                     fNDumpSkip = fParameters.GetIntegerParameter("n_dump_skip");
                     fNSpectrumAveragerPoolSize = fParameters.GetIntegerParameter("n_spec_ave_pool_size");
+                    fEnableDigitizerFanOut = fParameters.GetIntegerParameter("enable_digitizer_fan_out");
+                    fEnableDumperBestEffort = fParameters.GetIntegerParameter("enable_dumper_best_effort");
+                    fNSchedulerThreads = fParameters.GetIntegerParameter("n_scheduler_threads");
+                    fEnableAdaptiveThreads = fParameters.GetIntegerParameter("enable_adaptive_threads");
+                    fNSpectrometerThreadsMax = fParameters.GetIntegerParameter("n_spec_threads_max");
+                    fDumperBackPressureThreshold = fParameters.GetIntegerParameter("dumper_back_pressure_threshold");
+                    fWriterBackPressureThreshold = fParameters.GetIntegerParameter("writer_back_pressure_threshold");
+                    fWriterDecimationFactor = fParameters.GetIntegerParameter("writer_decimation_factor");
+                    fPipelineStatusInterval = fParameters.GetIntegerParameter("pipeline_status_interval");
+                    fFlushPartialAverages = fParameters.GetIntegerParameter("flush_partial_averages");
+                    fPartialAverageTimeout = fParameters.GetIntegerParameter("partial_average_timeout_ms");
+                    fNSpectrumAveragerThreads = fParameters.GetIntegerParameter("n_averager_threads");
+                    if(fNSpectrumAveragerThreads == 0){fNSpectrumAveragerThreads = 1;}
+                    fEnableSpectralKurtosis = fParameters.GetIntegerParameter("enable_spectral_kurtosis");
+                    fSKThresholdSigma = fParameters.GetFloatingPointParameter("sk_threshold_sigma");
+                    fFFTOverlap = fParameters.GetIntegerParameter("fft_overlap");
+                    if(fFFTOverlap != 1 && fFFTOverlap != 2 && fFFTOverlap != 4)
+                    {
+                        std::cout<<"HSpectrometerManager::Initialize: Warning, fft_overlap must be 1, 2 or 4, not "<<fFFTOverlap<<", using 1."<<std::endl;
+                        fFFTOverlap = 1;
+                    }
+                    if(fFFTOverlap != 1 && fEnableSpectralKurtosis)
+                    {
+                        //the spectral kurtosis estimator assumes the spectra are independent
+                        std::cout<<"HSpectrometerManager::Initialize: Warning, overlapping ffts are not compatible with spectral kurtosis, using fft_overlap=1."<<std::endl;
+                        fFFTOverlap = 1;
+                    }
+                    fEnableRFIBlanking = fParameters.GetIntegerParameter("enable_rfi_blanking");
+                    fRFIBlankingBlockSize = fParameters.GetIntegerParameter("rfi_blanking_block_size");
+                    fRFIBlankingThreshold = fParameters.GetIntegerParameter("rfi_blanking_threshold");
+                    fNBlankerThreads = fParameters.GetIntegerParameter("n_blanker_threads");
+                    if(fNBlankerThreads == 0){fNBlankerThreads = 1;}
+                    fEnableZoom = fParameters.GetIntegerParameter("enable_zoom");
+                    fZoomCenterFrequency = fParameters.GetIntegerParameter("zoom_center_frequency_hz");
+                    fZoomDecimation = fParameters.GetIntegerParameter("zoom_decimation");
+                    fZoomTapsPerPhase = fParameters.GetIntegerParameter("zoom_fir_taps_per_phase");
+                    fZoomFFTSize = fParameters.GetIntegerParameter("zoom_fft_size");
+                    fNZoomThreads = fParameters.GetIntegerParameter("n_zoom_threads");
+                    if(fNZoomThreads == 0){fNZoomThreads = 1;}
+                    fNZoomPoolSize = fParameters.GetIntegerParameter("n_zoom_pool_size");
+                    fZoomBackPressureThreshold = fParameters.GetIntegerParameter("zoom_back_pressure_threshold");
+                    fMultiResolutionFFTSizes.clear();
+                    std::string mr_sizes = fParameters.GetStringParameter("multi_resolution_fft_sizes");
+                    if(mr_sizes != std::string("none"))
+                    {
+                        std::vector< std::string > mr_tokens;
+                        fTokenizer.SetString(&mr_sizes);
+                        fTokenizer.SetIncludeEmptyTokensFalse();
+                        fTokenizer.SetDelimiter(std::string(","));
+                        fTokenizer.GetTokens(&mr_tokens);
+                        for(size_t i=0; i<mr_tokens.size(); i++)
+                        {
+                            int mr_size = atoi(mr_tokens[i].c_str());
+                            if(mr_size > 0){fMultiResolutionFFTSizes.push_back(mr_size);}
+                        }
+                    }
+                    fNMultiResolutionThreads = fParameters.GetIntegerParameter("n_multi_resolution_threads");
+                    if(fNMultiResolutionThreads == 0){fNMultiResolutionThreads = 1;}
+                    fNMultiResolutionPoolSize = fParameters.GetIntegerParameter("n_multi_resolution_pool_size");
+                    fMultiResolutionBackPressureThreshold = fParameters.GetIntegerParameter("multi_resolution_back_pressure_threshold");
+                    fEnableDualChannel = fParameters.GetIntegerParameter("enable_dual_channel");
+                    fDualChannelInterleaveBlock = fParameters.GetIntegerParameter("dual_channel_interleave_block");
+                    if(fDualChannelInterleaveBlock == 0){fDualChannelInterleaveBlock = 1;}
+                    fStokesFFTSize = fParameters.GetIntegerParameter("stokes_fft_size");
+                    fNStokesAverages = fParameters.GetIntegerParameter("n_stokes_averages");
+                    if(fNStokesAverages == 0){fNStokesAverages = 1;}
+                    fNStokesThreads = fParameters.GetIntegerParameter("n_stokes_threads");
+                    if(fNStokesThreads == 0){fNStokesThreads = 1;}
+                    fNStokesPoolSize = fParameters.GetIntegerParameter("n_stokes_pool_size");
+                    fStokesBackPressureThreshold = fParameters.GetIntegerParameter("stokes_back_pressure_threshold");
+                    fEnablePhaseCalibration = fParameters.GetIntegerParameter("enable_pcal");
+                    fPhaseCalibrationFirstTone = fParameters.GetIntegerParameter("pcal_first_tone_hz");
+                    fPhaseCalibrationToneSpacing = fParameters.GetIntegerParameter("pcal_tone_spacing_hz");
+                    fNPhaseCalibrationTones = fParameters.GetIntegerParameter("pcal_n_tones");
+                    fNPhaseCalibrationBuffers = fParameters.GetIntegerParameter("n_pcal_integration_buffers");
+                    if(fNPhaseCalibrationBuffers == 0){fNPhaseCalibrationBuffers = 1;}
+                    fNPhaseCalibrationThreads = fParameters.GetIntegerParameter("n_pcal_threads");
+                    if(fNPhaseCalibrationThreads == 0){fNPhaseCalibrationThreads = 1;}
+                    fPhaseCalibrationBackPressureThreshold = fParameters.GetIntegerParameter("pcal_back_pressure_threshold");
+                    #ifndef HOSE_USE_ADQ7
+                    if(fEnableDualChannel)
+                    {
+                        std::cout<<"HSpectrometerManager::Initialize: Warning, dual-channel mode is only supported by the ADQ7 digitizer, it will be disabled."<<std::endl;
+                        fEnableDualChannel = 0;
+                    }
+                    #endif
                     #ifdef HOSE_USE_ADQ7
                     fNADQ7SampleSkip = fParameters.GetIntegerParameter("n_adq7_sample_skip");
                     #endif
 
+                    //the stages which cannot work with the digitizer buffer size are disabled
+                    unsigned int broken_stages = CheckStageConstraints(fFFTSize, fNSpectrumAverages, "Initialize");
+                    if(broken_stages & eSpectrometerConstraint)
+                    {
+                        std::cout<<"HSpectrometerManager::Initialize: Warning, using fft_overlap=1."<<std::endl;
+                        fFFTOverlap = 1;
+                    }
+                    if(broken_stages & eStokesConstraint)
+                    {
+                        std::cout<<"HSpectrometerManager::Initialize: Warning, dual-channel mode will be disabled."<<std::endl;
+                        fEnableDualChannel = 0;
+                    }
+                    if(broken_stages & eZoomConstraint)
+                    {
+                        std::cout<<"HSpectrometerManager::Initialize: Warning, the zoom spectrometer will be disabled."<<std::endl;
+                        fEnableZoom = 0;
+                    }
+                    if(broken_stages & eMultiResolutionConstraint)
+                    {
+                        std::cout<<"HSpectrometerManager::Initialize: Warning, the multi-resolution spectra will be disabled."<<std::endl;
+                        fMultiResolutionFFTSizes.clear();
+                    }
+
                     //create the loggers
                     #ifdef HOSE_USE_SPDLOG
                     try
@@ -275,6 +478,7 @@ class HSpectrometerManager: public HApplicationBackend
                     fDigitizer->SetNThreads(fNDigitizerThreads);
                     #ifdef HOSE_USE_ADQ7
                     fDigitizer->SetSampleSkipFactor(fNADQ7SampleSkip);
+                    fDigitizer->SetChannelMask(true, fEnableDualChannel != 0);
                     #endif
                     bool digitizer_init_success = fDigitizer->Initialize();
 
@@ -295,23 +499,163 @@ class HSpectrometerManager: public HApplicationBackend
                         fSpectrometerBufferAllocator->SetSampleArrayLength(fNSpectrumAverages*fFFTSize);
                         fSpectrometerBufferAllocator->SetSpectrumLength(fFFTSize);
                         fSpectrometerBufferAllocator->SetWindowFunction(fWindowFlag);
+                        fSpectrometerBufferAllocator->SetOverlapFactor(fFFTOverlap);
                         fSpectrometerSinkPool = new HBufferPool< SPECTRUM_TYPE >( fSpectrometerBufferAllocator );
                         fSpectrometerSinkPool->Allocate(fSpectrometerPoolSize, 1);
 
+                        //the impulsive RFI blanker modifies the raw data in place, so it has to be the
+                        //first consumer of each digitizer buffer (before the spectrometer and dumper)
+                        if(fEnableRFIBlanking)
+                        {
+                            fBlanker = new HImpulsiveRFIBlanker< typename XDigitizerType::sample_type >();
+                            fBlanker->SetBufferPool(fDigitizerSourcePool);
+                            fBlanker->SetBlockSize(fRFIBlankingBlockSize);
+                            fBlanker->SetThreshold(fRFIBlankingThreshold);
+                            fBlanker->SetNThreads(fNBlankerThreads);
+                        }
+
                         //create spectrometer
                         fSpectrometer = new SPECTROMETER_TYPE(fFFTSize, fNSpectrumAverages);
                         fSpectrometer->SetNThreads(fNSpectrometerThreads);
+                        if(fEnableSpectralKurtosis){fSpectrometer->EnableSpectralKurtosis();}
                         fSpectrometer->SetSourceBufferPool(fDigitizerSourcePool);
                         fSpectrometer->SetSinkBufferPool(fSpectrometerSinkPool);
 
+                        //the zoom spectrometer reads the same digitizer buffers (after the main spectrometer),
+                        //and has its own output pool and writer
+                        if(fEnableZoom)
+                        {
+                            fZoomBufferAllocator = new HBufferAllocatorNew< float >();
+                            fZoomBufferPool = new HBufferPool< float >(fZoomBufferAllocator);
+                            fZoomBufferPool->Allocate(fNZoomPoolSize, fZoomFFTSize);
+
+                            fZoomSpectrometer = new HZoomSpectrometer< typename XDigitizerType::sample_type >();
+                            fZoomSpectrometer->SetCenterFrequency(fZoomCenterFrequency);
+                            fZoomSpectrometer->SetDecimationFactor(fZoomDecimation);
+                            fZoomSpectrometer->SetNTapsPerPhase(fZoomTapsPerPhase);
+                            fZoomSpectrometer->SetFFTSize(fZoomFFTSize);
+                            fZoomSpectrometer->SetWindowFunction(fWindowFlag);
+                            fZoomSpectrometer->SetNThreads(fNZoomThreads);
+                            fZoomSpectrometer->SetSourceBufferPool(fDigitizerSourcePool);
+                            fZoomSpectrometer->SetSinkBufferPool(fZoomBufferPool);
+                            if(fZoomBackPressureThreshold > 0)
+                            {
+                                fZoomSpectrometer->GetBackPressurePolicy()->SetAction(HBackPressureAction::drop);
+                                fZoomSpectrometer->GetBackPressurePolicy()->SetBacklogThreshold(fZoomBackPressureThreshold);
+                            }
+
+                            fZoomSpectrumWriter = new HAveragedMultiThreadedSpectrumDataWriter();
+                            fZoomSpectrumWriter->SetBufferPool(fZoomBufferPool);
+                            fZoomSpectrumWriter->SetNThreads(1);
+                            fZoomSpectrumWriter->SetFileNameTag(std::string("_zoom"));
+                            fZoomSpectrumWriter->DisableNoisePowerWriteToDisk();
+                            if(fEnableSpectrumWriteToFile){fZoomSpectrumWriter->EnableSpectrumWriteToDisk();}
+                            else{fZoomSpectrumWriter->DisableSpectrumWriteToDisk();}
+                        }
+
+                        //additional fft sizes computed from the same digitizer buffers, in a single pass,
+                        //each resolution has its own output pool and writer
+                        if(fMultiResolutionFFTSizes.size() != 0)
+                        {
+                            fMultiResolutionSpectrometer = new HMultiResolutionSpectrometer< typename XDigitizerType::sample_type >();
+                            fMultiResolutionSpectrometer->SetWindowFunction(fWindowFlag);
+                            fMultiResolutionSpectrometer->SetNThreads(fNMultiResolutionThreads);
+                            fMultiResolutionSpectrometer->SetBufferPool(fDigitizerSourcePool);
+                            if(fMultiResolutionBackPressureThreshold > 0)
+                            {
+                                fMultiResolutionSpectrometer->GetBackPressurePolicy()->SetAction(HBackPressureAction::drop);
+                                fMultiResolutionSpectrometer->GetBackPressurePolicy()->SetBacklogThreshold(fMultiResolutionBackPressureThreshold);
+                            }
+
+                            for(size_t i=0; i<fMultiResolutionFFTSizes.size(); i++)
+                            {
+                                size_t mr_size = fMultiResolutionFFTSizes[i];
+                                HBufferAllocatorNew< float >* mr_allocator = new HBufferAllocatorNew< float >();
+                                HBufferPool< float >* mr_pool = new HBufferPool< float >(mr_allocator);
+                                mr_pool->Allocate(fNMultiResolutionPoolSize, mr_size/2+1);
+                                fMultiResolutionBufferAllocators.push_back(mr_allocator);
+                                fMultiResolutionBufferPools.push_back(mr_pool);
+                                if(!fMultiResolutionSpectrometer->AddResolution(mr_size, mr_pool)){continue;}
+
+                                std::stringstream mrtag;
+                                mrtag << "_fft" << mr_size;
+                                HAveragedMultiThreadedSpectrumDataWriter* mr_writer = new HAveragedMultiThreadedSpectrumDataWriter();
+                                mr_writer->SetBufferPool(mr_pool);
+                                mr_writer->SetNThreads(1);
+                                mr_writer->SetFileNameTag(mrtag.str());
+                                mr_writer->DisableNoisePowerWriteToDisk();
+                                if(fEnableSpectrumWriteToFile){mr_writer->EnableSpectrumWriteToDisk();}
+                                else{mr_writer->DisableSpectrumWriteToDisk();}
+                                fMultiResolutionWriters.push_back(mr_writer);
+                            }
+                        }
+
+                        //in dual-channel mode the digitizer buffers hold both inputs (interleaved), the stokes spectrometer
+                        //separates them and computes the auto and cross spectra, with its own output pool and writer
+                        if(fEnableDualChannel)
+                        {
+                            size_t stokes_length = fStokesFFTSize/2+1;
+                            fStokesBufferAllocator = new HBufferAllocatorNew< float >();
+                            fStokesBufferPool = new HBufferPool< float >(fStokesBufferAllocator);
+                            fStokesBufferPool->Allocate(fNStokesPoolSize, 4*stokes_length);
+
+                            fStokesSpectrometer = new HStokesSpectrometer< typename XDigitizerType::sample_type >();
+                            fStokesSpectrometer->SetFFTSize(fStokesFFTSize);
+                            fStokesSpectrometer->SetWindowFunction(fWindowFlag);
+                            fStokesSpectrometer->SetInterleaveBlockSize(fDualChannelInterleaveBlock);
+                            fStokesSpectrometer->SetNBuffersToAverage(fNStokesAverages);
+                            fStokesSpectrometer->SetNThreads(fNStokesThreads);
+                            fStokesSpectrometer->SetSourceBufferPool(fDigitizerSourcePool);
+                            fStokesSpectrometer->SetSinkBufferPool(fStokesBufferPool);
+                            if(fStokesBackPressureThreshold > 0)
+                            {
+                                fStokesSpectrometer->GetBackPressurePolicy()->SetAction(HBackPressureAction::drop);
+                                fStokesSpectrometer->GetBackPressurePolicy()->SetBacklogThreshold(fStokesBackPressureThreshold);
+                            }
+
+                            fStokesSpectrumWriter = new HAveragedMultiThreadedSpectrumDataWriter();
+                            fStokesSpectrumWriter->SetBufferPool(fStokesBufferPool);
+                            fStokesSpectrumWriter->SetNThreads(1);
+                            fStokesSpectrumWriter->SetFileNameTag(std::string("_stokes"));
+                            fStokesSpectrumWriter->EnableStokesRecords();
+                            fStokesSpectrumWriter->DisableNoisePowerWriteToDisk();
+                            if(fEnableSpectrumWriteToFile){fStokesSpectrumWriter->EnableSpectrumWriteToDisk();}
+                            else{fStokesSpectrumWriter->DisableSpectrumWriteToDisk();}
+                        }
+
+                        //phase-calibration tones are extracted from the raw digitizer buffers, and written to their own records
+                        //(in dual-channel mode the buffers hold both inputs interleaved, so the tones would not be meaningful)
+                        if(fEnablePhaseCalibration && fEnableDualChannel)
+                        {
+                            std::cout<<"HSpectrometerManager::Initialize: Warning, phase-calibration extraction is not supported in dual-channel mode, it will be disabled."<<std::endl;
+                            fEnablePhaseCalibration = 0;
+                        }
+                        if(fEnablePhaseCalibration)
+                        {
+                            fPhaseCalibrationMonitor = new HPhaseCalibrationMonitor< typename XDigitizerType::sample_type >();
+                            fPhaseCalibrationMonitor->SetFirstToneFrequency(fPhaseCalibrationFirstTone);
+                            fPhaseCalibrationMonitor->SetToneSpacing(fPhaseCalibrationToneSpacing);
+                            fPhaseCalibrationMonitor->SetNTones(fNPhaseCalibrationTones);
+                            fPhaseCalibrationMonitor->SetNBuffersToIntegrate(fNPhaseCalibrationBuffers);
+                            fPhaseCalibrationMonitor->SetNThreads(fNPhaseCalibrationThreads);
+                            fPhaseCalibrationMonitor->SetBufferPool(fDigitizerSourcePool);
+                            if(fPhaseCalibrationBackPressureThreshold > 0)
+                            {
+                                fPhaseCalibrationMonitor->GetBackPressurePolicy()->SetAction(HBackPressureAction::drop);
+                                fPhaseCalibrationMonitor->GetBackPressurePolicy()->SetBacklogThreshold(fPhaseCalibrationBackPressureThreshold);
+                            }
+                        }
+
                         //create post-spectrometer data pool for averaging
                         fSpectrumAveragingBufferAllocator = new HBufferAllocatorNew< float >();
                         fSpectrumAveragingBufferPool = new HBufferPool< float >(fSpectrumAveragingBufferAllocator);
-                        fSpectrumAveragingBufferPool->Allocate(fNSpectrumAveragerPoolSize, fFFTSize/2+1); //create a work space of buffers
+                        //(with spectral kurtosis, the average |X|^4 spectrum is stored after the power spectrum)
+                        size_t n_ave_buffer_length = (fFFTSize/2+1)*(fEnableSpectralKurtosis ? 2 : 1);
+                        fSpectrumAveragingBufferPool->Allocate(fNSpectrumAveragerPoolSize, n_ave_buffer_length); //create a work space of buffers
 
                         // fSpectrumAverager = new AVERAGER_TYPE(fFFTSize/2+1, fNSpectrumAveragesCPU); //further average down on cpu
                         fSpectrumAverager = new AVERAGER_TYPE(fFFTSize/2+1, fNSpectrumAveragesCPU, fUDPNoisePowerPort, fUDPNoisePowerIP, fUDPSpectrumPort, fUDPSpectrumIP);
-                        fSpectrumAverager->SetNThreads(1); //ONE THREAD ONLY!
+                        fSpectrumAverager->SetNThreads(fNSpectrumAveragerThreads);
                         fSpectrumAverager->SetSourceBufferPool(fSpectrometerSinkPool);
                         fSpectrumAverager->SetSinkBufferPool(fSpectrumAveragingBufferPool);
                         fSpectrumAverager->SetBufferSkip(fUDPNoisePowerSkipInterval);
@@ -321,6 +665,19 @@ class HSpectrometerManager: public HApplicationBackend
                         else{fSpectrumAverager->DisableNoisePowerUDPMessages();}
                         if(fEnableSpectrumUDPMessages){fSpectrumAverager->EnableSpectrumUDPMessages();}
                         else{fSpectrumAverager->DisableSpectrumUDPMessages();}
+                        if(fFlushPartialAverages){fSpectrumAverager->EnablePartialAverageFlush();}
+                        else{fSpectrumAverager->DisablePartialAverageFlush();}
+                        fSpectrumAverager->SetPartialAverageTimeoutMilliseconds(fPartialAverageTimeout);
+                        if(fEnableSpectralKurtosis){fSpectrumAverager->EnableSpectralKurtosis();}
+
+                        //the RFI flagger has to see each averaged spectrum before the writer does
+                        if(fEnableSpectralKurtosis)
+                        {
+                            fSpectralKurtosisFlagger = new HSpectralKurtosisFlagger();
+                            fSpectralKurtosisFlagger->SetBufferPool(fSpectrumAveragingBufferPool);
+                            fSpectralKurtosisFlagger->SetThresholdSigma(fSKThresholdSigma);
+                            fSpectralKurtosisFlagger->SetNThreads(1);
+                        }
 
                         fAveragedSpectrumWriter = new HAveragedMultiThreadedSpectrumDataWriter();
                         fAveragedSpectrumWriter->SetBufferPool(fSpectrumAveragingBufferPool);
@@ -329,8 +686,17 @@ class HSpectrometerManager: public HApplicationBackend
                         if(fEnableSpectrumWriteToFile){fAveragedSpectrumWriter->EnableSpectrumWriteToDisk();}
                         else{fAveragedSpectrumWriter->DisableSpectrumWriteToDisk();}
 
+                        //the main spectrometer sees the two inputs as a single (interleaved) stream, so its spectra
+                        //are not meaningful in dual-channel mode, only the (total) noise power is kept
+                        if(fEnableDualChannel && fEnableSpectrumWriteToFile)
+                        {
+                            std::cout<<"HSpectrometerManager::Initialize: Warning, the main spectrum files are not written in dual-channel mode, see the (*_stokes.spec) files."<<std::endl;
+                            fAveragedSpectrumWriter->DisableSpectrumWriteToDisk();
+                        }
+
                         if(fEnableNoisePowerWriteToFile){fAveragedSpectrumWriter->EnableNoisePowerWriteToDisk();}
                         else{fAveragedSpectrumWriter->DisableNoisePowerWriteToDisk();}
+                        UpdateWindowProperties();
 
                         //create an itermittent raw data dumper
                         fDumper = new HRawDataDumper< typename XDigitizerType::sample_type >();
@@ -338,9 +704,109 @@ class HSpectrometerManager: public HApplicationBackend
                         fDumper->SetBufferDumpFrequency(fNDumpSkip);
                         fDumper->SetNThreads(1);
 
+                        //the spectrometer and dumper can share each digitizer buffer concurrently,
+                        //and the dumper can be allowed to miss buffers rather than stall the acquisition
+                        if(fEnableDigitizerFanOut && fBlanker != nullptr)
+                        {
+                            std::cout<<"HSpectrometerManager::Initialize: Warning, digitizer fan-out cannot be used with RFI blanking, it will be disabled."<<std::endl;
+                            fEnableDigitizerFanOut = 0;
+                        }
+                        if(fEnableDigitizerFanOut){fDigitizerSourcePool->EnableFanOut();}
+                        if(fEnableDumperBestEffort){fDumper->SetBestEffort(true);}
+
+                        //under overload shed work in order of increasing value, the raw data dumper pauses first,
+                        //then the writer thins out the averaged spectra, so that the spectrometer can keep up
+                        if(fDumperBackPressureThreshold > 0)
+                        {
+                            fDumper->GetBackPressurePolicy()->SetAction(HBackPressureAction::pause);
+                            fDumper->GetBackPressurePolicy()->SetBacklogThreshold(fDumperBackPressureThreshold);
+                        }
+                        if(fWriterBackPressureThreshold > 0)
+                        {
+                            if(fWriterDecimationFactor > 1)
+                            {
+                                fAveragedSpectrumWriter->GetBackPressurePolicy()->SetAction(HBackPressureAction::decimate);
+                                fAveragedSpectrumWriter->GetBackPressurePolicy()->SetDecimationFactor(fWriterDecimationFactor);
+                            }
+                            else
+                            {
+                                fAveragedSpectrumWriter->GetBackPressurePolicy()->SetAction(HBackPressureAction::drop);
+                            }
+                            fAveragedSpectrumWriter->GetBackPressurePolicy()->SetBacklogThreshold(fWriterBackPressureThreshold);
+                        }
+
+                        //let the processing stages share one pool of worker threads, with the
+                        //thread counts above acting as per-stage concurrency limits
+                        //(the digitizer keeps its own threads, since they block on the hardware)
+                        if(fNSchedulerThreads > 0)
+                        {
+                            HTaskScheduler::GetInstance()->SetNThreads(fNSchedulerThreads);
+                            fSpectrometer->SetUseSharedScheduler(true);
+                            fSpectrometer->SetSchedulerPriority(3);
+                            fSpectrumAverager->SetUseSharedScheduler(true);
+                            fSpectrumAverager->SetSchedulerPriority(2);
+                            fAveragedSpectrumWriter->SetUseSharedScheduler(true);
+                            fAveragedSpectrumWriter->SetSchedulerPriority(1);
+                            if(fSpectralKurtosisFlagger != nullptr)
+                            {
+                                fSpectralKurtosisFlagger->SetUseSharedScheduler(true);
+                                fSpectralKurtosisFlagger->SetSchedulerPriority(1);
+                            }
+                            fDumper->SetUseSharedScheduler(true);
+                            fDumper->SetSchedulerPriority(0);
+                            if(fBlanker != nullptr)
+                            {
+                                fBlanker->SetUseSharedScheduler(true);
+                                fBlanker->SetSchedulerPriority(3);
+                            }
+                            if(fZoomSpectrometer != nullptr)
+                            {
+                                fZoomSpectrometer->SetUseSharedScheduler(true);
+                                fZoomSpectrometer->SetSchedulerPriority(2);
+                                fZoomSpectrumWriter->SetUseSharedScheduler(true);
+                                fZoomSpectrumWriter->SetSchedulerPriority(1);
+                            }
+                            if(fMultiResolutionSpectrometer != nullptr)
+                            {
+                                fMultiResolutionSpectrometer->SetUseSharedScheduler(true);
+                                fMultiResolutionSpectrometer->SetSchedulerPriority(2);
+                                for(size_t i=0; i<fMultiResolutionWriters.size(); i++)
+                                {
+                                    fMultiResolutionWriters[i]->SetUseSharedScheduler(true);
+                                    fMultiResolutionWriters[i]->SetSchedulerPriority(1);
+                                }
+                            }
+                            if(fStokesSpectrometer != nullptr)
+                            {
+                                fStokesSpectrometer->SetUseSharedScheduler(true);
+                                fStokesSpectrometer->SetSchedulerPriority(3);
+                                fStokesSpectrumWriter->SetUseSharedScheduler(true);
+                                fStokesSpectrumWriter->SetSchedulerPriority(1);
+                            }
+                            if(fPhaseCalibrationMonitor != nullptr)
+                            {
+                                fPhaseCalibrationMonitor->SetUseSharedScheduler(true);
+                                fPhaseCalibrationMonitor->SetSchedulerPriority(2);
+                            }
+                        }
+
+                        //grow/shrink the spectrometer threads to follow the digitizer backlog
+                        if(fEnableAdaptiveThreads)
+                        {
+                            fThreadController = new HAdaptiveThreadController();
+                            HBufferPool< typename XDigitizerType::sample_type >* source_pool = fDigitizerSourcePool;
+                            SPECTROMETER_TYPE* spectrometer = fSpectrometer;
+                            fThreadController->AddStage(fSpectrometer,
+                                [source_pool, spectrometer](){return source_pool->GetConsumerPoolSize(spectrometer->GetConsumerID());},
+                                1, std::max(fNSpectrometerThreads, fNSpectrometerThreadsMax) );
+                        }
+
                         fDigitizerSourcePool->Initialize();
                         fSpectrometerSinkPool->Initialize();
                         fSpectrumAveragingBufferPool->Initialize();
+                        if(fZoomBufferPool != nullptr){fZoomBufferPool->Initialize();}
+                        for(size_t i=0; i<fMultiResolutionBufferPools.size(); i++){fMultiResolutionBufferPools[i]->Initialize();}
+                        if(fStokesBufferPool != nullptr){fStokesBufferPool->Initialize();}
 
                         #ifdef HOSE_USE_SPDLOG
 
@@ -361,108 +827,126 @@ class HSpectrometerManager: public HApplicationBackend
                         sfss << "sampling_frequency_Hz=";
                         sfss << fDigitizer->GetSamplingFrequency();
 
-                        std::string digitizer_config = "digitizer_config; " + ndtss.str() + "; " + sbfss.str() + "; " + pfss.str() + "; " + sfss.str();
+                        std::stringstream dfoss;
+                        dfoss << "digitizer_pool_fan_out=";
+                        dfoss << fEnableDigitizerFanOut;
+
+                        std::string digitizer_config = "digitizer_config; " + ndtss.str() + "; " + sbfss.str() + "; " + pfss.str() + "; " + sfss.str() + "; " + dfoss.str();
                         fConfigLogger->info( digitizer_config.c_str() );
 
-                        //spectrometer configuration line
-                        std::stringstream navess;
-                        navess << "n_averages=";
-                        navess << fNSpectrumAverages;
+                        LogSpectrometerConfig();
+
+                        //noise diode configuration
+                        std::stringstream ndsfss;
+                        ndsfss << "noise_diode_switching_frequency_Hz=";
+                        ndsfss << 0;
+                        // ndsfss << noise_diode_switching_freq;
+
+                        std::stringstream ndbpss;
+                        ndbpss << "noise_blanking_period=";
+                        ndbpss << 0;
+                        // ndbpss << noise_diode_blanking_period;
 
-                        std::stringstream fftss;
-                        fftss << "fft_size=";
-                        fftss << fFFTSize;
+                        std::string noise_diode_config = "noise_diode_config; " + ndsfss.str() + "; " + ndbpss.str();
+                        fConfigLogger->info( noise_diode_config.c_str() );
 
-                        //window function information, this is essentially hard-coded for now,
-                        //but it is possible we may implement different types in the future
-                        //TODO FIXME move this calculation out of here
-                        std::vector<double> pOut;
-                        double s1 = 0;
-                        double s2 = 0;
-                        pOut.resize(fFFTSize);
+                        //back-pressure configuration
+                        std::stringstream dbpss;
+                        dbpss << "dumper_back_pressure_threshold=";
+                        dbpss << fDumperBackPressureThreshold;
 
+                        std::stringstream wbpss;
+                        wbpss << "writer_back_pressure_threshold=";
+                        wbpss << fWriterBackPressureThreshold;
 
-                        if(fWindowFlag == NO_WIN)
+                        std::stringstream wdfss;
+                        wdfss << "writer_decimation_factor=";
+                        wdfss << fWriterDecimationFactor;
+
+                        std::string back_pressure_config = "back_pressure_config; " + dbpss.str() + "; " + wbpss.str() + "; " + wdfss.str();
+                        fConfigLogger->info( back_pressure_config.c_str() );
+
+                        //rfi flagging configuration
+                        std::stringstream skss;
+                        skss << "spectral_kurtosis=";
+                        skss << fEnableSpectralKurtosis;
+
+                        std::stringstream sktss;
+                        sktss << "sk_threshold_sigma=";
+                        sktss << fSKThresholdSigma;
+
+                        std::stringstream rbss;
+                        rbss << "rfi_blanking=";
+                        rbss << fEnableRFIBlanking;
+
+                        std::stringstream rbbss;
+                        rbbss << "rfi_blanking_block_size=";
+                        rbbss << fRFIBlankingBlockSize;
+
+                        std::stringstream rbtss;
+                        rbtss << "rfi_blanking_threshold=";
+                        rbtss << fRFIBlankingThreshold;
+
+                        std::string rfi_config = "rfi_config; " + skss.str() + "; " + sktss.str() + "; " + rbss.str() + "; " + rbbss.str() + "; " + rbtss.str();
+                        fConfigLogger->info( rfi_config.c_str() );
+
+                        //zoom spectrometer configuration
+                        if(fZoomSpectrometer != nullptr)
                         {
-                            s1 = fFFTSize;
-                            s2 = fFFTSize;
+                            double zoom_rate = ( (double) fDigitizer->GetSamplingFrequency() )/( (double) fZoomDecimation );
+                            std::stringstream zss;
+                            zss << "zoom_config; ";
+                            zss << "zoom_center_frequency_Hz=" << fZoomCenterFrequency << "; ";
+                            zss << "zoom_decimation=" << fZoomDecimation << "; ";
+                            zss << "zoom_fir_taps=" << fZoomDecimation*fZoomTapsPerPhase << "; ";
+                            zss << "zoom_fft_size=" << fZoomFFTSize << "; ";
+                            zss << "zoom_bandwidth_Hz=" << zoom_rate << "; ";
+                            zss << "zoom_channel_width_Hz=" << zoom_rate/fZoomFFTSize << "; ";
+                            zss << "n_zoom_threads=" << fNZoomThreads;
+                            fConfigLogger->info( zss.str().c_str() );
                         }
 
-                        if(fWindowFlag == BH_WIN)
+                        //multi-resolution spectrometer configuration
+                        if(fMultiResolutionSpectrometer != nullptr)
                         {
-                            double a0 = 0.35875f;
-                            double a1 = 0.48829f;
-                            double a2 = 0.14128f;
-                            double a3 = 0.01168f;
-                            unsigned int idx = 0;
-                            while( idx < fFFTSize )
+                            std::stringstream mrss;
+                            mrss << "multi_resolution_config; ";
+                            mrss << "fft_sizes=";
+                            for(size_t i=0; i<fMultiResolutionSpectrometer->GetNResolutions(); i++)
                             {
-                                pOut[idx]   = a0 - (a1 * std::cos( (2.0f * M_PI * idx) / (fFFTSize- 1) )) + (a2 * std::cos( (4.0f * M_PI * idx) / (fFFTSize- 1) )) - (a3 * std::cos( (6.0f * M_PI * idx) / (fFFTSize - 1) ));
-                                s1 += pOut[idx];
-                                s2 += pOut[idx]*pOut[idx];
-                                idx++;
+                                if(i != 0){mrss << ",";}
+                                mrss << fMultiResolutionSpectrometer->GetFFTSize(i);
                             }
+                            mrss << "; ";
+                            mrss << "n_multi_resolution_threads=" << fNMultiResolutionThreads;
+                            fConfigLogger->info( mrss.str().c_str() );
                         }
 
-                        if(fWindowFlag == HANN_WIN)
+                        //dual-channel (stokes) spectrometer configuration
+                        if(fStokesSpectrometer != nullptr)
                         {
-                            unsigned int idx    = 0;
-                            while( idx < fFFTSize )
-                            {
-                                pOut[idx] = 0.5 + 0.5*( std::cos( (2.0f * M_PI * idx) / (fFFTSize - 1) ) );
-                                s1 += pOut[idx];
-                                s2 += pOut[idx]*pOut[idx];
-                                idx++;
-                            }
+                            std::stringstream stss;
+                            stss << "stokes_config; ";
+                            stss << "dual_channel_interleave_block=" << fDualChannelInterleaveBlock << "; ";
+                            stss << "stokes_fft_size=" << fStokesFFTSize << "; ";
+                            stss << "stokes_channel_width_Hz=" << ( (double) fDigitizer->GetSamplingFrequency() )/( (double) fStokesFFTSize ) << "; ";
+                            stss << "n_stokes_averages=" << fNStokesAverages << "; ";
+                            stss << "n_stokes_threads=" << fNStokesThreads;
+                            fConfigLogger->info( stss.str().c_str() );
                         }
 
-                        std::stringstream wtss;
-                        wtss << "window_type=" << aWindowName; 
-                        std::stringstream wts1ss;
-                        wts1ss << "window_s1=";
-                        wts1ss << s1;
-                        std::stringstream wts2ss;
-                        wts2ss << "window_s2=";
-                        wts2ss << s2;
-                        std::stringstream wtnenbwss;
-                        wtnenbwss << "window_normalized_equivalent_noise_bandwidth=";
-                        wtnenbwss << fFFTSize*s2/(s1*s1);
-                        std::stringstream wtenbwss;
-                        wtenbwss << "window_equivalent_noise_bandwidth_Hz=";
-                        wtenbwss <<  (fFFTSize*s2/(s1*s1) )*(fDigitizer->GetSamplingFrequency()/fFFTSize);
-                        std::stringstream nstss;
-                        nstss << "n_spectrometer_threads=";
-                        nstss << fNSpectrometerThreads;
-                        std::stringstream nwtss;
-                        nwtss << "n_writer_threads=";
-                        nwtss << 1;
-
-
-                        std::string spectrometer_config = "spectrometer_config; " + navess.str() + "; "
-                            + fftss.str() + "; "
-                            + nstss.str() + "; "
-                            + nwtss.str() + "; "
-                            + wtss.str() + "; "
-                            + wts1ss.str() + "; "
-                            + wts2ss.str() + "; "
-                            + wtnenbwss.str() + "; "
-                            + wtenbwss.str();
-
-                        fConfigLogger->info( spectrometer_config.c_str() );
-
-                        //noise diode configuration
-                        std::stringstream ndsfss;
-                        ndsfss << "noise_diode_switching_frequency_Hz=";
-                        ndsfss << 0;
-                        // ndsfss << noise_diode_switching_freq;
-
-                        std::stringstream ndbpss;
-                        ndbpss << "noise_blanking_period=";
-                        ndbpss << 0;
-                        // ndbpss << noise_diode_blanking_period;
-
-                        std::string noise_diode_config = "noise_diode_config; " + ndsfss.str() + "; " + ndbpss.str();
-                        fConfigLogger->info( noise_diode_config.c_str() );
+                        //phase-calibration tone extraction configuration
+                        if(fPhaseCalibrationMonitor != nullptr)
+                        {
+                            std::stringstream pcss;
+                            pcss << "pcal_config; ";
+                            pcss << "pcal_first_tone_hz=" << fPhaseCalibrationFirstTone << "; ";
+                            pcss << "pcal_tone_spacing_hz=" << fPhaseCalibrationToneSpacing << "; ";
+                            pcss << "pcal_n_tones=" << fNPhaseCalibrationTones << "; ";
+                            pcss << "n_pcal_integration_buffers=" << fNPhaseCalibrationBuffers << "; ";
+                            pcss << "n_pcal_threads=" << fNPhaseCalibrationThreads;
+                            fConfigLogger->info( pcss.str().c_str() );
+                        }
 
                         #endif
                         fInitialized = true;
@@ -483,6 +967,10 @@ class HSpectrometerManager: public HApplicationBackend
                 std::thread server_thread( &HServer::Run, fServer );
 
                 fAveragedSpectrumWriter->StartConsumption();
+                if(fSpectralKurtosisFlagger != nullptr){fSpectralKurtosisFlagger->StartConsumption();}
+                if(fZoomSpectrumWriter != nullptr){fZoomSpectrumWriter->StartConsumption();}
+                for(size_t i=0; i<fMultiResolutionWriters.size(); i++){fMultiResolutionWriters[i]->StartConsumption();}
+                if(fStokesSpectrumWriter != nullptr){fStokesSpectrumWriter->StartConsumption();}
 
                 // NUMA node0 CPU(s):     0-7,16-23
                 // NUMA node1 CPU(s):     8-15,24-31
@@ -496,13 +984,60 @@ class HSpectrometerManager: public HApplicationBackend
                 fDumper->StartConsumption();
 
                 fSpectrumAverager->StartConsumptionProduction();
-                for(unsigned int i=0; i<1; i++)
+                fSpectrumAveragerFirstCore = core_id;
+                for(unsigned int i=0; i<fNSpectrumAveragerThreads; i++)
                 {
                     fSpectrumAverager->AssociateThreadWithSingleProcessor(i, core_id++);
                 };
 
+                if(fBlanker != nullptr)
+                {
+                    fBlanker->StartConsumption();
+                    for(unsigned int i=0; i<fNBlankerThreads; i++)
+                    {
+                        fBlanker->AssociateThreadWithSingleProcessor(i, core_id++);
+                    };
+                }
+
+                if(fZoomSpectrometer != nullptr)
+                {
+                    fZoomSpectrometer->StartConsumptionProduction();
+                    for(unsigned int i=0; i<fNZoomThreads; i++)
+                    {
+                        fZoomSpectrometer->AssociateThreadWithSingleProcessor(i, core_id++);
+                    };
+                }
+
+                if(fMultiResolutionSpectrometer != nullptr)
+                {
+                    fMultiResolutionSpectrometer->StartConsumption();
+                    for(unsigned int i=0; i<fNMultiResolutionThreads; i++)
+                    {
+                        fMultiResolutionSpectrometer->AssociateThreadWithSingleProcessor(i, core_id++);
+                    };
+                }
+
+                if(fStokesSpectrometer != nullptr)
+                {
+                    fStokesSpectrometer->StartConsumptionProduction();
+                    for(unsigned int i=0; i<fNStokesThreads; i++)
+                    {
+                        fStokesSpectrometer->AssociateThreadWithSingleProcessor(i, core_id++);
+                    };
+                }
+
+                if(fPhaseCalibrationMonitor != nullptr)
+                {
+                    fPhaseCalibrationMonitor->StartConsumption();
+                    for(unsigned int i=0; i<fNPhaseCalibrationThreads; i++)
+                    {
+                        fPhaseCalibrationMonitor->AssociateThreadWithSingleProcessor(i, core_id++);
+                    };
+                }
+
                 fSpectrometer->StartConsumptionProduction();
                 core_id = 24;
+                fSpectrometerFirstCore = core_id;
                 for(size_t i=0; i<fNSpectrometerThreads; i++)
                 {
                     fSpectrometer->AssociateThreadWithSingleProcessor(i, core_id++);
@@ -514,6 +1049,8 @@ class HSpectrometerManager: public HApplicationBackend
                     fDigitizer->AssociateThreadWithSingleProcessor(i, core_id++);
                 };
 
+                if(fThreadController != nullptr){fThreadController->Start();}
+
                 fRecordingState = IDLE;
 
                 std::cout<<"Ready."<<std::endl;
@@ -563,6 +1100,17 @@ class HSpectrometerManager: public HApplicationBackend
                         }
                     }
 
+                    //periodically report the data loss counters while recording
+                    if(fPipelineStatusInterval > 0 && (fRecordingState == RECORDING_UNTIL_OFF || fRecordingState == RECORDING_UNTIL_TIME) )
+                    {
+                        std::time_t now = std::time(nullptr);
+                        if(now - fLastPipelineStatusTime >= fPipelineStatusInterval)
+                        {
+                            LogPipelineStatus();
+                            fLastPipelineStatusTime = now;
+                        }
+                    }
+
                     //sleep for 5 microsecond
                     //usleep(5);
                 }
@@ -576,12 +1124,25 @@ class HSpectrometerManager: public HApplicationBackend
                     ProcessCommand(fCannedStopCommand);
                 }
 
+                if(fThreadController != nullptr){fThreadController->Stop();}
+
                 sleep(1);
                 fDigitizer->StopProduction();
                 sleep(1);
+                if(fBlanker != nullptr){fBlanker->StopConsumption();}
                 fSpectrometer->StopConsumptionProduction();
+                if(fZoomSpectrometer != nullptr){fZoomSpectrometer->StopConsumptionProduction();}
+                if(fMultiResolutionSpectrometer != nullptr){fMultiResolutionSpectrometer->StopConsumption();}
+                if(fStokesSpectrometer != nullptr){fStokesSpectrometer->StopConsumptionProduction();}
+                if(fPhaseCalibrationMonitor != nullptr){fPhaseCalibrationMonitor->StopConsumption();}
                 sleep(1);
+                if(fSpectralKurtosisFlagger != nullptr){fSpectralKurtosisFlagger->StopConsumption();}
                 fAveragedSpectrumWriter->StopConsumption();
+                if(fZoomSpectrumWriter != nullptr){fZoomSpectrumWriter->StopConsumption();}
+                for(size_t i=0; i<fMultiResolutionWriters.size(); i++){fMultiResolutionWriters[i]->StopConsumption();}
+                if(fStokesSpectrumWriter != nullptr){fStokesSpectrumWriter->StopConsumption();}
+
+                if(fNSchedulerThreads > 0){HTaskScheduler::GetInstance()->Terminate();}
 
                 CleanUp();
 
@@ -598,6 +1159,349 @@ class HSpectrometerManager: public HApplicationBackend
 
     private:
 
+        //change the fft size, window and averaging without a restart, this is only done while idle (the digitizer is
+        //not armed, so it does not take any buffers, and its threads are left running since stopping them would tear
+        //down the card), the buffers already in flight are processed (and their averages written out), then only the
+        //spectrometer and averager are stopped and rebuilt, the buffer pools are re-used when they are big enough, except for the spectrometer data (which holds
+        //the gpu workspace for a particular fft size/window), returns false if the old configuration had to be kept
+        bool Reconfigure(size_t fft_size, size_t n_ave_gpu, size_t n_ave_cpu, int window_flag, std::string window_name)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            //every stage reading the digitizer buffers must be able to work with the new size
+            if( CheckStageConstraints(fft_size, n_ave_gpu, "Reconfigure") != 0 )
+            {
+                std::cout<<"HSpectrometerManager::Reconfigure: Error, fft size "<<fft_size<<" and "<<n_ave_gpu<<" averages do not suit all of the enabled stages, the configuration will be ignored."<<std::endl;
+                return false;
+            }
+
+            if(fThreadController != nullptr){fThreadController->Stop();}
+            bool drained = WaitForIdle(fDigitizerSourcePool);
+            fSpectrometer->StopConsumptionProduction();
+            drained = drained && WaitForIdle(fSpectrometerSinkPool);
+            fSpectrumAverager->StopConsumptionProduction();
+
+            if(drained)
+            {
+                //finish the averages which are still open, and let the writer catch up
+                fSpectrumAverager->Reconfigure(fft_size/2+1, n_ave_cpu);
+                drained = WaitForIdle(fSpectrumAveragingBufferPool);
+            }
+
+            if(drained)
+            {
+                bool rebuild_spectrometer_data = (fft_size != fFFTSize || n_ave_gpu != fNSpectrumAverages || window_flag != fWindowFlag);
+                fFFTSize = fft_size;
+                fNSpectrumAverages = n_ave_gpu;
+                fNSpectrumAveragesCPU = n_ave_cpu;
+                fWindowFlag = window_flag;
+                fWindowName = window_name;
+
+                //the digitizer buffers are pinned memory, which is slow to allocate, so a smaller size re-uses them
+                fDigitizerSourcePool->Resize(fDigitizerPoolSize, fNSpectrumAverages*fFFTSize);
+
+                if(rebuild_spectrometer_data)
+                {
+                    fSpectrometerBufferAllocator->SetSampleArrayLength(fNSpectrumAverages*fFFTSize);
+                    fSpectrometerBufferAllocator->SetSpectrumLength(fFFTSize);
+                    fSpectrometerBufferAllocator->SetWindowFunction(fWindowFlag);
+                    fSpectrometerSinkPool->Allocate(fSpectrometerPoolSize, 1);
+                }
+
+                size_t n_ave_buffer_length = (fFFTSize/2+1)*(fEnableSpectralKurtosis ? 2 : 1);
+                fSpectrumAveragingBufferPool->Resize(fNSpectrumAveragerPoolSize, n_ave_buffer_length);
+                fSpectrometer->Reconfigure(fFFTSize, fNSpectrumAverages);
+                UpdateWindowProperties();
+            }
+            else
+            {
+                std::cout<<"HSpectrometerManager::Reconfigure: Error, the pipeline did not drain, keeping the current configuration."<<std::endl;
+                fSpectrumAverager->Reconfigure(fFFTSize/2+1, fNSpectrumAveragesCPU);
+            }
+
+            //resume, with the same processor affinity as at start-up
+            fSpectrumAverager->StartConsumptionProduction();
+            for(unsigned int i=0; i<fNSpectrumAveragerThreads; i++)
+            {
+                fSpectrumAverager->AssociateThreadWithSingleProcessor(i, fSpectrumAveragerFirstCore + i);
+            }
+            fSpectrometer->StartConsumptionProduction();
+            for(size_t i=0; i<fNSpectrometerThreads; i++)
+            {
+                fSpectrometer->AssociateThreadWithSingleProcessor(i, fSpectrometerFirstCore + i);
+            }
+            if(fThreadController != nullptr){fThreadController->Start();}
+
+            double elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+            #ifdef HOSE_USE_SPDLOG
+            std::stringstream ss;
+            ss << "configure_status; ";
+            ss << "success=" << drained << "; ";
+            ss << "reconfiguration_time_s=" << elapsed;
+            fStatusLogger->info( ss.str().c_str() );
+            if(drained){LogSpectrometerConfig();}
+            #endif
+
+            return drained;
+        }
+
+        enum
+        {
+            eSpectrometerConstraint = 1,
+            eStokesConstraint = 2,
+            eZoomConstraint = 4,
+            eMultiResolutionConstraint = 8
+        };
+
+        //the digitizer buffers (n_ave_gpu*fft_size samples) are read by every enabled stage, returns the stages
+        //(as a mask of the flags above) which cannot work with them, the blanker and pcal monitor take any size
+        unsigned int CheckStageConstraints(size_t fft_size, size_t n_ave_gpu, const char* caller)
+        {
+            unsigned int broken_stages = 0;
+            size_t buffer_length = fft_size*n_ave_gpu;
+
+            //the overlapping frames must line up with the fft size
+            if(fft_size < 2 || fft_size % (2*fFFTOverlap) != 0)
+            {
+                std::cout<<"HSpectrometerManager::"<<caller<<": Error, fft size "<<fft_size<<" is not a multiple of "<<2*fFFTOverlap<<"."<<std::endl;
+                broken_stages |= eSpectrometerConstraint;
+            }
+
+            //each half of the buffer is one channel, which is cut into whole frames of interleave blocks
+            if(fEnableDualChannel && (fStokesFFTSize < 2 || fStokesFFTSize % fDualChannelInterleaveBlock != 0 || buffer_length % (2*fStokesFFTSize) != 0) )
+            {
+                std::cout<<"HSpectrometerManager::"<<caller<<": Error, stokes_fft_size must be a multiple of the interleave block size, and divide half the digitizer buffer ("<<buffer_length<<" samples)."<<std::endl;
+                broken_stages |= eStokesConstraint;
+            }
+
+            //the filter has to fill up, and leave at least one zoom fft, within each buffer
+            if(fEnableZoom)
+            {
+                size_t n_taps = fZoomDecimation*fZoomTapsPerPhase;
+                if(fZoomDecimation == 0 || fZoomFFTSize < 2 || buffer_length < n_taps + (fZoomFFTSize - 1)*fZoomDecimation)
+                {
+                    std::cout<<"HSpectrometerManager::"<<caller<<": Error, the digitizer buffer ("<<buffer_length<<" samples) is too short for a zoom fft of "<<fZoomFFTSize<<" points."<<std::endl;
+                    broken_stages |= eZoomConstraint;
+                }
+            }
+
+            //the frames of every resolution must tile the buffer
+            for(size_t i=0; i<fMultiResolutionFFTSizes.size(); i++)
+            {
+                if(buffer_length % fMultiResolutionFFTSizes[i] != 0)
+                {
+                    std::cout<<"HSpectrometerManager::"<<caller<<": Error, multi-resolution fft size "<<fMultiResolutionFFTSizes[i]<<" does not divide the digitizer buffer ("<<buffer_length<<" samples)."<<std::endl;
+                    broken_stages |= eMultiResolutionConstraint;
+                }
+            }
+
+            return broken_stages;
+        }
+
+        //wait for all of the buffers of a pool to be returned to its producer
+        template< typename XPoolType >
+        bool WaitForIdle(XPoolType* pool)
+        {
+            for(unsigned int i=0; i<RECONFIGURE_DRAIN_TIMEOUT_MS; i++)
+            {
+                if(pool->IsIdle()){return true;}
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return pool->IsIdle();
+        }
+
+        //window function information (the gpu window is mirrored here), this is essentially hard-coded for now,
+        //but it is possible we may implement different types in the future. The values are logged with the
+        //spectrometer configuration, and passed on to the writer so they are recorded next to the spectra
+        void UpdateWindowProperties()
+        {
+            std::vector<double> pOut;
+            double s1 = 0;
+            double s2 = 0;
+            pOut.resize(fFFTSize);
+
+            if(fWindowFlag == NO_WIN)
+            {
+                s1 = fFFTSize;
+                s2 = fFFTSize;
+                std::fill(pOut.begin(), pOut.end(), 1.0);
+            }
+
+            if(fWindowFlag == BH_WIN)
+            {
+                double a0 = 0.35875f;
+                double a1 = 0.48829f;
+                double a2 = 0.14128f;
+                double a3 = 0.01168f;
+                unsigned int idx = 0;
+                while( idx < fFFTSize )
+                {
+                    pOut[idx]   = a0 - (a1 * std::cos( (2.0f * M_PI * idx) / (fFFTSize- 1) )) + (a2 * std::cos( (4.0f * M_PI * idx) / (fFFTSize- 1) )) - (a3 * std::cos( (6.0f * M_PI * idx) / (fFFTSize - 1) ));
+                    s1 += pOut[idx];
+                    s2 += pOut[idx]*pOut[idx];
+                    idx++;
+                }
+            }
+
+            if(fWindowFlag == HANN_WIN)
+            {
+                unsigned int idx    = 0;
+                while( idx < fFFTSize )
+                {
+                    pOut[idx] = 0.5 + 0.5*( std::cos( (2.0f * M_PI * idx) / (fFFTSize - 1) ) );
+                    s1 += pOut[idx];
+                    s2 += pOut[idx]*pOut[idx];
+                    idx++;
+                }
+            }
+
+            //overlapping frames are correlated, the variance of the average is that of
+            //(number of spectra)/(1 + 2*sum_j c_j^2) independent ones, where c_j is the
+            //window overlap correlation at a shift of j hops (Welch 1967)
+            double overlap_variance_factor = 1.0;
+            size_t hop = fFFTSize/fFFTOverlap;
+            for(size_t j=1; j<fFFTOverlap && s2 != 0; j++)
+            {
+                double c = 0;
+                for(size_t i=0; i + j*hop < fFFTSize; i++){c += pOut[i]*pOut[i + j*hop];}
+                c /= s2;
+                overlap_variance_factor += 2.0*c*c;
+            }
+            fWindowS1 = s1;
+            fWindowS2 = s2;
+            fOverlapIndependentFraction = 1.0/overlap_variance_factor;
+
+            if(fAveragedSpectrumWriter != nullptr)
+            {
+                fAveragedSpectrumWriter->SetWindowProperties(fWindowName, fFFTSize, fWindowS1, fWindowS2, fFFTOverlap, fOverlapIndependentFraction);
+            }
+        }
+
+        //spectrometer configuration line (also logged again whenever the spectrometer is reconfigured)
+        void LogSpectrometerConfig()
+        {
+            #ifdef HOSE_USE_SPDLOG
+            std::stringstream navess;
+            navess << "n_averages=";
+            navess << fNSpectrumAverages;
+
+            std::stringstream fftss;
+            fftss << "fft_size=";
+            fftss << fFFTSize;
+
+            std::stringstream wtss;
+            wtss << "window_type=" << fWindowName; 
+            std::stringstream wts1ss;
+            wts1ss << "window_s1=";
+            wts1ss << fWindowS1;
+            std::stringstream wts2ss;
+            wts2ss << "window_s2=";
+            wts2ss << fWindowS2;
+            std::stringstream wtnenbwss;
+            wtnenbwss << "window_normalized_equivalent_noise_bandwidth=";
+            wtnenbwss << fFFTSize*fWindowS2/(fWindowS1*fWindowS1);
+            std::stringstream wtenbwss;
+            wtenbwss << "window_equivalent_noise_bandwidth_Hz=";
+            wtenbwss <<  (fFFTSize*fWindowS2/(fWindowS1*fWindowS1) )*(fDigitizer->GetSamplingFrequency()/fFFTSize);
+
+            std::stringstream ovss;
+            ovss << "fft_overlap=";
+            ovss << fFFTOverlap;
+            std::stringstream oveqss;
+            oveqss << "overlap_independent_spectra_fraction=";
+            oveqss << fOverlapIndependentFraction;
+            std::stringstream nstss;
+            nstss << "n_spectrometer_threads=";
+            nstss << fNSpectrometerThreads;
+            std::stringstream natss;
+            natss << "n_averager_threads=";
+            natss << fNSpectrumAveragerThreads;
+            std::stringstream nwtss;
+            nwtss << "n_writer_threads=";
+            nwtss << 1;
+            std::stringstream nsctss;
+            nsctss << "n_scheduler_threads=";
+            nsctss << fNSchedulerThreads;
+
+
+            std::string spectrometer_config = "spectrometer_config; " + navess.str() + "; "
+                + fftss.str() + "; "
+                + nstss.str() + "; "
+                + natss.str() + "; "
+                + nwtss.str() + "; "
+                + nsctss.str() + "; "
+                + wtss.str() + "; "
+                + wts1ss.str() + "; "
+                + wts2ss.str() + "; "
+                + wtnenbwss.str() + "; "
+                + wtenbwss.str() + "; "
+                + ovss.str() + "; "
+                + oveqss.str();
+
+            fConfigLogger->info( spectrometer_config.c_str() );
+            #endif
+        }
+
+        //report the buffers/spectra which have been lost or shed by each stage (totals since start-up)
+        void LogPipelineStatus()
+        {
+            #ifdef HOSE_USE_SPDLOG
+            std::stringstream ss;
+            ss << "pipeline_status; ";
+            ss << "digitizer_buffers_stolen=" << fDigitizer->GetBufferHandler().GetNStolenBuffers() << "; ";
+            ss << "spectrometer_buffers_stolen=" << fSpectrometer->GetSinkBufferHandler().GetNStolenBuffers() << "; ";
+            if(fFFTOverlap > 1){ss << "spectrometer_missing_tails=" << fSpectrometer->GetNMissingTails() << "; ";}
+            ss << "dumper_buffers_skipped=" << fDumper->GetNSkippedBuffers() << "; ";
+            ss << "averages_dropped=" << fSpectrumAverager->GetNDroppedAverages() << "; ";
+            ss << "partial_averages=" << fSpectrumAverager->GetNPartialAverages() << "; ";
+            ss << "discarded_averages=" << fSpectrumAverager->GetNDiscardedAverages() << "; ";
+            ss << "missing_samples=" << fSpectrumAverager->GetNMissingSamples() << "; ";
+            ss << "late_buffers=" << fSpectrumAverager->GetNLateBuffers() << "; ";
+            ss << "writer_spectra_dropped=" << fAveragedSpectrumWriter->GetNDroppedSpectra();
+            if(fBlanker != nullptr)
+            {
+                ss << "; rfi_blanked_samples=" << fBlanker->GetNBlankedSamples();
+                ss << "; rfi_blanker_throughput_Msps=" << 1e-6*fBlanker->GetThroughput();
+            }
+            if(fSpectralKurtosisFlagger != nullptr)
+            {
+                ss << "; rfi_spectra_flagged=" << fSpectralKurtosisFlagger->GetNSpectraFlagged();
+                ss << "; rfi_channels_flagged=" << fSpectralKurtosisFlagger->GetNChannelsFlagged();
+            }
+            if(fZoomSpectrometer != nullptr)
+            {
+                ss << "; zoom_buffers_skipped=" << fZoomSpectrometer->GetNSkippedBuffers();
+                ss << "; zoom_throughput_Msps=" << 1e-6*fZoomSpectrometer->GetThroughput();
+                ss << "; zoom_writer_spectra_dropped=" << fZoomSpectrumWriter->GetNDroppedSpectra();
+            }
+            if(fMultiResolutionSpectrometer != nullptr)
+            {
+                ss << "; multi_resolution_buffers_skipped=" << fMultiResolutionSpectrometer->GetNSkippedBuffers();
+                ss << "; multi_resolution_throughput_Msps=" << 1e-6*fMultiResolutionSpectrometer->GetThroughput();
+                for(size_t i=0; i<fMultiResolutionWriters.size(); i++)
+                {
+                    ss << "; fft" << fMultiResolutionSpectrometer->GetFFTSize(i) << "_writer_spectra_dropped=" << fMultiResolutionWriters[i]->GetNDroppedSpectra();
+                }
+            }
+            if(fStokesSpectrometer != nullptr)
+            {
+                ss << "; stokes_buffers_skipped=" << fStokesSpectrometer->GetNSkippedBuffers();
+                ss << "; stokes_averages_dropped=" << fStokesSpectrometer->GetNDroppedAverages();
+                ss << "; stokes_partial_averages=" << fStokesSpectrometer->GetNPartialAverages();
+                ss << "; stokes_throughput_Msps=" << 1e-6*fStokesSpectrometer->GetThroughput();
+                ss << "; stokes_writer_spectra_dropped=" << fStokesSpectrumWriter->GetNDroppedSpectra();
+            }
+            if(fPhaseCalibrationMonitor != nullptr)
+            {
+                ss << "; pcal_buffers_skipped=" << fPhaseCalibrationMonitor->GetNSkippedBuffers();
+                ss << "; pcal_records_written=" << fPhaseCalibrationMonitor->GetNRecordsWritten();
+                ss << "; pcal_throughput_Msps=" << 1e-6*fPhaseCalibrationMonitor->GetThroughput();
+            }
+            fStatusLogger->info( ss.str().c_str() );
+            #endif
+        }
+
         void CleanUp()
         {
             //remove the lock file
@@ -679,6 +1583,53 @@ class HSpectrometerManager: public HApplicationBackend
                             fStatusLogger->info( ss.str().c_str() );
                             #endif
                     break;
+                    case CONFIGURE:
+                        if(fRecordingState == IDLE)
+                        {
+                            //fields which are left empty keep their current value, e.g. configure=4194304:::hann
+                            long fft_size = fFFTSize;
+                            long n_ave_gpu = fNSpectrumAverages;
+                            long n_ave_cpu = fNSpectrumAveragesCPU;
+                            if(tokens[1].size() != 0){fft_size = std::atol(tokens[1].c_str());}
+                            if(tokens[2].size() != 0){n_ave_gpu = std::atol(tokens[2].c_str());}
+                            if(tokens[3].size() != 0){n_ave_cpu = std::atol(tokens[3].c_str());}
+
+                            int window_flag = fWindowFlag;
+                            std::string window_name = fWindowName;
+                            if(tokens[4].size() != 0)
+                            {
+                                window_name = tokens[4];
+                                window_flag = -1;
+                                if(window_name == "none"){window_flag = NO_WIN;}
+                                if(window_name == "blackman_harris"){window_flag = BH_WIN;}
+                                if(window_name == "hann"){window_flag = HANN_WIN;}
+                            }
+
+                            if(fft_size > 0 && n_ave_gpu > 0 && n_ave_cpu > 0 && window_flag >= 0)
+                            {
+                                Reconfigure(fft_size, n_ave_gpu, n_ave_cpu, window_flag, window_name);
+                            }
+                            else
+                            {
+                                std::cout<<"HSpectrometerManager::ProcessCommand: Error, invalid configuration: "<<command<<", it will be ignored."<<std::endl;
+                                #ifdef HOSE_USE_SPDLOG
+                                ss << "configure_status; ";
+                                ss << "success=0; ";
+                                ss << "error=invalid configuration";
+                                fStatusLogger->info( ss.str().c_str() );
+                                #endif
+                            }
+                        }
+                        else
+                        {
+                            #ifdef HOSE_USE_SPDLOG
+                            ss << "configure_status; ";
+                            ss << "success=0; ";
+                            ss << "error=cannot reconfigure while recording";
+                            fStatusLogger->info( ss.str().c_str() );
+                            #endif
+                        }
+                    break;
                     case RECORD_ON:
                         if(fRecordingState == IDLE)
                         {
@@ -717,6 +1668,7 @@ class HSpectrometerManager: public HApplicationBackend
                             ss << "scan_name=" << fScanName;
                             fStatusLogger->info( ss.str().c_str() );
                             #endif
+                            LogPipelineStatus();
                         }
                     break;
                     case CONFIGURE_NEXT_RECORDING:
@@ -842,6 +1794,11 @@ class HSpectrometerManager: public HApplicationBackend
                     return SET_POWER_BINS;
                 }
 
+                if(command_tokens[0] == std::string("configure") && command_tokens.size() == 5)
+                {
+                    return CONFIGURE;
+                }
+
                 if(command_tokens[0] == std::string("record") )
                 {
                     if(command_tokens[1] == std::string("on") && command_tokens.size() == 5)
@@ -889,6 +1846,38 @@ class HSpectrometerManager: public HApplicationBackend
             fAveragedSpectrumWriter->SetSourceName(fSourceName);
             fAveragedSpectrumWriter->SetScanName(fScanName);
             fAveragedSpectrumWriter->InitializeOutputDirectory();
+
+            if(fZoomSpectrumWriter != nullptr)
+            {
+                fZoomSpectrumWriter->SetExperimentName(fExperimentName);
+                fZoomSpectrumWriter->SetSourceName(fSourceName);
+                fZoomSpectrumWriter->SetScanName(fScanName);
+                fZoomSpectrumWriter->InitializeOutputDirectory();
+            }
+
+            for(size_t i=0; i<fMultiResolutionWriters.size(); i++)
+            {
+                fMultiResolutionWriters[i]->SetExperimentName(fExperimentName);
+                fMultiResolutionWriters[i]->SetSourceName(fSourceName);
+                fMultiResolutionWriters[i]->SetScanName(fScanName);
+                fMultiResolutionWriters[i]->InitializeOutputDirectory();
+            }
+
+            if(fStokesSpectrumWriter != nullptr)
+            {
+                fStokesSpectrumWriter->SetExperimentName(fExperimentName);
+                fStokesSpectrumWriter->SetSourceName(fSourceName);
+                fStokesSpectrumWriter->SetScanName(fScanName);
+                fStokesSpectrumWriter->InitializeOutputDirectory();
+            }
+
+            if(fPhaseCalibrationMonitor != nullptr)
+            {
+                fPhaseCalibrationMonitor->SetExperimentName(fExperimentName);
+                fPhaseCalibrationMonitor->SetSourceName(fSourceName);
+                fPhaseCalibrationMonitor->SetScanName(fScanName);
+                fPhaseCalibrationMonitor->InitializeOutputDirectory();
+            }
         }
 
 
@@ -1055,6 +2044,9 @@ class HSpectrometerManager: public HApplicationBackend
                     case SET_POWER_BINS:
                         return true;
                     break;
+                    case CONFIGURE:
+                        return true;
+                    break;
                     case RECORD_OFF:
                         return true;
                     break;
@@ -1188,11 +2180,63 @@ class HSpectrometerManager: public HApplicationBackend
         size_t fNDigitizerThreads;
         size_t fNSpectrometerThreads;
         int fWindowFlag;
+        std::string fWindowName;
+        double fWindowS1;
+        double fWindowS2;
+        double fOverlapIndependentFraction;
 
         size_t fNADQ7SampleSkip;
         size_t fNSpectrumAveragesCPU;
         size_t fNDumpSkip;
         size_t fNSpectrumAveragerPoolSize;
+        int fEnableDigitizerFanOut;
+        int fEnableDumperBestEffort;
+        int fNSchedulerThreads;
+        int fEnableAdaptiveThreads;
+        size_t fNSpectrometerThreadsMax;
+        size_t fNSpectrumAveragerThreads;
+        int fEnableSpectralKurtosis;
+        double fSKThresholdSigma;
+        size_t fFFTOverlap;
+        int fEnableRFIBlanking;
+        size_t fRFIBlankingBlockSize;
+        int fRFIBlankingThreshold;
+        unsigned int fNBlankerThreads;
+        int fEnableZoom;
+        uint64_t fZoomCenterFrequency;
+        size_t fZoomDecimation;
+        size_t fZoomTapsPerPhase;
+        size_t fZoomFFTSize;
+        unsigned int fNZoomThreads;
+        size_t fNZoomPoolSize;
+        size_t fZoomBackPressureThreshold;
+        std::vector< size_t > fMultiResolutionFFTSizes;
+        unsigned int fNMultiResolutionThreads;
+        size_t fNMultiResolutionPoolSize;
+        size_t fMultiResolutionBackPressureThreshold;
+        int fEnableDualChannel;
+        size_t fDualChannelInterleaveBlock;
+        size_t fStokesFFTSize;
+        size_t fNStokesAverages;
+        unsigned int fNStokesThreads;
+        size_t fNStokesPoolSize;
+        size_t fStokesBackPressureThreshold;
+        int fEnablePhaseCalibration;
+        uint64_t fPhaseCalibrationFirstTone;
+        uint64_t fPhaseCalibrationToneSpacing;
+        size_t fNPhaseCalibrationTones;
+        size_t fNPhaseCalibrationBuffers;
+        unsigned int fNPhaseCalibrationThreads;
+        size_t fPhaseCalibrationBackPressureThreshold;
+        size_t fDumperBackPressureThreshold;
+        size_t fWriterBackPressureThreshold;
+        unsigned int fWriterDecimationFactor;
+        int fPipelineStatusInterval;
+        std::time_t fLastPipelineStatusTime;
+        int fFlushPartialAverages;
+        unsigned int fPartialAverageTimeout;
+        unsigned int fSpectrumAveragerFirstCore; //processor affinity of the stages which are restarted on reconfiguration
+        unsigned int fSpectrometerFirstCore;
 
         //state data
         int fRecordingState;
@@ -1211,6 +2255,7 @@ class HSpectrometerManager: public HApplicationBackend
         HBufferAllocatorSpectrometerDataCUDA< SPECTRUM_TYPE >* fSpectrometerBufferAllocator;
         SPECTROMETER_TYPE* fSpectrometer;
         HRawDataDumper< typename XDigitizerType::sample_type >* fDumper;
+        HImpulsiveRFIBlanker< typename XDigitizerType::sample_type >* fBlanker;
         HBufferPool< typename XDigitizerType::sample_type >* fDigitizerSourcePool;
         HBufferPool< SPECTRUM_TYPE >* fSpectrometerSinkPool;
 
@@ -1218,6 +2263,21 @@ class HSpectrometerManager: public HApplicationBackend
         HBufferPool< float >* fSpectrumAveragingBufferPool;
         AVERAGER_TYPE* fSpectrumAverager;
         HAveragedMultiThreadedSpectrumDataWriter* fAveragedSpectrumWriter;
+        HSpectralKurtosisFlagger* fSpectralKurtosisFlagger;
+        HZoomSpectrometer< typename XDigitizerType::sample_type >* fZoomSpectrometer;
+        HBufferAllocatorNew< float >* fZoomBufferAllocator;
+        HBufferPool< float >* fZoomBufferPool;
+        HAveragedMultiThreadedSpectrumDataWriter* fZoomSpectrumWriter;
+        HMultiResolutionSpectrometer< typename XDigitizerType::sample_type >* fMultiResolutionSpectrometer;
+        std::vector< HBufferAllocatorNew< float >* > fMultiResolutionBufferAllocators;
+        std::vector< HBufferPool< float >* > fMultiResolutionBufferPools;
+        std::vector< HAveragedMultiThreadedSpectrumDataWriter* > fMultiResolutionWriters;
+        HStokesSpectrometer< typename XDigitizerType::sample_type >* fStokesSpectrometer;
+        HBufferAllocatorNew< float >* fStokesBufferAllocator;
+        HBufferPool< float >* fStokesBufferPool;
+        HAveragedMultiThreadedSpectrumDataWriter* fStokesSpectrumWriter;
+        HPhaseCalibrationMonitor< typename XDigitizerType::sample_type >* fPhaseCalibrationMonitor;
+        HAdaptiveThreadController* fThreadController;
 
         std::string fCannedStopCommand;
 
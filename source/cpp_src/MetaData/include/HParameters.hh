@@ -35,9 +35,11 @@ class HParameters
         void UseDefaultParameters();
 
         int GetIntegerParameter(std::string name);
+        double GetFloatingPointParameter(std::string name);
         std::string GetStringParameter(std::string name);
 
         int GetIntegerParameter(const char* name);
+        double GetFloatingPointParameter(const char* name);
         std::string GetStringParameter(const char* name);
 
         HParameters& operator=(const HParameters& rhs)
@@ -47,6 +49,7 @@ class HParameters
                 fParameterFile = rhs.fParameterFile;
                 fHaveParameterFile = rhs.fHaveParameterFile;
                 fIntegerParam = rhs.fIntegerParam;
+                fFloatingPointParam = rhs.fFloatingPointParam;
                 fStringParam = rhs.fStringParam;
             }
             return *this;
@@ -58,6 +61,8 @@ class HParameters
         bool fHaveParameterFile;
         //integer parameter map
         std::map<std::string, int> fIntegerParam;
+        //floating point parameter map
+        std::map<std::string, double> fFloatingPointParam;
         //string parameter map
         std::map<std::string, std::string> fStringParam;
 
@@ -0,0 +1,97 @@
+#ifndef HScanMetaData_HH__
+#define HScanMetaData_HH__
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*
+*File: HScanMetaData.hh
+*Class: HScanMetaData
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: time ordered lookup of the records in a scan's meta_data.json file (a list of
+* {measurement, time, fields} objects). Times are UTC microseconds since the unix epoch.
+* The antenna position is interpolated linearly in time, while the frequency map and source
+* status take the last value recorded before the requested time. Times before the first
+* (after the last) record return the first (last) record.
+*/
+
+namespace hose
+{
+
+class HScanMetaData
+{
+    public:
+        HScanMetaData();
+        virtual ~HScanMetaData();
+
+        //returns false if the file cannot be opened or parsed
+        bool ReadFile(const std::string& filename);
+
+        //the lookups return false if there are no records of that type
+        bool GetAntennaPosition(int64_t time_usec, double& az, double& el) const;
+
+        //sky frequency (Hz) and index of the reference bin, and the channel spacing (Hz)
+        bool GetFrequencyMap(int64_t time_usec, double& ref_freq, double& ref_bin_index, double& freq_delta) const;
+
+        //source name, ra (HHMMSS.SS) and dec (+DDMMSS.S) as recorded
+        bool GetSourceStatus(int64_t time_usec, std::string& source, std::string& ra, std::string& dec) const;
+
+        size_t GetNAntennaPositions() const {return fAntennaPositions.size();};
+        size_t GetNFrequencyMaps() const {return fFrequencyMaps.size();};
+        size_t GetNSourceStatus() const {return fSourceStatus.size();};
+
+        //convert a YYYY-MM-DDTHH:MM:SS.(F)Z time stamp to microseconds since the epoch
+        //(the fractional second is truncated to microseconds)
+        static bool ConvertTimeStamp(const std::string& time_stamp, int64_t& time_usec);
+
+    protected:
+
+        struct HAntennaRecord
+        {
+            int64_t fTime;
+            double fAz;
+            double fEl;
+        };
+
+        struct HFrequencyMapRecord
+        {
+            int64_t fTime;
+            double fReferenceFrequency;
+            double fReferenceBinIndex;
+            double fFrequencyDelta;
+        };
+
+        struct HSourceRecord
+        {
+            int64_t fTime;
+            std::string fSource;
+            std::string fRA;
+            std::string fDec;
+        };
+
+        //index of the last record strictly before the time (or 0)
+        template< typename XRecordType >
+        static size_t FindPrevious(const std::vector< XRecordType >& records, int64_t time_usec)
+        {
+            size_t lo = 0;
+            size_t hi = records.size();
+            while(lo < hi)
+            {
+                size_t mid = (lo + hi)/2;
+                if(records[mid].fTime < time_usec){lo = mid + 1;}
+                else{hi = mid;}
+            }
+            return (lo == 0) ? 0 : lo - 1;
+        }
+
+        std::vector< HAntennaRecord > fAntennaPositions;
+        std::vector< HFrequencyMapRecord > fFrequencyMaps;
+        std::vector< HSourceRecord > fSourceStatus;
+};
+
+}
+
+#endif /* end of include guard: HScanMetaData_HH__ */
@@ -23,6 +23,7 @@ HParameters::HParameters(const HParameters& copy)
     fParameterFile = copy.fParameterFile;
     fHaveParameterFile = copy.fHaveParameterFile;
     fIntegerParam = copy.fIntegerParam;
+    fFloatingPointParam = copy.fFloatingPointParam;
     fStringParam = copy.fStringParam;
 }
 
@@ -42,6 +43,10 @@ HParameters::Initialize()
     fIntegerParam[std::string("enable_spectrum_write_to_file")] = 1; //enable write data to file on disk (enable=1, disable=0)
     fIntegerParam[std::string("enable_noise_power_write_to_file")] = 1; //enable write data to file on disk (enable=1, disable=0)
 
+    //overlap of consecutive fft frames, 1 (none), 2 (50%) or 4 (75%), recovers the signal lost at the edges of the window
+    //(the spectrum is normalized as if the frames did not overlap), not used with spectral kurtosis
+    fIntegerParam[std::string("fft_overlap")] = 1;
+
     //configure noise power monitoring UDP messages
     fStringParam[std::string("noise_power_ip_address")] = std::string("192.52.63.48"); //odyssey
     fStringParam[std::string("noise_power_port")] = std::string("8181");
@@ -55,6 +60,79 @@ HParameters::Initialize()
     fStringParam[std::string("spectrum_port")] = std::string("8282");
     fIntegerParam[std::string("enable_spectrum_udp")] = 0; //enable udp spectrum monitoring messages (enable=1, disable=0)
 
+    //configure how the digitizer buffers are shared between the spectrometer and raw data dumper
+    fIntegerParam[std::string("enable_digitizer_fan_out")] = 0; //hand each buffer to all consumers concurrently (enable=1, disable=0)
+    fIntegerParam[std::string("enable_dumper_best_effort")] = 0; //let the raw data dumper skip buffers when it falls behind (enable=1, disable=0)
+
+    //number of worker threads in the shared (work-stealing) scheduler used by the processing stages
+    //if zero, each stage runs on its own dedicated threads
+    fIntegerParam[std::string("n_scheduler_threads")] = 0;
+
+    //let the number of spectrometer threads follow the digitizer buffer backlog (enable=1, disable=0)
+    //between one and n_spec_threads_max threads (n_spec_threads is the starting value)
+    fIntegerParam[std::string("enable_adaptive_threads")] = 0;
+    fIntegerParam[std::string("n_spec_threads_max")] = 4;
+
+    //shed the least valuable work first when a stage falls behind (the thresholds are queue backlogs in buffers, 0 disables)
+    //the raw data dumper pauses until its queue has drained, the writer keeps only every n-th spectrum (a factor of 1 drops them all)
+    fIntegerParam[std::string("dumper_back_pressure_threshold")] = 0;
+    fIntegerParam[std::string("writer_back_pressure_threshold")] = 0;
+    fIntegerParam[std::string("writer_decimation_factor")] = 4;
+    fIntegerParam[std::string("pipeline_status_interval")] = 60; //seconds between drop/loss counter reports in the status log while recording (0 disables)
+
+    //write out averages which could not be completed (recording stopped, or buffers went missing) rather than discarding them
+    fIntegerParam[std::string("flush_partial_averages")] = 0; //(enable=1, disable=0)
+    fIntegerParam[std::string("partial_average_timeout_ms")] = 1000; //time without new data before an incomplete average is flushed
+    fIntegerParam[std::string("n_averager_threads")] = 1; //threads summing spectra in the cpu averager (output order is preserved)
+
+    //accumulate |X|^4 along with the power spectrum and flag channels with a discrepant spectral kurtosis as RFI (enable=1, disable=0)
+    fIntegerParam[std::string("enable_spectral_kurtosis")] = 0;
+    fFloatingPointParam[std::string("sk_threshold_sigma")] = 3.0; //flagging threshold in standard deviations of the estimator
+
+    //zero blocks of raw samples with impulsive RFI before the fft (enable=1, disable=0), not compatible with the digitizer fan-out
+    fIntegerParam[std::string("enable_rfi_blanking")] = 0;
+    fIntegerParam[std::string("rfi_blanking_block_size")] = 1024; //number of samples per block
+    fIntegerParam[std::string("rfi_blanking_threshold")] = 6; //block power threshold above the median, in (MAD estimated) standard deviations
+    fIntegerParam[std::string("n_blanker_threads")] = 1;
+
+    //'zoom' spectrometer (on the cpu) for a narrow sub-band at high resolution (enable=1, disable=0), the sub-band is
+    //mixed down from the center frequency, decimated and transformed, the spectra are written to (*_zoom.spec) files
+    fIntegerParam[std::string("enable_zoom")] = 0;
+    fIntegerParam[std::string("zoom_center_frequency_hz")] = 0; //frequency within the digitized band which is mixed down to zero
+    fIntegerParam[std::string("zoom_decimation")] = 64; //the zoom bandwidth is the sample rate divided by this
+    fIntegerParam[std::string("zoom_fir_taps_per_phase")] = 16; //the decimating fir has zoom_decimation*zoom_fir_taps_per_phase taps
+    fIntegerParam[std::string("zoom_fft_size")] = 4096; //number of zoom channels
+    fIntegerParam[std::string("n_zoom_threads")] = 1;
+    fIntegerParam[std::string("n_zoom_pool_size")] = 16;
+    fIntegerParam[std::string("zoom_back_pressure_threshold")] = 2; //digitizer buffers queued before the zoom stage starts skipping them (0 never skips)
+
+    //additional spectral resolutions computed (on the cpu) from the same digitizer buffers, given as a comma separated
+    //list of fft sizes (e.g. 1024,16384) which must divide each other, each is written to its own (*_fft<size>.spec) files
+    fStringParam[std::string("multi_resolution_fft_sizes")] = std::string("none");
+    fIntegerParam[std::string("n_multi_resolution_threads")] = 1;
+    fIntegerParam[std::string("n_multi_resolution_pool_size")] = 16;
+    fIntegerParam[std::string("multi_resolution_back_pressure_threshold")] = 2; //digitizer buffers queued before buffers are skipped (0 never skips)
+
+    //dual-channel (e.g. dual polarization) mode, both digitizer inputs are streamed (enable=1, disable=0), the auto and cross spectra
+    //are computed (on the cpu) and written as the Stokes parameters I, Q, U, V to (*_stokes.spec) files, the main spectrometer output is disabled
+    fIntegerParam[std::string("enable_dual_channel")] = 0;
+    fIntegerParam[std::string("dual_channel_interleave_block")] = 1; //samples of each channel in a row in the digitizer buffer (1 alternates A and B)
+    fIntegerParam[std::string("stokes_fft_size")] = 65536;
+    fIntegerParam[std::string("n_stokes_averages")] = 4; //number of digitizer buffers averaged into each set of Stokes spectra
+    fIntegerParam[std::string("n_stokes_threads")] = 2;
+    fIntegerParam[std::string("n_stokes_pool_size")] = 8;
+    fIntegerParam[std::string("stokes_back_pressure_threshold")] = 4; //digitizer buffers queued before buffers are skipped (0 never skips)
+
+    //phase-calibration tone extraction (enable=1, disable=0), the amplitude and phase of each tone in the comb at
+    //pcal_first_tone_hz + k*pcal_tone_spacing_hz are integrated over several digitizer buffers and written to (*.pcal) files
+    fIntegerParam[std::string("enable_pcal")] = 0;
+    fIntegerParam[std::string("pcal_first_tone_hz")] = 10000;
+    fIntegerParam[std::string("pcal_tone_spacing_hz")] = 1000000;
+    fIntegerParam[std::string("pcal_n_tones")] = 0; //0 takes every tone below the Nyquist frequency
+    fIntegerParam[std::string("n_pcal_integration_buffers")] = 16; //number of digitizer buffers in each record
+    fIntegerParam[std::string("n_pcal_threads")] = 1;
+    fIntegerParam[std::string("pcal_back_pressure_threshold")] = 4; //digitizer buffers queued before buffers are skipped (0 never skips)
+
 
     #ifdef HOSE_USE_PX14
     fIntegerParam[std::string("n_ave_spectra_gpu")] = 16;
@@ -149,6 +227,14 @@ HParameters::ReadParameters()
                         std::cout<<"setting: "<<fTokens[0]<<", "<<fTokens[1]<<std::endl;
                         fIntegerParam[ fTokens[0] ] = atoi(fTokens[1].c_str());
                     }
+
+                    auto fparam = fFloatingPointParam.find(fTokens[0]);
+                    if(fparam != fFloatingPointParam.end() )
+                    {
+                        //we have a floating point parameter
+                        std::cout<<"setting: "<<fTokens[0]<<", "<<fTokens[1]<<std::endl;
+                        fFloatingPointParam[ fTokens[0] ] = atof(fTokens[1].c_str());
+                    }
                 }
             }
         }
@@ -168,6 +254,12 @@ HParameters::GetIntegerParameter(const char* name)
     return GetIntegerParameter(std::string(name));
 }
 
+double
+HParameters::GetFloatingPointParameter(const char* name)
+{
+    return GetFloatingPointParameter(std::string(name));
+}
+
 std::string 
 HParameters::GetStringParameter(const char* name)
 {
@@ -189,6 +281,21 @@ HParameters::GetIntegerParameter(std::string name)
     }
 }
 
+double
+HParameters::GetFloatingPointParameter(std::string name)
+{
+    auto param = fFloatingPointParam.find(name);
+    if(param != fFloatingPointParam.end() )
+    {
+        return param->second;
+    }
+    else
+    {
+        //TODO handle error
+        return -1.0;
+    }
+}
+
 std::string
 HParameters::GetStringParameter(std::string name)
 {
@@ -0,0 +1,159 @@
+#include "HScanMetaData.hh"
+#include "HTimeStampConverter.hh"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+
+//single header JSON lib
+#include <json.hpp>
+using json = nlohmann::json;
+
+namespace hose
+{
+
+template< typename XRecordType >
+static bool EarlierRecord(const XRecordType& a, const XRecordType& b){return a.fTime < b.fTime;}
+
+HScanMetaData::HScanMetaData(){};
+
+HScanMetaData::~HScanMetaData(){};
+
+bool
+HScanMetaData::ConvertTimeStamp(const std::string& time_stamp, int64_t& time_usec)
+{
+    uint64_t epoch_sec = 0;
+    double frac = 0.0;
+    if(!HTimeStampConverter::ConvertTimeStampToEpochSecond(time_stamp, epoch_sec, frac)){return false;}
+    time_usec = ( (int64_t) epoch_sec )*1000000 + (int64_t) std::floor(frac*1e6 + 1e-3);
+    return true;
+}
+
+bool
+HScanMetaData::ReadFile(const std::string& filename)
+{
+    fAntennaPositions.clear();
+    fFrequencyMaps.clear();
+    fSourceStatus.clear();
+
+    std::ifstream metadata(filename.c_str());
+    if(!metadata.is_open())
+    {
+        std::cout<<"HScanMetaData::ReadFile: Error, could not open file: "<<filename<<std::endl;
+        return false;
+    }
+
+    json j;
+    try
+    {
+        metadata >> j;
+    }
+    catch(std::exception& e)
+    {
+        std::cout<<"HScanMetaData::ReadFile: Error, could not parse file: "<<filename<<" ("<<e.what()<<")"<<std::endl;
+        return false;
+    }
+
+    for(json::iterator it = j.begin(); it != j.end(); ++it)
+    {
+        if( !it->is_object() || it->count("measurement") == 0 || it->count("time") == 0 || it->count("fields") == 0 ){continue;}
+
+        int64_t time_usec = 0;
+        std::string time_stamp = (*it)["time"].get<std::string>();
+        if(!ConvertTimeStamp(time_stamp, time_usec))
+        {
+            std::cout<<"HScanMetaData::ReadFile: Warning, skipping record with malformed time stamp: "<<time_stamp<<std::endl;
+            continue;
+        }
+
+        //records missing one of the fields we use are skipped
+        std::string measurement_name = (*it)["measurement"].get<std::string>();
+        auto fields = (*it)["fields"];
+        try
+        {
+            if(measurement_name == std::string("antenna_position"))
+            {
+                HAntennaRecord rec;
+                rec.fTime = time_usec;
+                rec.fAz = fields.at("az").get<double>();
+                rec.fEl = fields.at("el").get<double>();
+                fAntennaPositions.push_back(rec);
+            }
+            else if(measurement_name == std::string("frequency_map"))
+            {
+                HFrequencyMapRecord rec;
+                rec.fTime = time_usec;
+                rec.fReferenceFrequency = fields.at("reference_bin_center_sky_frequency_MHz").get<double>()*1e6;
+                rec.fReferenceBinIndex = fields.at("reference_bin_index").get<double>();
+                rec.fFrequencyDelta = fields.at("frequency_delta_MHz").get<double>()*1e6/fields.at("bin_delta").get<double>();
+                fFrequencyMaps.push_back(rec);
+            }
+            else if(measurement_name == std::string("source_status"))
+            {
+                HSourceRecord rec;
+                rec.fTime = time_usec;
+                rec.fSource = fields.at("source").get<std::string>();
+                rec.fRA = fields.at("ra").get<std::string>();
+                rec.fDec = fields.at("dec").get<std::string>();
+                fSourceStatus.push_back(rec);
+            }
+        }
+        catch(std::exception& e)
+        {
+            std::cout<<"HScanMetaData::ReadFile: Warning, skipping incomplete "<<measurement_name<<" record at: "<<time_stamp<<std::endl;
+        }
+    }
+
+    //records are not guaranteed to be in time order
+    std::stable_sort(fAntennaPositions.begin(), fAntennaPositions.end(), EarlierRecord<HAntennaRecord>);
+    std::stable_sort(fFrequencyMaps.begin(), fFrequencyMaps.end(), EarlierRecord<HFrequencyMapRecord>);
+    std::stable_sort(fSourceStatus.begin(), fSourceStatus.end(), EarlierRecord<HSourceRecord>);
+
+    return true;
+}
+
+bool
+HScanMetaData::GetAntennaPosition(int64_t time_usec, double& az, double& el) const
+{
+    if(fAntennaPositions.size() == 0){return false;}
+
+    size_t idx = FindPrevious(fAntennaPositions, time_usec);
+    const HAntennaRecord& prev = fAntennaPositions[idx];
+    az = prev.fAz;
+    el = prev.fEl;
+    if(idx + 1 < fAntennaPositions.size() && time_usec > prev.fTime)
+    {
+        const HAntennaRecord& next = fAntennaPositions[idx+1];
+        double w = ( (double) (time_usec - prev.fTime) )/( (double) (next.fTime - prev.fTime) );
+        az += w*(next.fAz - prev.fAz);
+        el += w*(next.fEl - prev.fEl);
+    }
+    return true;
+}
+
+bool
+HScanMetaData::GetFrequencyMap(int64_t time_usec, double& ref_freq, double& ref_bin_index, double& freq_delta) const
+{
+    if(fFrequencyMaps.size() == 0){return false;}
+
+    const HFrequencyMapRecord& rec = fFrequencyMaps[ FindPrevious(fFrequencyMaps, time_usec) ];
+    ref_freq = rec.fReferenceFrequency;
+    ref_bin_index = rec.fReferenceBinIndex;
+    freq_delta = rec.fFrequencyDelta;
+    return true;
+}
+
+bool
+HScanMetaData::GetSourceStatus(int64_t time_usec, std::string& source, std::string& ra, std::string& dec) const
+{
+    if(fSourceStatus.size() == 0){return false;}
+
+    const HSourceRecord& rec = fSourceStatus[ FindPrevious(fSourceStatus, time_usec) ];
+    source = rec.fSource;
+    ra = rec.fRA;
+    dec = rec.fDec;
+    return true;
+}
+
+}
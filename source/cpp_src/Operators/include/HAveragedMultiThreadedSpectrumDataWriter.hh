@@ -6,12 +6,15 @@
 #include <ios>
 #include <fstream>
 #include <sstream>
+#include <string>
 #include <thread>
+#include <mutex>
 
 #include "HLinearBuffer.hh"
 #include "HBufferPool.hh"
 #include "HConsumer.hh"
 #include "HDirectoryWriter.hh"
+#include "HBackPressurePolicy.hh"
 
 extern "C"
 {
@@ -29,7 +32,14 @@ namespace hose
 *Author: J. Barrett
 *Email: barrettj@mit.edu
 *Date:
-*Description:
+*Description: writes the averaged spectra (.spec) and noise power (.npow) to disk.
+* If the writer falls behind, spectra may be shed according to the back-pressure policy,
+* in which case a (.gap) record is written in place of each spectrum which was dropped.
+* A (.gap) record is also written alongside any spectrum with missing samples in its integration period.
+* If the spectrum carries an RFI mask (see HSpectralKurtosisFlagger) the flagged channels are written to a (.rfi) record,
+* which also notes the number of samples removed by time-domain blanking (see HImpulsiveRFIBlanker).
+* The spectrometer's window function and frame overlap (equivalent noise bandwidth, fraction of independent spectra)
+* are written to a (.win) record next to the first spectrum of each acquisition, and again whenever they change.
 */
 
 class HAveragedMultiThreadedSpectrumDataWriter: public HConsumer< float, HConsumerBufferHandler_Immediate< float > >, public HDirectoryWriter
@@ -45,16 +55,61 @@ class HAveragedMultiThreadedSpectrumDataWriter: public HConsumer< float, HConsum
         void EnableSpectrumWriteToDisk(){fEnableSpectrum = true;};
         void DisableSpectrumWriteToDisk(){fEnableSpectrum = false;}
 
+        //the spectra are the four Stokes spectra I, Q, U, V one after the other (see HStokesSpectrometer),
+        //the whole set is written to one (.spec) file, and the layout is marked with an 'S' in the version flag
+        void EnableStokesRecords(){fStokesRecords = true;};
+        void DisableStokesRecords(){fStokesRecords = false;};
+
+        //appended to the name of every file written (after the sideband/polarization flags), so that
+        //several writers can share an output directory, e.g. "_zoom" for the zoom spectra
+        void SetFileNameTag(std::string tag){fFileNameTag = tag;};
+        std::string GetFileNameTag() const {return fFileNameTag;};
+
+        //configure how (and if) spectra are shed when the writer cannot keep up
+        HBackPressurePolicy* GetBackPressurePolicy(){return &fBackPressurePolicy;};
+        const HBackPressurePolicy* GetBackPressurePolicy() const {return &fBackPressurePolicy;};
+
+        uint64_t GetNDroppedSpectra() const {return fBackPressurePolicy.GetNDropped();};
+
+        //the window function (sums of the window w and w^2 over the fft size) and overlap of the spectrometer frames,
+        //independent_fraction is the number of independent spectra per overlapped frame in the average
+        void SetWindowProperties(std::string window_name, size_t fft_size, double s1, double s2, size_t fft_overlap, double independent_fraction);
+
     private:
 
         virtual void ExecuteThreadTask() override;
         virtual bool WorkPresent() override;
         virtual void Idle() override;
 
+        //marks a spectrum which was not written (or only partially integrated), so the loss is visible in the output stream
+        void WriteGapRecord(const HBufferMetaData* meta, const std::string& reason);
+
+        //lists the (ranges of) channels of a spectrum which have been flagged as RFI, and the number of blanked samples
+        void WriteRFIRecord(const HBufferMetaData* meta);
+
+        //the window function and overlap properties which apply to this spectrum (and those which follow it)
+        void WriteWindowRecord(const HBufferMetaData* meta);
+
+        HBackPressurePolicy fBackPressurePolicy;
+
         //bool fEnable;
         
         bool fEnableSpectrum;
         bool fEnableNoisePower;
+        bool fStokesRecords;
+
+        std::string fFileNameTag;
+
+        std::mutex fWindowMutex;
+        bool fHaveWindowProperties;
+        bool fWindowRecordPending;
+        uint64_t fWindowRecordStartSecond;
+        std::string fWindowName;
+        size_t fWindowFFTSize;
+        double fWindowS1;
+        double fWindowS2;
+        size_t fFFTOverlap;
+        double fIndependentFraction;
 
 };
 
@@ -27,6 +27,7 @@ class HBufferAllocatorSpectrometerDataCUDA: public HBufferAllocatorBase< XBuffer
         HBufferAllocatorSpectrometerDataCUDA():
             HBufferAllocatorBase< XBufferItemType >(),
             fWindowFlag(0),
+            fOverlapFactor(1),
             fSpectrumLength(2),
             fSampleArrayLength(3) //default values will fail on alloc
         {};
@@ -34,6 +35,7 @@ class HBufferAllocatorSpectrometerDataCUDA: public HBufferAllocatorBase< XBuffer
         virtual ~HBufferAllocatorSpectrometerDataCUDA(){};
 
         void SetWindowFunction(int window_flag = 0){fWindowFlag = window_flag;}; //0 = none, 1 = blackman_harris, 2 = hann
+        void SetOverlapFactor(int overlap_factor = 1){fOverlapFactor = overlap_factor;}; //1 = none, 2 = 50%, 4 = 75%
 
         //must set the spectrum and array lengths
         void SetSpectrumLength(size_t spec_len){fSpectrumLength = spec_len;};
@@ -48,6 +50,7 @@ class HBufferAllocatorSpectrometerDataCUDA: public HBufferAllocatorBase< XBuffer
         virtual void DeallocateImpl(XBufferItemType* ptr, size_t size) override;
 
         int fWindowFlag;
+        int fOverlapFactor;
         size_t fSpectrumLength;
         size_t fSampleArrayLength;
 
@@ -72,7 +75,7 @@ HBufferAllocatorSpectrometerDataCUDA< spectrometer_data >::AllocateImpl(size_t s
     }
 
     spectrometer_data* ptr = nullptr;
-    ptr = new_spectrometer_data(fSampleArrayLength, fSpectrumLength, fWindowFlag);
+    ptr = new_spectrometer_data_overlap(fSampleArrayLength, fSpectrumLength, fWindowFlag, fOverlapFactor);
     return ptr;
 }
 
@@ -0,0 +1,171 @@
+#ifndef HImpulsiveRFIBlanker_HH__
+#define HImpulsiveRFIBlanker_HH__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <stdint.h>
+
+#include "HLinearBuffer.hh"
+#include "HBufferPool.hh"
+#include "HConsumer.hh"
+#include "HSampleConversionKernel.hh"
+
+namespace hose
+{
+
+/*
+*File: HImpulsiveRFIBlanker.hh
+*Class: HImpulsiveRFIBlanker
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: time-domain blanking of impulsive RFI in digitizer buffers, ahead of the spectrometer.
+* The buffer is cut into blocks of samples, the power of each block is compared against the median block
+* power of the buffer, and blocks which exceed it by more than threshold*MAD (median absolute deviation,
+* scaled to a standard deviation) are set to the zero level of the digitizer. The buffer is modified in place
+* and the number of samples blanked is stored in the buffer meta data, so that the averages can be corrected.
+* Must be attached to the digitizer pool before the spectrometer (and cannot be used in fan-out mode).
+*/
+
+template< typename XSampleType >
+class HImpulsiveRFIBlanker: public HConsumer< XSampleType, HConsumerBufferHandler_Immediate< XSampleType > >
+{
+
+    public:
+        HImpulsiveRFIBlanker():
+            fBlockSize(1024),
+            fThreshold(6.0),
+            fNProcessedSamples(0),
+            fNBlankedSamples(0),
+            fProcessingTime(0)
+        {};
+
+        virtual ~HImpulsiveRFIBlanker(){};
+
+        //number of samples over which the power is computed (the smallest unit which can be blanked)
+        void SetBlockSize(size_t n){fBlockSize = (n == 0) ? 1 : n;};
+        size_t GetBlockSize() const {return fBlockSize;};
+
+        //blocks with a power above median + threshold*sigma are blanked (sigma estimated as 1.4826*MAD)
+        void SetThreshold(double n_sigma){fThreshold = n_sigma;};
+        double GetThreshold() const {return fThreshold;};
+
+        //blanks the outlier blocks of an array, returns the number of samples which were blanked
+        size_t BlankSamples(XSampleType* data, size_t n_samples) const
+        {
+            size_t n_blocks = (n_samples + fBlockSize - 1)/fBlockSize;
+            if(n_blocks < 3){return 0;}
+
+            std::vector<double> power(n_blocks);
+            for(size_t b=0; b<n_blocks; b++)
+            {
+                size_t start = b*fBlockSize;
+                size_t length = std::min(fBlockSize, n_samples - start);
+                power[b] = BlockPower(data + start, length);
+            }
+
+            //robust estimates of the typical block power and its spread
+            std::vector<double> work(power);
+            double median = Median(work);
+            for(size_t b=0; b<n_blocks; b++){work[b] = std::fabs(power[b] - median);}
+            double mad = Median(work);
+            if(mad <= 0.0){return 0;} //no spread to measure against
+            double limit = median + fThreshold*1.4826*mad;
+
+            size_t n_blanked = 0;
+            for(size_t b=0; b<n_blocks; b++)
+            {
+                if(power[b] > limit)
+                {
+                    size_t start = b*fBlockSize;
+                    size_t length = std::min(fBlockSize, n_samples - start);
+                    std::fill(data + start, data + start + length, ZeroLevel());
+                    n_blanked += length;
+                }
+            }
+            return n_blanked;
+        }
+
+        uint64_t GetNProcessedSamples() const {return fNProcessedSamples;};
+        uint64_t GetNBlankedSamples() const {return fNBlankedSamples;};
+
+        //processing rate in samples per second (of busy time, per thread)
+        double GetThroughput() const
+        {
+            uint64_t ns = fProcessingTime;
+            if(ns == 0){return 0.0;}
+            return 1e9*( (double) fNProcessedSamples )/( (double) ns );
+        }
+
+    private:
+
+        virtual void ExecuteThreadTask() override
+        {
+            HLinearBuffer< XSampleType >* tail = nullptr;
+            if( this->fBufferPool->GetConsumerPoolSize( this->GetConsumerID() ) != 0 )
+            {
+                HConsumerBufferPolicyCode buffer_code = this->fBufferHandler.ReserveBuffer(this->fBufferPool, tail, this->GetConsumerID() );
+                if(buffer_code == HConsumerBufferPolicyCode::success && tail != nullptr)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(tail->fMutex);
+                        auto start = std::chrono::steady_clock::now();
+
+                        size_t n_samples = tail->GetArrayDimension(0);
+                        size_t n_blanked = BlankSamples(tail->GetData(), n_samples);
+                        tail->GetMetaData()->SetNBlankedSamples(n_blanked);
+
+                        auto elapsed = std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - start );
+                        fProcessingTime += elapsed.count();
+                        fNProcessedSamples += n_samples;
+                        fNBlankedSamples += n_blanked;
+                    }
+                    this->fBufferHandler.ReleaseBufferToConsumer(this->fBufferPool, tail, this->GetNextConsumerID() );
+                }
+            }
+        }
+
+        virtual bool WorkPresent() override
+        {
+            return ( this->fBufferPool->GetConsumerPoolSize( this->GetConsumerID() ) != 0 );
+        }
+
+        //sample value corresponding to zero volts (mid-scale for unsigned data)
+        static XSampleType ZeroLevel()
+        {
+            if(std::numeric_limits< XSampleType >::is_signed || !std::numeric_limits< XSampleType >::is_integer){return 0;}
+            return (XSampleType) ( ( (uint64_t) std::numeric_limits< XSampleType >::max() + 1)/2 );
+        }
+
+        //variance of a block of samples
+        static double BlockPower(const XSampleType* data, size_t length)
+        {
+            double sum = 0.0;
+            double sum2 = 0.0;
+            HSampleConversionKernel::Moments(data, length, sum, sum2);
+            double mean = sum/length;
+            return sum2/length - mean*mean;
+        }
+
+        static double Median(std::vector<double>& values)
+        {
+            size_t mid = values.size()/2;
+            std::nth_element(values.begin(), values.begin() + mid, values.end());
+            return values[mid];
+        }
+
+        size_t fBlockSize;
+        double fThreshold;
+
+        std::atomic<uint64_t> fNProcessedSamples;
+        std::atomic<uint64_t> fNBlankedSamples;
+        std::atomic<uint64_t> fProcessingTime; //ns
+};
+
+}
+
+#endif /* end of include guard: HImpulsiveRFIBlanker */
@@ -0,0 +1,181 @@
+#ifndef HIntegrationPeriodTracker_HH__
+#define HIntegrationPeriodTracker_HH__
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+extern "C"
+{
+    #include "HDataAccumulationStruct.h"
+}
+
+namespace hose
+{
+
+/*
+*File: HIntegrationPeriodTracker.hh
+*Class: HIntegrationPeriodTracker
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: bookkeeping of the integration periods of the averaging stages (spectrum averager, Stokes spectrometer,
+* phase-calibration monitor). The periods are fixed by the sample index (period k covers buffers [k*n_buffers,
+* (k+1)*n_buffers) of the acquisition), so buffers may be added by any number of threads and in any order. A thread
+* claims the partial sum for its buffer's period (each thread has its own), adds the buffer into it without holding
+* any lock, and then releases it along with the buffer's counts. Periods are taken out strictly in order: the oldest
+* one once it is complete, or with whatever it has if its stream has ended, if too many later periods are open, if it
+* has timed out, or if everything is being flushed. Buffers missing from a period are flagged in its validity mask
+* and counted as missing samples; incomplete periods are either passed on as partial averages or discarded.
+*/
+
+class HIntegrationPeriodTracker
+{
+    public:
+
+        //identifies an integration period by its data stream and its index within the acquisition
+        struct HPeriodKey
+        {
+            uint64_t fAcquisitionStartSecond;
+            uint64_t fSampleRate;
+            char fSidebandFlag;
+            char fPolarizationFlag;
+            uint64_t fPeriodIndex;
+
+            bool SameStream(const HPeriodKey& rhs) const
+            {
+                return (fAcquisitionStartSecond == rhs.fAcquisitionStartSecond && fSampleRate == rhs.fSampleRate
+                        && fSidebandFlag == rhs.fSidebandFlag && fPolarizationFlag == rhs.fPolarizationFlag);
+            }
+
+            bool operator<(const HPeriodKey& rhs) const
+            {
+                if(fAcquisitionStartSecond != rhs.fAcquisitionStartSecond){return fAcquisitionStartSecond < rhs.fAcquisitionStartSecond;}
+                if(fSampleRate != rhs.fSampleRate){return fSampleRate < rhs.fSampleRate;}
+                if(fSidebandFlag != rhs.fSidebandFlag){return fSidebandFlag < rhs.fSidebandFlag;}
+                if(fPolarizationFlag != rhs.fPolarizationFlag){return fPolarizationFlag < rhs.fPolarizationFlag;}
+                return fPeriodIndex < rhs.fPeriodIndex;
+            }
+        };
+
+        //the accumulated data of one integration period
+        struct HPeriod
+        {
+            uint64_t fLeadingSampleIndex; //first sample of the period
+            uint64_t fBufferSampleLength; //number of samples in each input buffer
+            bool fHaveFourthMoment; //if the partial sums also hold the sum of |X|^4 (after the power spectrum)
+            std::vector< std::vector<double> > fPartialSums; //one for each worker thread (empty if unused)
+            std::vector< uint8_t > fValidityMask; //which buffers of the period have been accumulated
+            size_t fNBuffersAccumulated;
+            size_t fNFourthMomentAccumulated;
+            unsigned int fNInProgress; //number of threads currently adding a buffer
+            uint64_t fNTotalSpectrum;
+            uint64_t fNTotalSamplesAccumulated;
+            uint64_t fNBlankedSamples;
+            std::vector< struct HDataAccumulationStruct > fAccumulations; //noise power data
+            std::chrono::steady_clock::time_point fLastUpdate;
+        };
+
+        //what is to be done with a period which has been taken out
+        enum HPeriodStatus
+        {
+            eComplete, //all of the buffers were accumulated
+            ePartial, //incomplete, to be written out anyway
+            eDiscarded //incomplete and thrown away (the partial sums have already been recycled)
+        };
+
+        HIntegrationPeriodTracker(size_t spectrum_length, size_t n_buffers);
+        virtual ~HIntegrationPeriodTracker();
+
+        //change the spectrum length and number of buffers per period, all open periods are dropped
+        //(and the thread assignments forgotten), so take them out first
+        void Configure(size_t spectrum_length, size_t n_buffers);
+
+        size_t GetSpectrumLength() const {return fSpectrumLength;};
+        size_t GetNBuffersPerPeriod() const {return fNBuffersPerPeriod;};
+
+        //new periods also accumulate the |X|^4 spectrum (partial sums are then 2*spectrum_length long)
+        void EnableFourthMoment(){fEnableFourthMoment = true;};
+        void DisableFourthMoment(){fEnableFourthMoment = false;};
+
+        //pass on incomplete periods as partial averages rather than discarding them
+        void EnablePartialFlush(){fFlushPartial = true;};
+        void DisablePartialFlush(){fFlushPartial = false;};
+
+        //time without any new data after which an incomplete period is taken out, 0 waits forever
+        void SetTimeoutMilliseconds(unsigned int ms){fTimeout = ms;};
+        unsigned int GetTimeoutMilliseconds() const {return fTimeout;};
+
+        //the period a buffer belongs to
+        HPeriodKey GetKey(uint64_t acquisition_start_sec, uint64_t sample_rate, char sideband, char polarization,
+                          uint64_t leading_sample_index, uint64_t n_samples) const;
+
+        //index of the calling thread's partial sum
+        size_t GetWorkerIndex();
+
+        //returns the partial sum to add the buffer into, or nullptr if the buffer cannot be used (its period
+        //has already been taken out, it does not fit the period, or it is a duplicate), which counts as late
+        double* Claim(const HPeriodKey& key, uint64_t leading_sample_index, uint64_t n_samples, size_t worker, HPeriod*& period);
+
+        //add the buffer's counts and noise power data to the period once its spectrum has been summed
+        void Release(HPeriod* period, uint64_t n_spectra, uint64_t n_samples, uint64_t n_blanked_samples,
+                     bool have_fourth_moment, const struct HDataAccumulationStruct& stat);
+
+        //take out the oldest period if it is ready (see above), or all of them (one per call) if finish_all is set,
+        //n_max_open is the number of open periods beyond which the oldest is taken out regardless
+        bool TakePeriod(unsigned int n_max_open, bool finish_all, HPeriodKey& key, HPeriod& period, HPeriodStatus& status);
+
+        //merge the partial sums of the period into the first one used, which is returned (nullptr if there are none)
+        static double* MergePartialSums(HPeriod& period);
+
+        //hand the period's partial sum arrays back for re-use
+        void Recycle(HPeriod& period);
+
+        unsigned int GetNOpenPeriods() const {return fNOpenPeriods;};
+        std::chrono::steady_clock::time_point GetLastUpdateTime() const
+        {
+            return std::chrono::steady_clock::time_point( std::chrono::steady_clock::duration(fLastUpdateTime) );
+        };
+
+        uint64_t GetNBuffersReceived() const {return fNBuffersReceived;};
+        uint64_t GetNLateBuffers() const {return fNLateBuffers;}; //buffers which arrived after their period was taken out
+        uint64_t GetNMissingSamples() const {return fNMissingSamples;}; //samples missing from the input stream
+        uint64_t GetNDiscardedPeriods() const {return fNDiscardedPeriods;};
+
+    protected:
+
+        //should only be called while holding the mutex
+        std::vector<double> GetSpareSum(size_t length);
+        void AccountCoverage(HPeriod& period);
+
+        size_t fSpectrumLength;
+        size_t fNBuffersPerPeriod;
+        bool fEnableFourthMoment;
+        bool fFlushPartial;
+        unsigned int fTimeout;
+
+        //open periods (ordered), the thread-to-partial-sum assignment and a stock
+        //of spare partial sum arrays are all protected by the mutex
+        std::mutex fMutex;
+        std::map< HPeriodKey, HPeriod > fOpenPeriods;
+        std::map< std::thread::id, size_t > fWorkerIndices;
+        std::vector< std::vector<double> > fSpareSums;
+        bool fHaveLastKey;
+        HPeriodKey fLastKey; //most recent period to be taken out
+        uint64_t fNextSampleIndex; //sample index expected to follow the last period taken out
+
+        std::atomic<unsigned int> fNOpenPeriods;
+        std::atomic< std::chrono::steady_clock::rep > fLastUpdateTime;
+        std::atomic<uint64_t> fNBuffersReceived;
+        std::atomic<uint64_t> fNLateBuffers;
+        std::atomic<uint64_t> fNMissingSamples;
+        std::atomic<uint64_t> fNDiscardedPeriods;
+};
+
+}
+
+#endif /* end of include guard: HIntegrationPeriodTracker_HH__ */
@@ -0,0 +1,264 @@
+#ifndef HMultiResolutionSpectrometer_HH__
+#define HMultiResolutionSpectrometer_HH__
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+#include "HLinearBuffer.hh"
+#include "HBufferPool.hh"
+#include "HConsumer.hh"
+#include "HProducerBufferHandlerPolicy.hh"
+#include "HBackPressurePolicy.hh"
+#include "HSampleConversionKernel.hh"
+#include "HSpectrumAccumulationKernel.hh"
+#include "HPowerSpectrumAccumulator.hh"
+
+namespace hose
+{
+
+/*
+*File: HMultiResolutionSpectrometer.hh
+*Class: HMultiResolutionSpectrometer
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: CPU spectrometer which computes the power spectrum of each digitizer buffer at several FFT sizes
+* in a single pass over the data. The buffer is read in chunks (a multiple of the largest FFT size), each chunk
+* is converted to floating point once, and while it is in cache it is cut into frames for every FFT size.
+* Each FFT size produces one averaged spectrum per buffer into its own output pool (so it can have its own writer).
+* The FFT sizes must all divide the largest one. The digitizer buffers are not modified, and are passed on to the
+* next consumer. Buffers may be skipped according to the back-pressure policy (or if an output pool is full),
+* rather than holding up the acquisition.
+*/
+
+template< typename XSampleType >
+class HMultiResolutionSpectrometer: public HConsumer< XSampleType, HConsumerBufferHandler_Immediate< XSampleType > >
+{
+
+    public:
+        HMultiResolutionSpectrometer():
+            fWindowFlag(0),
+            fChunkSize(0),
+            fNProcessedSamples(0),
+            fNSkippedBuffers(0),
+            fProcessingTime(0)
+        {};
+
+        virtual ~HMultiResolutionSpectrometer()
+        {
+            for(size_t i=0; i<fWorkspaces.size(); i++){delete fWorkspaces[i];}
+            for(size_t i=0; i<fSinkBufferHandlers.size(); i++){delete fSinkBufferHandlers[i];}
+        };
+
+        //adds an FFT size and the pool its spectra are written to (buffers of at least fft_size/2+1),
+        //must be called before the threads are started, returns false if the size is not compatible with the others
+        bool AddResolution(size_t fft_size, HBufferPool< float >* sink_pool)
+        {
+            size_t largest = fft_size;
+            for(size_t i=0; i<fFFTSizes.size(); i++){largest = std::max(largest, fFFTSizes[i]);}
+            bool compatible = (fft_size >= 2 && sink_pool != nullptr);
+            for(size_t i=0; i<fFFTSizes.size(); i++){ if(largest % fFFTSizes[i] != 0){compatible = false;} }
+            if(largest % fft_size != 0){compatible = false;}
+            if(!compatible)
+            {
+                std::cout<<"HMultiResolutionSpectrometer::AddResolution: Error, FFT size "<<fft_size<<" does not divide (or is not divisible by) the other sizes, it will be ignored."<<std::endl;
+                return false;
+            }
+            fFFTSizes.push_back(fft_size);
+            fSinkPools.push_back(sink_pool);
+            fSinkBufferHandlers.push_back(new HProducerBufferHandler_Immediate< float >());
+
+            //work in chunks of ~64k samples (or one frame of the largest size, if that is bigger)
+            fChunkSize = largest*std::max< size_t >(1, 65536/largest);
+            return true;
+        }
+
+        size_t GetNResolutions() const {return fFFTSizes.size();};
+        size_t GetFFTSize(size_t i) const {return fFFTSizes[i];};
+
+        void SetWindowFunction(int window_flag = 0){fWindowFlag = window_flag;}; //0 = none, 1 = blackman_harris, 2 = hann
+
+        //configure how (and if) buffers are skipped when the spectrometer cannot keep up
+        HBackPressurePolicy* GetBackPressurePolicy(){return &fBackPressurePolicy;};
+        const HBackPressurePolicy* GetBackPressurePolicy() const {return &fBackPressurePolicy;};
+
+        uint64_t GetNSkippedBuffers() const {return fNSkippedBuffers + fBackPressurePolicy.GetNDropped();};
+        uint64_t GetNProcessedSamples() const {return fNProcessedSamples;};
+
+        //processing rate in input samples per second (of busy time, per thread)
+        double GetThroughput() const
+        {
+            uint64_t ns = fProcessingTime;
+            if(ns == 0){return 0.0;}
+            return 1e9*( (double) fNProcessedSamples )/( (double) ns );
+        }
+
+    protected:
+
+        //per-thread float conversion space and one accumulator for each FFT size
+        struct HMultiResolutionWorkspace
+        {
+            ~HMultiResolutionWorkspace(){for(size_t i=0; i<fAccumulators.size(); i++){delete fAccumulators[i];}};
+            std::vector<float> fSamples;
+            std::vector< HPowerSpectrumAccumulator* > fAccumulators;
+        };
+
+        virtual void ExecuteThreadTask() override
+        {
+            HLinearBuffer< XSampleType >* source = nullptr;
+
+            size_t backlog = this->fBufferPool->GetConsumerPoolSize( this->GetConsumerID() );
+            if(backlog == 0){return;}
+
+            HConsumerBufferPolicyCode source_code = this->fBufferHandler.ReserveBuffer(this->fBufferPool, source, this->GetConsumerID());
+            if( !(source_code & HConsumerBufferPolicyCode::success) || source == nullptr){return;}
+
+            if( fFFTSizes.size() != 0 && fBackPressurePolicy.Accept(backlog) )
+            {
+                //we need an output buffer for every resolution, otherwise the buffer is skipped
+                size_t n_res = fFFTSizes.size();
+                std::vector< HLinearBuffer< float >* > sinks(n_res, nullptr);
+                bool have_sinks = true;
+                for(size_t r=0; r<n_res; r++)
+                {
+                    HProducerBufferPolicyCode sink_code = fSinkBufferHandlers[r]->ReserveBuffer(fSinkPools[r], sinks[r]);
+                    if( !(sink_code & HProducerBufferPolicyCode::success) || sinks[r] == nullptr
+                        || sinks[r]->GetArrayDimension(0) < fFFTSizes[r]/2 + 1)
+                    {
+                        have_sinks = false;
+                    }
+                }
+
+                if(have_sinks)
+                {
+                    //in fan-out mode the source buffer is shared (read-only) with the other consumers, so we don't lock it
+                    std::unique_lock<std::mutex> source_lock(source->fMutex, std::defer_lock);
+                    if( !this->fBufferPool->IsFanOutEnabled() ){ source_lock.lock(); }
+
+                    auto start = std::chrono::steady_clock::now();
+                    HBufferMetaData* meta = source->GetMetaData();
+                    size_t n_samples = source->GetArrayDimension(0);
+                    HMultiResolutionWorkspace* work = ClaimWorkspace();
+                    Process(source->GetData(), n_samples, work);
+
+                    //average, correcting for any samples zeroed by the time-domain RFI blanker
+                    double blank_scale = 1.0;
+                    uint64_t n_blanked = meta->GetNBlankedSamples();
+                    if(n_blanked != 0 && n_blanked < n_samples){blank_scale = ( (double) n_samples )/( (double) (n_samples - n_blanked) );}
+
+                    for(size_t r=0; r<n_res; r++)
+                    {
+                        std::lock_guard<std::mutex> sink_lock(sinks[r]->fMutex);
+                        HPowerSpectrumAccumulator* acc = work->fAccumulators[r];
+                        uint64_t n_spectra = acc->GetNSpectra();
+                        double scale = (n_spectra == 0) ? 0.0 : blank_scale/( (double) n_spectra );
+                        HSpectrumAccumulationKernel::Normalize(acc->GetPowerSum(), scale, sinks[r]->GetData(), acc->GetSpectrumLength());
+
+                        HBufferMetaData* sink_meta = sinks[r]->GetMetaData();
+                        *sink_meta = *meta;
+                        sink_meta->SetPowerSpectrumLength(acc->GetSpectrumLength());
+                        sink_meta->SetNTotalSpectrum(n_spectra);
+                        sink_meta->SetNTotalSamplesCollected(n_samples);
+                        sink_meta->ClearRFIMask();
+                        fSinkBufferHandlers[r]->ReleaseBufferToConsumer(fSinkPools[r], sinks[r]);
+                    }
+                    ReturnWorkspace(work);
+
+                    auto elapsed = std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - start );
+                    fProcessingTime += elapsed.count();
+                    fNProcessedSamples += n_samples;
+                }
+                else
+                {
+                    //no room for the output, skip this buffer rather than stall the digitizer
+                    for(size_t r=0; r<n_res; r++)
+                    {
+                        if(sinks[r] != nullptr){fSinkBufferHandlers[r]->ReleaseBufferToProducer(fSinkPools[r], sinks[r]);}
+                    }
+                    fNSkippedBuffers++;
+                }
+            }
+
+            this->fBufferHandler.ReleaseBufferToConsumer(this->fBufferPool, source, this->GetNextConsumerID());
+        }
+
+        virtual bool WorkPresent() override
+        {
+            return ( this->fBufferPool->GetConsumerPoolSize( this->GetConsumerID() ) != 0 );
+        }
+
+        //one pass over the buffer, each chunk is converted once and then used by every FFT size
+        void Process(const XSampleType* data, size_t n_samples, HMultiResolutionWorkspace* work)
+        {
+            for(size_t r=0; r<work->fAccumulators.size(); r++){work->fAccumulators[r]->Reset();}
+
+            for(size_t start=0; start<n_samples; start += fChunkSize)
+            {
+                size_t length = std::min(fChunkSize, n_samples - start);
+                const XSampleType* in = data + start;
+                float* x = &(work->fSamples[0]);
+                HSampleConversionKernel::ConvertAndWindow(in, nullptr, x, length);
+
+                for(size_t r=0; r<work->fAccumulators.size(); r++)
+                {
+                    size_t n = fFFTSizes[r];
+                    for(size_t offset=0; offset + n <= length; offset += n){work->fAccumulators[r]->AddFrame(x + offset);}
+                }
+            }
+
+            for(size_t r=0; r<work->fAccumulators.size(); r++){work->fAccumulators[r]->Flush();}
+        }
+
+        HMultiResolutionWorkspace* ClaimWorkspace()
+        {
+            std::lock_guard<std::mutex> lock(fWorkspaceMutex);
+            if(fFreeWorkspaces.size() != 0)
+            {
+                HMultiResolutionWorkspace* work = fFreeWorkspaces.back();
+                fFreeWorkspaces.pop_back();
+                return work;
+            }
+
+            HMultiResolutionWorkspace* work = new HMultiResolutionWorkspace();
+            work->fSamples.resize(fChunkSize);
+            for(size_t r=0; r<fFFTSizes.size(); r++)
+            {
+                work->fAccumulators.push_back(new HPowerSpectrumAccumulator());
+                work->fAccumulators[r]->SetFFTSize(fFFTSizes[r]);
+                work->fAccumulators[r]->SetWindowFunction(fWindowFlag);
+                work->fAccumulators[r]->Initialize();
+            }
+            fWorkspaces.push_back(work);
+            return work;
+        }
+
+        void ReturnWorkspace(HMultiResolutionWorkspace* work)
+        {
+            std::lock_guard<std::mutex> lock(fWorkspaceMutex);
+            fFreeWorkspaces.push_back(work);
+        }
+
+        int fWindowFlag;
+        size_t fChunkSize;
+        std::vector< size_t > fFFTSizes;
+        std::vector< HBufferPool< float >* > fSinkPools;
+        std::vector< HProducerBufferHandler_Immediate< float >* > fSinkBufferHandlers;
+
+        std::mutex fWorkspaceMutex;
+        std::vector< HMultiResolutionWorkspace* > fWorkspaces;
+        std::vector< HMultiResolutionWorkspace* > fFreeWorkspaces;
+
+        HBackPressurePolicy fBackPressurePolicy;
+        std::atomic<uint64_t> fNProcessedSamples;
+        std::atomic<uint64_t> fNSkippedBuffers;
+        std::atomic<uint64_t> fProcessingTime; //ns
+};
+
+}
+
+#endif /* end of include guard: HMultiResolutionSpectrometer */
@@ -0,0 +1,69 @@
+#ifndef HOscillatorPhase_HH__
+#define HOscillatorPhase_HH__
+
+#include <cmath>
+#include <complex>
+#include <stdint.h>
+
+namespace hose
+{
+
+/*
+*File: HOscillatorPhase.hh
+*Class: HOscillatorPhase
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: phase of a numerically controlled oscillator (local oscillator, phase-cal tone) at an absolute
+* sample index. The phase f*n/fs (in cycles) is reduced modulo 1 in integer arithmetic, so it does not lose
+* precision as the sample index grows, and the product f*n is formed modulo fs so that it cannot overflow
+* for any sample rate (a plain 64 bit product of two residues overflows once fs exceeds 2^32 Hz).
+*/
+
+class HOscillatorPhase
+{
+    public:
+
+        //e^{-i*2pi*f*n/fs}, for a frequency f and sample rate fs in Hz
+        static std::complex<double> Phasor(uint64_t freq, uint64_t sample_index, uint64_t sample_rate)
+        {
+            uint64_t cycles = MultiplyModulo(freq, sample_index, sample_rate);
+            double phase = 2.0*M_PI*( (double) cycles )/( (double) sample_rate );
+            return std::complex<double>( std::cos(phase), -1.0*std::sin(phase) );
+        }
+
+        //(a*b) mod m without overflow
+        static uint64_t MultiplyModulo(uint64_t a, uint64_t b, uint64_t m)
+        {
+            a %= m;
+            b %= m;
+            #if defined(__SIZEOF_INT128__)
+            return (uint64_t) ( ( (unsigned __int128) a * b ) % m );
+            #else
+            //double and add
+            uint64_t result = 0;
+            while(b != 0)
+            {
+                if(b & 1){result = (result >= m - a) ? result - (m - a) : result + a;}
+                a = (a >= m - a) ? a - (m - a) : a + a;
+                b >>= 1;
+            }
+            return result;
+            #endif
+        }
+
+        static uint64_t GreatestCommonDivisor(uint64_t a, uint64_t b)
+        {
+            while(b != 0)
+            {
+                uint64_t r = a % b;
+                a = b;
+                b = r;
+            }
+            return a;
+        }
+};
+
+}
+
+#endif /* end of include guard: HOscillatorPhase_HH__ */
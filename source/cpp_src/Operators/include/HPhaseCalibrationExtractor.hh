@@ -0,0 +1,139 @@
+#ifndef HPhaseCalibrationExtractor_HH__
+#define HPhaseCalibrationExtractor_HH__
+
+#include <algorithm>
+#include <complex>
+#include <limits>
+#include <vector>
+#include <stdint.h>
+
+#include "HOscillatorPhase.hh"
+
+namespace hose
+{
+
+/*
+*File: HPhaseCalibrationExtractor.hh
+*Class: HPhaseCalibrationExtractor
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: extracts the amplitude and phase of a comb of phase-calibration tones (at f0, f0+df, f0+2df, ... Hz)
+* from a stream of real samples, the phases are referenced to the first sample of the acquisition (sample index zero).
+* Since every tone is a multiple of fs/P, with P = fs/gcd(fs, f0, df), the whole comb repeats every P samples, so
+* the samples are simply folded (summed) modulo P as they arrive (one addition per sample), and a single transform of
+* the folded period at read out gives every tone at once. If P is too long to keep, each tone is instead accumulated
+* by its own phase rotator (a dot product with a table of the tone over a short chunk, rotated to the absolute sample
+* index of the chunk). The sums of two extractors with the same configuration can be merged.
+* Not thread safe, each thread needs its own extractor.
+*/
+
+class HPhaseCalibrationExtractor
+{
+    public:
+
+        HPhaseCalibrationExtractor();
+        virtual ~HPhaseCalibrationExtractor();
+
+        void SetSampleRate(uint64_t rate){fSampleRate = rate; fInitialized = false;};
+        uint64_t GetSampleRate() const {return fSampleRate;};
+
+        //the tones are at first_tone + k*spacing (Hz), for k < n_tones (0 takes every tone below the Nyquist frequency)
+        void SetFirstToneFrequency(uint64_t freq){fFirstToneFrequency = freq; fInitialized = false;};
+        void SetToneSpacing(uint64_t spacing){fToneSpacing = spacing; fInitialized = false;};
+        void SetNTones(size_t n){fNRequestedTones = n; fInitialized = false;};
+
+        //longest period (in samples) which is folded, beyond this the phase rotators are used
+        void SetMaxFoldLength(size_t n){fMaxFoldLength = n; fInitialized = false;};
+
+        //works out the tone frequencies and the fold period, and allocates the sums
+        bool Initialize();
+
+        //zeros the accumulated sums
+        void Reset();
+
+        //adds a buffer of samples, the first of which has the given index (from the start of the acquisition)
+        template< typename XSampleType >
+        void Process(const XSampleType* data, size_t n_samples, uint64_t leading_sample_index);
+
+        //adds the sums of another extractor (which must have the same configuration)
+        void Merge(const HPhaseCalibrationExtractor& other);
+
+        size_t GetNTones() const {return fToneFrequencies.size();};
+        uint64_t GetToneFrequency(size_t k) const {return fToneFrequencies[k];};
+        uint64_t GetNSamples() const {return fNSamples;};
+        bool IsFolding() const {return fFoldLength != 0;};
+        size_t GetFoldLength() const {return fFoldLength;};
+
+        //sum over n of x[n]*e^{-i*2pi*f*n/fs} for each tone
+        void GetToneSums(std::vector< std::complex<double> >& sums) const;
+
+        //amplitude (in digitizer units, zero-level subtracted) and phase (radians) of each tone
+        void GetTones(std::vector< double >& amplitude, std::vector< double >& phase) const;
+
+    private:
+
+        void AccumulateFold(const float* x, size_t n, uint64_t first_sample_index);
+        void AccumulateRotators(const float* x, size_t n, uint64_t first_sample_index);
+
+        //e^{-i*2pi*f*n/fs}, computed exactly from the sample index
+        std::complex<double> Phasor(uint64_t freq, uint64_t sample_index) const
+        {
+            return HOscillatorPhase::Phasor(freq, sample_index, fSampleRate);
+        }
+
+        //sample value corresponding to zero volts (mid-scale for unsigned data)
+        template< typename XSampleType >
+        static float ZeroLevel()
+        {
+            if(std::numeric_limits< XSampleType >::is_signed || !std::numeric_limits< XSampleType >::is_integer){return 0.0f;}
+            return (float) ( ( (uint64_t) std::numeric_limits< XSampleType >::max() + 1)/2 );
+        }
+
+        bool fInitialized;
+        uint64_t fSampleRate;
+        uint64_t fFirstToneFrequency;
+        uint64_t fToneSpacing;
+        size_t fNRequestedTones;
+        size_t fMaxFoldLength;
+        size_t fChunkSize;
+        uint64_t fCombResolution; //gcd(fs, f0, df), every tone is a multiple of this
+
+        std::vector< uint64_t > fToneFrequencies;
+        uint64_t fNSamples;
+
+        //folded samples, indexed by the sample index modulo the fold length
+        size_t fFoldLength;
+        std::vector< double > fFold;
+
+        //phase rotators, e^{-i*2pi*f*k/fs} for k within a chunk (one row per tone), and the tone sums
+        std::vector< float > fRotationReal;
+        std::vector< float > fRotationImag;
+        std::vector< std::complex<double> > fToneSums;
+
+        std::vector< float > fInput;
+};
+
+template< typename XSampleType >
+void
+HPhaseCalibrationExtractor::Process(const XSampleType* data, size_t n_samples, uint64_t leading_sample_index)
+{
+    if(!fInitialized && !Initialize()){return;}
+
+    float zero = ZeroLevel< XSampleType >();
+    for(size_t start=0; start<n_samples; start += fChunkSize)
+    {
+        size_t length = std::min(fChunkSize, n_samples - start);
+        const XSampleType* in = data + start;
+        float* x = &(fInput[0]);
+        for(size_t i=0; i<length; i++){x[i] = ( (float) in[i] ) - zero;}
+
+        if(fFoldLength != 0){AccumulateFold(x, length, leading_sample_index + start);}
+        else{AccumulateRotators(x, length, leading_sample_index + start);}
+    }
+    fNSamples += n_samples;
+}
+
+}
+
+#endif /* end of include guard: HPhaseCalibrationExtractor */
@@ -0,0 +1,337 @@
+#ifndef HPhaseCalibrationMonitor_HH__
+#define HPhaseCalibrationMonitor_HH__
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "HLinearBuffer.hh"
+#include "HBufferPool.hh"
+#include "HConsumer.hh"
+#include "HDirectoryWriter.hh"
+#include "HBackPressurePolicy.hh"
+#include "HPhaseCalibrationExtractor.hh"
+#include "HIntegrationPeriodTracker.hh"
+
+namespace hose
+{
+
+/*
+*File: HPhaseCalibrationMonitor.hh
+*Class: HPhaseCalibrationMonitor
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: extracts the phase-calibration tones (see HPhaseCalibrationExtractor) from every digitizer buffer,
+* and integrates them over n_buffers consecutive buffers (the integration periods are fixed by the sample index,
+* so the buffers may be processed by any number of threads and in any order). The amplitude and phase of each tone
+* is written to a (.pcal) record for each integration period, named like the spectra and noise power files.
+* The periods are tracked as in the spectrum averager (see HIntegrationPeriodTracker), each with its own extractor
+* holding the tone sums: buffers which are missing from a period are noted in the record, incomplete periods are
+* written out once a later acquisition starts or too many later periods are open, and buffers which arrive after
+* their period has been written out, or which do not fit it, are not used. The digitizer buffers are not modified,
+* and are passed on to the next consumer, they may be skipped according to the back-pressure policy.
+*/
+
+template< typename XSampleType >
+class HPhaseCalibrationMonitor: public HConsumer< XSampleType, HConsumerBufferHandler_Immediate< XSampleType > >, public HDirectoryWriter
+{
+
+    public:
+        HPhaseCalibrationMonitor():
+            HDirectoryWriter(),
+            fFirstToneFrequency(0),
+            fToneSpacing(0),
+            fNTones(0),
+            fNBuffersToIntegrate(1),
+            fNMaxOpenIntegrations(0),
+            fPeriods(1, 1),
+            fNProcessedSamples(0),
+            fNSkippedBuffers(0),
+            fNRecordsWritten(0),
+            fNPartialRecords(0),
+            fProcessingTime(0)
+        {
+            //incomplete periods are written out, with the missing buffers noted
+            fPeriods.EnablePartialFlush();
+        };
+
+        virtual ~HPhaseCalibrationMonitor()
+        {
+            for(size_t i=0; i<fWorkspaces.size(); i++){delete fWorkspaces[i];}
+            for(auto it = fOpenIntegrations.begin(); it != fOpenIntegrations.end(); it++){delete it->second;}
+        };
+
+        //configuration, must be set before the threads are started
+        void SetFirstToneFrequency(uint64_t freq){fFirstToneFrequency = freq;};
+        void SetToneSpacing(uint64_t spacing){fToneSpacing = spacing;};
+        void SetNTones(size_t n){fNTones = n;}; //0 takes every tone below the Nyquist frequency
+        void SetNBuffersToIntegrate(size_t n){fNBuffersToIntegrate = (n == 0) ? 1 : n; fPeriods.Configure(1, fNBuffersToIntegrate);};
+
+        //maximum number of integration periods which may be open at once, beyond this the oldest one is
+        //written out with whatever it has (0 uses one more than the number of threads)
+        void SetNMaxOpenIntegrations(unsigned int n){fNMaxOpenIntegrations = n;};
+
+        uint64_t GetFirstToneFrequency() const {return fFirstToneFrequency;};
+        uint64_t GetToneSpacing() const {return fToneSpacing;};
+        size_t GetNBuffersToIntegrate() const {return fNBuffersToIntegrate;};
+
+        //configure how (and if) buffers are skipped when the monitor cannot keep up
+        HBackPressurePolicy* GetBackPressurePolicy(){return &fBackPressurePolicy;};
+        const HBackPressurePolicy* GetBackPressurePolicy() const {return &fBackPressurePolicy;};
+
+        uint64_t GetNSkippedBuffers() const {return fNSkippedBuffers + fBackPressurePolicy.GetNDropped();};
+        uint64_t GetNProcessedSamples() const {return fNProcessedSamples;};
+        uint64_t GetNRecordsWritten() const {return fNRecordsWritten;};
+        uint64_t GetNPartialRecords() const {return fNPartialRecords;}; //written with part of the period missing
+        uint64_t GetNLateBuffers() const {return fPeriods.GetNLateBuffers();}; //arrived after their period was written, or did not fit it
+        uint64_t GetNMissingSamples() const {return fPeriods.GetNMissingSamples();}; //samples missing from the input stream
+
+        //processing rate in input samples per second (of busy time, per thread)
+        double GetThroughput() const
+        {
+            uint64_t ns = fProcessingTime;
+            if(ns == 0){return 0.0;}
+            return 1e9*( (double) fNProcessedSamples )/( (double) ns );
+        }
+
+    protected:
+
+        //the period bookkeeping is left to the tracker, the tone sums of each open period are kept in an extractor
+        typedef HIntegrationPeriodTracker::HPeriodKey HPhaseCalibrationKey;
+        typedef HIntegrationPeriodTracker::HPeriod HPhaseCalibrationIntegration;
+
+        virtual void ExecuteThreadTask() override
+        {
+            HLinearBuffer< XSampleType >* source = nullptr;
+
+            size_t backlog = this->fBufferPool->GetConsumerPoolSize( this->GetConsumerID() );
+            if(backlog == 0){return;}
+
+            HConsumerBufferPolicyCode source_code = this->fBufferHandler.ReserveBuffer(this->fBufferPool, source, this->GetConsumerID());
+            if( !(source_code & HConsumerBufferPolicyCode::success) || source == nullptr){return;}
+
+            if( fBackPressurePolicy.Accept(backlog) )
+            {
+                //in fan-out mode the source buffer is shared (read-only) with the other consumers, so we don't lock it
+                std::unique_lock<std::mutex> source_lock(source->fMutex, std::defer_lock);
+                if( !this->fBufferPool->IsFanOutEnabled() ){ source_lock.lock(); }
+
+                auto start = std::chrono::steady_clock::now();
+                const HBufferMetaData* meta = source->GetMetaData();
+                size_t n_samples = source->GetArrayDimension(0);
+                HPhaseCalibrationExtractor* work = ClaimWorkspace(meta->GetSampleRate());
+                if(work != nullptr)
+                {
+                    work->Reset();
+                    work->Process(source->GetData(), n_samples, meta->GetLeadingSampleIndex());
+                    AddToIntegration(meta, n_samples, work);
+                    auto elapsed = std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - start );
+                    fProcessingTime += elapsed.count();
+                    fNProcessedSamples += n_samples;
+                    ReturnWorkspace(work);
+                }
+                else
+                {
+                    fNSkippedBuffers++;
+                }
+            }
+
+            this->fBufferHandler.ReleaseBufferToConsumer(this->fBufferPool, source, this->GetNextConsumerID());
+
+            FinishIntegrations();
+        }
+
+        virtual bool WorkPresent() override
+        {
+            return ( this->fBufferPool->GetConsumerPoolSize( this->GetConsumerID() ) != 0 );
+        }
+
+        //add the tone sums of a buffer to its integration period (unless it is late, or does not fit the period)
+        void AddToIntegration(const HBufferMetaData* meta, size_t n_samples, const HPhaseCalibrationExtractor* work)
+        {
+            uint64_t leading_sample_index = meta->GetLeadingSampleIndex();
+            HPhaseCalibrationKey key = fPeriods.GetKey(meta->GetAcquisitionStartSecond(), meta->GetSampleRate(), meta->GetSidebandFlag(),
+                                                       meta->GetPolarizationFlag(), leading_sample_index, n_samples);
+
+            HPhaseCalibrationIntegration* integration = nullptr;
+            if( fPeriods.Claim(key, leading_sample_index, n_samples, fPeriods.GetWorkerIndex(), integration) == nullptr ){return;}
+
+            {
+                std::lock_guard<std::mutex> lock(fIntegrationMutex);
+                auto it = fOpenIntegrations.find(key);
+                if(it == fOpenIntegrations.end())
+                {
+                    HPhaseCalibrationExtractor* sums = new HPhaseCalibrationExtractor();
+                    ConfigureExtractor(sums, meta->GetSampleRate());
+                    sums->Initialize();
+                    it = fOpenIntegrations.insert( std::make_pair(key, sums) ).first;
+                }
+                it->second->Merge(*work);
+            }
+
+            //there is no noise power data for the tones
+            struct HDataAccumulationStruct stat;
+            stat.start_index = leading_sample_index;
+            stat.stop_index = leading_sample_index + n_samples;
+            stat.sum_x = 0.0;
+            stat.sum_x2 = 0.0;
+            stat.count = n_samples;
+            stat.state_flag = H_NOISE_UNKNOWN;
+            fPeriods.Release(integration, 0, n_samples, meta->GetNBlankedSamples(), false, stat);
+        }
+
+        //write out the periods which are ready, in order
+        void FinishIntegrations()
+        {
+            std::lock_guard<std::mutex> finish_lock(fFinishMutex);
+
+            unsigned int n_max_open = fNMaxOpenIntegrations;
+            if(n_max_open == 0){n_max_open = this->GetNThreads() + 1;}
+
+            HPhaseCalibrationKey key;
+            HPhaseCalibrationIntegration integration;
+            HIntegrationPeriodTracker::HPeriodStatus status;
+            while( fPeriods.TakePeriod(n_max_open, false, key, integration, status) )
+            {
+                HPhaseCalibrationExtractor* sums = nullptr;
+                {
+                    std::lock_guard<std::mutex> lock(fIntegrationMutex);
+                    auto it = fOpenIntegrations.find(key);
+                    if(it != fOpenIntegrations.end()){sums = it->second; fOpenIntegrations.erase(it);}
+                }
+
+                if(sums != nullptr && status != HIntegrationPeriodTracker::eDiscarded)
+                {
+                    bool written = WriteRecord(key, integration, sums);
+                    if(written && status == HIntegrationPeriodTracker::ePartial){fNPartialRecords++;}
+                }
+                delete sums;
+                if(status != HIntegrationPeriodTracker::eDiscarded){fPeriods.Recycle(integration);}
+            }
+        }
+
+        bool WriteRecord(const HPhaseCalibrationKey& key, const HPhaseCalibrationIntegration& integration, const HPhaseCalibrationExtractor* sums)
+        {
+            std::stringstream ss;
+            ss << fCurrentOutputDirectory;
+            ss << "/";
+            ss << key.fAcquisitionStartSecond;
+            ss << "_";
+            ss << integration.fLeadingSampleIndex;
+            ss << "_";
+            ss << key.fSidebandFlag;
+            ss << key.fPolarizationFlag;
+            ss << ".pcal";
+
+            std::ofstream out_file;
+            out_file.open(ss.str().c_str(), std::ios::out);
+            if(!out_file.is_open())
+            {
+                std::cout<<"HPhaseCalibrationMonitor::WriteRecord: Error, could not open: "<<ss.str()<<std::endl;
+                return false;
+            }
+
+            std::vector< double > amplitude;
+            std::vector< double > phase;
+            sums->GetTones(amplitude, phase);
+
+            out_file << "experiment_name=" << fExperimentName << std::endl;
+            out_file << "source_name=" << fSourceName << std::endl;
+            out_file << "scan_name=" << fScanName << std::endl;
+            out_file << "acquisition_start_second=" << key.fAcquisitionStartSecond << std::endl;
+            out_file << "leading_sample_index=" << integration.fLeadingSampleIndex << std::endl;
+            out_file << "sample_length=" << sums->GetNSamples() << std::endl;
+            out_file << "sample_rate=" << key.fSampleRate << std::endl;
+            out_file << "sideband=" << key.fSidebandFlag << std::endl;
+            out_file << "polarization=" << key.fPolarizationFlag << std::endl;
+            out_file << "validity_sample_length=" << integration.fBufferSampleLength << std::endl;
+            out_file << "validity_mask=";
+            for(size_t i=0; i<integration.fValidityMask.size(); i++){out_file << (unsigned int) integration.fValidityMask[i];}
+            out_file << std::endl;
+
+            //one line per tone: frequency (Hz), amplitude (digitizer units), phase (degrees, at sample index zero)
+            out_file << "n_tones=" << sums->GetNTones() << std::endl;
+            for(size_t t=0; t<sums->GetNTones(); t++)
+            {
+                out_file << "tone=" << sums->GetToneFrequency(t) << " " << amplitude[t] << " " << phase[t]*180.0/M_PI << std::endl;
+            }
+            out_file.close();
+            fNRecordsWritten++;
+            return true;
+        }
+
+        void ConfigureExtractor(HPhaseCalibrationExtractor* extractor, uint64_t sample_rate)
+        {
+            extractor->SetSampleRate(sample_rate);
+            extractor->SetFirstToneFrequency(fFirstToneFrequency);
+            extractor->SetToneSpacing(fToneSpacing);
+            extractor->SetNTones(fNTones);
+        }
+
+        HPhaseCalibrationExtractor* ClaimWorkspace(uint64_t sample_rate)
+        {
+            std::lock_guard<std::mutex> lock(fWorkspaceMutex);
+            HPhaseCalibrationExtractor* work = nullptr;
+            if(fFreeWorkspaces.size() != 0)
+            {
+                work = fFreeWorkspaces.back();
+                fFreeWorkspaces.pop_back();
+                if(work->GetSampleRate() == sample_rate){return work;}
+            }
+            else
+            {
+                work = new HPhaseCalibrationExtractor();
+                fWorkspaces.push_back(work);
+            }
+
+            //new, or the sample rate has changed
+            ConfigureExtractor(work, sample_rate);
+            if(!work->Initialize())
+            {
+                fFreeWorkspaces.push_back(work);
+                return nullptr;
+            }
+            return work;
+        }
+
+        void ReturnWorkspace(HPhaseCalibrationExtractor* work)
+        {
+            std::lock_guard<std::mutex> lock(fWorkspaceMutex);
+            fFreeWorkspaces.push_back(work);
+        }
+
+        uint64_t fFirstToneFrequency;
+        uint64_t fToneSpacing;
+        size_t fNTones;
+        size_t fNBuffersToIntegrate;
+        unsigned int fNMaxOpenIntegrations;
+
+        std::mutex fWorkspaceMutex;
+        std::vector< HPhaseCalibrationExtractor* > fWorkspaces;
+        std::vector< HPhaseCalibrationExtractor* > fFreeWorkspaces;
+
+        HIntegrationPeriodTracker fPeriods;
+        std::mutex fFinishMutex; //records are written by one thread at a time, in order
+        std::mutex fIntegrationMutex;
+        std::map< HPhaseCalibrationKey, HPhaseCalibrationExtractor* > fOpenIntegrations; //tone sums of the open periods
+
+        HBackPressurePolicy fBackPressurePolicy;
+        std::atomic<uint64_t> fNProcessedSamples;
+        std::atomic<uint64_t> fNSkippedBuffers;
+        std::atomic<uint64_t> fNRecordsWritten;
+        std::atomic<uint64_t> fNPartialRecords;
+        std::atomic<uint64_t> fProcessingTime; //ns
+};
+
+}
+
+#endif /* end of include guard: HPhaseCalibrationMonitor */
@@ -0,0 +1,78 @@
+#ifndef HPowerSpectrumAccumulator_HH__
+#define HPowerSpectrumAccumulator_HH__
+
+#include <complex>
+#include <vector>
+#include <stdint.h>
+
+#include "HArrayWrapper.hh"
+#include "HFastFourierTransform.hh"
+
+namespace hose
+{
+
+/*
+*File: HPowerSpectrumAccumulator.hh
+*Class: HPowerSpectrumAccumulator
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: accumulates the power spectrum (fft_size/2+1 channels) of consecutive frames of real samples on the cpu.
+* Frames are transformed two at a time, as the real and imaginary parts of a single complex FFT, and the two
+* spectra are separated using the symmetry of the transform of a real sequence, which halves the cost.
+* Not thread safe, each thread needs its own accumulator.
+*/
+
+class HPowerSpectrumAccumulator
+{
+    public:
+
+        HPowerSpectrumAccumulator();
+        virtual ~HPowerSpectrumAccumulator();
+
+        void SetFFTSize(size_t n){fFFTSize = n; fInitialized = false;};
+        size_t GetFFTSize() const {return fFFTSize;};
+        size_t GetSpectrumLength() const {return fFFTSize/2 + 1;};
+
+        void SetWindowFunction(int window_flag = 0){fWindowFlag = window_flag; fInitialized = false;}; //0 = none, 1 = blackman_harris, 2 = hann
+
+        //computes the window, and allocates the workspace
+        bool Initialize();
+
+        //zeros the accumulated spectrum
+        void Reset();
+
+        //adds the power spectrum of a frame of fft_size (zero-level subtracted) samples
+        void AddFrame(const float* x);
+
+        //transforms the last frame, if it is still waiting for a partner, must be called before reading the sum
+        void Flush();
+
+        const double* GetPowerSum() const {return &(fPowerSum[0]);};
+        uint64_t GetNSpectra() const {return fNSpectra;};
+
+        //sum of the squares of the window coefficients (fft_size if there is no window), for power normalization
+        double GetWindowSumOfSquares() const {return fWindowSumOfSquares;};
+
+    private:
+
+        void TransformFrames();
+
+        bool fInitialized;
+        size_t fFFTSize;
+        int fWindowFlag;
+
+        std::vector<double> fWindow;
+        double fWindowSumOfSquares;
+        std::vector<double> fPowerSum;
+        uint64_t fNSpectra;
+        bool fHavePendingFrame; //the real part of the workspace holds a frame which has not been transformed
+
+        std::vector< std::complex<double> > fWorkspace;
+        HArrayWrapper< std::complex<double>, 1 > fWorkspaceWrapper;
+        HFastFourierTransform fFFT;
+};
+
+}
+
+#endif /* end of include guard: HPowerSpectrumAccumulator */
@@ -18,6 +18,7 @@ extern "C"
 #include "HConsumer.hh"
 
 #include "HDirectoryWriter.hh"
+#include "HBackPressurePolicy.hh"
 
 namespace hose
 {
@@ -48,6 +49,12 @@ class HRawDataDumper: public HConsumer< XBufferItemType, HConsumerBufferHandler_
         //frequency at which buffers are dumped to disk...1 is every buffer, 2 is every other, etc.
         void SetBufferDumpFrequency(unsigned int buff_freq){fBufferDumpFrequency = buff_freq;};
 
+        //configure how (and if) buffers are skipped when the dumper cannot keep up
+        HBackPressurePolicy* GetBackPressurePolicy(){return &fBackPressurePolicy;};
+        const HBackPressurePolicy* GetBackPressurePolicy() const {return &fBackPressurePolicy;};
+
+        uint64_t GetNSkippedBuffers() const {return fBackPressurePolicy.GetNDropped();};
+
     private:
 
         virtual void ExecuteThreadTask() override
@@ -56,15 +63,23 @@ class HRawDataDumper: public HConsumer< XBufferItemType, HConsumerBufferHandler_
             //if so, then write buffer to raw output file in data directory
             //get a buffer from the buffer handler
             HLinearBuffer< XBufferItemType >* tail = nullptr;
-            if( this->fBufferPool->GetConsumerPoolSize( this->GetConsumerID() ) != 0 )
+            size_t backlog = this->fBufferPool->GetConsumerPoolSize( this->GetConsumerID() );
+            if( backlog != 0 )
             {
                 //grab a buffer to process
                 HConsumerBufferPolicyCode buffer_code = this->fBufferHandler.ReserveBuffer(this->fBufferPool, tail, this->GetConsumerID() );
 
-                if(buffer_code == HConsumerBufferPolicyCode::success && tail != nullptr)
+                if(buffer_code == HConsumerBufferPolicyCode::success && tail != nullptr && !fBackPressurePolicy.Accept(backlog) )
                 {
-                    std::lock_guard<std::mutex> lock( tail->fMutex );
-        
+                    //we are behind, pass the buffer along untouched
+                    this->fBufferHandler.ReleaseBufferToConsumer(this->fBufferPool, tail, this->GetNextConsumerID() );
+                }
+                else if(buffer_code == HConsumerBufferPolicyCode::success && tail != nullptr)
+                {
+                    //in fan-out mode the buffer is shared (read-only) with the other consumers, so we don't lock it
+                    std::unique_lock<std::mutex> lock( tail->fMutex, std::defer_lock );
+                    if( !this->fBufferPool->IsFanOutEnabled() ){ lock.lock(); }
+
                     uint64_t most_recent_sample_index = tail->GetMetaData()->GetLeadingSampleIndex() + tail->GetArraySize();
 
                     if(most_recent_sample_index > fMostRecentSampleIndex)
@@ -121,6 +136,8 @@ class HRawDataDumper: public HConsumer< XBufferItemType, HConsumerBufferHandler_
         unsigned int fBufferCount;
         uint64_t fMostRecentSampleIndex;
 
+        HBackPressurePolicy fBackPressurePolicy;
+
 };
 
 
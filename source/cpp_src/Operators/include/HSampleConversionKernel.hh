@@ -0,0 +1,243 @@
+#ifndef HSampleConversionKernel_HH__
+#define HSampleConversionKernel_HH__
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <stdint.h>
+
+#if defined(__AVX2__) || defined(__AVX512BW__)
+    #include <immintrin.h>
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+namespace hose
+{
+
+/*
+*File: HSampleConversionKernel.hh
+*Class: HSampleConversionKernel
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: first pass of a cpu spectrometer over the digitizer data. 16-bit samples are converted to float,
+* with the zero level (mid-scale of offset binary data) removed, multiplied by the window, and written to the
+* FFT input, while the sum and sum of squares of the samples (the total power statistics) are collected,
+* all in a single pass, rather than one pass each for the conversion, the window and the reduction.
+* The sums are of the un-windowed samples and are exact (integer arithmetic). Any scale factor can be folded
+* into the window. The widest of AVX-512BW, AVX2 or SSE2 which the compiler targets is used, with a plain
+* loop for the remainder (and for strided output). The sums alone (without the conversion) are also available,
+* for stages which only need the power of the samples (e.g. HImpulsiveRFIBlanker).
+*/
+
+class HSampleConversionKernel
+{
+    public:
+
+        //out[i*out_stride] = window[i]*(in[i] - zero), for i in [0, length), the window may be nullptr (no window),
+        //if sum and sum2 are not nullptr the zero-level subtracted samples and their squares are added to them
+        static void ConvertAndWindow(const uint16_t* in, const float* window, float* out, std::size_t length,
+                                     double* sum = nullptr, double* sum2 = nullptr, std::size_t out_stride = 1)
+        {
+            Convert16<true>(in, true, window, out, length, out_stride, sum, sum2);
+        }
+
+        static void ConvertAndWindow(const int16_t* in, const float* window, float* out, std::size_t length,
+                                     double* sum = nullptr, double* sum2 = nullptr, std::size_t out_stride = 1)
+        {
+            Convert16<true>(reinterpret_cast<const uint16_t*>(in), false, window, out, length, out_stride, sum, sum2);
+        }
+
+        //plain loop for any other sample type (the zero level is the mid-scale value of unsigned integer types)
+        template< typename XSampleType >
+        static void ConvertAndWindow(const XSampleType* in, const float* window, float* out, std::size_t length,
+                                     double* sum = nullptr, double* sum2 = nullptr, std::size_t out_stride = 1)
+        {
+            double zero = 0.0;
+            if(!std::numeric_limits< XSampleType >::is_signed && std::numeric_limits< XSampleType >::is_integer)
+            {
+                zero = (double) ( ( (uint64_t) std::numeric_limits< XSampleType >::max() + 1)/2 );
+            }
+            double s = 0.0;
+            double s2 = 0.0;
+            for(std::size_t i=0; i<length; i++)
+            {
+                double x = ( (double) in[i] ) - zero;
+                s += x;
+                s2 += x*x;
+                out[i*out_stride] = (window != nullptr) ? window[i]*( (float) x ) : (float) x;
+            }
+            if(sum != nullptr){*sum += s;}
+            if(sum2 != nullptr){*sum2 += s2;}
+        }
+
+        //the zero-level subtracted samples and their squares are added to sum and sum2, nothing is written
+        static void Moments(const uint16_t* in, std::size_t length, double& sum, double& sum2)
+        {
+            Convert16<false>(in, true, nullptr, nullptr, length, 1, &sum, &sum2);
+        }
+
+        static void Moments(const int16_t* in, std::size_t length, double& sum, double& sum2)
+        {
+            Convert16<false>(reinterpret_cast<const uint16_t*>(in), false, nullptr, nullptr, length, 1, &sum, &sum2);
+        }
+
+        template< typename XSampleType >
+        static void Moments(const XSampleType* in, std::size_t length, double& sum, double& sum2)
+        {
+            double zero = 0.0;
+            if(!std::numeric_limits< XSampleType >::is_signed && std::numeric_limits< XSampleType >::is_integer)
+            {
+                zero = (double) ( ( (uint64_t) std::numeric_limits< XSampleType >::max() + 1)/2 );
+            }
+            double s = 0.0;
+            double s2 = 0.0;
+            for(std::size_t i=0; i<length; i++)
+            {
+                double x = ( (double) in[i] ) - zero;
+                s += x;
+                s2 += x*x;
+            }
+            sum += s;
+            sum2 += s2;
+        }
+
+    private:
+
+        //offset binary (unsigned) samples are converted to two's complement by flipping the top bit, so
+        //both types share the same integer path, the int32 lanes of the sums grow by at most 2^16 per
+        //step, so they are emptied into the 64 bit totals every 2^14 steps, if XConvert is false only the sums are computed
+        template< bool XConvert >
+        static void Convert16(const uint16_t* in, bool offset_binary, const float* window, float* out, std::size_t length,
+                              std::size_t out_stride, double* sum, double* sum2)
+        {
+            int64_t isum = 0;
+            uint64_t isum2 = 0;
+            std::size_t i = 0;
+
+            if(out_stride == 1)
+            {
+                #if defined(__AVX512BW__)
+                const __m512i flip = _mm512_set1_epi16( offset_binary ? (short) 0x8000 : 0 );
+                const __m512i ones = _mm512_set1_epi16(1);
+                const __m512i zero = _mm512_setzero_si512();
+                while(i+32 <= length)
+                {
+                    std::size_t stop = std::min(length - length%32, i + 32*16384);
+                    __m512i s = _mm512_setzero_si512();
+                    __m512i s2 = _mm512_setzero_si512();
+                    for(; i<stop; i += 32)
+                    {
+                        __m512i x = _mm512_xor_si512( _mm512_loadu_si512( reinterpret_cast<const void*>(in + i) ), flip);
+                        s = _mm512_add_epi32(s, _mm512_madd_epi16(x, ones) );
+                        __m512i x2 = _mm512_madd_epi16(x, x);
+                        s2 = _mm512_add_epi64(s2, _mm512_unpacklo_epi32(x2, zero) );
+                        s2 = _mm512_add_epi64(s2, _mm512_unpackhi_epi32(x2, zero) );
+                        if(!XConvert){continue;}
+                        __m512 lo = _mm512_cvtepi32_ps( _mm512_cvtepi16_epi32( _mm512_castsi512_si256(x) ) );
+                        __m512 hi = _mm512_cvtepi32_ps( _mm512_cvtepi16_epi32( _mm512_extracti64x4_epi64(x, 1) ) );
+                        if(window != nullptr)
+                        {
+                            lo = _mm512_mul_ps(lo, _mm512_loadu_ps(window + i) );
+                            hi = _mm512_mul_ps(hi, _mm512_loadu_ps(window + i + 16) );
+                        }
+                        _mm512_storeu_ps(out + i, lo);
+                        _mm512_storeu_ps(out + i + 16, hi);
+                    }
+                    int32_t ps[16];
+                    uint64_t ps2[8];
+                    _mm512_storeu_si512( reinterpret_cast<void*>(ps), s);
+                    _mm512_storeu_si512( reinterpret_cast<void*>(ps2), s2);
+                    for(unsigned int j=0; j<16; j++){isum += ps[j];}
+                    for(unsigned int j=0; j<8; j++){isum2 += ps2[j];}
+                }
+                #elif defined(__AVX2__)
+                const __m256i flip = _mm256_set1_epi16( offset_binary ? (short) 0x8000 : 0 );
+                const __m256i ones = _mm256_set1_epi16(1);
+                const __m256i zero = _mm256_setzero_si256();
+                while(i+16 <= length)
+                {
+                    std::size_t stop = std::min(length - length%16, i + 16*16384);
+                    __m256i s = _mm256_setzero_si256();
+                    __m256i s2 = _mm256_setzero_si256();
+                    for(; i<stop; i += 16)
+                    {
+                        __m256i x = _mm256_xor_si256( _mm256_loadu_si256( reinterpret_cast<const __m256i*>(in + i) ), flip);
+                        s = _mm256_add_epi32(s, _mm256_madd_epi16(x, ones) );
+                        __m256i x2 = _mm256_madd_epi16(x, x);
+                        s2 = _mm256_add_epi64(s2, _mm256_unpacklo_epi32(x2, zero) );
+                        s2 = _mm256_add_epi64(s2, _mm256_unpackhi_epi32(x2, zero) );
+                        if(!XConvert){continue;}
+                        __m256 lo = _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32( _mm256_castsi256_si128(x) ) );
+                        __m256 hi = _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32( _mm256_extracti128_si256(x, 1) ) );
+                        if(window != nullptr)
+                        {
+                            lo = _mm256_mul_ps(lo, _mm256_loadu_ps(window + i) );
+                            hi = _mm256_mul_ps(hi, _mm256_loadu_ps(window + i + 8) );
+                        }
+                        _mm256_storeu_ps(out + i, lo);
+                        _mm256_storeu_ps(out + i + 8, hi);
+                    }
+                    int32_t ps[8];
+                    uint64_t ps2[4];
+                    _mm256_storeu_si256( reinterpret_cast<__m256i*>(ps), s);
+                    _mm256_storeu_si256( reinterpret_cast<__m256i*>(ps2), s2);
+                    for(unsigned int j=0; j<8; j++){isum += ps[j];}
+                    for(unsigned int j=0; j<4; j++){isum2 += ps2[j];}
+                }
+                #elif defined(__SSE2__)
+                const __m128i flip = _mm_set1_epi16( offset_binary ? (short) 0x8000 : 0 );
+                const __m128i ones = _mm_set1_epi16(1);
+                const __m128i zero = _mm_setzero_si128();
+                while(i+8 <= length)
+                {
+                    std::size_t stop = std::min(length - length%8, i + 8*16384);
+                    __m128i s = _mm_setzero_si128();
+                    __m128i s2 = _mm_setzero_si128();
+                    for(; i<stop; i += 8)
+                    {
+                        __m128i x = _mm_xor_si128( _mm_loadu_si128( reinterpret_cast<const __m128i*>(in + i) ), flip);
+                        s = _mm_add_epi32(s, _mm_madd_epi16(x, ones) );
+                        __m128i x2 = _mm_madd_epi16(x, x);
+                        s2 = _mm_add_epi64(s2, _mm_unpacklo_epi32(x2, zero) );
+                        s2 = _mm_add_epi64(s2, _mm_unpackhi_epi32(x2, zero) );
+                        if(!XConvert){continue;}
+                        //sign extend to int32 (no SSE4.1), by placing each sample in the top half and shifting back down
+                        __m128 lo = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16(x, x), 16) );
+                        __m128 hi = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpackhi_epi16(x, x), 16) );
+                        if(window != nullptr)
+                        {
+                            lo = _mm_mul_ps(lo, _mm_loadu_ps(window + i) );
+                            hi = _mm_mul_ps(hi, _mm_loadu_ps(window + i + 4) );
+                        }
+                        _mm_storeu_ps(out + i, lo);
+                        _mm_storeu_ps(out + i + 4, hi);
+                    }
+                    int32_t ps[4];
+                    uint64_t ps2[2];
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>(ps), s);
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>(ps2), s2);
+                    isum += (int64_t) ps[0] + ps[1] + ps[2] + ps[3];
+                    isum2 += ps2[0] + ps2[1];
+                }
+                #endif
+            }
+
+            const uint16_t mask = offset_binary ? 0x8000 : 0;
+            for(; i<length; i++)
+            {
+                int32_t x = (int16_t) (in[i] ^ mask);
+                isum += x;
+                isum2 += (uint64_t) ( (int64_t) x*x );
+                if(XConvert){out[i*out_stride] = (window != nullptr) ? window[i]*( (float) x ) : (float) x;}
+            }
+
+            if(sum != nullptr){*sum += isum;}
+            if(sum2 != nullptr){*sum2 += isum2;}
+        }
+};
+
+}
+
+#endif /* end of include guard: HSampleConversionKernel */
@@ -0,0 +1,61 @@
+#ifndef HSpectralKurtosisFlagger_HH__
+#define HSpectralKurtosisFlagger_HH__
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+
+#include "HLinearBuffer.hh"
+#include "HBufferPool.hh"
+#include "HConsumer.hh"
+
+namespace hose
+{
+
+/*
+*File: HSpectralKurtosisFlagger.hh
+*Class: HSpectralKurtosisFlagger
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: flags RFI in averaged spectra using the spectral kurtosis estimator (Nita & Gary 2010),
+* SK = (M+1)/(M-1) * ( M*S2/(S1*S1) - 1 ), where S1 and S2 are the sums of |X|^2 and |X|^4 over the
+* M spectra in each channel. For Gaussian noise SK is 1 with a variance of 4M^2/((M-1)(M+2)(M+3)),
+* so channels which deviate by more than the threshold (in standard deviations) are flagged.
+* Expects buffers as produced by the spectrum averager with spectral kurtosis enabled (the average
+* power spectrum followed by the average |X|^4 spectrum); the per-channel mask is stored in the buffer
+* meta data and the buffer is then passed on to the next consumer (i.e. the writer) unchanged.
+*/
+
+class HSpectralKurtosisFlagger: public HConsumer< float, HConsumerBufferHandler_Immediate< float > >
+{
+    public:
+
+        HSpectralKurtosisFlagger();
+        virtual ~HSpectralKurtosisFlagger();
+
+        void SetThresholdSigma(double n_sigma){fThresholdSigma = n_sigma;};
+        double GetThresholdSigma() const {return fThresholdSigma;};
+
+        //computes the mask for one spectrum, power and power2 are the |X|^2 and |X|^4 spectra, each summed over
+        //n_spectra/n_buffers spectra and then averaged over n_buffers, returns the number of channels flagged
+        size_t FlagSpectrum(const float* power, const float* power2, size_t length, uint64_t n_spectra, uint64_t n_buffers, std::vector< uint8_t >& mask) const;
+
+        uint64_t GetNSpectraFlagged() const {return fNSpectraFlagged;}; //spectra with at least one flagged channel
+        uint64_t GetNChannelsFlagged() const {return fNChannelsFlagged;};
+
+    protected:
+
+        virtual void ExecuteThreadTask() override;
+        virtual bool WorkPresent() override;
+        virtual void Idle() override;
+
+        double fThresholdSigma;
+
+        std::atomic<uint64_t> fNSpectraFlagged;
+        std::atomic<uint64_t> fNChannelsFlagged;
+};
+
+}
+
+#endif /* end of include guard: HSpectralKurtosisFlagger */
@@ -1,6 +1,12 @@
 #ifndef HSpectrometerCUDA_HH__
 #define HSpectrometerCUDA_HH__
 
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
 #include "HConsumerProducer.hh"
 #include "spectrometer.h"
 
@@ -14,22 +20,48 @@ namespace hose
 *Email: barrettj@mit.edu
 *Date:
 *Description: signed short int version
+* If the spectrometer data is allocated with an overlap factor > 1, the frames overlap, and the last
+* (spectrum_length - hop) samples of each buffer are kept so the frames spanning the boundary with the next
+* buffer can be formed. Buffers may be processed out of order by different threads, so the tail is only
+* used if it has already been stored when the next buffer is processed, otherwise those frames are skipped.
 */
 
 class HSpectrometerCUDA: public HConsumerProducer< SAMPLE_TYPE, spectrometer_data, HConsumerBufferHandler_Immediate< SAMPLE_TYPE >, HProducerBufferHandler_Steal< spectrometer_data > >
 {
 
     public:
-        HSpectrometerCUDA(size_t spectrum_length, size_t n_averages);  //spec size and averages are fixed at constuction time
+        HSpectrometerCUDA(size_t spectrum_length, size_t n_averages);
         virtual ~HSpectrometerCUDA();
 
+        //change the spec size and averages, only while the threads are stopped (the sink buffers must
+        //be re-allocated to match), any buffer tails kept for overlapping frames are discarded
+        void Reconfigure(size_t spectrum_length, size_t n_averages);
+        size_t GetSpectrumLength() const {return fSpectrumLength;};
+        size_t GetNAverages() const {return fNAverages;};
+
+        //also accumulate the sum of |X|^4 in each channel (needed for spectral kurtosis RFI flagging)
+        void EnableSpectralKurtosis(){fEnableSpectralKurtosis = true;};
+        void DisableSpectralKurtosis(){fEnableSpectralKurtosis = false;};
+
+        //number of buffers for which the tail of the preceding buffer was not available (overlap mode only)
+        uint64_t GetNMissingTails() const {return fNMissingTails;};
+
     protected:
 
         virtual void ExecuteThreadTask() override;
         virtual bool WorkPresent() override;
 
+        //keep the end of this buffer for the next one, and retrieve the end of the previous one (if it is there)
+        bool ExchangeTail(HLinearBuffer< SAMPLE_TYPE >* source, size_t tail_length, std::vector< SAMPLE_TYPE >& previous_tail);
+
         size_t fSpectrumLength;
         size_t fNAverages;
+        bool fEnableSpectralKurtosis;
+
+        //buffer tails, keyed by (acquisition start second, index of the sample which follows the tail)
+        std::mutex fTailMutex;
+        std::map< std::pair<uint64_t, uint64_t>, std::vector< SAMPLE_TYPE > > fTails;
+        std::atomic<uint64_t> fNMissingTails;
 
 };
 
@@ -0,0 +1,147 @@
+#ifndef HSpectrumAccumulationKernel_HH__
+#define HSpectrumAccumulationKernel_HH__
+
+#include <cstddef>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+namespace hose
+{
+
+/*
+*File: HSpectrumAccumulationKernel.hh
+*Class: HSpectrumAccumulationKernel
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: inner loops of the spectrum averager. Power spectra (float) are summed into a double
+* precision accumulator, so that long integrations do not lose precision, and the power in a band of
+* bins is collected in the same pass over the data. Normalization of the sum, conversion back to float
+* and the (optional) rebinning for the monitoring spectrum are likewise done in a single pass.
+* An SSE2 version is used when it is available (always the case on x86_64), with a plain loop otherwise.
+*/
+
+class HSpectrumAccumulationKernel
+{
+    public:
+
+        //sum += in, returns the sum of in[band_low, band_high)
+        static double AccumulateWithBandPower(const float* in, double* sum, std::size_t length, std::size_t band_low, std::size_t band_high)
+        {
+            if(band_high > length){band_high = length;}
+            if(band_low > band_high){band_low = band_high;}
+
+            //the band is handled as a separate stretch of the same loop, to keep the loops branch free
+            double band_power = 0.0;
+            Accumulate(in, sum, band_low, nullptr);
+            Accumulate(in + band_low, sum + band_low, band_high - band_low, &band_power);
+            Accumulate(in + band_high, sum + band_high, length - band_high, nullptr);
+            return band_power;
+        }
+
+        //sum += in (used to merge partial sums)
+        static void Merge(const double* in, double* sum, std::size_t length)
+        {
+            std::size_t i = 0;
+            #if defined(__SSE2__)
+            for(; i+4 <= length; i += 4)
+            {
+                _mm_storeu_pd(sum + i, _mm_add_pd( _mm_loadu_pd(sum + i), _mm_loadu_pd(in + i) ) );
+                _mm_storeu_pd(sum + i + 2, _mm_add_pd( _mm_loadu_pd(sum + i + 2), _mm_loadu_pd(in + i + 2) ) );
+            }
+            #endif
+            for(; i<length; i++){sum[i] += in[i];}
+        }
+
+        //out = scale*sum, and if rebinned is not null, rebinned[i/bin_factor] += out[i] (for i/bin_factor < n_bins)
+        static void Normalize(const double* sum, double scale, float* out, std::size_t length,
+                              float* rebinned = nullptr, std::size_t bin_factor = 1, std::size_t n_bins = 0)
+        {
+            if(rebinned == nullptr || bin_factor == 0)
+            {
+                Scale(sum, scale, out, length, nullptr);
+                return;
+            }
+
+            for(std::size_t b=0; b<n_bins; b++)
+            {
+                std::size_t start = b*bin_factor;
+                if(start >= length){break;}
+                std::size_t n = (start + bin_factor <= length) ? bin_factor : length - start;
+                double bin_sum = 0.0;
+                Scale(sum + start, scale, out + start, n, &bin_sum);
+                rebinned[b] += bin_sum;
+            }
+
+            //anything past the last bin of the summary is only normalized
+            std::size_t done = n_bins*bin_factor;
+            if(done < length){Scale(sum + done, scale, out + done, length - done, nullptr);}
+        }
+
+    private:
+
+        static void Accumulate(const float* in, double* sum, std::size_t length, double* total)
+        {
+            std::size_t i = 0;
+            #if defined(__SSE2__)
+            __m128d t0 = _mm_setzero_pd();
+            __m128d t1 = _mm_setzero_pd();
+            for(; i+4 <= length; i += 4)
+            {
+                __m128 x = _mm_loadu_ps(in + i);
+                __m128d lo = _mm_cvtps_pd(x);
+                __m128d hi = _mm_cvtps_pd( _mm_movehl_ps(x, x) );
+                _mm_storeu_pd(sum + i, _mm_add_pd( _mm_loadu_pd(sum + i), lo) );
+                _mm_storeu_pd(sum + i + 2, _mm_add_pd( _mm_loadu_pd(sum + i + 2), hi) );
+                t0 = _mm_add_pd(t0, lo);
+                t1 = _mm_add_pd(t1, hi);
+            }
+            double partial[2];
+            _mm_storeu_pd(partial, _mm_add_pd(t0, t1));
+            double tail = partial[0] + partial[1];
+            #else
+            double tail = 0.0;
+            #endif
+            for(; i<length; i++)
+            {
+                sum[i] += in[i];
+                tail += in[i];
+            }
+            if(total != nullptr){*total += tail;}
+        }
+
+        static void Scale(const double* sum, double scale, float* out, std::size_t length, double* total)
+        {
+            std::size_t i = 0;
+            #if defined(__SSE2__)
+            __m128d s = _mm_set1_pd(scale);
+            __m128d t = _mm_setzero_pd();
+            for(; i+4 <= length; i += 4)
+            {
+                __m128d lo = _mm_mul_pd( _mm_loadu_pd(sum + i), s);
+                __m128d hi = _mm_mul_pd( _mm_loadu_pd(sum + i + 2), s);
+                _mm_storeu_ps(out + i, _mm_movelh_ps( _mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi) ) );
+                t = _mm_add_pd(t, _mm_add_pd(lo, hi));
+            }
+            double partial[2];
+            _mm_storeu_pd(partial, t);
+            double tail = partial[0] + partial[1];
+            #else
+            double tail = 0.0;
+            #endif
+            for(; i<length; i++)
+            {
+                double x = scale*sum[i];
+                out[i] = x;
+                tail += x;
+            }
+            if(total != nullptr){*total += tail;}
+        }
+
+};
+
+}
+
+#endif /* end of include guard: HSpectrumAccumulationKernel */
@@ -1,7 +1,13 @@
 #ifndef HSpectrumAverager_HH__
 #define HSpectrumAverager_HH__
 
+#include <atomic>
+#include <mutex>
+#include <vector>
+
 #include "HConsumerProducer.hh"
+#include "HSpectrumAccumulationKernel.hh"
+#include "HIntegrationPeriodTracker.hh"
 
 #include "spectrometer.h"
 
@@ -31,7 +37,17 @@ namespace hose
 *Author: J. Barrett
 *Email: barrettj@mit.edu
 *Date:
-*Description: This operator must be single threaded!!!
+*Description: Averages n_buffers consecutive spectrometer buffers together. The integration periods are
+* fixed by the sample index, so buffers may be processed by any number of threads and in any order (the
+* bookkeeping is done by HIntegrationPeriodTracker). Each thread adds its buffers into its own partial sum
+* for the period, and once a period is complete the partial sums are merged and the averages are handed on
+* strictly in order. The sums are kept in double precision.
+* Buffers which are missing from a period are flagged in the validity mask of the output meta data, and
+* incomplete averages may be flushed with their actual number of spectra/samples instead of discarded.
+* If spectral kurtosis is enabled, the sum of |X|^4 delivered by the spectrometer is averaged in the same way,
+* and written after the power spectrum (so the output buffers must be 2*spectrum_length long).
+* Samples zeroed by the time-domain RFI blanker are accounted for by scaling the average up by the
+* fraction of the samples which were kept.
 */
 
 class HSpectrumAverager: public HConsumerProducer< spectrometer_data, float, HConsumerBufferHandler_WaitWithTimeout< spectrometer_data >, HProducerBufferHandler_Immediate< float > >
@@ -39,18 +55,22 @@ class HSpectrumAverager: public HConsumerProducer< spectrometer_data, float, HCo
 
     public:
 
-        //spec size and averages are fixed at constuction time
+        //spec size and averages are set at constuction time (but see Reconfigure)
         HSpectrumAverager(size_t spectrum_length, size_t n_buffers);
 
-        //for better or worse, the spectrum averager is the best place to insert the 
+        //for better or worse, the spectrum averager is the best place to insert the
         //code to handle the noise-power UDP unicast messaging. So we add some options to
         //configure the the IP/port here (fixed at construction time)
         HSpectrumAverager(size_t spectrum_length, size_t n_buffers,
                           std::string noise_port, std::string noise_ip,
-                          std::string spec_port, std::string spec_ip); 
+                          std::string spec_port, std::string spec_ip);
 
         virtual ~HSpectrumAverager();
 
+        //change the spec size and averages, only while the threads are stopped, any averages which are still
+        //open are finished first (written out or discarded as configured, so the sink pool must still be drained)
+        void Reconfigure(size_t spectrum_length, size_t n_buffers);
+
         void EnableNoisePowerUDPMessages(){fEnableNoiseUDP = true;};
         void DisableNoisePowerUDPMessages(){fEnableNoiseUDP = false;};
 
@@ -62,34 +82,50 @@ class HSpectrumAverager: public HConsumerProducer< spectrometer_data, float, HCo
         void SetSpectralPowerLowerBound(size_t lower_bound){fSpecLowerBound = lower_bound;};
         void SetSpectralPowerUpperBound(size_t upper_bound){fSpecUpperBound = upper_bound;};
 
+        //number of averages lost because no output buffer was available (the writer is falling behind)
+        uint64_t GetNDroppedAverages() const {return fNDroppedAverages;};
+
+        //write out incomplete averages (end of a recording, or data missing at the end of the period)
+        //rather than throwing away the integration time which was collected
+        void EnablePartialAverageFlush(){fPeriods.EnablePartialFlush();};
+        void DisablePartialAverageFlush(){fPeriods.DisablePartialFlush();};
+
+        //time without any new data after which an incomplete average is flushed (or discarded), 0 waits forever
+        void SetPartialAverageTimeoutMilliseconds(unsigned int ms){fPeriods.SetTimeoutMilliseconds(ms);};
+
+        //maximum number of integration periods which may be open at once, beyond this the oldest one is
+        //finished with whatever it has (0 uses one more than the number of threads)
+        void SetNMaxOpenAverages(unsigned int n){fNMaxOpenAverages = n;};
+
+        //also average the |X|^4 spectrum (if the spectrometer provides it), for spectral kurtosis estimation
+        void EnableSpectralKurtosis(){fEnableSpectralKurtosis = true; fPeriods.EnableFourthMoment();};
+        void DisableSpectralKurtosis(){fEnableSpectralKurtosis = false; fPeriods.DisableFourthMoment();};
+
+        uint64_t GetNPartialAverages() const {return fNPartialAverages;}; //incomplete averages written
+        uint64_t GetNDiscardedAverages() const {return fPeriods.GetNDiscardedPeriods();}; //incomplete averages thrown away
+        uint64_t GetNMissingSamples() const {return fPeriods.GetNMissingSamples();}; //samples missing from the input stream
+        uint64_t GetNLateBuffers() const {return fPeriods.GetNLateBuffers();}; //buffers which arrived after their average was finished
+
     protected:
 
+        typedef HIntegrationPeriodTracker::HPeriodKey HAverageKey;
+        typedef HIntegrationPeriodTracker::HPeriod HAverage;
+
         virtual void ExecuteThreadTask() override;
         virtual bool WorkPresent() override;
 
-        //break work into manageable chunks
-        bool CheckMetaData(char sideband_flag, char pol_flag, uint64_t start_second, uint64_t sample_rate, uint64_t leading_sample_index) const;
-        void Accumulate(float* array);
-        bool WriteAccumulatedSpectrumAverage();
-        void Reset();
+        void FinishAverages();
+        bool WriteAccumulatedSpectrumAverage(const HAverageKey& key, HAverage& average);
 
         size_t fPowerSpectrumLength;
         size_t fNBuffersToAccumulate; //number of buffers to be averaged (independent of any pre-averaging done)
 
-        //workspace for the accumulated data:
-        size_t fNBuffersAccumulated;
-        char fSidebandFlag;
-        char fPolarizationFlag;
-        uint64_t fAcquisitionStartSecond;
-        uint64_t fLeadingSampleIndex;
-        uint64_t fNTotalSpectrum;
-        uint64_t fNTotalSamplesAccumulated;
-        uint64_t fSampleRate;
-        std::vector<float> fAccumulatedSpectrum;
-        HLinearBuffer< float >* fAccumulationBuffer;
-
-        //to collect the noise power info
-        HDataAccumulationContainer fNoisePowerAccumulator;
+        //open integration periods and their partial sums
+        HIntegrationPeriodTracker fPeriods;
+
+        //averages are finished by one thread at a time, so that they leave in order
+        std::mutex fFinishMutex;
+        bool fFinishAll; //finish every open average, complete or not (when reconfiguring)
 
     private:
 
@@ -102,16 +138,22 @@ class HSpectrumAverager: public HConsumerProducer< spectrometer_data, float, HCo
         std::string fSpectrumPort;
         std::string fSpectrumIPAddress;
 
-        //accumulation of spectral bins 
-        double fSpectralPowerSum;
+        //accumulation of spectral bins
         size_t fSpecLowerBound;
         size_t fSpecUpperBound;
 
+        std::atomic<uint64_t> fNDroppedAverages;
+        bool fEnableSpectralKurtosis;
+
+        //handling of incomplete averages
+        unsigned int fNMaxOpenAverages;
+        std::atomic<uint64_t> fNPartialAverages;
+
 
         #ifdef HOSE_USE_ZEROMQ
             zmq::context_t* fNoiseContext;
             zmq::socket_t* fNoisePublisher;
-            void SendNoisePowerUDPPacket(const uint64_t& start_sec, const uint64_t& leading_sample_index, const uint64_t& sample_rate, const struct HDataAccumulationStruct& stat);
+            void SendNoisePowerUDPPacket(const uint64_t& start_sec, const uint64_t& leading_sample_index, const uint64_t& sample_rate, const struct HDataAccumulationStruct& stat, double spectral_power_sum);
         #endif
 
         #ifdef ENABLE_SPECTRUM_UDP
@@ -119,7 +161,7 @@ class HSpectrumAverager: public HConsumerProducer< spectrometer_data, float, HCo
             zmq::context_t* fSpectrumContext;
             zmq::socket_t* fSpectrumPublisher;
             float fRebinnedSpectrum[NBINS];
-        #endif 
+        #endif
 
 
 };
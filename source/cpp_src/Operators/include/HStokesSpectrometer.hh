@@ -0,0 +1,351 @@
+#ifndef HStokesSpectrometer_HH__
+#define HStokesSpectrometer_HH__
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+#include "HLinearBuffer.hh"
+#include "HBufferPool.hh"
+#include "HConsumerProducer.hh"
+#include "HBackPressurePolicy.hh"
+#include "HSampleConversionKernel.hh"
+#include "HStokesSpectrumAccumulator.hh"
+#include "HIntegrationPeriodTracker.hh"
+
+namespace hose
+{
+
+/*
+*File: HStokesSpectrometer.hh
+*Class: HStokesSpectrometer
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: CPU spectrometer for dual-input (e.g. dual polarization) digitizer buffers, which hold the samples of
+* the two channels interleaved in blocks of n samples (n = 1 for alternating samples), with the sample indices in the
+* meta data counting the samples of one channel. Both channels are separated and transformed in a single pass over
+* the buffer (see HStokesSpectrumAccumulator), and the auto and cross spectra are averaged over n_buffers consecutive
+* buffers (integration periods are fixed by the sample index, so the buffers may be processed by any number of
+* threads and in any order). Each average is written out as the four Stokes spectra I, Q, U, V one after the other
+* (4*(fft_size/2+1) values), with the length of one of them as the power spectrum length in the meta data.
+* The periods are tracked as in the spectrum averager (see HIntegrationPeriodTracker): buffers which are missing from a
+* period are flagged in the validity mask, incomplete periods are written out once a later acquisition starts or too
+* many later periods are open, and buffers which arrive after their period has been written out, or which do not fit
+* it, are not used. The digitizer buffers are not modified, and are passed on to the next consumer, they may be
+* skipped according to the back-pressure policy.
+*/
+
+template< typename XSampleType >
+class HStokesSpectrometer: public HConsumerProducer< XSampleType, float, HConsumerBufferHandler_Immediate< XSampleType >, HProducerBufferHandler_Immediate< float > >
+{
+
+    public:
+        HStokesSpectrometer():
+            fFFTSize(4096),
+            fWindowFlag(0),
+            fInterleaveBlockSize(1),
+            fNBuffersToAverage(1),
+            fNMaxOpenAverages(0),
+            fPeriods(4*(4096/2+1), 1),
+            fNProcessedSamples(0),
+            fNSkippedBuffers(0),
+            fNDroppedAverages(0),
+            fNPartialAverages(0),
+            fProcessingTime(0)
+        {
+            //incomplete periods are written out, with the missing buffers flagged
+            fPeriods.EnablePartialFlush();
+        };
+
+        virtual ~HStokesSpectrometer()
+        {
+            for(size_t i=0; i<fWorkspaces.size(); i++){delete fWorkspaces[i];}
+        };
+
+        //configuration, must be set before the threads are started
+        void SetFFTSize(size_t n){fFFTSize = n; fPeriods.Configure(4*GetSpectrumLength(), fNBuffersToAverage);};
+        void SetWindowFunction(int window_flag = 0){fWindowFlag = window_flag;}; //0 = none, 1 = blackman_harris, 2 = hann
+        void SetInterleaveBlockSize(size_t n){fInterleaveBlockSize = (n == 0) ? 1 : n;}; //must divide the fft size
+        void SetNBuffersToAverage(size_t n){fNBuffersToAverage = (n == 0) ? 1 : n; fPeriods.Configure(4*GetSpectrumLength(), fNBuffersToAverage);};
+
+        //maximum number of integration periods which may be open at once, beyond this the oldest one is
+        //written out with whatever it has (0 uses one more than the number of threads)
+        void SetNMaxOpenAverages(unsigned int n){fNMaxOpenAverages = n;};
+
+        size_t GetFFTSize() const {return fFFTSize;};
+        size_t GetSpectrumLength() const {return fFFTSize/2 + 1;};
+        size_t GetInterleaveBlockSize() const {return fInterleaveBlockSize;};
+        size_t GetNBuffersToAverage() const {return fNBuffersToAverage;};
+
+        //configure how (and if) buffers are skipped when the spectrometer cannot keep up
+        HBackPressurePolicy* GetBackPressurePolicy(){return &fBackPressurePolicy;};
+        const HBackPressurePolicy* GetBackPressurePolicy() const {return &fBackPressurePolicy;};
+
+        uint64_t GetNSkippedBuffers() const {return fNSkippedBuffers + fBackPressurePolicy.GetNDropped();};
+        uint64_t GetNProcessedSamples() const {return fNProcessedSamples;};
+        uint64_t GetNDroppedAverages() const {return fNDroppedAverages;}; //no output buffer was available
+        uint64_t GetNPartialAverages() const {return fNPartialAverages;}; //written with part of the period missing
+        uint64_t GetNLateBuffers() const {return fPeriods.GetNLateBuffers();}; //arrived after their period was written, or did not fit it
+        uint64_t GetNMissingSamples() const {return fPeriods.GetNMissingSamples();}; //samples (per channel) missing from the input stream
+
+        //processing rate in input samples (both channels) per second (of busy time, per thread)
+        double GetThroughput() const
+        {
+            uint64_t ns = fProcessingTime;
+            if(ns == 0){return 0.0;}
+            return 1e9*( (double) fNProcessedSamples )/( (double) ns );
+        }
+
+    protected:
+
+        //per-thread de-interleaved frames and the spectrum accumulator
+        struct HStokesWorkspace
+        {
+            std::vector<float> fX;
+            std::vector<float> fY;
+            HStokesSpectrumAccumulator fAccumulator;
+        };
+
+        //the sums of an integration period are the auto spectra followed by the real and imaginary cross spectrum
+        typedef HIntegrationPeriodTracker::HPeriodKey HStokesAverageKey;
+        typedef HIntegrationPeriodTracker::HPeriod HStokesAverage;
+
+        virtual void ExecuteThreadTask() override
+        {
+            HLinearBuffer< XSampleType >* source = nullptr;
+
+            size_t backlog = this->fSourceBufferPool->GetConsumerPoolSize( this->GetConsumerID() );
+            if(backlog == 0){return;}
+
+            HConsumerBufferPolicyCode source_code = this->fSourceBufferHandler.ReserveBuffer(this->fSourceBufferPool, source, this->GetConsumerID());
+            if( !(source_code & HConsumerBufferPolicyCode::success) || source == nullptr){return;}
+
+            if( fBackPressurePolicy.Accept(backlog) )
+            {
+                //in fan-out mode the source buffer is shared (read-only) with the other consumers, so we don't lock it
+                std::unique_lock<std::mutex> source_lock(source->fMutex, std::defer_lock);
+                if( !this->fSourceBufferPool->IsFanOutEnabled() ){ source_lock.lock(); }
+
+                auto start = std::chrono::steady_clock::now();
+                size_t n_samples = source->GetArrayDimension(0);
+                HStokesWorkspace* work = ClaimWorkspace();
+                if(work != nullptr && Process(source->GetData(), n_samples, work) )
+                {
+                    AddToAverage(source->GetMetaData(), n_samples, work);
+                    auto elapsed = std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - start );
+                    fProcessingTime += elapsed.count();
+                    fNProcessedSamples += n_samples;
+                }
+                else
+                {
+                    fNSkippedBuffers++;
+                }
+                ReturnWorkspace(work);
+            }
+
+            this->fSourceBufferHandler.ReleaseBufferToConsumer(this->fSourceBufferPool, source, this->GetNextConsumerID());
+
+            FinishAverages();
+        }
+
+        virtual bool WorkPresent() override
+        {
+            return ( this->fSourceBufferPool->GetConsumerPoolSize( this->GetConsumerID() ) != 0 );
+        }
+
+        //one pass over the buffer, each pair of frames is separated into the two channels and transformed
+        bool Process(const XSampleType* data, size_t n_samples, HStokesWorkspace* work)
+        {
+            size_t n = fFFTSize;
+            size_t b = fInterleaveBlockSize;
+            size_t n_frames = n_samples/(2*n);
+            if(n_frames == 0){return false;}
+
+            work->fAccumulator.Reset();
+            float* x = &(work->fX[0]);
+            float* y = &(work->fY[0]);
+            for(size_t f=0; f<n_frames; f++)
+            {
+                const XSampleType* in = data + 2*n*f;
+                for(size_t m=0; m<n; m += b)
+                {
+                    HSampleConversionKernel::ConvertAndWindow(in + 2*m, nullptr, x + m, b);
+                    HSampleConversionKernel::ConvertAndWindow(in + 2*m + b, nullptr, y + m, b);
+                }
+                work->fAccumulator.AddFrame(x, y);
+            }
+            return true;
+        }
+
+        //add the spectra of a buffer to its integration period (unless it is late, or does not fit the period)
+        void AddToAverage(const HBufferMetaData* meta, size_t n_samples, HStokesWorkspace* work)
+        {
+            size_t length = GetSpectrumLength();
+            uint64_t n_channel_samples = n_samples/2; //the sample index counts the samples of one channel
+            uint64_t leading_sample_index = meta->GetLeadingSampleIndex();
+            HStokesAverageKey key = fPeriods.GetKey(meta->GetAcquisitionStartSecond(), meta->GetSampleRate(), meta->GetSidebandFlag(),
+                                                    meta->GetPolarizationFlag(), leading_sample_index, n_channel_samples);
+
+            HStokesAverage* average = nullptr;
+            double* sums = fPeriods.Claim(key, leading_sample_index, n_channel_samples, fPeriods.GetWorkerIndex(), average);
+            if(sums == nullptr){return;}
+
+            const double* xx = work->fAccumulator.GetXXSum();
+            const double* yy = work->fAccumulator.GetYYSum();
+            const std::complex<double>* xy = work->fAccumulator.GetXYSum();
+            for(size_t k=0; k<length; k++)
+            {
+                sums[k] += xx[k];
+                sums[length + k] += yy[k];
+                sums[2*length + k] += xy[k].real();
+                sums[3*length + k] += xy[k].imag();
+            }
+
+            //there is no noise power data for the stokes spectra
+            struct HDataAccumulationStruct stat;
+            stat.start_index = leading_sample_index;
+            stat.stop_index = leading_sample_index + n_channel_samples;
+            stat.sum_x = 0.0;
+            stat.sum_x2 = 0.0;
+            stat.count = n_channel_samples;
+            stat.state_flag = H_NOISE_UNKNOWN;
+            fPeriods.Release(average, work->fAccumulator.GetNSpectra(), n_samples, meta->GetNBlankedSamples(), false, stat);
+        }
+
+        //write out the periods which are ready, in order
+        void FinishAverages()
+        {
+            std::lock_guard<std::mutex> finish_lock(fFinishMutex);
+
+            unsigned int n_max_open = fNMaxOpenAverages;
+            if(n_max_open == 0){n_max_open = this->GetNThreads() + 1;}
+
+            HStokesAverageKey key;
+            HStokesAverage average;
+            HIntegrationPeriodTracker::HPeriodStatus status;
+            while( fPeriods.TakePeriod(n_max_open, false, key, average, status) )
+            {
+                if(status == HIntegrationPeriodTracker::eDiscarded){continue;}
+                bool written = WriteAverage(key, average);
+                if(written && status == HIntegrationPeriodTracker::ePartial){fNPartialAverages++;}
+                fPeriods.Recycle(average);
+            }
+        }
+
+        bool WriteAverage(const HStokesAverageKey& key, HStokesAverage& average)
+        {
+            const double* sums = HIntegrationPeriodTracker::MergePartialSums(average);
+            if(sums == nullptr){return false;}
+
+            HLinearBuffer< float >* sink = nullptr;
+            size_t length = GetSpectrumLength();
+            HProducerBufferPolicyCode sink_code = this->fSinkBufferHandler.ReserveBuffer(this->fSinkBufferPool, sink);
+            if( !(sink_code & HProducerBufferPolicyCode::success) || sink == nullptr || sink->GetArrayDimension(0) < 4*length)
+            {
+                if(sink != nullptr){this->fSinkBufferHandler.ReleaseBufferToProducer(this->fSinkBufferPool, sink);}
+                fNDroppedAverages++;
+                return false;
+            }
+
+            std::lock_guard<std::mutex> sink_lock(sink->fMutex);
+
+            //average, correcting for any samples zeroed by the time-domain RFI blanker
+            double scale = 0.0;
+            uint64_t n_samples = average.fNTotalSamplesAccumulated;
+            if(average.fNTotalSpectrum != 0)
+            {
+                scale = 1.0/( (double) average.fNTotalSpectrum );
+                if(average.fNBlankedSamples != 0 && average.fNBlankedSamples < n_samples)
+                {
+                    scale *= ( (double) n_samples )/( (double) (n_samples - average.fNBlankedSamples) );
+                }
+            }
+
+            float* out = sink->GetData();
+            for(size_t k=0; k<length; k++)
+            {
+                out[k] = scale*(sums[k] + sums[length + k]);
+                out[length + k] = scale*(sums[k] - sums[length + k]);
+                out[2*length + k] = 2.0*scale*sums[2*length + k];
+                out[3*length + k] = -2.0*scale*sums[3*length + k];
+            }
+
+            HBufferMetaData* sink_meta = sink->GetMetaData();
+            *sink_meta = HBufferMetaData();
+            sink_meta->SetAcquisitionStartSecond(key.fAcquisitionStartSecond);
+            sink_meta->SetSampleRate(key.fSampleRate);
+            sink_meta->SetSidebandFlag(key.fSidebandFlag);
+            sink_meta->SetPolarizationFlag(key.fPolarizationFlag);
+            sink_meta->SetLeadingSampleIndex(average.fLeadingSampleIndex);
+            sink_meta->SetPowerSpectrumLength(length);
+            sink_meta->SetNTotalSpectrum(average.fNTotalSpectrum);
+            sink_meta->SetNTotalSamplesCollected(n_samples/2);
+            sink_meta->SetNBlankedSamples(average.fNBlankedSamples);
+            sink_meta->SetValidityMask(average.fValidityMask, average.fBufferSampleLength);
+
+            this->fSinkBufferHandler.ReleaseBufferToConsumer(this->fSinkBufferPool, sink);
+            return true;
+        }
+
+        HStokesWorkspace* ClaimWorkspace()
+        {
+            if(fFFTSize < 2 || fFFTSize % fInterleaveBlockSize != 0)
+            {
+                std::cout<<"HStokesSpectrometer::ClaimWorkspace: Error, the interleave block size "<<fInterleaveBlockSize<<" does not divide the FFT size "<<fFFTSize<<"."<<std::endl;
+                return nullptr;
+            }
+
+            std::lock_guard<std::mutex> lock(fWorkspaceMutex);
+            if(fFreeWorkspaces.size() != 0)
+            {
+                HStokesWorkspace* work = fFreeWorkspaces.back();
+                fFreeWorkspaces.pop_back();
+                return work;
+            }
+
+            HStokesWorkspace* work = new HStokesWorkspace();
+            work->fX.resize(fFFTSize);
+            work->fY.resize(fFFTSize);
+            work->fAccumulator.SetFFTSize(fFFTSize);
+            work->fAccumulator.SetWindowFunction(fWindowFlag);
+            work->fAccumulator.Initialize();
+            fWorkspaces.push_back(work);
+            return work;
+        }
+
+        void ReturnWorkspace(HStokesWorkspace* work)
+        {
+            if(work == nullptr){return;}
+            std::lock_guard<std::mutex> lock(fWorkspaceMutex);
+            fFreeWorkspaces.push_back(work);
+        }
+
+        size_t fFFTSize;
+        int fWindowFlag;
+        size_t fInterleaveBlockSize;
+        size_t fNBuffersToAverage;
+        unsigned int fNMaxOpenAverages;
+
+        std::mutex fWorkspaceMutex;
+        std::vector< HStokesWorkspace* > fWorkspaces;
+        std::vector< HStokesWorkspace* > fFreeWorkspaces;
+
+        HIntegrationPeriodTracker fPeriods;
+        std::mutex fFinishMutex; //averages are written by one thread at a time, in order
+
+        HBackPressurePolicy fBackPressurePolicy;
+        std::atomic<uint64_t> fNProcessedSamples;
+        std::atomic<uint64_t> fNSkippedBuffers;
+        std::atomic<uint64_t> fNDroppedAverages;
+        std::atomic<uint64_t> fNPartialAverages;
+        std::atomic<uint64_t> fProcessingTime; //ns
+};
+
+}
+
+#endif /* end of include guard: HStokesSpectrometer */
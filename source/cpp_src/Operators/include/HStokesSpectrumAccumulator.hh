@@ -0,0 +1,78 @@
+#ifndef HStokesSpectrumAccumulator_HH__
+#define HStokesSpectrumAccumulator_HH__
+
+#include <complex>
+#include <vector>
+#include <stdint.h>
+
+#include "HArrayWrapper.hh"
+#include "HFastFourierTransform.hh"
+
+namespace hose
+{
+
+/*
+*File: HStokesSpectrumAccumulator.hh
+*Class: HStokesSpectrumAccumulator
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: accumulates the two auto-power spectra and the complex cross-spectrum (fft_size/2+1 channels each)
+* of simultaneous frames of real samples from two inputs (e.g. the X and Y polarizations) on the cpu.
+* Both frames are transformed at once, as the real and imaginary parts of a single complex FFT, and the two
+* spectra are separated using the symmetry of the transform of a real sequence. The sums can be read out as the
+* Stokes parameters, for linear feeds: I = <|X|^2> + <|Y|^2>, Q = <|X|^2> - <|Y|^2>, U = 2Re<XY*>, V = -2Im<XY*>.
+* Not thread safe, each thread needs its own accumulator.
+*/
+
+class HStokesSpectrumAccumulator
+{
+    public:
+
+        HStokesSpectrumAccumulator();
+        virtual ~HStokesSpectrumAccumulator();
+
+        void SetFFTSize(size_t n){fFFTSize = n; fInitialized = false;};
+        size_t GetFFTSize() const {return fFFTSize;};
+        size_t GetSpectrumLength() const {return fFFTSize/2 + 1;};
+
+        void SetWindowFunction(int window_flag = 0){fWindowFlag = window_flag; fInitialized = false;}; //0 = none, 1 = blackman_harris, 2 = hann
+
+        //computes the window, and allocates the workspace
+        bool Initialize();
+
+        //zeros the accumulated spectra
+        void Reset();
+
+        //adds the spectra of a pair of simultaneous frames of fft_size (zero-level subtracted) samples
+        void AddFrame(const float* x, const float* y);
+
+        //sums of |X|^2, |Y|^2 and XY* over all the frames added since the last reset
+        const double* GetXXSum() const {return &(fXXSum[0]);};
+        const double* GetYYSum() const {return &(fYYSum[0]);};
+        const std::complex<double>* GetXYSum() const {return &(fXYSum[0]);};
+        uint64_t GetNSpectra() const {return fNSpectra;};
+
+        //writes the averages I, Q, U, V (scaled by the given factor) one after the other, out must hold 4*spectrum_length values
+        void GetStokes(double scale, float* out) const;
+
+    private:
+
+        bool fInitialized;
+        size_t fFFTSize;
+        int fWindowFlag;
+
+        std::vector<double> fWindow;
+        std::vector<double> fXXSum;
+        std::vector<double> fYYSum;
+        std::vector< std::complex<double> > fXYSum;
+        uint64_t fNSpectra;
+
+        std::vector< std::complex<double> > fWorkspace;
+        HArrayWrapper< std::complex<double>, 1 > fWorkspaceWrapper;
+        HFastFourierTransform fFFT;
+};
+
+}
+
+#endif /* end of include guard: HStokesSpectrumAccumulator */
@@ -0,0 +1,332 @@
+#ifndef HWelchPowerSpectralDensity_HH__
+#define HWelchPowerSpectralDensity_HH__
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+extern "C"
+{
+    #include "HBasicDefines.h"
+    #include "HSpectrumFile.h"
+}
+
+#include "HTaskScheduler.hh"
+#include "HSampleConversionKernel.hh"
+#include "HPowerSpectrumAccumulator.hh"
+
+namespace hose
+{
+
+/*
+*File: HWelchPowerSpectralDensity.hh
+*Class: HWelchPowerSpectralDensity
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: Welch estimate of the power spectrum of a stream of raw samples (e.g. a .bin dump from HRawDataDumper),
+* the average of the power spectra of windowed, possibly overlapping, segments. Samples may be passed in blocks of
+* any size (AddSamples) or read from a file in chunks (ProcessFile), only the current chunk and the overlap with
+* the next one are held in memory, so the length of the capture is not limited by memory. The segments of a chunk
+* are split between a fixed number of tasks on the task scheduler (serially if there is none), and each task has
+* its own FFT plan and accumulator, which are only combined when the result is requested.
+* The result can be written as a standard .spec file, either as the averaged power spectrum (same normalization
+* as the spectrometers) or as the one-sided power spectral density (units^2/Hz).
+*/
+
+template< typename XSampleType >
+class HWelchPowerSpectralDensity
+{
+    public:
+        HWelchPowerSpectralDensity():
+            fInitialized(false),
+            fSegmentLength(4096),
+            fOverlap(2048),
+            fWindowFlag(2),
+            fMaxAverages(0),
+            fChunkSize(1 << 22),
+            fScheduler(nullptr),
+            fNSegments(0),
+            fSampleRate(0),
+            fStartTime(0),
+            fLeadingSampleIndex(0),
+            fSidebandFlag('\0'),
+            fPolarizationFlag('\0')
+        {};
+
+        virtual ~HWelchPowerSpectralDensity()
+        {
+            ClearWorkspaces();
+        };
+
+        //number of samples in each segment (the FFT size)
+        void SetSegmentLength(size_t n){fSegmentLength = n; fInitialized = false;};
+        size_t GetSegmentLength() const {return fSegmentLength;};
+        size_t GetSpectrumLength() const {return fSegmentLength/2 + 1;};
+
+        //number of samples shared by consecutive segments, must be less than the segment length
+        void SetOverlap(size_t n){fOverlap = n; fInitialized = false;};
+        size_t GetOverlap() const {return fOverlap;};
+
+        void SetWindowFunction(int window_flag = 2){fWindowFlag = window_flag; fInitialized = false;}; //0 = none, 1 = blackman_harris, 2 = hann
+
+        //stop after this many segments (0 = use every complete segment)
+        void SetMaxAverages(uint64_t n){fMaxAverages = n;};
+        uint64_t GetMaxAverages() const {return fMaxAverages;};
+
+        //number of samples read from a file at a time
+        void SetChunkSize(size_t n){fChunkSize = std::max< size_t >(n, 1);};
+        size_t GetChunkSize() const {return fChunkSize;};
+
+        //segments are processed on the scheduler if it is running (the number of tasks is fixed at initialization)
+        void SetTaskScheduler(HTaskScheduler* scheduler){fScheduler = scheduler; fInitialized = false;};
+
+        //meta data for the output file, the sample rate is also needed for the power spectral density
+        void SetSampleRate(uint64_t sample_rate){fSampleRate = sample_rate;};
+        uint64_t GetSampleRate() const {return fSampleRate;};
+        void SetStartTime(uint64_t start){fStartTime = start;};
+        void SetLeadingSampleIndex(uint64_t index){fLeadingSampleIndex = index;};
+        void SetSidebandFlag(char sideband){fSidebandFlag = sideband;};
+        void SetPolarizationFlag(char pol){fPolarizationFlag = pol;};
+
+        //allocates the per-task accumulators and clears any previous result
+        bool Initialize()
+        {
+            fInitialized = false;
+            if(fSegmentLength < 2 || fOverlap >= fSegmentLength)
+            {
+                std::cout<<"HWelchPowerSpectralDensity::Initialize: Error, invalid segment length: "<<fSegmentLength<<" with overlap: "<<fOverlap<<"."<<std::endl;
+                return false;
+            }
+
+            //the thread calling ParallelFor also takes part, so there is one more task than there are workers
+            size_t n_tasks = 1;
+            if(fScheduler != nullptr && fScheduler->IsRunning()){n_tasks = fScheduler->GetNThreads() + 1;}
+
+            ClearWorkspaces();
+            for(size_t t=0; t<n_tasks; t++)
+            {
+                HWelchWorkspace* work = new HWelchWorkspace();
+                work->fSamples.resize(fSegmentLength);
+                work->fAccumulator.SetFFTSize(fSegmentLength);
+                work->fAccumulator.SetWindowFunction(fWindowFlag);
+                work->fAccumulator.Initialize();
+                fWorkspaces.push_back(work);
+            }
+
+            fInitialized = true;
+            Reset();
+            return true;
+        }
+
+        //discards the accumulated spectra and any buffered samples
+        void Reset()
+        {
+            for(size_t t=0; t<fWorkspaces.size(); t++){fWorkspaces[t]->fAccumulator.Reset();}
+            fBuffer.clear();
+            fNSegments = 0;
+        }
+
+        //true once the maximum number of averages has been reached
+        bool IsComplete() const {return (fMaxAverages != 0 && fNSegments >= fMaxAverages);};
+
+        //appends a block of samples to the stream, every segment it completes is processed
+        void AddSamples(const XSampleType* data, size_t n_samples)
+        {
+            if(!fInitialized && !Initialize()){return;}
+            if(IsComplete()){return;}
+            fBuffer.insert(fBuffer.end(), data, data + n_samples);
+            ProcessBuffer();
+        }
+
+        //streams the raw samples of a file (no header) through the estimator
+        bool ProcessFile(const std::string& filename)
+        {
+            if(!fInitialized && !Initialize()){return false;}
+
+            std::ifstream in_file;
+            in_file.open(filename.c_str(), std::ios::in | std::ios::binary);
+            if(!in_file.is_open())
+            {
+                std::cout<<"HWelchPowerSpectralDensity::ProcessFile: Error, could not open file: "<<filename<<std::endl;
+                return false;
+            }
+
+            while(in_file.good() && !IsComplete())
+            {
+                //read the next chunk behind the samples left over from the last one
+                size_t n_kept = fBuffer.size();
+                fBuffer.resize(n_kept + fChunkSize);
+                in_file.read( reinterpret_cast< char* >( &(fBuffer[n_kept]) ), (std::streamsize) (fChunkSize*sizeof(XSampleType)) );
+                size_t n_read = ( (size_t) in_file.gcount() )/sizeof(XSampleType);
+                fBuffer.resize(n_kept + n_read);
+                ProcessBuffer();
+            }
+            in_file.close();
+            return true;
+        }
+
+        //number of segments averaged so far
+        uint64_t GetNAverages() const {return fNSegments;};
+
+        //number of samples spanned by the averaged segments
+        uint64_t GetNSamplesUsed() const
+        {
+            if(fNSegments == 0){return 0;}
+            return (fNSegments - 1)*(fSegmentLength - fOverlap) + fSegmentLength;
+        }
+
+        //mean of |X[k]|^2 over the (windowed) segments, k in [0, segment_length/2]
+        bool GetAveragedPowerSpectrum(std::vector< double >& spectrum)
+        {
+            spectrum.assign(GetSpectrumLength(), 0.0);
+            if(!fInitialized || fNSegments == 0){return false;}
+
+            uint64_t n_spectra = 0;
+            for(size_t t=0; t<fWorkspaces.size(); t++)
+            {
+                HPowerSpectrumAccumulator* acc = &(fWorkspaces[t]->fAccumulator);
+                acc->Flush();
+                const double* sum = acc->GetPowerSum();
+                for(size_t k=0; k<spectrum.size(); k++){spectrum[k] += sum[k];}
+                n_spectra += acc->GetNSpectra();
+            }
+            for(size_t k=0; k<spectrum.size(); k++){spectrum[k] /= (double) n_spectra;}
+            return true;
+        }
+
+        //one-sided power spectral density in (sample units)^2/Hz, or per unit of the sampling frequency if the sample rate is not set,
+        //so that its sum times the bin width (sample_rate/segment_length) is the mean square of the samples
+        bool GetPowerSpectralDensity(std::vector< double >& psd)
+        {
+            if(!GetAveragedPowerSpectrum(psd)){return false;}
+            double rate = (fSampleRate == 0) ? 1.0 : (double) fSampleRate;
+            double norm = 1.0/( rate*fWorkspaces[0]->fAccumulator.GetWindowSumOfSquares() );
+            for(size_t k=0; k<psd.size(); k++)
+            {
+                //the negative frequencies are folded in, except for DC and (for even lengths) Nyquist
+                bool unpaired = (k == 0) || (fSegmentLength % 2 == 0 && k == fSegmentLength/2);
+                psd[k] *= unpaired ? norm : 2.0*norm;
+            }
+            return true;
+        }
+
+        //writes the averaged power spectrum (or the power spectral density) as a .spec file of floats
+        bool WriteToFile(const std::string& filename, bool density = false)
+        {
+            std::vector< double > spectrum;
+            bool ok = density ? GetPowerSpectralDensity(spectrum) : GetAveragedPowerSpectrum(spectrum);
+            if(!ok)
+            {
+                std::cout<<"HWelchPowerSpectralDensity::WriteToFile: Error, no spectrum has been accumulated."<<std::endl;
+                return false;
+            }
+            std::vector< float > values(spectrum.begin(), spectrum.end());
+
+            struct HSpectrumFileStruct* spec_data = CreateSpectrumFileStruct();
+            if(spec_data == nullptr){return false;}
+
+            memcpy( spec_data->fHeader.fVersionFlag, SPECTRUM_HEADER_VERSION, HVERSION_WIDTH);
+            spec_data->fHeader.fVersionFlag[HVERSION_WIDTH] = 'R'; //R indicates the spectrum data type is a real quantity
+            spec_data->fHeader.fVersionFlag[HVERSION_WIDTH+1] = 'F'; //F indicates the spectrum data type is a float
+            spec_data->fHeader.fSidebandFlag[0] = fSidebandFlag;
+            spec_data->fHeader.fPolarizationFlag[0] = fPolarizationFlag;
+            spec_data->fHeader.fStartTime = fStartTime;
+            spec_data->fHeader.fSampleRate = fSampleRate;
+            spec_data->fHeader.fLeadingSampleIndex = fLeadingSampleIndex;
+            spec_data->fHeader.fSampleLength = GetNSamplesUsed();
+            spec_data->fHeader.fNAverages = fNSegments;
+            spec_data->fHeader.fSpectrumLength = values.size();
+            spec_data->fHeader.fSpectrumDataTypeSize = sizeof(float);
+            spec_data->fRawSpectrumData = reinterpret_cast< char* >( &(values[0]) );
+
+            int ret_val = WriteSpectrumFile(filename.c_str(), spec_data);
+            if(ret_val != HSUCCESS){std::cout<<"HWelchPowerSpectralDensity::WriteToFile: Error, could not write file: "<<filename<<std::endl;}
+
+            //the data belongs to the vector, so detach it before the struct is destroyed
+            InitializeSpectrumFileStruct(spec_data);
+            DestroySpectrumFileStruct(spec_data);
+            return (ret_val == HSUCCESS);
+        }
+
+    private:
+
+        //per-task conversion space and accumulator (with its own FFT plan)
+        struct HWelchWorkspace
+        {
+            std::vector< float > fSamples;
+            HPowerSpectrumAccumulator fAccumulator;
+        };
+
+        void ClearWorkspaces()
+        {
+            for(size_t t=0; t<fWorkspaces.size(); t++){delete fWorkspaces[t];}
+            fWorkspaces.clear();
+        }
+
+        //processes every complete segment in the buffer, then drops the samples no later segment needs
+        void ProcessBuffer()
+        {
+            size_t hop = fSegmentLength - fOverlap;
+            size_t n_buffered = fBuffer.size();
+            if(n_buffered < fSegmentLength){return;}
+
+            uint64_t n_segments = (n_buffered - fSegmentLength)/hop + 1;
+            if(fMaxAverages != 0){n_segments = std::min< uint64_t >(n_segments, fMaxAverages - fNSegments);}
+
+            //each task takes a contiguous run of segments and feeds its own accumulator
+            size_t n_tasks = fWorkspaces.size();
+            const XSampleType* data = &(fBuffer[0]);
+            size_t length = fSegmentLength;
+            std::vector< HWelchWorkspace* >& workspaces = fWorkspaces;
+            auto task = [data, length, hop, n_segments, n_tasks, &workspaces](size_t t)
+            {
+                HWelchWorkspace* work = workspaces[t];
+                float* x = &(work->fSamples[0]);
+                uint64_t begin = (n_segments*t)/n_tasks;
+                uint64_t end = (n_segments*(t+1))/n_tasks;
+                for(uint64_t s=begin; s<end; s++)
+                {
+                    HSampleConversionKernel::ConvertAndWindow(data + s*hop, nullptr, x, length);
+                    work->fAccumulator.AddFrame(x);
+                }
+            };
+
+            if(fScheduler != nullptr && n_tasks > 1){fScheduler->ParallelFor(n_tasks, task);}
+            else{for(size_t t=0; t<n_tasks; t++){task(t);} }
+
+            fNSegments += n_segments;
+            if(IsComplete())
+            {
+                fBuffer.clear();
+                return;
+            }
+            fBuffer.erase(fBuffer.begin(), fBuffer.begin() + std::min< size_t >(n_segments*hop, n_buffered) );
+        }
+
+        bool fInitialized;
+        size_t fSegmentLength;
+        size_t fOverlap;
+        int fWindowFlag;
+        uint64_t fMaxAverages;
+        size_t fChunkSize;
+        HTaskScheduler* fScheduler;
+
+        std::vector< XSampleType > fBuffer; //samples from the start of the next segment onwards
+        std::vector< HWelchWorkspace* > fWorkspaces;
+        uint64_t fNSegments;
+
+        uint64_t fSampleRate;
+        uint64_t fStartTime;
+        uint64_t fLeadingSampleIndex;
+        char fSidebandFlag;
+        char fPolarizationFlag;
+};
+
+}
+
+#endif /* end of include guard: HWelchPowerSpectralDensity */
@@ -0,0 +1,58 @@
+#ifndef HWindowFunction_HH__
+#define HWindowFunction_HH__
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace hose
+{
+
+/*
+*File: HWindowFunction.hh
+*Class: HWindowFunction
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: the (symmetric) window functions used by the cpu spectrometers, selected with the same
+* flags as the gpu spectrometer: 0 = none, 1 = blackman_harris, 2 = hann. Unknown flags give no window.
+*/
+
+class HWindowFunction
+{
+    public:
+
+        enum
+        {
+            eNone = 0,
+            eBlackmanHarris = 1,
+            eHann = 2
+        };
+
+        //value of point i of an n point window
+        static double Value(int window_flag, std::size_t i, std::size_t n)
+        {
+            if(n < 2){return 1.0;}
+            double phase = (2.0*M_PI*i)/( (double) n - 1.0 );
+            if(window_flag == eBlackmanHarris){return 0.35875 - 0.48829*std::cos(phase) + 0.14128*std::cos(2.0*phase) - 0.01168*std::cos(3.0*phase);}
+            if(window_flag == eHann){return 0.5 - 0.5*std::cos(phase);}
+            return 1.0;
+        }
+
+        //fill in an n point window, returns its sum of squares
+        static double Fill(int window_flag, std::size_t n, std::vector<double>& window)
+        {
+            window.resize(n);
+            double sum_of_squares = 0.0;
+            for(std::size_t i=0; i<n; i++)
+            {
+                window[i] = Value(window_flag, i, n);
+                sum_of_squares += window[i]*window[i];
+            }
+            return sum_of_squares;
+        }
+};
+
+}
+
+#endif /* end of include guard: HWindowFunction_HH__ */
@@ -0,0 +1,151 @@
+#ifndef HZoomDownConverter_HH__
+#define HZoomDownConverter_HH__
+
+#include <algorithm>
+#include <complex>
+#include <limits>
+#include <vector>
+#include <stdint.h>
+
+#include "HArrayWrapper.hh"
+#include "HFastFourierTransform.hh"
+#include "HOscillatorPhase.hh"
+
+namespace hose
+{
+
+/*
+*File: HZoomDownConverter.hh
+*Class: HZoomDownConverter
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: CPU 'zoom' spectrometer kernel, for high resolution spectra of a narrow sub-band.
+* The real input samples are mixed down to baseband by a numerically controlled oscillator at the
+* center frequency of the sub-band, low-pass filtered and decimated by a polyphase FIR (only the retained
+* output samples are computed), and the resulting complex samples are cut into frames which are windowed,
+* Fourier transformed and accumulated into a power spectrum. The spectrum is ordered from the lowest to
+* the highest frequency, with the center frequency in channel fft_size/2. The oscillator phase is
+* derived from the absolute sample index, so it is continuous across buffers.
+* Each call to Process handles one buffer independently: the first n_taps-1 samples only prime the
+* filter, and decimated samples which do not fill a complete frame at the end of the buffer are discarded.
+* Not thread safe, each thread needs its own down-converter.
+*/
+
+class HZoomDownConverter
+{
+    public:
+
+        HZoomDownConverter();
+        virtual ~HZoomDownConverter();
+
+        void SetSampleRate(uint64_t rate){fSampleRate = rate; fInitialized = false;};
+        uint64_t GetSampleRate() const {return fSampleRate;};
+
+        //frequency (Hz) within the digitized band which is mixed down to zero
+        void SetCenterFrequency(uint64_t freq){fCenterFrequency = freq; fInitialized = false;};
+        uint64_t GetCenterFrequency() const {return fCenterFrequency;};
+
+        void SetDecimationFactor(size_t n){fDecimationFactor = (n == 0) ? 1 : n; fInitialized = false;};
+        size_t GetDecimationFactor() const {return fDecimationFactor;};
+
+        //the FIR has decimation_factor*n_taps_per_phase coefficients
+        void SetNTapsPerPhase(size_t n){fNTapsPerPhase = (n == 0) ? 1 : n; fInitialized = false;};
+        size_t GetNTapsPerPhase() const {return fNTapsPerPhase;};
+
+        //number of (complex) samples per transform, which is also the number of output channels
+        void SetFFTSize(size_t n){fFFTSize = n; fInitialized = false;};
+        size_t GetFFTSize() const {return fFFTSize;};
+
+        void SetWindowFunction(int window_flag = 0){fWindowFlag = window_flag; fInitialized = false;}; //0 = none, 1 = blackman_harris, 2 = hann
+
+        double GetOutputSampleRate() const {return ( (double) fSampleRate )/( (double) fDecimationFactor );};
+        double GetChannelWidth() const {return GetOutputSampleRate()/( (double) fFFTSize );};
+
+        //designs the filter and window, and allocates the workspace
+        bool Initialize();
+
+        //number of complete spectra which a buffer of n_samples will produce
+        size_t GetNSpectra(size_t n_samples) const;
+
+        //adds the power spectra of a buffer to power_sum (length fft_size), returns the number of spectra added
+        template< typename XSampleType >
+        size_t Process(const XSampleType* data, size_t n_samples, uint64_t leading_sample_index, double* power_sum);
+
+    private:
+
+        //mixes and filters one chunk of (zero-level subtracted) samples, the outputs go into the frame
+        void ProcessChunk(const float* x, size_t n_outputs, uint64_t first_sample_index, double* power_sum);
+        void TransformFrame(double* power_sum);
+
+        //e^{-i*2pi*f*n/fs}, computed exactly from the sample index
+        std::complex<double> OscillatorPhasor(uint64_t sample_index) const
+        {
+            return HOscillatorPhase::Phasor(fCenterFrequency, sample_index, fSampleRate);
+        }
+
+        static float Dot(const float* a, const float* b, size_t n);
+
+        //sample value corresponding to zero volts (mid-scale for unsigned data)
+        template< typename XSampleType >
+        static float ZeroLevel()
+        {
+            if(std::numeric_limits< XSampleType >::is_signed || !std::numeric_limits< XSampleType >::is_integer){return 0.0f;}
+            return (float) ( ( (uint64_t) std::numeric_limits< XSampleType >::max() + 1)/2 );
+        }
+
+        bool fInitialized;
+        uint64_t fSampleRate;
+        uint64_t fCenterFrequency;
+        size_t fDecimationFactor;
+        size_t fNTapsPerPhase;
+        size_t fNTaps;
+        size_t fFFTSize;
+        int fWindowFlag;
+
+        size_t fChunkOutputs; //number of decimated samples produced per chunk
+        size_t fChunkInputs; //number of input samples needed per chunk
+
+        std::vector<float> fCoefficients; //time reversed, so each output is a plain dot product
+        std::vector<float> fRotationReal; //e^{-i*2pi*f*k/fs} for k within a chunk
+        std::vector<float> fRotationImag;
+        std::vector<float> fInput;
+        std::vector<float> fMixedReal;
+        std::vector<float> fMixedImag;
+        std::vector<double> fWindow;
+
+        //frame currently being filled and the FFT
+        size_t fFramePosition;
+        std::vector< std::complex<double> > fFrame;
+        HArrayWrapper< std::complex<double>, 1 > fFrameWrapper;
+        HFastFourierTransform fFFT;
+};
+
+template< typename XSampleType >
+size_t
+HZoomDownConverter::Process(const XSampleType* data, size_t n_samples, uint64_t leading_sample_index, double* power_sum)
+{
+    if(!fInitialized && !Initialize()){return 0;}
+
+    size_t n_spectra = GetNSpectra(n_samples);
+    size_t n_outputs = n_spectra*fFFTSize;
+    float zero = ZeroLevel< XSampleType >();
+
+    fFramePosition = 0;
+    size_t output_index = 0;
+    while(output_index < n_outputs)
+    {
+        size_t n_chunk = std::min(fChunkOutputs, n_outputs - output_index);
+        size_t start = output_index*fDecimationFactor;
+        size_t n_in = (n_chunk - 1)*fDecimationFactor + fNTaps;
+        const XSampleType* in = data + start;
+        for(size_t i=0; i<n_in; i++){fInput[i] = ( (float) in[i] ) - zero;}
+        ProcessChunk(&(fInput[0]), n_chunk, leading_sample_index + start, power_sum);
+        output_index += n_chunk;
+    }
+    return n_spectra;
+}
+
+}
+
+#endif /* end of include guard: HZoomDownConverter */
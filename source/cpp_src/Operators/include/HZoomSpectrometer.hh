@@ -0,0 +1,230 @@
+#ifndef HZoomSpectrometer_HH__
+#define HZoomSpectrometer_HH__
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+#include "HConsumerProducer.hh"
+#include "HBackPressurePolicy.hh"
+#include "HSpectrumAccumulationKernel.hh"
+#include "HZoomDownConverter.hh"
+
+namespace hose
+{
+
+/*
+*File: HZoomSpectrometer.hh
+*Class: HZoomSpectrometer
+*Author: J. Barrett
+*Email: barrettj@mit.edu
+*Date:
+*Description: CPU spectrometer for a narrow sub-band at high resolution (see HZoomDownConverter).
+* Takes digitizer buffers and produces one averaged power spectrum (fft_size channels, centered on the
+* zoom frequency) per buffer, the output meta data carries the decimated sample rate. It reads the digitizer
+* buffers without modifying them, and passes each one on to the next consumer. Since it may not be able to keep
+* up with the full digitizer rate, buffers can be skipped according to the back-pressure policy (and are also
+* skipped if there is no free output buffer), rather than holding up the acquisition.
+*/
+
+template< typename XSampleType >
+class HZoomSpectrometer: public HConsumerProducer< XSampleType, float, HConsumerBufferHandler_Immediate< XSampleType >, HProducerBufferHandler_Immediate< float > >
+{
+
+    public:
+        HZoomSpectrometer():
+            fCenterFrequency(0),
+            fDecimationFactor(64),
+            fNTapsPerPhase(16),
+            fFFTSize(4096),
+            fWindowFlag(0),
+            fNProcessedSamples(0),
+            fNSkippedBuffers(0),
+            fProcessingTime(0)
+        {};
+
+        virtual ~HZoomSpectrometer()
+        {
+            for(size_t i=0; i<fWorkspaces.size(); i++){delete fWorkspaces[i];}
+        };
+
+        //configuration, must be set before the threads are started
+        void SetCenterFrequency(uint64_t freq){fCenterFrequency = freq;};
+        void SetDecimationFactor(size_t n){fDecimationFactor = n;};
+        void SetNTapsPerPhase(size_t n){fNTapsPerPhase = n;};
+        void SetFFTSize(size_t n){fFFTSize = n;};
+        void SetWindowFunction(int window_flag = 0){fWindowFlag = window_flag;}; //0 = none, 1 = blackman_harris, 2 = hann
+
+        uint64_t GetCenterFrequency() const {return fCenterFrequency;};
+        size_t GetDecimationFactor() const {return fDecimationFactor;};
+        size_t GetNTapsPerPhase() const {return fNTapsPerPhase;};
+        size_t GetFFTSize() const {return fFFTSize;};
+
+        //configure how (and if) buffers are skipped when the zoom spectrometer cannot keep up
+        HBackPressurePolicy* GetBackPressurePolicy(){return &fBackPressurePolicy;};
+        const HBackPressurePolicy* GetBackPressurePolicy() const {return &fBackPressurePolicy;};
+
+        uint64_t GetNSkippedBuffers() const {return fNSkippedBuffers + fBackPressurePolicy.GetNDropped();};
+        uint64_t GetNProcessedSamples() const {return fNProcessedSamples;};
+
+        //processing rate in input samples per second (of busy time, per thread)
+        double GetThroughput() const
+        {
+            uint64_t ns = fProcessingTime;
+            if(ns == 0){return 0.0;}
+            return 1e9*( (double) fNProcessedSamples )/( (double) ns );
+        }
+
+    protected:
+
+        //per-thread down-converter and power spectrum sum
+        struct HZoomWorkspace
+        {
+            HZoomDownConverter fConverter;
+            std::vector<double> fPowerSum;
+        };
+
+        virtual void ExecuteThreadTask() override
+        {
+            HLinearBuffer< XSampleType >* source = nullptr;
+            HLinearBuffer< float >* sink = nullptr;
+
+            size_t backlog = this->fSourceBufferPool->GetConsumerPoolSize( this->GetConsumerID() );
+            if(backlog == 0){return;}
+
+            HConsumerBufferPolicyCode source_code = this->fSourceBufferHandler.ReserveBuffer(this->fSourceBufferPool, source, this->GetConsumerID());
+            if( !(source_code & HConsumerBufferPolicyCode::success) || source == nullptr){return;}
+
+            if( fBackPressurePolicy.Accept(backlog) )
+            {
+                HProducerBufferPolicyCode sink_code = this->fSinkBufferHandler.ReserveBuffer(this->fSinkBufferPool, sink);
+                if( (sink_code & HProducerBufferPolicyCode::success) && sink != nullptr)
+                {
+                    std::lock_guard<std::mutex> sink_lock(sink->fMutex);
+
+                    //in fan-out mode the source buffer is shared (read-only) with the other consumers, so we don't lock it
+                    std::unique_lock<std::mutex> source_lock(source->fMutex, std::defer_lock);
+                    if( !this->fSourceBufferPool->IsFanOutEnabled() ){ source_lock.lock(); }
+
+                    auto start = std::chrono::steady_clock::now();
+                    HBufferMetaData* meta = source->GetMetaData();
+                    size_t n_samples = source->GetArrayDimension(0);
+
+                    HZoomWorkspace* work = ClaimWorkspace(meta->GetSampleRate());
+                    size_t n_spectra = 0;
+                    if(work != nullptr && sink->GetArrayDimension(0) >= fFFTSize)
+                    {
+                        work->fPowerSum.assign(fFFTSize, 0.0);
+                        n_spectra = work->fConverter.Process(source->GetData(), n_samples, meta->GetLeadingSampleIndex(), &(work->fPowerSum[0]) );
+                    }
+
+                    if(n_spectra != 0)
+                    {
+                        //average, correcting for any samples zeroed by the time-domain RFI blanker
+                        double scale = 1.0/( (double) n_spectra );
+                        uint64_t n_blanked = meta->GetNBlankedSamples();
+                        if(n_blanked != 0 && n_blanked < n_samples){scale *= ( (double) n_samples )/( (double) (n_samples - n_blanked) );}
+                        HSpectrumAccumulationKernel::Normalize(&(work->fPowerSum[0]), scale, sink->GetData(), fFFTSize);
+
+                        HBufferMetaData* sink_meta = sink->GetMetaData();
+                        *sink_meta = *meta;
+                        sink_meta->SetSampleRate( (uint64_t) ( work->fConverter.GetOutputSampleRate() + 0.5 ) );
+                        sink_meta->SetPowerSpectrumLength(fFFTSize);
+                        sink_meta->SetNTotalSpectrum(n_spectra);
+                        sink_meta->SetNTotalSamplesCollected(n_samples);
+                        sink_meta->ClearRFIMask();
+                    }
+                    ReturnWorkspace(work);
+
+                    if(n_spectra != 0)
+                    {
+                        auto elapsed = std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - start );
+                        fProcessingTime += elapsed.count();
+                        fNProcessedSamples += n_samples;
+                        this->fSinkBufferHandler.ReleaseBufferToConsumer(this->fSinkBufferPool, sink);
+                    }
+                    else
+                    {
+                        fNSkippedBuffers++;
+                        this->fSinkBufferHandler.ReleaseBufferToProducer(this->fSinkBufferPool, sink);
+                    }
+                }
+                else
+                {
+                    //no room for the output, skip this buffer rather than stall the digitizer
+                    fNSkippedBuffers++;
+                }
+            }
+
+            this->fSourceBufferHandler.ReleaseBufferToConsumer(this->fSourceBufferPool, source, this->GetNextConsumerID());
+        }
+
+        virtual bool WorkPresent() override
+        {
+            return ( this->fSourceBufferPool->GetConsumerPoolSize( this->GetConsumerID() ) != 0 );
+        }
+
+        //hands out a down-converter which is not in use by another thread (creating one if needed)
+        HZoomWorkspace* ClaimWorkspace(uint64_t sample_rate)
+        {
+            HZoomWorkspace* work = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(fWorkspaceMutex);
+                if(fFreeWorkspaces.size() != 0)
+                {
+                    work = fFreeWorkspaces.back();
+                    fFreeWorkspaces.pop_back();
+                }
+                else
+                {
+                    work = new HZoomWorkspace();
+                    fWorkspaces.push_back(work);
+                }
+            }
+
+            //(re)configure if the sample rate has changed since the last time it was used
+            if(work->fConverter.GetSampleRate() != sample_rate || work->fConverter.GetFFTSize() != fFFTSize)
+            {
+                work->fConverter.SetSampleRate(sample_rate);
+                work->fConverter.SetCenterFrequency(fCenterFrequency);
+                work->fConverter.SetDecimationFactor(fDecimationFactor);
+                work->fConverter.SetNTapsPerPhase(fNTapsPerPhase);
+                work->fConverter.SetFFTSize(fFFTSize);
+                work->fConverter.SetWindowFunction(fWindowFlag);
+                if(!work->fConverter.Initialize())
+                {
+                    ReturnWorkspace(work);
+                    return nullptr;
+                }
+            }
+            return work;
+        }
+
+        void ReturnWorkspace(HZoomWorkspace* work)
+        {
+            if(work == nullptr){return;}
+            std::lock_guard<std::mutex> lock(fWorkspaceMutex);
+            fFreeWorkspaces.push_back(work);
+        }
+
+        uint64_t fCenterFrequency;
+        size_t fDecimationFactor;
+        size_t fNTapsPerPhase;
+        size_t fFFTSize;
+        int fWindowFlag;
+
+        std::mutex fWorkspaceMutex;
+        std::vector< HZoomWorkspace* > fWorkspaces;
+        std::vector< HZoomWorkspace* > fFreeWorkspaces;
+
+        HBackPressurePolicy fBackPressurePolicy;
+        std::atomic<uint64_t> fNProcessedSamples;
+        std::atomic<uint64_t> fNSkippedBuffers;
+        std::atomic<uint64_t> fProcessingTime; //ns
+};
+
+}
+
+#endif /* end of include guard: HZoomSpectrometer */
@@ -1,5 +1,7 @@
 #include "HAveragedMultiThreadedSpectrumDataWriter.hh"
 
+#include <algorithm>
+
 namespace hose
 {
 
@@ -7,11 +9,35 @@ namespace hose
 HAveragedMultiThreadedSpectrumDataWriter::HAveragedMultiThreadedSpectrumDataWriter():
     HDirectoryWriter(),
     fEnableNoisePower(true),
-    fEnableSpectrum(true)
+    fEnableSpectrum(true),
+    fStokesRecords(false),
+    fHaveWindowProperties(false),
+    fWindowRecordPending(false),
+    fWindowRecordStartSecond(0),
+    fWindowName("none"),
+    fWindowFFTSize(0),
+    fWindowS1(0.0),
+    fWindowS2(0.0),
+    fFFTOverlap(1),
+    fIndependentFraction(1.0)
 {};
 
 HAveragedMultiThreadedSpectrumDataWriter::~HAveragedMultiThreadedSpectrumDataWriter(){};
 
+void
+HAveragedMultiThreadedSpectrumDataWriter::SetWindowProperties(std::string window_name, size_t fft_size, double s1, double s2, size_t fft_overlap, double independent_fraction)
+{
+    std::lock_guard<std::mutex> lock(fWindowMutex);
+    fWindowName = window_name;
+    fWindowFFTSize = fft_size;
+    fWindowS1 = s1;
+    fWindowS2 = s2;
+    fFFTOverlap = fft_overlap;
+    fIndependentFraction = independent_fraction;
+    fHaveWindowProperties = true;
+    fWindowRecordPending = true;
+}
+
 
 void
 HAveragedMultiThreadedSpectrumDataWriter::ExecuteThreadTask()
@@ -19,14 +45,38 @@ HAveragedMultiThreadedSpectrumDataWriter::ExecuteThreadTask()
     //get a buffer from the buffer handler
     HLinearBuffer< float >* tail = nullptr;
 
-    if( this->fBufferPool->GetConsumerPoolSize( this->GetConsumerID() ) != 0 )
+    size_t backlog = this->fBufferPool->GetConsumerPoolSize( this->GetConsumerID() );
+    if( backlog != 0 )
     {
         //grab a buffer to process
         HConsumerBufferPolicyCode buffer_code = this->fBufferHandler.ReserveBuffer(this->fBufferPool, tail, this->GetConsumerID() );
-        if( (fEnableNoisePower || fEnableSpectrum) && (buffer_code & HConsumerBufferPolicyCode::success) && tail != nullptr)
+        if( (fEnableNoisePower || fEnableSpectrum) && (buffer_code & HConsumerBufferPolicyCode::success) && tail != nullptr
+            && !fBackPressurePolicy.Accept(backlog) )
+        {
+            //we are too far behind, skip the (expensive) write and just leave a marker
+            std::lock_guard<std::mutex> lock(tail->fMutex);
+            WriteGapRecord(tail->GetMetaData(), std::string("back_pressure"));
+        }
+        else if( (fEnableNoisePower || fEnableSpectrum) && (buffer_code & HConsumerBufferPolicyCode::success) && tail != nullptr)
         {
             std::lock_guard<std::mutex> lock(tail->fMutex);
 
+            //if part of the integration period is missing, record which part next to the spectrum
+            const std::vector< uint8_t >* mask = tail->GetMetaData()->GetValidityMask();
+            if( std::find(mask->begin(), mask->end(), 0) != mask->end() )
+            {
+                WriteGapRecord(tail->GetMetaData(), std::string("missing_samples"));
+            }
+
+            //per-channel RFI flags (if they were computed) and the amount of data blanked in the time domain
+            if(fEnableSpectrum && (tail->GetMetaData()->GetRFIMask()->size() != 0 || tail->GetMetaData()->GetNBlankedSamples() != 0) )
+            {
+                WriteRFIRecord(tail->GetMetaData());
+            }
+
+            //the window/overlap properties, once per acquisition (or after a reconfiguration)
+            if(fEnableSpectrum){WriteWindowRecord(tail->GetMetaData());}
+
             if(fEnableSpectrum)
             {
                 //we rely on acquisitions start time, sample index, and sideband/pol flags to uniquely name/stamp a file
@@ -39,6 +89,7 @@ HAveragedMultiThreadedSpectrumDataWriter::ExecuteThreadTask()
                 ss << "_";
                 ss <<  tail->GetMetaData()->GetSidebandFlag();
                 ss <<  tail->GetMetaData()->GetPolarizationFlag();
+                ss <<  fFileNameTag;
 
                 std::string spec_filename = ss.str() + ".spec";
 
@@ -55,6 +106,7 @@ HAveragedMultiThreadedSpectrumDataWriter::ExecuteThreadTask()
                     memcpy( spec_data->fHeader.fVersionFlag, SPECTRUM_HEADER_VERSION, HVERSION_WIDTH);
                     spec_data->fHeader.fVersionFlag[HVERSION_WIDTH] = 'R'; //R indicates the spectrum data type is a real quantity
                     spec_data->fHeader.fVersionFlag[HVERSION_WIDTH+1] = 'F'; //F indicates the spectrum data type is a float
+                    if(fStokesRecords){spec_data->fHeader.fVersionFlag[HVERSION_WIDTH+2] = 'S';} //S indicates the data is I, Q, U, V (each of the spectrum length)
                     spec_data->fHeader.fSidebandFlag[0] = tail->GetMetaData()->GetSidebandFlag() ;
                     spec_data->fHeader.fPolarizationFlag[0] = tail->GetMetaData()->GetPolarizationFlag();
                     spec_data->fHeader.fStartTime = tail->GetMetaData()->GetAcquisitionStartSecond();
@@ -64,6 +116,7 @@ HAveragedMultiThreadedSpectrumDataWriter::ExecuteThreadTask()
                     spec_data->fHeader.fSampleLength = tail->GetMetaData()->GetNTotalSamplesCollected();
                     spec_data->fHeader.fNAverages = tail->GetMetaData()->GetNTotalSpectrum();
                     spec_data->fHeader.fSpectrumLength = tail->GetMetaData()->GetPowerSpectrumLength();
+                    if(fStokesRecords){spec_data->fHeader.fSpectrumLength *= 4;}
                     spec_data->fHeader.fSpectrumDataTypeSize = sizeof(float);
 
                     strcpy(spec_data->fHeader.fExperimentName, fExperimentName.c_str() );
@@ -94,6 +147,7 @@ HAveragedMultiThreadedSpectrumDataWriter::ExecuteThreadTask()
                 ss2 << "_";
                 ss2 << tail->GetMetaData()->GetSidebandFlag();
                 ss2 << tail->GetMetaData()->GetPolarizationFlag();
+                ss2 << fFileNameTag;
 
                 std::string noise_power_filename = ss2.str() + ".npow";
 
@@ -136,6 +190,172 @@ HAveragedMultiThreadedSpectrumDataWriter::ExecuteThreadTask()
     }
 }
 
+void
+HAveragedMultiThreadedSpectrumDataWriter::WriteGapRecord(const HBufferMetaData* meta, const std::string& reason)
+{
+    //named like the spectrum it replaces, so that it sorts into the same place in the output stream
+    std::stringstream ss;
+    ss << fCurrentOutputDirectory;
+    ss << "/";
+    ss << meta->GetAcquisitionStartSecond();
+    ss << "_";
+    ss << meta->GetLeadingSampleIndex();
+    ss << "_";
+    ss << meta->GetSidebandFlag();
+    ss << meta->GetPolarizationFlag();
+    ss << fFileNameTag;
+    ss << ".gap";
+
+    std::ofstream out_file;
+    out_file.open(ss.str().c_str(), std::ios::out);
+    if(!out_file.is_open())
+    {
+        std::cout<<"HAveragedMultiThreadedSpectrumDataWriter::WriteGapRecord: Error, could not open: "<<ss.str()<<std::endl;
+        return;
+    }
+    out_file << "reason=" << reason << std::endl;
+    out_file << "experiment_name=" << fExperimentName << std::endl;
+    out_file << "source_name=" << fSourceName << std::endl;
+    out_file << "scan_name=" << fScanName << std::endl;
+    out_file << "acquisition_start_second=" << meta->GetAcquisitionStartSecond() << std::endl;
+    out_file << "leading_sample_index=" << meta->GetLeadingSampleIndex() << std::endl;
+    out_file << "sample_length=" << meta->GetNTotalSamplesCollected() << std::endl;
+    out_file << "sample_rate=" << meta->GetSampleRate() << std::endl;
+    out_file << "sideband=" << meta->GetSidebandFlag() << std::endl;
+    out_file << "polarization=" << meta->GetPolarizationFlag() << std::endl;
+    out_file << "n_dropped_total=" << fBackPressurePolicy.GetNDropped() << std::endl;
+
+    //which blocks of samples (following the leading sample index) made it into the average
+    const std::vector< uint8_t >* mask = meta->GetValidityMask();
+    if(mask->size() != 0)
+    {
+        uint64_t block_length = meta->GetValiditySampleLength();
+        out_file << "validity_sample_length=" << block_length << std::endl;
+        out_file << "validity_mask=";
+        for(size_t i=0; i<mask->size(); i++){out_file << (unsigned int) (*mask)[i];}
+        out_file << std::endl;
+        for(size_t i=0; i<mask->size(); i++)
+        {
+            if( (*mask)[i] == 0 )
+            {
+                uint64_t start = meta->GetLeadingSampleIndex() + i*block_length;
+                out_file << "missing_samples=" << start << ":" << start + block_length << std::endl;
+            }
+        }
+    }
+    out_file.close();
+}
+
+void
+HAveragedMultiThreadedSpectrumDataWriter::WriteRFIRecord(const HBufferMetaData* meta)
+{
+    std::stringstream ss;
+    ss << fCurrentOutputDirectory;
+    ss << "/";
+    ss << meta->GetAcquisitionStartSecond();
+    ss << "_";
+    ss << meta->GetLeadingSampleIndex();
+    ss << "_";
+    ss << meta->GetSidebandFlag();
+    ss << meta->GetPolarizationFlag();
+    ss << fFileNameTag;
+    ss << ".rfi";
+
+    std::ofstream out_file;
+    out_file.open(ss.str().c_str(), std::ios::out);
+    if(!out_file.is_open())
+    {
+        std::cout<<"HAveragedMultiThreadedSpectrumDataWriter::WriteRFIRecord: Error, could not open: "<<ss.str()<<std::endl;
+        return;
+    }
+
+    out_file << "acquisition_start_second=" << meta->GetAcquisitionStartSecond() << std::endl;
+    out_file << "leading_sample_index=" << meta->GetLeadingSampleIndex() << std::endl;
+    out_file << "sideband=" << meta->GetSidebandFlag() << std::endl;
+    out_file << "polarization=" << meta->GetPolarizationFlag() << std::endl;
+    out_file << "sample_length=" << meta->GetNTotalSamplesCollected() << std::endl;
+    out_file << "n_spectra=" << meta->GetNTotalSpectrum() << std::endl;
+
+    //time-domain blanking (the spectrum has already been corrected for it)
+    out_file << "blanked_samples=" << meta->GetNBlankedSamples() << std::endl;
+
+    //spectral kurtosis flags
+    const std::vector< uint8_t >* mask = meta->GetRFIMask();
+    if(mask->size() == 0)
+    {
+        out_file.close();
+        return;
+    }
+    out_file << "n_channels=" << mask->size() << std::endl;
+    out_file << "n_flagged=" << std::count(mask->begin(), mask->end(), 1) << std::endl;
+
+    //contiguous runs of flagged channels, as [start:stop)
+    size_t i = 0;
+    while(i < mask->size())
+    {
+        if( (*mask)[i] == 0 ){i++; continue;}
+        size_t start = i;
+        while(i < mask->size() && (*mask)[i] != 0){i++;}
+        out_file << "flagged_channels=" << start << ":" << i << std::endl;
+    }
+    out_file.close();
+}
+
+void
+HAveragedMultiThreadedSpectrumDataWriter::WriteWindowRecord(const HBufferMetaData* meta)
+{
+    std::lock_guard<std::mutex> lock(fWindowMutex);
+    if(!fHaveWindowProperties){return;}
+    if(!fWindowRecordPending && fWindowRecordStartSecond == meta->GetAcquisitionStartSecond()){return;}
+
+    std::stringstream ss;
+    ss << fCurrentOutputDirectory;
+    ss << "/";
+    ss << meta->GetAcquisitionStartSecond();
+    ss << "_";
+    ss << meta->GetLeadingSampleIndex();
+    ss << "_";
+    ss << meta->GetSidebandFlag();
+    ss << meta->GetPolarizationFlag();
+    ss << fFileNameTag;
+    ss << ".win";
+
+    std::ofstream out_file;
+    out_file.open(ss.str().c_str(), std::ios::out);
+    if(!out_file.is_open())
+    {
+        std::cout<<"HAveragedMultiThreadedSpectrumDataWriter::WriteWindowRecord: Error, could not open: "<<ss.str()<<std::endl;
+        return;
+    }
+
+    //normalized equivalent noise bandwidth (in channels) N*s2/s1^2
+    double nenbw = 0.0;
+    if(fWindowS1 != 0.0){nenbw = fWindowFFTSize*fWindowS2/(fWindowS1*fWindowS1);}
+    double channel_width = 0.0;
+    if(fWindowFFTSize != 0){channel_width = ( (double) meta->GetSampleRate() )/( (double) fWindowFFTSize );}
+
+    out_file << "acquisition_start_second=" << meta->GetAcquisitionStartSecond() << std::endl;
+    out_file << "leading_sample_index=" << meta->GetLeadingSampleIndex() << std::endl;
+    out_file << "sideband=" << meta->GetSidebandFlag() << std::endl;
+    out_file << "polarization=" << meta->GetPolarizationFlag() << std::endl;
+    out_file << "sample_rate=" << meta->GetSampleRate() << std::endl;
+    out_file << "fft_size=" << fWindowFFTSize << std::endl;
+    out_file << "window_type=" << fWindowName << std::endl;
+    out_file << "window_s1=" << fWindowS1 << std::endl;
+    out_file << "window_s2=" << fWindowS2 << std::endl;
+    out_file << "window_normalized_equivalent_noise_bandwidth=" << nenbw << std::endl;
+    out_file << "window_equivalent_noise_bandwidth_Hz=" << nenbw*channel_width << std::endl;
+    out_file << "fft_overlap=" << fFFTOverlap << std::endl;
+    out_file << "overlap_independent_spectra_fraction=" << fIndependentFraction << std::endl;
+    //the spectrum count (n_averages) in the .spec header is that of non-overlapping frames, so the number
+    //of independent spectra in an average is n_averages times this
+    out_file << "independent_spectra_per_spectrum=" << fFFTOverlap*fIndependentFraction << std::endl;
+    out_file.close();
+
+    fWindowRecordPending = false;
+    fWindowRecordStartSecond = meta->GetAcquisitionStartSecond();
+}
+
 bool
 HAveragedMultiThreadedSpectrumDataWriter::WorkPresent()
 {
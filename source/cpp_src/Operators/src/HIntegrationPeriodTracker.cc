@@ -0,0 +1,239 @@
+#include "HIntegrationPeriodTracker.hh"
+#include "HSpectrumAccumulationKernel.hh"
+
+namespace hose
+{
+
+HIntegrationPeriodTracker::HIntegrationPeriodTracker(size_t spectrum_length, size_t n_buffers):
+    fSpectrumLength(spectrum_length),
+    fNBuffersPerPeriod(n_buffers),
+    fEnableFourthMoment(false),
+    fFlushPartial(false),
+    fTimeout(0),
+    fHaveLastKey(false),
+    fNextSampleIndex(0),
+    fNOpenPeriods(0),
+    fLastUpdateTime(0),
+    fNBuffersReceived(0),
+    fNLateBuffers(0),
+    fNMissingSamples(0),
+    fNDiscardedPeriods(0)
+{
+    if(fNBuffersPerPeriod == 0){fNBuffersPerPeriod = 1;}
+}
+
+HIntegrationPeriodTracker::~HIntegrationPeriodTracker(){}
+
+void
+HIntegrationPeriodTracker::Configure(size_t spectrum_length, size_t n_buffers)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    fSpectrumLength = spectrum_length;
+    fNBuffersPerPeriod = n_buffers;
+    if(fNBuffersPerPeriod == 0){fNBuffersPerPeriod = 1;}
+
+    //the spare sums have the wrong length now, and the threads will be new ones when they are restarted
+    fOpenPeriods.clear();
+    fNOpenPeriods = 0;
+    fSpareSums.clear();
+    fWorkerIndices.clear();
+    fHaveLastKey = false;
+    fNextSampleIndex = 0;
+}
+
+HIntegrationPeriodTracker::HPeriodKey
+HIntegrationPeriodTracker::GetKey(uint64_t acquisition_start_sec, uint64_t sample_rate, char sideband, char polarization,
+                                  uint64_t leading_sample_index, uint64_t n_samples) const
+{
+    //integration periods are aligned to the start of the acquisition
+    HPeriodKey key;
+    key.fAcquisitionStartSecond = acquisition_start_sec;
+    key.fSampleRate = sample_rate;
+    key.fSidebandFlag = sideband;
+    key.fPolarizationFlag = polarization;
+    key.fPeriodIndex = (n_samples == 0) ? 0 : leading_sample_index/(n_samples*fNBuffersPerPeriod);
+    return key;
+}
+
+size_t
+HIntegrationPeriodTracker::GetWorkerIndex()
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto it = fWorkerIndices.find( std::this_thread::get_id() );
+    if(it == fWorkerIndices.end())
+    {
+        size_t index = fWorkerIndices.size();
+        fWorkerIndices.insert( std::make_pair(std::this_thread::get_id(), index) );
+        return index;
+    }
+    return it->second;
+}
+
+double*
+HIntegrationPeriodTracker::Claim(const HPeriodKey& key, uint64_t leading_sample_index, uint64_t n_samples, size_t worker, HPeriod*& period)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+
+    //this buffer belongs to a period which has already been taken out, we can't use it
+    if(fHaveLastKey && key.SameStream(fLastKey) && !(fLastKey < key) )
+    {
+        fNLateBuffers++;
+        return nullptr;
+    }
+
+    auto it = fOpenPeriods.find(key);
+    if(it == fOpenPeriods.end())
+    {
+        HPeriod new_period;
+        new_period.fLeadingSampleIndex = key.fPeriodIndex*n_samples*fNBuffersPerPeriod;
+        new_period.fBufferSampleLength = n_samples;
+        new_period.fHaveFourthMoment = fEnableFourthMoment;
+        new_period.fValidityMask.resize(fNBuffersPerPeriod, 0);
+        new_period.fNBuffersAccumulated = 0;
+        new_period.fNFourthMomentAccumulated = 0;
+        new_period.fNInProgress = 0;
+        new_period.fNTotalSpectrum = 0;
+        new_period.fNTotalSamplesAccumulated = 0;
+        new_period.fNBlankedSamples = 0;
+        new_period.fLastUpdate = std::chrono::steady_clock::now();
+        it = fOpenPeriods.insert( std::make_pair(key, std::move(new_period)) ).first;
+        fNOpenPeriods = fOpenPeriods.size();
+    }
+    period = &(it->second);
+
+    //buffers are expected to tile the integration period exactly
+    size_t slot = (leading_sample_index - period->fLeadingSampleIndex)/period->fBufferSampleLength;
+    if(n_samples != period->fBufferSampleLength || leading_sample_index < period->fLeadingSampleIndex
+       || slot >= fNBuffersPerPeriod || period->fValidityMask[slot] != 0)
+    {
+        fNLateBuffers++;
+        return nullptr;
+    }
+    period->fValidityMask[slot] = 1;
+    period->fNInProgress++;
+
+    //each thread adds into its own partial sum (the memory of the inner vectors does not move if the outer one grows)
+    if(period->fPartialSums.size() <= worker){period->fPartialSums.resize(worker+1);}
+    if(period->fPartialSums[worker].size() == 0)
+    {
+        period->fPartialSums[worker] = GetSpareSum( period->fHaveFourthMoment ? 2*fSpectrumLength : fSpectrumLength );
+    }
+    return &( period->fPartialSums[worker][0] );
+}
+
+void
+HIntegrationPeriodTracker::Release(HPeriod* period, uint64_t n_spectra, uint64_t n_samples, uint64_t n_blanked_samples,
+                                   bool have_fourth_moment, const struct HDataAccumulationStruct& stat)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    period->fNInProgress--;
+    period->fNBuffersAccumulated++;
+    if(have_fourth_moment){period->fNFourthMomentAccumulated++;}
+    period->fNTotalSpectrum += n_spectra;
+    period->fNTotalSamplesAccumulated += n_samples;
+    period->fNBlankedSamples += n_blanked_samples;
+    period->fAccumulations.push_back(stat);
+    period->fLastUpdate = std::chrono::steady_clock::now();
+    fLastUpdateTime = period->fLastUpdate.time_since_epoch().count();
+    fNBuffersReceived++;
+}
+
+bool
+HIntegrationPeriodTracker::TakePeriod(unsigned int n_max_open, bool finish_all, HPeriodKey& key, HPeriod& period, HPeriodStatus& status)
+{
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        if(fOpenPeriods.size() == 0){return false;}
+
+        auto it = fOpenPeriods.begin();
+        if(it->second.fNInProgress != 0){return false;} //somebody is still adding to it
+
+        bool complete = (it->second.fNBuffersAccumulated == fNBuffersPerPeriod);
+        if(!complete)
+        {
+            //the oldest period is unfinished, give up on it if its stream has ended, if too
+            //many later periods have piled up behind it, or if no data has arrived for a while
+            auto next = it; next++;
+            bool stream_ended = ( next != fOpenPeriods.end() && !next->first.SameStream(it->first) );
+            bool backed_up = ( fOpenPeriods.size() > n_max_open );
+            bool stale = ( fTimeout != 0 && std::chrono::steady_clock::now() - it->second.fLastUpdate >= std::chrono::milliseconds(fTimeout) );
+            if( !stream_ended && !backed_up && !stale && !finish_all ){return false;}
+        }
+
+        key = it->first;
+        period = std::move(it->second);
+        fOpenPeriods.erase(it);
+        fNOpenPeriods = fOpenPeriods.size();
+
+        //anything for this period or before which turns up from now on is too late
+        if(!fHaveLastKey || !key.SameStream(fLastKey)){fNextSampleIndex = period.fLeadingSampleIndex;}
+        fHaveLastKey = true;
+        fLastKey = key;
+        AccountCoverage(period);
+
+        if(complete){status = eComplete;}
+        else if(fFlushPartial){status = ePartial;}
+        else{status = eDiscarded; fNDiscardedPeriods++;}
+    }
+
+    if(status == eDiscarded){Recycle(period);}
+    return true;
+}
+
+double*
+HIntegrationPeriodTracker::MergePartialSums(HPeriod& period)
+{
+    double* total = nullptr;
+    for(size_t j=0; j<period.fPartialSums.size(); j++)
+    {
+        if(period.fPartialSums[j].size() == 0){continue;}
+        if(total == nullptr){total = &(period.fPartialSums[j][0]);}
+        else{HSpectrumAccumulationKernel::Merge( &(period.fPartialSums[j][0]), total, period.fPartialSums[j].size() );}
+    }
+    return total;
+}
+
+void
+HIntegrationPeriodTracker::Recycle(HPeriod& period)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    for(size_t i=0; i<period.fPartialSums.size(); i++)
+    {
+        if(period.fPartialSums[i].size() != 0){fSpareSums.push_back( std::move(period.fPartialSums[i]) );}
+    }
+    period.fPartialSums.clear();
+}
+
+std::vector<double>
+HIntegrationPeriodTracker::GetSpareSum(size_t length)
+{
+    std::vector<double> sum;
+    if(fSpareSums.size() != 0)
+    {
+        sum = std::move(fSpareSums.back());
+        fSpareSums.pop_back();
+    }
+    sum.assign(length, 0.0);
+    return sum;
+}
+
+void
+HIntegrationPeriodTracker::AccountCoverage(HPeriod& period)
+{
+    //only the part of the integration period up to the last buffer received is covered,
+    //any holes in it are flagged (and counted along with any samples missing since the previous period)
+    size_t n_covered = fNBuffersPerPeriod;
+    while(n_covered > 0 && period.fValidityMask[n_covered-1] == 0){n_covered--;}
+    period.fValidityMask.resize(n_covered);
+    for(size_t i=0; i<n_covered; i++)
+    {
+        if(period.fValidityMask[i] != 0)
+        {
+            uint64_t block_start = period.fLeadingSampleIndex + i*period.fBufferSampleLength;
+            if(block_start > fNextSampleIndex){fNMissingSamples += block_start - fNextSampleIndex;}
+            fNextSampleIndex = block_start + period.fBufferSampleLength;
+        }
+    }
+}
+
+}
@@ -0,0 +1,218 @@
+#include "HPhaseCalibrationExtractor.hh"
+
+#include <cmath>
+#include <iostream>
+
+#include "HArrayWrapper.hh"
+#include "HFastFourierTransform.hh"
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+namespace hose
+{
+
+HPhaseCalibrationExtractor::HPhaseCalibrationExtractor():
+    fInitialized(false),
+    fSampleRate(0),
+    fFirstToneFrequency(0),
+    fToneSpacing(0),
+    fNRequestedTones(0),
+    fMaxFoldLength(1 << 22),
+    fChunkSize(1024),
+    fCombResolution(1),
+    fNSamples(0),
+    fFoldLength(0)
+{};
+
+HPhaseCalibrationExtractor::~HPhaseCalibrationExtractor(){};
+
+bool
+HPhaseCalibrationExtractor::Initialize()
+{
+    fToneFrequencies.clear();
+    if(fSampleRate == 0)
+    {
+        std::cout<<"HPhaseCalibrationExtractor::Initialize: Error, sample rate not set."<<std::endl;
+        return false;
+    }
+
+    //tones strictly between zero and the Nyquist frequency
+    uint64_t freq = fFirstToneFrequency;
+    while(2*freq < fSampleRate && (fNRequestedTones == 0 || fToneFrequencies.size() < fNRequestedTones) )
+    {
+        if(freq != 0){fToneFrequencies.push_back(freq);}
+        if(fToneSpacing == 0){break;}
+        freq += fToneSpacing;
+    }
+    if(fToneFrequencies.size() == 0)
+    {
+        std::cout<<"HPhaseCalibrationExtractor::Initialize: Error, no tones below the Nyquist frequency (first tone "<<fFirstToneFrequency<<" Hz, spacing "<<fToneSpacing<<" Hz)."<<std::endl;
+        return false;
+    }
+
+    //the comb repeats every fs/gcd(fs, f0, df) samples
+    fCombResolution = HOscillatorPhase::GreatestCommonDivisor(fSampleRate, HOscillatorPhase::GreatestCommonDivisor(fFirstToneFrequency, fToneSpacing) );
+    uint64_t period = fSampleRate/fCombResolution;
+    fFoldLength = (period <= fMaxFoldLength) ? period : 0;
+
+    fFold.clear();
+    fRotationReal.clear();
+    fRotationImag.clear();
+    if(fFoldLength != 0)
+    {
+        fFold.assign(fFoldLength, 0.0);
+    }
+    else
+    {
+        size_t n_tones = fToneFrequencies.size();
+        fRotationReal.resize(n_tones*fChunkSize);
+        fRotationImag.resize(n_tones*fChunkSize);
+        for(size_t t=0; t<n_tones; t++)
+        {
+            for(size_t k=0; k<fChunkSize; k++)
+            {
+                std::complex<double> r = Phasor(fToneFrequencies[t], k);
+                fRotationReal[t*fChunkSize + k] = r.real();
+                fRotationImag[t*fChunkSize + k] = r.imag();
+            }
+        }
+    }
+    fToneSums.assign(fToneFrequencies.size(), std::complex<double>(0.0, 0.0));
+    fInput.resize(fChunkSize);
+
+    fInitialized = true;
+    Reset();
+    return true;
+}
+
+void
+HPhaseCalibrationExtractor::Reset()
+{
+    std::fill(fFold.begin(), fFold.end(), 0.0);
+    std::fill(fToneSums.begin(), fToneSums.end(), std::complex<double>(0.0, 0.0));
+    fNSamples = 0;
+}
+
+void
+HPhaseCalibrationExtractor::Merge(const HPhaseCalibrationExtractor& other)
+{
+    if(!fInitialized && !Initialize()){return;}
+    if(other.fFold.size() != fFold.size() || other.fToneSums.size() != fToneSums.size())
+    {
+        std::cout<<"HPhaseCalibrationExtractor::Merge: Error, the extractors do not have the same configuration."<<std::endl;
+        return;
+    }
+    for(size_t j=0; j<fFold.size(); j++){fFold[j] += other.fFold[j];}
+    for(size_t t=0; t<fToneSums.size(); t++){fToneSums[t] += other.fToneSums[t];}
+    fNSamples += other.fNSamples;
+}
+
+void
+HPhaseCalibrationExtractor::AccumulateFold(const float* x, size_t n, uint64_t first_sample_index)
+{
+    //add contiguous runs of the chunk onto the folded period
+    size_t j = first_sample_index % fFoldLength;
+    double* fold = &(fFold[0]);
+    size_t i = 0;
+    while(i < n)
+    {
+        size_t run = std::min(n - i, fFoldLength - j);
+        for(size_t k=0; k<run; k++){fold[j + k] += x[i + k];}
+        i += run;
+        j = 0;
+    }
+}
+
+void
+HPhaseCalibrationExtractor::AccumulateRotators(const float* x, size_t n, uint64_t first_sample_index)
+{
+    //sum_k x[k]*e^{-i*w*(n0+k)} = e^{-i*w*n0} * sum_k x[k]*r[k]
+    for(size_t t=0; t<fToneFrequencies.size(); t++)
+    {
+        const float* rr = &(fRotationReal[t*fChunkSize]);
+        const float* ri = &(fRotationImag[t*fChunkSize]);
+        float sr = 0.0f;
+        float si = 0.0f;
+        size_t k = 0;
+
+        #if defined(__SSE2__)
+        __m128 vsr = _mm_setzero_ps();
+        __m128 vsi = _mm_setzero_ps();
+        for(; k+4 <= n; k += 4)
+        {
+            __m128 vx = _mm_loadu_ps(x + k);
+            vsr = _mm_add_ps(vsr, _mm_mul_ps(vx, _mm_loadu_ps(rr + k)) );
+            vsi = _mm_add_ps(vsi, _mm_mul_ps(vx, _mm_loadu_ps(ri + k)) );
+        }
+        float tr[4];
+        float ti[4];
+        _mm_storeu_ps(tr, vsr);
+        _mm_storeu_ps(ti, vsi);
+        sr = (tr[0] + tr[1]) + (tr[2] + tr[3]);
+        si = (ti[0] + ti[1]) + (ti[2] + ti[3]);
+        #endif
+
+        for(; k<n; k++)
+        {
+            sr += x[k]*rr[k];
+            si += x[k]*ri[k];
+        }
+        fToneSums[t] += Phasor(fToneFrequencies[t], first_sample_index)*std::complex<double>(sr, si);
+    }
+}
+
+void
+HPhaseCalibrationExtractor::GetToneSums(std::vector< std::complex<double> >& sums) const
+{
+    sums.assign(fToneFrequencies.size(), std::complex<double>(0.0, 0.0));
+    if(!fInitialized){return;}
+
+    if(fFoldLength == 0)
+    {
+        sums = fToneSums;
+        return;
+    }
+
+    //each tone falls exactly on a bin of the transform of the folded period, bin m = f*P/fs = f/gcd, the (forward)
+    //transform uses the e^{+i} kernel, and the input is real, so the e^{-i} sum is the conjugate of the bin
+    std::vector< std::complex<double> > work(fFoldLength);
+    for(size_t j=0; j<fFoldLength; j++){work[j] = std::complex<double>(fFold[j], 0.0);}
+    HArrayWrapper< std::complex<double>, 1 > wrapper;
+    size_t dim[1] = {fFoldLength};
+    wrapper.SetData(&(work[0]));
+    wrapper.SetArrayDimensions(dim);
+    HFastFourierTransform fft;
+    fft.SetSize(fFoldLength);
+    fft.SetForward();
+    fft.SetInput(&wrapper);
+    fft.SetOutput(&wrapper);
+    fft.Initialize();
+    fft.ExecuteOperation();
+
+    for(size_t t=0; t<fToneFrequencies.size(); t++)
+    {
+        uint64_t bin = fToneFrequencies[t]/fCombResolution;
+        sums[t] = std::conj(work[bin]);
+    }
+}
+
+void
+HPhaseCalibrationExtractor::GetTones(std::vector< double >& amplitude, std::vector< double >& phase) const
+{
+    std::vector< std::complex<double> > sums;
+    GetToneSums(sums);
+    amplitude.assign(sums.size(), 0.0);
+    phase.assign(sums.size(), 0.0);
+    if(fNSamples == 0){return;}
+
+    //a tone a*cos(w*n + p) sums to (N*a/2)*e^{ip}
+    for(size_t t=0; t<sums.size(); t++)
+    {
+        amplitude[t] = 2.0*std::abs(sums[t])/( (double) fNSamples );
+        phase[t] = std::arg(sums[t]);
+    }
+}
+
+}
@@ -0,0 +1,102 @@
+#include "HPowerSpectrumAccumulator.hh"
+#include "HWindowFunction.hh"
+
+#include <cmath>
+#include <iostream>
+
+namespace hose
+{
+
+HPowerSpectrumAccumulator::HPowerSpectrumAccumulator():
+    fInitialized(false),
+    fFFTSize(0),
+    fWindowFlag(0),
+    fWindowSumOfSquares(0),
+    fNSpectra(0),
+    fHavePendingFrame(false)
+{};
+
+HPowerSpectrumAccumulator::~HPowerSpectrumAccumulator(){};
+
+bool
+HPowerSpectrumAccumulator::Initialize()
+{
+    if(fFFTSize < 2)
+    {
+        std::cout<<"HPowerSpectrumAccumulator::Initialize: Error, invalid FFT size: "<<fFFTSize<<"."<<std::endl;
+        return false;
+    }
+
+    fWindowSumOfSquares = HWindowFunction::Fill(fWindowFlag, fFFTSize, fWindow);
+
+    fWorkspace.resize(fFFTSize);
+    size_t dim[1] = {fFFTSize};
+    fWorkspaceWrapper.SetData(&(fWorkspace[0]));
+    fWorkspaceWrapper.SetArrayDimensions(dim);
+    fFFT.SetSize(fFFTSize);
+    fFFT.SetForward();
+    fFFT.SetInput(&fWorkspaceWrapper);
+    fFFT.SetOutput(&fWorkspaceWrapper);
+    fFFT.Initialize();
+
+    fInitialized = true;
+    Reset();
+    return true;
+}
+
+void
+HPowerSpectrumAccumulator::Reset()
+{
+    fPowerSum.assign(GetSpectrumLength(), 0.0);
+    fNSpectra = 0;
+    fHavePendingFrame = false;
+}
+
+void
+HPowerSpectrumAccumulator::AddFrame(const float* x)
+{
+    if(!fInitialized && !Initialize()){return;}
+
+    if(!fHavePendingFrame)
+    {
+        //first frame of a pair goes into the real part
+        for(size_t i=0; i<fFFTSize; i++){fWorkspace[i] = std::complex<double>(fWindow[i]*x[i], 0.0);}
+        fHavePendingFrame = true;
+    }
+    else
+    {
+        //second frame goes into the imaginary part, then both are transformed
+        for(size_t i=0; i<fFFTSize; i++){fWorkspace[i].imag(fWindow[i]*x[i]);}
+        TransformFrames();
+        fNSpectra += 2;
+        fHavePendingFrame = false;
+    }
+}
+
+void
+HPowerSpectrumAccumulator::Flush()
+{
+    if(fHavePendingFrame)
+    {
+        //the imaginary part is zero, so the 'second' spectrum vanishes
+        TransformFrames();
+        fNSpectra += 1;
+        fHavePendingFrame = false;
+    }
+}
+
+void
+HPowerSpectrumAccumulator::TransformFrames()
+{
+    fFFT.ExecuteOperation();
+
+    //with z = a + ib (a and b real), A[k] = (Z[k] + Z*[N-k])/2 and B[k] = (Z[k] - Z*[N-k])/2i,
+    //and since |A[k]|^2 + |B[k]|^2 = (|Z[k]|^2 + |Z[N-k]|^2)/2, the pair of power spectra is a simple sum
+    for(size_t k=0; k<=fFFTSize/2; k++)
+    {
+        size_t nk = (fFFTSize - k) % fFFTSize;
+        fPowerSum[k] += 0.5*( std::norm(fWorkspace[k]) + std::norm(fWorkspace[nk]) );
+    }
+}
+
+}
@@ -0,0 +1,106 @@
+#include "HSpectralKurtosisFlagger.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <unistd.h>
+
+namespace hose
+{
+
+HSpectralKurtosisFlagger::HSpectralKurtosisFlagger():
+    fThresholdSigma(3.0),
+    fNSpectraFlagged(0),
+    fNChannelsFlagged(0)
+{};
+
+HSpectralKurtosisFlagger::~HSpectralKurtosisFlagger(){};
+
+size_t
+HSpectralKurtosisFlagger::FlagSpectrum(const float* power, const float* power2, size_t length, uint64_t n_spectra, uint64_t n_buffers, std::vector< uint8_t >& mask) const
+{
+    mask.assign(length, 0);
+    if(n_spectra < 2 || n_buffers == 0){return 0;}
+
+    double m = n_spectra;
+    double nb = n_buffers;
+    double sigma = std::sqrt( 4.0*m*m/( (m-1.0)*(m+2.0)*(m+3.0) ) );
+    double bound = fThresholdSigma*sigma;
+
+    //the spectra are averages over the buffers, so S1 = nb*power and S2 = nb*power2
+    double norm = (m+1.0)/(m-1.0);
+    double ratio = m/nb;
+    size_t n_flagged = 0;
+    for(size_t i=0; i<length; i++)
+    {
+        double s1 = power[i];
+        double s2 = power2[i];
+        if(s1 <= 0.0 || s2 <= 0.0){continue;} //no data in this channel
+        double sk = norm*( ratio*s2/(s1*s1) - 1.0 );
+        if( std::fabs(sk - 1.0) > bound )
+        {
+            mask[i] = 1;
+            n_flagged++;
+        }
+    }
+    return n_flagged;
+}
+
+void
+HSpectralKurtosisFlagger::ExecuteThreadTask()
+{
+    HLinearBuffer< float >* tail = nullptr;
+
+    if( this->fBufferPool->GetConsumerPoolSize( this->GetConsumerID() ) != 0 )
+    {
+        HConsumerBufferPolicyCode buffer_code = this->fBufferHandler.ReserveBuffer(this->fBufferPool, tail, this->GetConsumerID() );
+        if( (buffer_code & HConsumerBufferPolicyCode::success) && tail != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(tail->fMutex);
+            HBufferMetaData* meta = tail->GetMetaData();
+            size_t length = meta->GetPowerSpectrumLength();
+
+            if(length != 0 && tail->GetArrayDimension(0) >= 2*length)
+            {
+                //the number of buffers in the average is the number of blocks marked valid
+                const std::vector< uint8_t >* validity = meta->GetValidityMask();
+                uint64_t n_buffers = std::count(validity->begin(), validity->end(), 1);
+                if(validity->size() == 0){n_buffers = 1;}
+
+                const float* power = tail->GetData();
+                size_t n_flagged = FlagSpectrum(power, power + length, length, meta->GetNTotalSpectrum(), n_buffers, *(meta->GetRFIMask()) );
+                if(n_flagged != 0)
+                {
+                    fNSpectraFlagged++;
+                    fNChannelsFlagged += n_flagged;
+                }
+            }
+            else
+            {
+                meta->ClearRFIMask();
+            }
+        }
+
+        if(tail != nullptr)
+        {
+            this->fBufferHandler.ReleaseBufferToConsumer(this->fBufferPool, tail, this->GetNextConsumerID() );
+        }
+    }
+}
+
+bool
+HSpectralKurtosisFlagger::WorkPresent()
+{
+    if(this->fBufferPool->GetConsumerPoolSize(this->GetConsumerID()) == 0)
+    {
+        return false;
+    }
+    return true;
+}
+
+void
+HSpectralKurtosisFlagger::Idle()
+{
+    usleep(10);
+}
+
+}
@@ -1,11 +1,16 @@
 #include "HSpectrometerCUDA.hh"
 
+//number of buffer tails retained for the overlapping frames (oldest are discarded first)
+#define MAX_N_TAILS 16
+
 namespace hose
 {
 
 HSpectrometerCUDA::HSpectrometerCUDA(size_t spectrum_length, size_t n_averages):
     fSpectrumLength(spectrum_length),
-    fNAverages(n_averages)
+    fNAverages(n_averages),
+    fEnableSpectralKurtosis(false),
+    fNMissingTails(0)
     {
         //std::cout<<"cuda spectrometer  = "<<this<<std::endl;
     };
@@ -14,6 +19,17 @@ HSpectrometerCUDA::HSpectrometerCUDA(size_t spectrum_length, size_t n_averages):
 HSpectrometerCUDA::~HSpectrometerCUDA(){};
 
 
+void
+HSpectrometerCUDA::Reconfigure(size_t spectrum_length, size_t n_averages)
+{
+    fSpectrumLength = spectrum_length;
+    fNAverages = n_averages;
+
+    std::lock_guard<std::mutex> lock(fTailMutex);
+    fTails.clear();
+}
+
+
 bool
 HSpectrometerCUDA::WorkPresent()
 {
@@ -49,7 +65,9 @@ HSpectrometerCUDA::ExecuteThreadTask()
             if( (source_code & HConsumerBufferPolicyCode::success) && source !=nullptr)
             {
 
-                std::lock_guard<std::mutex> source_lock(source->fMutex);
+                //in fan-out mode the source buffer is shared (read-only) with the other consumers, so we don't lock it
+                std::unique_lock<std::mutex> source_lock(source->fMutex, std::defer_lock);
+                if( !fSourceBufferPool->IsFanOutEnabled() ){ source_lock.lock(); }
 
                 //point the sdata to the buffer object (this is a horrible hack)
                 sdata = &( (sink->GetData())[0] ); //should have buffer size of 1
@@ -62,9 +80,21 @@ HSpectrometerCUDA::ExecuteThreadTask()
                 sdata->data_length = source->GetArrayDimension(0); //also equal to fSpectrumLength*fNAverages;
                 sdata->spectrum_length = fSpectrumLength;
                 sdata->n_spectra = fNAverages;
+                sdata->kurtosis_flag = fEnableSpectralKurtosis ? 1 : 0;
+
+                //overlapping frames also need the end of the previous buffer
+                std::vector< SAMPLE_TYPE > previous_tail;
+                sdata->tail = nullptr;
+                if(sdata->overlap_factor > 1)
+                {
+                    size_t tail_length = fSpectrumLength - fSpectrumLength/sdata->overlap_factor;
+                    if( ExchangeTail(source, tail_length, previous_tail) ){ sdata->tail = &(previous_tail[0]); }
+                    else{ fNMissingTails++; }
+                }
 
                 //call Juha's process_vector routine
                 process_vector_no_output(source->GetData(), sdata);
+                sdata->tail = nullptr;
 
                 sdata->validity_flag = 1;
 
@@ -84,6 +114,33 @@ HSpectrometerCUDA::ExecuteThreadTask()
 
 }
 
+bool
+HSpectrometerCUDA::ExchangeTail(HLinearBuffer< SAMPLE_TYPE >* source, size_t tail_length, std::vector< SAMPLE_TYPE >& previous_tail)
+{
+    const HBufferMetaData* meta = source->GetMetaData();
+    size_t length = source->GetArrayDimension(0);
+    if(tail_length == 0 || tail_length > length){return false;}
+
+    uint64_t start_second = meta->GetAcquisitionStartSecond();
+    uint64_t leading_index = meta->GetLeadingSampleIndex();
+    const SAMPLE_TYPE* data = source->GetData();
+    std::vector< SAMPLE_TYPE > tail(data + length - tail_length, data + length);
+
+    std::lock_guard<std::mutex> lock(fTailMutex);
+    fTails[ std::make_pair(start_second, leading_index + length) ] = std::move(tail);
+
+    bool found = false;
+    auto it = fTails.find( std::make_pair(start_second, leading_index) );
+    if(it != fTails.end())
+    {
+        previous_tail = std::move(it->second);
+        fTails.erase(it);
+        found = true;
+    }
+
+    while(fTails.size() > MAX_N_TAILS){fTails.erase(fTails.begin());}
+    return found;
+}
 
 
 }
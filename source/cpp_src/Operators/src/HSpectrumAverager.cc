@@ -1,6 +1,7 @@
 #include "HSpectrumAverager.hh"
 #include "HNetworkDefines.hh"
 
+#include <algorithm>
 #include <cstdlib>
 
 
@@ -10,15 +11,19 @@ namespace hose
 HSpectrumAverager::HSpectrumAverager(size_t spectrum_length, size_t n_buffers):
     fPowerSpectrumLength(spectrum_length),
     fNBuffersToAccumulate(n_buffers),
-    fSpecLowerBound(0),
-    fSpecUpperBound(0),
+    fPeriods(spectrum_length, n_buffers),
+    fFinishAll(false),
     fEnableNoiseUDP(false),
     fEnableSpectrumUDP(false),
-    fSkipInterval(8)
+    fSkipInterval(8),
+    fSpecLowerBound(0),
+    fSpecUpperBound(0),
+    fNDroppedAverages(0),
+    fEnableSpectralKurtosis(false),
+    fNMaxOpenAverages(0),
+    fNPartialAverages(0)
 {
-    fAccumulatedSpectrum.resize(spectrum_length);
-    fAccumulationBuffer = new HLinearBuffer<float>( &(fAccumulatedSpectrum[0]), spectrum_length);
-    fNBuffersAccumulated = 0;
+    if(fNBuffersToAccumulate == 0){fNBuffersToAccumulate = 1;}
 };
 
 
@@ -27,19 +32,23 @@ HSpectrumAverager::HSpectrumAverager(size_t spectrum_length, size_t n_buffers,
                                      std::string spec_port, std::string spec_ip):
     fPowerSpectrumLength(spectrum_length),
     fNBuffersToAccumulate(n_buffers),
+    fPeriods(spectrum_length, n_buffers),
+    fFinishAll(false),
+    fEnableNoiseUDP(false),
+    fEnableSpectrumUDP(false),
+    fSkipInterval(8),
     fNoisePort(noise_port),
     fNoiseIPAddress(noise_ip),
     fSpectrumPort(spec_port),
     fSpectrumIPAddress(spec_ip),
     fSpecLowerBound(0),
     fSpecUpperBound(0),
-    fEnableNoiseUDP(false),
-    fEnableSpectrumUDP(false),
-    fSkipInterval(8)
+    fNDroppedAverages(0),
+    fEnableSpectralKurtosis(false),
+    fNMaxOpenAverages(0),
+    fNPartialAverages(0)
 {
-        fAccumulatedSpectrum.resize(spectrum_length);
-        fAccumulationBuffer = new HLinearBuffer<float>( &(fAccumulatedSpectrum[0]), spectrum_length);
-        fNBuffersAccumulated = 0;
+        if(fNBuffersToAccumulate == 0){fNBuffersToAccumulate = 1;}
 
         #ifdef HOSE_USE_ZEROMQ
             //fEnableNoiseUDP = true;
@@ -77,12 +86,34 @@ HSpectrumAverager::~HSpectrumAverager()
 };
 
 
+void
+HSpectrumAverager::Reconfigure(size_t spectrum_length, size_t n_buffers)
+{
+    //pass on whatever is left of the old configuration first
+    fFinishAll = true;
+    FinishAverages();
+    fFinishAll = false;
+
+    fPowerSpectrumLength = spectrum_length;
+    fNBuffersToAccumulate = n_buffers;
+    if(fNBuffersToAccumulate == 0){fNBuffersToAccumulate = 1;}
+    fPeriods.Configure(fPowerSpectrumLength, fNBuffersToAccumulate);
+
+    #ifdef ENABLE_SPECTRUM_UDP
+        fBinFactor = fPowerSpectrumLength/SPEC_UDP_NBINS;
+    #endif
+}
+
+
 bool
 HSpectrumAverager::WorkPresent()
 {
     if( fSourceBufferPool->GetConsumerPoolSize( this->GetConsumerID() ) == 0)
     {
-        return false;
+        //nothing new to process, but an unfinished average may have been waiting too long
+        if(fPeriods.GetNOpenPeriods() == 0 || fPeriods.GetTimeoutMilliseconds() == 0){return false;}
+        std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - fPeriods.GetLastUpdateTime();
+        return ( elapsed >= std::chrono::milliseconds( fPeriods.GetTimeoutMilliseconds() ) );
     }
     return true;
 }
@@ -100,204 +131,161 @@ HSpectrumAverager::ExecuteThreadTask()
         HConsumerBufferPolicyCode source_code = this->fSourceBufferHandler.ReserveBuffer(this->fSourceBufferPool, source, this->GetConsumerID());
         if( (source_code & HConsumerBufferPolicyCode::success) && source !=nullptr)
         {
-            std::lock_guard<std::mutex> source_lock(source->fMutex);
-            sdata = &( (source->GetData())[0] ); //should have buffer size of 1
-
-                //first collect the meta-data information from this buffer
-            char sideband_flag = source->GetMetaData()->GetSidebandFlag() ;
-            char pol_flag = source->GetMetaData()->GetPolarizationFlag();
-            uint64_t start_second = source->GetMetaData()->GetAcquisitionStartSecond();
-            uint64_t sample_rate = source->GetMetaData()->GetSampleRate();
-            uint64_t leading_sample_index = source->GetMetaData()->GetLeadingSampleIndex();
-            uint64_t n_spectra = sdata->n_spectra;
-            uint64_t n_spectrum_samples_length = sdata->spectrum_length; //number of samples used in FFT to create an individual spectrum
-            uint64_t power_spectrum_length = ((sdata->spectrum_length)/2+1); //length of the power spectrum
-            uint64_t n_total_samples = n_spectra*n_spectrum_samples_length; //total number of samples used to compute the averaged spectrum we get from this buffer
-
-            //collect the noise power data
-            float sum = sdata->sum;
-            float sum2 = sdata->sum2;
-
-            //pass checks?
-            if(fNBuffersAccumulated == 0 && power_spectrum_length == fPowerSpectrumLength)
             {
-                //first buffer recieved since reset, so re-initialize the values
-                fNBuffersAccumulated++;
-                fSidebandFlag = sideband_flag;
-                fPolarizationFlag = pol_flag;
-                fAcquisitionStartSecond = start_second;
-                fSampleRate = sample_rate;
-                fLeadingSampleIndex = leading_sample_index;
-                fNTotalSpectrum = n_spectra;
-                fNTotalSamplesAccumulated = n_total_samples;
-                Accumulate(sdata->spectrum);
-                this->fSourceBufferHandler.ReleaseBufferToConsumer(this->fSourceBufferPool, source, this->GetNextConsumerID() );
-                source = nullptr;
-
-                //noise power data
-                struct HDataAccumulationStruct stat;
-                stat.start_index = leading_sample_index;
-                stat.stop_index = leading_sample_index + n_total_samples;
-                stat.sum_x = sum;
-                stat.sum_x2 = sum2;
-                stat.count = n_total_samples;
-                stat.state_flag = H_NOISE_UNKNOWN;
-                fNoisePowerAccumulator.AppendAccumulation(stat);
-
-                #ifdef HOSE_USE_ZEROMQ
-                    if(fEnableNoiseUDP && fNBuffersAccumulated%fSkipInterval == 0){SendNoisePowerUDPPacket(fAcquisitionStartSecond, fLeadingSampleIndex, fSampleRate, stat);}
-                #endif 
+                std::lock_guard<std::mutex> source_lock(source->fMutex);
+                sdata = &( (source->GetData())[0] ); //should have buffer size of 1
 
+                //first collect the meta-data information from this buffer
+                uint64_t leading_sample_index = source->GetMetaData()->GetLeadingSampleIndex();
+                uint64_t power_spectrum_length = ((sdata->spectrum_length)/2+1); //length of the power spectrum
+                //total number of samples used to compute the averaged spectrum we get from this buffer
+                //(not n_spectra*spectrum_length, since the frames may overlap)
+                uint64_t n_total_samples = sdata->data_length;
 
-            }
-            else if( CheckMetaData(sideband_flag, pol_flag, start_second, sample_rate, leading_sample_index) ) //meta data matches, so accumulate another spectrum
-            {
-                //accumulate statistics
-                //first buffer recieved since reset, so re-initialize the values
-                fNBuffersAccumulated++;
-                fNTotalSpectrum += n_spectra;
-                fNTotalSamplesAccumulated += n_total_samples;
-                Accumulate(sdata->spectrum);
-                this->fSourceBufferHandler.ReleaseBufferToConsumer(this->fSourceBufferPool, source, this->GetNextConsumerID() );
-                source = nullptr;
-
-                //noise power data
-                struct HDataAccumulationStruct stat;
-                stat.start_index = leading_sample_index;
-                stat.stop_index = leading_sample_index + n_total_samples;
-                stat.sum_x = sum;
-                stat.sum_x2 = sum2;
-                stat.count = n_total_samples;
-                stat.state_flag = H_NOISE_UNKNOWN;
-                fNoisePowerAccumulator.AppendAccumulation(stat);
-
-                #ifdef HOSE_USE_ZEROMQ
-                    if(fEnableNoiseUDP && fNBuffersAccumulated%fSkipInterval == 0){SendNoisePowerUDPPacket(fAcquisitionStartSecond, fLeadingSampleIndex, fSampleRate, stat);}
-                #endif 
-
-                //check if we have reached the desired number of buffers,
-                if(fNBuffersAccumulated == fNBuffersToAccumulate)
+                if(power_spectrum_length == fPowerSpectrumLength && n_total_samples != 0)
                 {
-                    WriteAccumulatedSpectrumAverage();
-                    Reset();
-                }
-            }
-            else
-            {
-                //bail out, something changed before we accumulated the required number of buffers,
-                //so write out what we have now and re-init
-                //WriteAccumulatedSpectrumAverage();
-                Reset();
-
-                //now start on new buffer
-                fNBuffersAccumulated++;
-                fSidebandFlag = sideband_flag;
-                fPolarizationFlag = pol_flag;
-                fAcquisitionStartSecond = start_second;
-                fSampleRate = sample_rate;
-                fLeadingSampleIndex = leading_sample_index;
-                fNTotalSpectrum = n_spectra;
-                fNTotalSamplesAccumulated = n_total_samples;
-                Accumulate(sdata->spectrum);
-
-                //noise power data
-                struct HDataAccumulationStruct stat;
-                stat.start_index = leading_sample_index;
-                stat.stop_index = leading_sample_index + n_total_samples;
-                stat.sum_x = sum;
-                stat.sum_x2 = sum2;
-                stat.count = n_total_samples;
-                stat.state_flag = H_NOISE_UNKNOWN;
-                fNoisePowerAccumulator.AppendAccumulation(stat);
-
-                this->fSourceBufferHandler.ReleaseBufferToConsumer(this->fSourceBufferPool, source, this->GetNextConsumerID() );
-                source = nullptr;
-
-                //check if we have reached the desired number of buffers, (unlikely here, can only happen if fNBuffersAccumulated is 1)
-                if(fNBuffersAccumulated == fNBuffersToAccumulate)
-                {
-                    WriteAccumulatedSpectrumAverage();
-                    Reset();
+                    const HBufferMetaData* meta = source->GetMetaData();
+                    HAverageKey key = fPeriods.GetKey(meta->GetAcquisitionStartSecond(), meta->GetSampleRate(), meta->GetSidebandFlag(),
+                                                      meta->GetPolarizationFlag(), leading_sample_index, n_total_samples);
+
+                    HAverage* average = nullptr;
+                    size_t worker = fPeriods.GetWorkerIndex();
+                    double* partial_sum = fPeriods.Claim(key, leading_sample_index, n_total_samples, worker, average);
+                    if(partial_sum != nullptr)
+                    {
+                        //this is the expensive part, and it is done without holding any locks
+                        //(the power in the noise-power bins is picked up on the same pass over the spectrum)
+                        double spectral_power_sum = HSpectrumAccumulationKernel::AccumulateWithBandPower(sdata->spectrum, partial_sum,
+                                                                                                         fPowerSpectrumLength, fSpecLowerBound, fSpecUpperBound);
+
+                        //the |X|^4 spectrum (if any) is kept right after the power spectrum
+                        bool have_fourth_moment = (average->fHaveFourthMoment && sdata->kurtosis_flag == 1 && sdata->spectrum2 != nullptr);
+                        if(have_fourth_moment)
+                        {
+                            HSpectrumAccumulationKernel::AccumulateWithBandPower(sdata->spectrum2, partial_sum + fPowerSpectrumLength, fPowerSpectrumLength, 0, 0);
+                        }
+
+                        //noise power data
+                        struct HDataAccumulationStruct stat;
+                        stat.start_index = leading_sample_index;
+                        stat.stop_index = leading_sample_index + n_total_samples;
+                        stat.sum_x = sdata->sum;
+                        stat.sum_x2 = sdata->sum2;
+                        stat.count = n_total_samples;
+                        stat.state_flag = H_NOISE_UNKNOWN;
+
+                        fPeriods.Release(average, sdata->n_spectra, n_total_samples, meta->GetNBlankedSamples(), have_fourth_moment, stat);
+
+                        #ifdef HOSE_USE_ZEROMQ
+                            if(fEnableNoiseUDP && fPeriods.GetNBuffersReceived()%fSkipInterval == 0)
+                            {
+                                SendNoisePowerUDPPacket(key.fAcquisitionStartSecond, leading_sample_index, key.fSampleRate, stat, spectral_power_sum);
+                            }
+                        #else
+                            (void) spectral_power_sum;
+                        #endif
+                    }
                 }
             }
+            this->fSourceBufferHandler.ReleaseBufferToConsumer(this->fSourceBufferPool, source, this->GetNextConsumerID() );
+            source = nullptr;
         }
-
-        // if(source != nullptr)
-        // {
-        //     //std::cout<<"averager releasing spec source buffer to consumer #"<<this->GetNextConsumerID()<<" in pool: "<<this->fSourceBufferPool<<std::endl;
-        //     //release source buffer
-        //     this->fSourceBufferHandler.ReleaseBufferToConsumer(this->fSourceBufferPool, source, this->GetNextConsumerID() );
-        // }
-
     }
-}
 
-
-bool
-HSpectrumAverager::CheckMetaData(char sideband_flag, char pol_flag, uint64_t start_second, uint64_t sample_rate, uint64_t leading_sample_index) const
-{
-    if(fSidebandFlag != sideband_flag){return false;}
-    if(fPolarizationFlag != pol_flag){return false;}
-    if(fAcquisitionStartSecond != start_second){return false;}
-    if(fSampleRate != sample_rate){return false;}
-    if(leading_sample_index < fLeadingSampleIndex){return false;}
-    return true;
+    //pass on whatever averages are ready
+    FinishAverages();
 }
 
+
 void
-HSpectrumAverager::Accumulate(float* array)
+HSpectrumAverager::FinishAverages()
 {
-    float* accum = fAccumulationBuffer->GetData();
-    for(size_t i=0; i<fPowerSpectrumLength; i++)
-    {
-        accum[i] += array[i];
-    }
-    
-    //hopefully this is not too inefficient --- if it is, we may have to move this to the GPU
-    //accculate total 'power' in specified spectral bins
-    fSpectralPowerSum = 0.0;
-    for(size_t j=fSpecLowerBound; j<fSpecUpperBound; j++)
+    //only one thread at a time, so that the averages are passed on in order
+    std::lock_guard<std::mutex> finish_lock(fFinishMutex);
+
+    unsigned int n_max_open = fNMaxOpenAverages;
+    if(n_max_open == 0){n_max_open = this->GetNThreads() + 1;}
+
+    HAverageKey key;
+    HAverage average;
+    HIntegrationPeriodTracker::HPeriodStatus status;
+    while( fPeriods.TakePeriod(n_max_open, fFinishAll, key, average, status) )
     {
-        fSpectralPowerSum += array[j];
+        if(status == HIntegrationPeriodTracker::eDiscarded){continue;}
+        bool written = WriteAccumulatedSpectrumAverage(key, average);
+        if(written && status == HIntegrationPeriodTracker::ePartial){fNPartialAverages++;}
+
+        //keep the partial sum arrays for re-use
+        fPeriods.Recycle(average);
     }
 }
 
+
 bool
-HSpectrumAverager::WriteAccumulatedSpectrumAverage()
+HSpectrumAverager::WriteAccumulatedSpectrumAverage(const HAverageKey& key, HAverage& average)
 {
+    if(average.fNBuffersAccumulated == 0){return false;}
+
     HLinearBuffer< float >* sink = nullptr;
     HProducerBufferPolicyCode sink_code = this->fSinkBufferHandler.ReserveBuffer(this->fSinkBufferPool, sink);
     if( (sink_code & HProducerBufferPolicyCode::success) && sink != nullptr)
     {
         std::lock_guard<std::mutex> sink_lock(sink->fMutex);
         //set the meta data values
-        sink->GetMetaData()->SetSidebandFlag(fSidebandFlag);
-        sink->GetMetaData()->SetPolarizationFlag(fPolarizationFlag);
-        sink->GetMetaData()->SetAcquisitionStartSecond(fAcquisitionStartSecond);
-        sink->GetMetaData()->SetSampleRate(fSampleRate);
-        sink->GetMetaData()->SetLeadingSampleIndex(fLeadingSampleIndex);
+        sink->GetMetaData()->SetSidebandFlag(key.fSidebandFlag);
+        sink->GetMetaData()->SetPolarizationFlag(key.fPolarizationFlag);
+        sink->GetMetaData()->SetAcquisitionStartSecond(key.fAcquisitionStartSecond);
+        sink->GetMetaData()->SetSampleRate(key.fSampleRate);
+        sink->GetMetaData()->SetLeadingSampleIndex(average.fLeadingSampleIndex);
         //bits of meta data specific to averaging spectrum together
-        sink->GetMetaData()->SetNTotalSpectrum(fNTotalSpectrum);
-        sink->GetMetaData()->SetNTotalSamplesCollected(fNTotalSamplesAccumulated);
+        sink->GetMetaData()->SetNTotalSpectrum(average.fNTotalSpectrum);
+        sink->GetMetaData()->SetNTotalSamplesCollected(average.fNTotalSamplesAccumulated);
         sink->GetMetaData()->SetPowerSpectrumLength(fPowerSpectrumLength);
+        //(the validity mask only covers the part of the period up to the last buffer received)
+        sink->GetMetaData()->SetValidityMask(average.fValidityMask, average.fBufferSampleLength);
+        sink->GetMetaData()->SetNBlankedSamples(average.fNBlankedSamples);
         //noise diode is not used at 37m
         sink->GetMetaData()->SetNoiseDiodeSwitchingFrequency(0);
         sink->GetMetaData()->SetNoiseDiodeBlankingPeriod(0);
 
-        //compute average and finish writing meta data
-        float* accum = fAccumulationBuffer->GetData();
+        sink->GetMetaData()->ClearRFIMask();
+
+        //merge the partial sums from each thread into the first one
+        double* total = HIntegrationPeriodTracker::MergePartialSums(average);
+
+        //then compute the average (and the rebinned monitoring spectrum) in one pass
         float* ave = sink->GetData();
-        for(size_t i=0; i<fPowerSpectrumLength; i++)
+        double scale = 1.0/(double)average.fNBuffersAccumulated;
+        //blanked samples contribute no power, so correct for the fraction of the data which was kept
+        if(average.fNBlankedSamples != 0 && average.fNBlankedSamples < average.fNTotalSamplesAccumulated)
+        {
+            scale *= (double) average.fNTotalSamplesAccumulated/(double)(average.fNTotalSamplesAccumulated - average.fNBlankedSamples);
+        }
+        #ifdef ENABLE_SPECTRUM_UDP
+        std::fill(fRebinnedSpectrum, fRebinnedSpectrum + NBINS, 0.0f);
+        HSpectrumAccumulationKernel::Normalize(total, scale, ave, fPowerSpectrumLength, fRebinnedSpectrum, fBinFactor, SPEC_UDP_NBINS);
+        #else
+        HSpectrumAccumulationKernel::Normalize(total, scale, ave, fPowerSpectrumLength);
+        #endif
+
+        //the |X|^4 average follows the power spectrum, it is left as zero unless every buffer provided it
+        if(fEnableSpectralKurtosis && sink->GetArrayDimension(0) >= 2*fPowerSpectrumLength)
         {
-            ave[i] = accum[i]/(float)fNBuffersAccumulated;
-            #ifdef ENABLE_SPECTRUM_UDP
-            fRebinnedSpectrum[i/fBinFactor] += ave[i];
-            #endif
+            if(average.fHaveFourthMoment && average.fNFourthMomentAccumulated == average.fNBuffersAccumulated)
+            {
+                HSpectrumAccumulationKernel::Normalize(total + fPowerSpectrumLength, scale, ave + fPowerSpectrumLength, fPowerSpectrumLength);
+            }
+            else
+            {
+                std::fill(ave + fPowerSpectrumLength, ave + 2*fPowerSpectrumLength, 0.0f);
+            }
         }
 
-        //stuff the noise power data into the meta data container
+        //stuff the noise power data (in time order) into the meta data container
+        std::sort(average.fAccumulations.begin(), average.fAccumulations.end(),
+            [](const struct HDataAccumulationStruct& a, const struct HDataAccumulationStruct& b){return a.start_index < b.start_index;} );
         sink->GetMetaData()->ClearAccumulation();
-        sink->GetMetaData()->ExtendAccumulation(fNoisePowerAccumulator.GetAccumulations());
+        sink->GetMetaData()->ExtendAccumulation(&(average.fAccumulations));
 
         //release to consumer
         this->fSinkBufferHandler.ReleaseBufferToConsumer(this->fSinkBufferPool, sink);
@@ -312,7 +300,7 @@ HSpectrumAverager::WriteAccumulatedSpectrumAverage()
                 fSpectrumPublisher->send(update);
             }
         }
-        #endif 
+        #endif
 
         return true;
 
@@ -321,42 +309,12 @@ HSpectrumAverager::WriteAccumulatedSpectrumAverage()
     {
         this->fSinkBufferHandler.ReleaseBufferToConsumer(this->fSinkBufferPool, sink);
     }
+    fNDroppedAverages++;
     return false; //failed
 }
 
-
-void HSpectrumAverager::Reset()
-{
-    //std::cout<<"reset"<<std::endl;
-    //reset the internal accumulation buffer for re-use
-    fSidebandFlag = '?';
-    fPolarizationFlag = '?';
-    fNBuffersAccumulated = 0;
-    fSampleRate = 0;
-    fAcquisitionStartSecond = 0;
-    fLeadingSampleIndex = 0;
-    fNTotalSpectrum = 0;
-    fNTotalSamplesAccumulated = 0;
-    float* accum = fAccumulationBuffer->GetData();
-    for(size_t i=0; i<fPowerSpectrumLength; i++)
-    {
-        accum[i] = 0.0;
-    }
-
-    #ifdef ENABLE_SPECTRUM_UDP
-    for(size_t i=0; i<SPEC_UDP_NBINS; i++)
-    {
-        fRebinnedSpectrum[i] = 0.0;
-    }
-    #endif
-
-    //for the noise power, clear out all the accumulation structs
-    fNoisePowerAccumulator.ClearAccumulation();
-
-}
-
 #ifdef HOSE_USE_ZEROMQ
-void HSpectrumAverager::SendNoisePowerUDPPacket(const uint64_t& start_sec, const uint64_t& leading_sample_index, const uint64_t& sample_rate, const struct HDataAccumulationStruct& stat)
+void HSpectrumAverager::SendNoisePowerUDPPacket(const uint64_t& start_sec, const uint64_t& leading_sample_index, const uint64_t& sample_rate, const struct HDataAccumulationStruct& stat, double spectral_power_sum)
 {
     //noise power data
     std::stringstream ss;
@@ -373,7 +331,7 @@ void HSpectrumAverager::SendNoisePowerUDPPacket(const uint64_t& start_sec, const
     //also dump the spectral bin power
     ss << fSpecLowerBound << "; ";
     ss << fSpecUpperBound << "; ";
-    ss << fSpectralPowerSum << "; ";
+    ss << spectral_power_sum << "; ";
 
     std::string msg = ss.str();
     if(fNoisePublisher->connected())
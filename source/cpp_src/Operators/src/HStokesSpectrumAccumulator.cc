@@ -0,0 +1,90 @@
+#include "HStokesSpectrumAccumulator.hh"
+#include "HWindowFunction.hh"
+
+#include <cmath>
+#include <iostream>
+
+namespace hose
+{
+
+HStokesSpectrumAccumulator::HStokesSpectrumAccumulator():
+    fInitialized(false),
+    fFFTSize(0),
+    fWindowFlag(0),
+    fNSpectra(0)
+{};
+
+HStokesSpectrumAccumulator::~HStokesSpectrumAccumulator(){};
+
+bool
+HStokesSpectrumAccumulator::Initialize()
+{
+    if(fFFTSize < 2)
+    {
+        std::cout<<"HStokesSpectrumAccumulator::Initialize: Error, invalid FFT size: "<<fFFTSize<<"."<<std::endl;
+        return false;
+    }
+
+    HWindowFunction::Fill(fWindowFlag, fFFTSize, fWindow);
+
+    fWorkspace.resize(fFFTSize);
+    size_t dim[1] = {fFFTSize};
+    fWorkspaceWrapper.SetData(&(fWorkspace[0]));
+    fWorkspaceWrapper.SetArrayDimensions(dim);
+    fFFT.SetSize(fFFTSize);
+    fFFT.SetForward();
+    fFFT.SetInput(&fWorkspaceWrapper);
+    fFFT.SetOutput(&fWorkspaceWrapper);
+    fFFT.Initialize();
+
+    fInitialized = true;
+    Reset();
+    return true;
+}
+
+void
+HStokesSpectrumAccumulator::Reset()
+{
+    fXXSum.assign(GetSpectrumLength(), 0.0);
+    fYYSum.assign(GetSpectrumLength(), 0.0);
+    fXYSum.assign(GetSpectrumLength(), std::complex<double>(0.0, 0.0));
+    fNSpectra = 0;
+}
+
+void
+HStokesSpectrumAccumulator::AddFrame(const float* x, const float* y)
+{
+    if(!fInitialized && !Initialize()){return;}
+
+    for(size_t i=0; i<fFFTSize; i++){fWorkspace[i] = std::complex<double>(fWindow[i]*x[i], fWindow[i]*y[i]);}
+    fFFT.ExecuteOperation();
+
+    //with z = x + iy (x and y real), X[k] = (Z[k] + Z*[N-k])/2 and Y[k] = (Z[k] - Z*[N-k])/2i,
+    //our 'forward' FFT uses exp(+i...), so the cross product is conjugated to give XY* in the usual exp(-i...) convention
+    for(size_t k=0; k<=fFFTSize/2; k++)
+    {
+        std::complex<double> zk = fWorkspace[k];
+        std::complex<double> znk = std::conj( fWorkspace[(fFFTSize - k) % fFFTSize] );
+        std::complex<double> xk = 0.5*(zk + znk);
+        std::complex<double> yk = std::complex<double>(0.0, -0.5)*(zk - znk);
+        fXXSum[k] += std::norm(xk);
+        fYYSum[k] += std::norm(yk);
+        fXYSum[k] += std::conj(xk)*yk;
+    }
+    fNSpectra++;
+}
+
+void
+HStokesSpectrumAccumulator::GetStokes(double scale, float* out) const
+{
+    size_t length = GetSpectrumLength();
+    for(size_t k=0; k<length; k++)
+    {
+        out[k] = scale*(fXXSum[k] + fYYSum[k]);
+        out[length + k] = scale*(fXXSum[k] - fYYSum[k]);
+        out[2*length + k] = 2.0*scale*fXYSum[k].real();
+        out[3*length + k] = -2.0*scale*fXYSum[k].imag();
+    }
+}
+
+}
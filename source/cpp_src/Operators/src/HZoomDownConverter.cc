@@ -0,0 +1,196 @@
+#include "HZoomDownConverter.hh"
+#include "HWindowFunction.hh"
+
+#include <cmath>
+#include <iostream>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+namespace hose
+{
+
+HZoomDownConverter::HZoomDownConverter():
+    fInitialized(false),
+    fSampleRate(0),
+    fCenterFrequency(0),
+    fDecimationFactor(1),
+    fNTapsPerPhase(16),
+    fNTaps(16),
+    fFFTSize(1024),
+    fWindowFlag(0),
+    fChunkOutputs(0),
+    fChunkInputs(0),
+    fFramePosition(0)
+{};
+
+HZoomDownConverter::~HZoomDownConverter(){};
+
+bool
+HZoomDownConverter::Initialize()
+{
+    if(fSampleRate == 0 || fFFTSize < 2)
+    {
+        std::cout<<"HZoomDownConverter::Initialize: Error, sample rate ("<<fSampleRate<<") or FFT size ("<<fFFTSize<<") not set."<<std::endl;
+        return false;
+    }
+
+    //low-pass filter, windowed sinc (Blackman-Harris) with its cut-off at the output Nyquist frequency,
+    //normalized to unity gain at DC and stored time reversed
+    fNTaps = fDecimationFactor*fNTapsPerPhase;
+    fCoefficients.resize(fNTaps);
+    double cutoff = 0.5/( (double) fDecimationFactor );
+    double center = 0.5*( (double) fNTaps - 1.0 );
+    double gain = 0.0;
+    std::vector<double> h(fNTaps);
+    for(size_t i=0; i<fNTaps; i++)
+    {
+        double x = 2.0*cutoff*( (double) i - center );
+        double sinc = (x == 0.0) ? 1.0 : std::sin(M_PI*x)/(M_PI*x);
+        h[i] = sinc*HWindowFunction::Value(HWindowFunction::eBlackmanHarris, i, fNTaps);
+        gain += h[i];
+    }
+    for(size_t i=0; i<fNTaps; i++){fCoefficients[i] = h[fNTaps - 1 - i]/gain;}
+
+    //work in chunks of ~64k input samples, so the mixed signal stays in cache while it is filtered
+    fChunkOutputs = std::max< size_t >(64, 65536/fDecimationFactor);
+    fChunkInputs = (fChunkOutputs - 1)*fDecimationFactor + fNTaps;
+    fInput.resize(fChunkInputs);
+    fMixedReal.resize(fChunkInputs);
+    fMixedImag.resize(fChunkInputs);
+
+    //oscillator rotation relative to the first sample of a chunk
+    fRotationReal.resize(fChunkInputs);
+    fRotationImag.resize(fChunkInputs);
+    for(size_t k=0; k<fChunkInputs; k++)
+    {
+        std::complex<double> r = OscillatorPhasor(k);
+        fRotationReal[k] = r.real();
+        fRotationImag[k] = r.imag();
+    }
+
+    //window applied to each frame of decimated samples
+    HWindowFunction::Fill(fWindowFlag, fFFTSize, fWindow);
+
+    //in-place transform of the frame
+    fFrame.resize(fFFTSize);
+    size_t dim[1] = {fFFTSize};
+    fFrameWrapper.SetData(&(fFrame[0]));
+    fFrameWrapper.SetArrayDimensions(dim);
+    fFFT.SetSize(fFFTSize);
+    fFFT.SetForward();
+    fFFT.SetInput(&fFrameWrapper);
+    fFFT.SetOutput(&fFrameWrapper);
+    fFFT.Initialize();
+
+    fFramePosition = 0;
+    fInitialized = true;
+    return true;
+}
+
+size_t
+HZoomDownConverter::GetNSpectra(size_t n_samples) const
+{
+    size_t n_taps = fDecimationFactor*fNTapsPerPhase;
+    if(n_samples < n_taps || fFFTSize == 0){return 0;}
+    size_t n_outputs = (n_samples - n_taps)/fDecimationFactor + 1;
+    return n_outputs/fFFTSize;
+}
+
+void
+HZoomDownConverter::ProcessChunk(const float* x, size_t n_outputs, uint64_t first_sample_index, double* power_sum)
+{
+    size_t n_in = (n_outputs - 1)*fDecimationFactor + fNTaps;
+
+    //mix down: x[k]*e^{-i*w*(n0+k)} = x[k]*( p*r[k] ), with p the phasor at the first sample
+    std::complex<double> p = OscillatorPhasor(first_sample_index);
+    float pr = p.real();
+    float pi = p.imag();
+    const float* rr = &(fRotationReal[0]);
+    const float* ri = &(fRotationImag[0]);
+    float* mr = &(fMixedReal[0]);
+    float* mi = &(fMixedImag[0]);
+    size_t k = 0;
+
+    #if defined(__SSE2__)
+    __m128 vpr = _mm_set1_ps(pr);
+    __m128 vpi = _mm_set1_ps(pi);
+    for(; k+4 <= n_in; k += 4)
+    {
+        __m128 vx = _mm_loadu_ps(x + k);
+        __m128 vrr = _mm_loadu_ps(rr + k);
+        __m128 vri = _mm_loadu_ps(ri + k);
+        __m128 oscr = _mm_sub_ps( _mm_mul_ps(vpr, vrr), _mm_mul_ps(vpi, vri) );
+        __m128 osci = _mm_add_ps( _mm_mul_ps(vpr, vri), _mm_mul_ps(vpi, vrr) );
+        _mm_storeu_ps(mr + k, _mm_mul_ps(vx, oscr) );
+        _mm_storeu_ps(mi + k, _mm_mul_ps(vx, osci) );
+    }
+    #endif
+
+    for(; k<n_in; k++)
+    {
+        mr[k] = x[k]*(pr*rr[k] - pi*ri[k]);
+        mi[k] = x[k]*(pr*ri[k] + pi*rr[k]);
+    }
+
+    //filter, evaluated only at the decimated output samples
+    const float* h = &(fCoefficients[0]);
+    for(size_t j=0; j<n_outputs; j++)
+    {
+        size_t offset = j*fDecimationFactor;
+        double yr = Dot(h, mr + offset, fNTaps);
+        double yi = Dot(h, mi + offset, fNTaps);
+        fFrame[fFramePosition] = fWindow[fFramePosition]*std::complex<double>(yr, yi);
+        fFramePosition++;
+        if(fFramePosition == fFFTSize)
+        {
+            TransformFrame(power_sum);
+            fFramePosition = 0;
+        }
+    }
+}
+
+void
+HZoomDownConverter::TransformFrame(double* power_sum)
+{
+    fFFT.ExecuteOperation();
+
+    //the (forward) transform uses the e^{+i} kernel, so channel i holds frequency -i; reverse it and
+    //swap the halves so that the spectrum runs from -fs/2 to +fs/2 about the center frequency
+    size_t half = fFFTSize/2;
+    for(size_t i=0; i<fFFTSize; i++)
+    {
+        size_t index = (half + fFFTSize - i) % fFFTSize;
+        power_sum[index] += std::norm(fFrame[i]);
+    }
+}
+
+float
+HZoomDownConverter::Dot(const float* a, const float* b, size_t n)
+{
+    size_t i = 0;
+    float sum = 0.0f;
+
+    #if defined(__SSE2__)
+    __m128 s0 = _mm_setzero_ps();
+    __m128 s1 = _mm_setzero_ps();
+    __m128 s2 = _mm_setzero_ps();
+    __m128 s3 = _mm_setzero_ps();
+    for(; i+16 <= n; i += 16)
+    {
+        s0 = _mm_add_ps(s0, _mm_mul_ps( _mm_loadu_ps(a + i), _mm_loadu_ps(b + i) ) );
+        s1 = _mm_add_ps(s1, _mm_mul_ps( _mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4) ) );
+        s2 = _mm_add_ps(s2, _mm_mul_ps( _mm_loadu_ps(a + i + 8), _mm_loadu_ps(b + i + 8) ) );
+        s3 = _mm_add_ps(s3, _mm_mul_ps( _mm_loadu_ps(a + i + 12), _mm_loadu_ps(b + i + 12) ) );
+    }
+    float partial[4];
+    _mm_storeu_ps(partial, _mm_add_ps( _mm_add_ps(s0, s1), _mm_add_ps(s2, s3) ) );
+    sum = (partial[0] + partial[1]) + (partial[2] + partial[3]);
+    #endif
+
+    for(; i<n; i++){sum += a[i]*b[i];}
+    return sum;
+}
+
+}
@@ -2,6 +2,7 @@
 #define HBitReversalPermutation_HH__
 
 #include <cstddef>
+#include <utility>
 #include <vector>
 
 namespace hose
@@ -65,6 +66,92 @@ class HBitReversalPermutation
             }
         }
 
+        //reverse the lowest n_bits of x
+        static unsigned int ReverseBits(unsigned int x, unsigned int n_bits);
+
+        //approximate size of the two blocks of data which are staged in cache by PermuteArrayBlocked
+        static const unsigned int BlockBytes = 32768;
+
+        template<typename DataType >
+        static void PermuteArrayBlocked(unsigned int N, DataType* arr) //must have N = 2^P, with P an integer
+        {
+            //in-place bit-reversal permutation without an index table, for large arrays the scattered swaps of
+            //PermuteArray miss the cache (and TLB) on nearly every access, so instead the indices are split
+            //into (a,b,c) = (top q bits, middle bits, low q bits), and the 2^q x 2^q elements sharing each middle
+            //value b are gathered into a buffer (reading rows of 2^q contiguous elements), then scattered to
+            //(rev(c), rev(b), rev(a)), again in contiguous rows, the block for b is exchanged with that of rev(b)
+            //see: "Towards an optimal bit-reversal permutation program", L. Carter and K. S. Gatlin, FOCS 1998
+            unsigned int log_n = LogBaseTwo(N);
+
+            //choose the block so that two of them fit in the buffer
+            unsigned int q = 0;
+            while( 2*(1u << (2*(q+1)))*sizeof(DataType) <= BlockBytes && 2*(q+1) <= log_n ){q++;}
+
+            if(q < 2)
+            {
+                //small array (it fits in cache anyway), swap while counting j in bit-reversed order
+                unsigned int j = 0;
+                for(unsigned int i=0; i<N; i++)
+                {
+                    if(i < j){std::swap(arr[i], arr[j]);}
+                    unsigned int bit = N >> 1;
+                    while(j & bit){j ^= bit; bit >>= 1;}
+                    j |= bit;
+                }
+                return;
+            }
+
+            unsigned int m = log_n - 2*q;
+            unsigned int block = 1u << q;
+            unsigned int n_middle = 1u << m;
+            unsigned int top_shift = m + q;
+
+            //(uninitialized storage, DataType is expected to be a plain value type like std::complex<double>)
+            alignas(DataType) unsigned char storage[BlockBytes];
+            DataType* first = reinterpret_cast<DataType*>(storage);
+            DataType* second = first + block*block;
+            unsigned int rev_q[1u << 8];
+            for(unsigned int i=0; i<block; i++){rev_q[i] = ReverseBits(i, q);}
+
+            for(unsigned int b=0; b<n_middle; b++)
+            {
+                unsigned int b_rev = ReverseBits(b, m);
+                if(b_rev < b){continue;} //already exchanged
+
+                //gather, first[rev(a)][c] = arr[a,b,c]
+                for(unsigned int a=0; a<block; a++)
+                {
+                    const DataType* src = arr + ( (a << top_shift) | (b << q) );
+                    DataType* dst = first + rev_q[a]*block;
+                    for(unsigned int c=0; c<block; c++){dst[c] = src[c];}
+                }
+                if(b_rev != b)
+                {
+                    for(unsigned int a=0; a<block; a++)
+                    {
+                        const DataType* src = arr + ( (a << top_shift) | (b_rev << q) );
+                        DataType* dst = second + rev_q[a]*block;
+                        for(unsigned int c=0; c<block; c++){dst[c] = src[c];}
+                    }
+                }
+
+                //scatter, arr[rev(c), rev(b), rev(a)] = first[rev(a)][c]
+                for(unsigned int c=0; c<block; c++)
+                {
+                    DataType* dst = arr + ( (rev_q[c] << top_shift) | (b_rev << q) );
+                    for(unsigned int a=0; a<block; a++){dst[a] = first[a*block + c];}
+                }
+                if(b_rev != b)
+                {
+                    for(unsigned int c=0; c<block; c++)
+                    {
+                        DataType* dst = arr + ( (rev_q[c] << top_shift) | (b << q) );
+                        for(unsigned int a=0; a<block; a++){dst[a] = second[a*block + c];}
+                    }
+                }
+            }
+        }
+
         template<typename DataType >
         static void PermuteArray(unsigned int N, unsigned int data_size, const unsigned int* permutation_index_arr, DataType* arr) //arbitrary data_size
         {
@@ -4,6 +4,7 @@
 #include <complex>
 
 #include "HArrayWrapper.hh"
+#include "HArrayView.hh"
 #include "HUnaryArrayOperator.hh"
 
 #include "HBitReversalPermutation.hh"
@@ -17,7 +18,11 @@ namespace hose
 *@file HFastFourierTransform.hh
 *@class HFastFourierTransform
 *@brief This is a class for a one dimensional FFT
-*@details
+*@details Powers of two and three use the in-place radix-2/radix-3 transforms, other sizes whose
+*prime factors are small (<= HFastFourierTransformUtilities::MaxMixedRadixPrime) use the mixed-radix
+*(Stockham) transform, and the Bluestein algorithm is used only when N has a large prime factor.
+*Powers of two from HFastFourierTransformUtilities::MinCodeletSize up to MaxCodeletSize^2 are done
+*with the compile time specialised codelets (directly, or composed by the six-step algorithm).
 *
 */
 
@@ -38,6 +43,20 @@ class HFastFourierTransform: public HUnaryArrayOperator< std::complex<double>, 1
 
         virtual void ExecuteOperation();
 
+        unsigned int GetSize() const {return fN;};
+        bool IsForward() const {return fForward;};
+
+        //length of the workspace needed by Transform (zero for the in-place radix-2/radix-3 transforms)
+        unsigned int GetWorkspaceSize() const;
+
+        //in-place transform of an array of length N, using the caller's workspace rather than the plan's,
+        //so that a single initialized plan can be shared (read-only) by several threads
+        void Transform(std::complex<double>* data, std::complex<double>* workspace) const;
+
+        //in-place transform of a (possibly strided) view of length N, e.g. a column of a larger array,
+        //strided data is gathered into a contiguous buffer and scattered back, contiguous data is not copied
+        void Transform(const HArrayView< std::complex<double>, 1 >& data);
+
     private:
 
         virtual void AllocateWorkspace();
@@ -48,16 +67,23 @@ class HFastFourierTransform: public HUnaryArrayOperator< std::complex<double>, 1
         bool fInitialized;
         bool fSizeIsPowerOfTwo;
         bool fSizeIsPowerOfThree;
+        bool fSizeIsMixedRadix;
+        bool fSizeUsesCodelets;
 
         //auxilliary workspace needed for basic 1D transform
         unsigned int fN;
         unsigned int fM;
+        unsigned int fN1; //six-step factors N = N1*N2
+        unsigned int fN2;
+        unsigned int fNStages;
+        unsigned int fRadices[HFastFourierTransformUtilities::MaxMixedRadixStages];
         unsigned int* fPermutation;
         std::complex<double>* fTwiddle;
         std::complex<double>* fConjugateTwiddle;
         std::complex<double>* fScale;
         std::complex<double>* fCirculant;
         std::complex<double>* fWorkspace;
+        std::complex<double>* fGatherBuffer; //only allocated if a strided view is transformed
 
 };
 
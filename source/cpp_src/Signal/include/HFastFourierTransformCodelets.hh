@@ -0,0 +1,193 @@
+#ifndef HFastFourierTransformCodelets_HH__
+#define HFastFourierTransformCodelets_HH__
+
+#include <complex>
+#include <cstddef>
+#include <stdint.h>
+
+namespace hose
+{
+
+/*
+*
+*@file HFastFourierTransformCodelets.hh
+*@class HFFTCodelet
+*@brief Fixed size (power of two) FFT kernels, generated at compile time
+*@details HFFTCodelet<N>::Apply computes the (e^{+i} kernel) DFT of N strided input points into N contiguous
+*output points, by recursive radix-2 decimation in time, which the compiler flattens since N is a template
+*parameter. The twiddle factors are constexpr, for N <= HFFTCodeletMaxUnrolledSize every butterfly is
+*unrolled with its twiddle as an immediate constant, larger codelets loop over a constexpr table.
+*These are not meant to be called directly, see HFastFourierTransformUtilities::GetCodelet/FFTSixStep.
+*
+*/
+
+//largest codelet whose butterflies are fully unrolled
+#define HFFTCodeletMaxUnrolledSize 64
+
+//cos/sin of 2*pi*m/M at compile time (c++11 constexpr, so each function is a single expression),
+//the argument is folded into [0, pi/4] using integer arithmetic (M must be divisible by 8), so the
+//short taylor series is accurate to long double precision
+struct HFFTConstexprMath
+{
+    static constexpr long double TwoPi(){return 6.283185307179586476925286766559005768L;}
+
+    static constexpr long double SinSeries(long double x2, long double term, unsigned int n, long double sum)
+    {
+        return (n > 12) ? sum : SinSeries(x2, -term*x2/( (long double) (2*n)*(2*n+1) ), n+1, sum + term);
+    }
+
+    static constexpr long double CosSeries(long double x2, long double term, unsigned int n, long double sum)
+    {
+        return (n > 12) ? sum : CosSeries(x2, -term*x2/( (long double) (2*n-1)*(2*n) ), n+1, sum + term);
+    }
+
+    static constexpr long double Angle(uint64_t m, uint64_t M){return TwoPi()*( (long double) m )/( (long double) M );}
+
+    static constexpr long double SinOctant(uint64_t m, uint64_t M){return SinSeries(Angle(m,M)*Angle(m,M), Angle(m,M), 1, 0.0L);}
+    static constexpr long double CosOctant(uint64_t m, uint64_t M){return CosSeries(Angle(m,M)*Angle(m,M), 1.0L, 1, 0.0L);}
+
+    //m in [0, M)
+    static constexpr long double Cos(uint64_t m, uint64_t M)
+    {
+        return (2*m > M) ? Cos(M - m, M) : ( (4*m > M) ? -Cos(M/2 - m, M) : ( (8*m > M) ? SinOctant(M/4 - m, M) : CosOctant(m, M) ) );
+    }
+
+    static constexpr long double Sin(uint64_t m, uint64_t M)
+    {
+        return (2*m > M) ? -Sin(M - m, M) : ( (4*m > M) ? Sin(M/2 - m, M) : ( (8*m > M) ? CosOctant(M/4 - m, M) : SinOctant(m, M) ) );
+    }
+
+    //the twiddle factor e^{+2 pi i k/N}
+    static constexpr double TwiddleReal(unsigned int k, unsigned int N){return (double) Cos( 8*( (uint64_t) (k % N) ), 8*( (uint64_t) N ) );}
+    static constexpr double TwiddleImag(unsigned int k, unsigned int N){return (double) Sin( 8*( (uint64_t) (k % N) ), 8*( (uint64_t) N ) );}
+};
+
+//compile time table of the N/2 twiddle factors used by the combine step of a looped codelet
+template<unsigned int... K> struct HFFTIndexSequence{};
+template<unsigned int N, unsigned int... K> struct HFFTMakeIndexSequence: HFFTMakeIndexSequence<N-1, N-1, K...>{};
+template<unsigned int... K> struct HFFTMakeIndexSequence<0, K...>{typedef HFFTIndexSequence<K...> type;};
+
+template<unsigned int N, typename SequenceType> struct HFFTTwiddleTableImpl;
+
+template<unsigned int N, unsigned int... K>
+struct HFFTTwiddleTableImpl<N, HFFTIndexSequence<K...> >
+{
+    static constexpr double fReal[sizeof...(K)] = {HFFTConstexprMath::TwiddleReal(K, N)...};
+    static constexpr double fImag[sizeof...(K)] = {HFFTConstexprMath::TwiddleImag(K, N)...};
+};
+
+template<unsigned int N, unsigned int... K>
+constexpr double HFFTTwiddleTableImpl<N, HFFTIndexSequence<K...> >::fReal[sizeof...(K)];
+
+template<unsigned int N, unsigned int... K>
+constexpr double HFFTTwiddleTableImpl<N, HFFTIndexSequence<K...> >::fImag[sizeof...(K)];
+
+template<unsigned int N>
+struct HFFTTwiddleTable: HFFTTwiddleTableImpl<N, typename HFFTMakeIndexSequence<N/2>::type >{};
+
+//x[K] +/- w^K x[K+N/2] for K in [K, K+COUNT), split in halves so the instantiation depth stays logarithmic
+template<unsigned int N, unsigned int K, unsigned int COUNT>
+struct HFFTButterflies
+{
+    static inline void Apply(std::complex<double>* x)
+    {
+        HFFTButterflies<N, K, COUNT/2>::Apply(x);
+        HFFTButterflies<N, K + COUNT/2, COUNT - COUNT/2>::Apply(x);
+    }
+};
+
+template<unsigned int N, unsigned int K>
+struct HFFTButterflies<N, K, 1>
+{
+    static inline void Apply(std::complex<double>* x)
+    {
+        constexpr double wr = HFFTConstexprMath::TwiddleReal(K, N);
+        constexpr double wi = HFFTConstexprMath::TwiddleImag(K, N);
+        double a = x[K+N/2].real();
+        double b = x[K+N/2].imag();
+        double tr = wr*a - wi*b;
+        double ti = wr*b + wi*a;
+        double ur = x[K].real();
+        double ui = x[K].imag();
+        x[K] = std::complex<double>(ur + tr, ui + ti);
+        x[K+N/2] = std::complex<double>(ur - tr, ui - ti);
+    }
+};
+
+//combine the two half-length transforms held in x[0,N/2) and x[N/2,N)
+template<unsigned int N, bool UNROLL = (N <= HFFTCodeletMaxUnrolledSize) >
+struct HFFTCombine
+{
+    static inline void Apply(std::complex<double>* x){HFFTButterflies<N, 0, N/2>::Apply(x);}
+};
+
+template<unsigned int N>
+struct HFFTCombine<N, false>
+{
+    static inline void Apply(std::complex<double>* x)
+    {
+        const double* w_real = HFFTTwiddleTable<N>::fReal;
+        const double* w_imag = HFFTTwiddleTable<N>::fImag;
+        for(unsigned int k=0; k<N/2; k++)
+        {
+            double a = x[k+N/2].real();
+            double b = x[k+N/2].imag();
+            double tr = w_real[k]*a - w_imag[k]*b;
+            double ti = w_real[k]*b + w_imag[k]*a;
+            double ur = x[k].real();
+            double ui = x[k].imag();
+            x[k] = std::complex<double>(ur + tr, ui + ti);
+            x[k+N/2] = std::complex<double>(ur - tr, ui - ti);
+        }
+    }
+};
+
+template<unsigned int N>
+struct HFFTCodelet
+{
+    static_assert( N >= 2 && (N & (N-1)) == 0, "HFFTCodelet: size must be a power of two");
+
+    static void Apply(const std::complex<double>* in, std::size_t stride, std::complex<double>* out)
+    {
+        HFFTCodelet<N/2>::Apply(in, 2*stride, out);
+        HFFTCodelet<N/2>::Apply(in + stride, 2*stride, out + N/2);
+        HFFTCombine<N>::Apply(out);
+    }
+};
+
+template<>
+struct HFFTCodelet<2>
+{
+    static inline void Apply(const std::complex<double>* in, std::size_t stride, std::complex<double>* out)
+    {
+        std::complex<double> a = in[0];
+        std::complex<double> b = in[stride];
+        out[0] = std::complex<double>(a.real() + b.real(), a.imag() + b.imag());
+        out[1] = std::complex<double>(a.real() - b.real(), a.imag() - b.imag());
+    }
+};
+
+template<>
+struct HFFTCodelet<4>
+{
+    static inline void Apply(const std::complex<double>* in, std::size_t stride, std::complex<double>* out)
+    {
+        //w = e^{+i pi/2} = i
+        std::complex<double> a0 = in[0];
+        std::complex<double> a1 = in[stride];
+        std::complex<double> a2 = in[2*stride];
+        std::complex<double> a3 = in[3*stride];
+        double s02r = a0.real() + a2.real(); double s02i = a0.imag() + a2.imag();
+        double d02r = a0.real() - a2.real(); double d02i = a0.imag() - a2.imag();
+        double s13r = a1.real() + a3.real(); double s13i = a1.imag() + a3.imag();
+        double d13r = a1.real() - a3.real(); double d13i = a1.imag() - a3.imag();
+        out[0] = std::complex<double>(s02r + s13r, s02i + s13i);
+        out[1] = std::complex<double>(d02r - d13i, d02i + d13r);
+        out[2] = std::complex<double>(s02r - s13r, s02i - s13i);
+        out[3] = std::complex<double>(d02r + d13i, d02i - d13r);
+    }
+};
+
+}
+
+#endif /* HFastFourierTransformCodelets_H__ */
@@ -4,6 +4,7 @@
 #include "HBitReversalPermutation.hh"
 
 #include <complex>
+#include <cstddef>
 
 namespace hose
 {
@@ -55,6 +56,67 @@ class HFastFourierTransformUtilities
                                         std::complex<double>& W1);
         static void FFTRadixThree(unsigned int N, std::complex<double>* data, std::complex<double>* twiddle);
 
+        ////////////////////////////////////////////////////////////////////////
+        //MIXED-RADIX (2,3,4,5,7 and other small primes)
+        //Stockham autosort formulation, natural order input and output, with no
+        //permutation step, but it needs a workspace of length N
+
+        //largest prime factor handled by the mixed-radix algorithm, above this Bluestein is used
+        static const unsigned int MaxMixedRadixPrime = 31;
+
+        //largest number of stages (radices) a 32-bit size can be factored into
+        static const unsigned int MaxMixedRadixStages = 32;
+
+        //factors N into the radices of each stage (4s first, then 2, 3, 5, 7, ...), radices must
+        //have space for MaxMixedRadixStages entries, returns the number of stages, or zero if N
+        //has a prime factor larger than MaxMixedRadixPrime
+        static unsigned int ComputeMixedRadixFactors(unsigned int N, unsigned int* radices);
+
+        //twiddle array must be length N (as computed by ComputeTwiddleFactors), workspace length N
+        static void FFTMixedRadix(unsigned int N,
+                                  unsigned int n_stages,
+                                  const unsigned int* radices,
+                                  std::complex<double>* data,
+                                  const std::complex<double>* twiddle,
+                                  std::complex<double>* workspace);
+
+        //a single stage of the transform, on a sub-sequence of length n with stride s
+        static void StockhamStageRadixTwo(unsigned int N, unsigned int n, unsigned int s, const std::complex<double>* x, std::complex<double>* y, const std::complex<double>* twiddle);
+        static void StockhamStageRadixThree(unsigned int N, unsigned int n, unsigned int s, const std::complex<double>* x, std::complex<double>* y, const std::complex<double>* twiddle);
+        static void StockhamStageRadixFour(unsigned int N, unsigned int n, unsigned int s, const std::complex<double>* x, std::complex<double>* y, const std::complex<double>* twiddle);
+        static void StockhamStageRadixFive(unsigned int N, unsigned int n, unsigned int s, const std::complex<double>* x, std::complex<double>* y, const std::complex<double>* twiddle);
+        static void StockhamStageRadixOdd(unsigned int N, unsigned int p, unsigned int n, unsigned int s, const std::complex<double>* x, std::complex<double>* y, const std::complex<double>* twiddle);
+
+        ////////////////////////////////////////////////////////////////////////
+        //CODELETS (compile time specialised power of two sizes, see HFastFourierTransformCodelets.hh)
+
+        //out-of-place transform of N points read with the given stride, written contiguously to out
+        typedef void (*CodeletFunction)(const std::complex<double>* in, std::size_t stride, std::complex<double>* out);
+
+        //smallest and largest codelet, larger power of two sizes are composed of two of them
+        static const unsigned int MinCodeletSize = 16;
+        static const unsigned int MaxCodeletSize = 1024;
+
+        //returns the codelet for a power of two N in [2, MaxCodeletSize], NULL otherwise
+        static CodeletFunction GetCodelet(unsigned int N);
+
+        //splits a power of two N in [MinCodeletSize, MaxCodeletSize^2] as N = N1*N2 with N1 <= N2 codelet sizes,
+        //(N1 = 1 if N is itself a codelet size), returns false if N cannot be done with codelets
+        static bool ComputeSixStepFactors(unsigned int N, unsigned int& N1, unsigned int& N2);
+
+        //six-step transform (transpose, N2 rows of length N1, twiddle, transpose, N1 rows of length N2, transpose)
+        //every pass is on contiguous rows, twiddle array must be length N (as computed by ComputeTwiddleFactors),
+        //workspace length N, natural order input and output
+        static void FFTSixStep(unsigned int N,
+                               unsigned int N1,
+                               unsigned int N2,
+                               std::complex<double>* data,
+                               const std::complex<double>* twiddle,
+                               std::complex<double>* workspace);
+
+        //out-of-place transpose of a rows x cols (row major) array, in blocks that stay in cache
+        static void Transpose(unsigned int rows, unsigned int cols, const std::complex<double>* in, std::complex<double>* out);
+
         ////////////////////////////////////////////////////////////////////////
         //Bluestein/Chirp-Z Algorithm for arbitrary N
         //"Inside the FFT Black Box", E. Chu and A. George, Ch. 13, CRC Press, 2000
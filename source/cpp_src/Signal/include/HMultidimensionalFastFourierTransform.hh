@@ -1,11 +1,16 @@
 #ifndef HMultidimensionalFastFourierTransform_HH__
 #define HMultidimensionalFastFourierTransform_HH__
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <mutex>
+#include <vector>
 
 #include "HArrayWrapper.hh"
+#include "HArrayView.hh"
 #include "HFastFourierTransform.hh"
+#include "HTaskScheduler.hh"
 
 namespace hose
 {
@@ -15,7 +20,13 @@ namespace hose
 *@file HMultidimensionalFastFourierTransform.hh
 *@class HMultidimensionalFastFourierTransform
 *@brief
-*@details
+*@details The transform along each dimension is done in batches of rows, which are run in parallel on the
+*shared task scheduler (HTaskScheduler::ParallelFor, so serially if the scheduler is not running).
+*Rows along the last dimension are contiguous and are transformed in place, along the other dimensions
+*a tile of neighbouring (strided) rows is transposed into a contiguous buffer, transformed and transposed
+*back, so each pass reads and writes whole cache lines. There is a single (read-only) 1D plan for each
+*dimension, which is shared by all threads, each thread claims its own tile buffer and workspace.
+*Any strided view (HArrayView) of the planned dimensions can be transformed in place with Transform.
 */
 
 template<size_t NDIM>
@@ -27,14 +38,16 @@ class HMultidimensionalFastFourierTransform: public HUnaryArrayOperator< std::co
             for(size_t i=0; i<NDIM; i++)
             {
                 fDimensionSize[i] = 0;
-                fWorkspace[i] = NULL;
-                fWorkspaceWrapper[i] = NULL;
                 fTransformCalculator[i] = NULL;
             }
 
             fIsValid = false;
             fInitialized = false;
             fForward = true;
+            fTileWidth = 16;
+            fMinElementsPerTask = 16384;
+            fMaxWorkspaceSize = 0;
+            fMaxDimensionSize = 0;
         };
 
         virtual ~HMultidimensionalFastFourierTransform()
@@ -45,9 +58,26 @@ class HMultidimensionalFastFourierTransform: public HUnaryArrayOperator< std::co
         virtual void SetForward(){fForward = true;}
         virtual void SetBackward(){fForward = false;};
 
+        //number of strided rows which are transposed into a contiguous tile together
+        void SetTileWidth(size_t n){fTileWidth = (n == 0) ? 1 : n;};
+
+        //contiguous rows are handed out to the threads in batches of at least this many elements
+        void SetMinElementsPerTask(size_t n){fMinElementsPerTask = (n == 0) ? 1 : n;};
+
+        //dimensions to plan for when the transform is only applied to views (no input/output arrays are set)
+        void SetArrayDimensions(const size_t* dim)
+        {
+            for(size_t i=0; i<NDIM; i++){fDimensionSize[i] = dim[i];}
+        }
+
         virtual void Initialize() override
         {
-            if(DoInputOutputDimensionsMatch())
+            if(this->fInput == NULL && this->fOutput == NULL)
+            {
+                fIsValid = true;
+                for(size_t i=0; i<NDIM; i++){if(fDimensionSize[i] == 0){fIsValid = false;} }
+            }
+            else if(DoInputOutputDimensionsMatch())
             {
                 fIsValid = true;
                 this->fInput->GetArrayDimensions(fDimensionSize);
@@ -68,21 +98,10 @@ class HMultidimensionalFastFourierTransform: public HUnaryArrayOperator< std::co
 
         virtual void ExecuteOperation() override
         {
-            if(fIsValid && fInitialized)
+            if(fIsValid && fInitialized && this->fInput != NULL && this->fOutput != NULL)
             {
                 size_t total_size = 1;
-                for(size_t i=0; i<NDIM; i++)
-                {
-                    total_size *= fDimensionSize[i];
-                    if(fForward)
-                    {
-                        fTransformCalculator[i]->SetForward();
-                    }
-                    else
-                    {
-                        fTransformCalculator[i]->SetBackward();
-                    }
-                }
+                for(size_t i=0; i<NDIM; i++){total_size *= fDimensionSize[i];}
 
                 //if input and output point to the same array, don't bother copying data over
                 if(this->fInput != this->fOutput)
@@ -91,81 +110,201 @@ class HMultidimensionalFastFourierTransform: public HUnaryArrayOperator< std::co
                     std::memcpy( (void*) this->fOutput->GetData(), (void*) this->fInput->GetData(), total_size*sizeof(std::complex<double>) );
                 }
 
-                size_t index[NDIM];
-                size_t non_active_dimension_size[NDIM-1];
-                size_t non_active_dimension_value[NDIM-1];
-                size_t non_active_dimension_index[NDIM-1];
+                TransformView( HArrayView< std::complex<double>, NDIM >( *(this->fOutput) ) );
+            }
+        }
+
+        //in-place transform of a (possibly strided) view, e.g. a sub-block or a range of channels of a larger
+        //array, or a transposed view, without copying it out, the dimensions must match the initialized ones
+        void Transform(const HArrayView< std::complex<double>, NDIM >& data)
+        {
+            bool valid = fIsValid && fInitialized;
+            for(size_t i=0; i<NDIM; i++)
+            {
+                if(data.GetArrayDimension(i) != fDimensionSize[i]){valid = false;}
+            }
+            if(!valid)
+            {
+                std::cout<<"HMultidimensionalFastFourierTransform::Transform: Warning, transform not valid for this view. Aborting."<<std::endl;
+                return;
+            }
+            TransformView(data);
+        }
+
+
+    private:
+
+        //per-thread scratch space
+        struct HTransformWorkspace
+        {
+            std::vector< std::complex<double> > fTile;
+            std::vector< std::complex<double> > fScratch;
+        };
+
+        void TransformView(const HArrayView< std::complex<double>, NDIM >& data)
+        {
+            for(size_t i=0; i<NDIM; i++)
+            {
+                if(fForward){fTransformCalculator[i]->SetForward();}
+                else{fTransformCalculator[i]->SetBackward();}
+            }
+
+            //select the dimension on which to perform the FFT
+            for(size_t d = 0; d < NDIM; d++)
+            {
+                TransformDimension(d, data.GetData(), data.GetArrayDimensions(), data.GetStrides() );
+            }
+        }
 
-                //select the dimension on which to perform the FFT
-                for(size_t d = 0; d < NDIM; d++)
+        void TransformDimension(size_t d, std::complex<double>* data, const size_t* dim, const size_t* strides)
+        {
+            size_t n = dim[d];
+            size_t stride = strides[d];
+            if(n < 2){return;}
+
+            //the other dimensions: the innermost of them is the one tiles are taken along,
+            //the rest are 'outer' dimensions, whose offsets are found from a flat outer index
+            size_t outer_dim[NDIM];
+            size_t outer_stride[NDIM];
+            size_t n_outer_dims = 0;
+            size_t outer = 1;
+            size_t columns = 1;
+            size_t column_stride = 0;
+            for(size_t i=0; i<NDIM; i++)
+            {
+                if(i == d){continue;}
+                outer_dim[n_outer_dims] = dim[i];
+                outer_stride[n_outer_dims] = strides[i];
+                n_outer_dims++;
+            }
+            if(n_outer_dims != 0)
+            {
+                n_outer_dims--;
+                columns = outer_dim[n_outer_dims];
+                column_stride = outer_stride[n_outer_dims];
+            }
+            for(size_t i=0; i<n_outer_dims; i++){outer *= outer_dim[i];}
+
+            auto outer_offset = [&outer_dim, &outer_stride, n_outer_dims](size_t o)
+            {
+                size_t offset = 0;
+                for(size_t i=n_outer_dims; i>0; i--)
+                {
+                    offset += (o % outer_dim[i-1])*outer_stride[i-1];
+                    o /= outer_dim[i-1];
+                }
+                return offset;
+            };
+
+            const HFastFourierTransform* plan = fTransformCalculator[d];
+            HTaskScheduler* scheduler = HTaskScheduler::GetInstance();
+
+            if(stride == 1)
+            {
+                //rows are contiguous, transform them in place, several to a task
+                size_t n_rows = outer*columns;
+                size_t rows_per_task = std::max< size_t >(1, fMinElementsPerTask/n);
+                size_t n_tasks = (n_rows + rows_per_task - 1)/rows_per_task;
+                scheduler->ParallelFor(n_tasks, [&](size_t task)
                 {
-                    //now we loop over all dimensions not specified by d
-                    //first compute the number of FFTs to perform
-                    size_t n_fft = 1;
-                    size_t count = 0;
-                    for(size_t i = 0; i < NDIM; i++)
+                    HTransformWorkspace* work = ClaimWorkspace();
+                    size_t row_end = std::min(n_rows, (task+1)*rows_per_task);
+                    for(size_t row = task*rows_per_task; row < row_end; row++)
                     {
-                        if(i != d)
-                        {
-                            n_fft *= fDimensionSize[i];
-                            non_active_dimension_index[count] = i;
-                            non_active_dimension_size[count] = fDimensionSize[i];
-                            count++;
-                        }
+                        plan->Transform(data + outer_offset(row/columns) + (row % columns)*column_stride, work->fScratch.data());
                     }
+                    ReturnWorkspace(work);
+                });
+            }
+            else
+            {
+                //transpose a tile of neighbouring rows into contiguous memory (for a row major array each row
+                //of the [n][columns] block contributes a run of width elements), transform, and transpose back
+                size_t width = std::min(fTileWidth, columns);
+                size_t n_tiles = (columns + width - 1)/width;
+                size_t n_tasks = outer*n_tiles;
+                scheduler->ParallelFor(n_tasks, [&](size_t task)
+                {
+                    HTransformWorkspace* work = ClaimWorkspace();
+                    std::complex<double>* tile = work->fTile.data();
+                    size_t first_column = (task % n_tiles)*width;
+                    size_t w = std::min(width, columns - first_column);
+                    std::complex<double>* block = data + outer_offset(task/n_tiles) + first_column*column_stride;
 
-                    //loop over the number of FFTs to perform
-                    for(size_t n=0; n<n_fft; n++)
+                    if(column_stride == 1)
                     {
-                        //invert place in list to obtain indices of block in array
-                        HArrayMath::RowMajorIndexFromOffset<NDIM-1>(n, non_active_dimension_size, non_active_dimension_value);
-
-                        //copy the value of the non-active dimensions in to index
-                        for(size_t i=0; i<NDIM-1; i++)
+                        for(size_t i=0; i<n; i++)
                         {
-                            index[ non_active_dimension_index[i] ] = non_active_dimension_value[i];
+                            const std::complex<double>* src = block + i*stride;
+                            for(size_t j=0; j<w; j++){tile[j*n + i] = src[j];}
                         }
-
-                        size_t data_location;
-                        //copy the row selected by the other dimensions
-                        for(size_t i=0; i<fDimensionSize[d]; i++)
+                    }
+                    else
+                    {
+                        for(size_t i=0; i<n; i++)
                         {
-                            index[d] = i;
-                            data_location = HArrayMath::OffsetFromRowMajorIndex<NDIM>(fDimensionSize, index);
-                            (*(fWorkspaceWrapper[d]))[i] = (*(this->fOutput))[data_location];
+                            const std::complex<double>* src = block + i*stride;
+                            for(size_t j=0; j<w; j++){tile[j*n + i] = src[j*column_stride];}
                         }
+                    }
 
-                        //compute the FFT of the row selected
-                        fTransformCalculator[d]->ExecuteOperation();
+                    for(size_t j=0; j<w; j++){plan->Transform(tile + j*n, work->fScratch.data());}
 
-                        //copy the row selected back
-                        for(size_t i=0; i<fDimensionSize[d]; i++)
+                    if(column_stride == 1)
+                    {
+                        for(size_t i=0; i<n; i++)
                         {
-                            index[d] = i;
-                            data_location = HArrayMath::OffsetFromRowMajorIndex<NDIM>(fDimensionSize, index);
-                            (*(this->fOutput))[data_location] = (*(fWorkspaceWrapper[d]))[i];
+                            std::complex<double>* dst = block + i*stride;
+                            for(size_t j=0; j<w; j++){dst[j] = tile[j*n + i];}
                         }
                     }
-                }
+                    else
+                    {
+                        for(size_t i=0; i<n; i++)
+                        {
+                            std::complex<double>* dst = block + i*stride;
+                            for(size_t j=0; j<w; j++){dst[j*column_stride] = tile[j*n + i];}
+                        }
+                    }
+                    ReturnWorkspace(work);
+                });
             }
         }
 
+        HTransformWorkspace* ClaimWorkspace()
+        {
+            std::lock_guard<std::mutex> lock(fWorkspaceMutex);
+            if(fFreeWorkspaces.size() != 0)
+            {
+                HTransformWorkspace* work = fFreeWorkspaces.back();
+                fFreeWorkspaces.pop_back();
+                return work;
+            }
+            HTransformWorkspace* work = new HTransformWorkspace();
+            work->fTile.resize( std::max< size_t >(1, fTileWidth*fMaxDimensionSize) );
+            work->fScratch.resize( std::max< size_t >(1, fMaxWorkspaceSize) );
+            fWorkspaces.push_back(work);
+            return work;
+        }
 
-    private:
+        void ReturnWorkspace(HTransformWorkspace* work)
+        {
+            std::lock_guard<std::mutex> lock(fWorkspaceMutex);
+            fFreeWorkspaces.push_back(work);
+        }
 
         virtual void AllocateWorkspace()
         {
-            size_t dim[1];
+            fMaxWorkspaceSize = 0;
+            fMaxDimensionSize = 0;
             for(size_t i=0; i<NDIM; i++)
             {
-                dim[0] = fDimensionSize[i];
-                fWorkspace[i] = new std::complex<double>[ fDimensionSize[i] ];
-                fWorkspaceWrapper[i] = new HArrayWrapper< std::complex<double>, 1 >(fWorkspace[i], dim);
+                //the plans are only initialized here, and are read-only during the transform
                 fTransformCalculator[i] = new HFastFourierTransform();
                 fTransformCalculator[i]->SetSize(fDimensionSize[i]);
-                fTransformCalculator[i]->SetInput(fWorkspaceWrapper[i]);
-                fTransformCalculator[i]->SetOutput(fWorkspaceWrapper[i]);
                 fTransformCalculator[i]->Initialize();
+                fMaxWorkspaceSize = std::max< size_t >(fMaxWorkspaceSize, fTransformCalculator[i]->GetWorkspaceSize() );
+                fMaxDimensionSize = std::max< size_t >(fMaxDimensionSize, fDimensionSize[i]);
             }
         }
 
@@ -173,10 +312,12 @@ class HMultidimensionalFastFourierTransform: public HUnaryArrayOperator< std::co
         {
             for(size_t i=0; i<NDIM; i++)
             {
-                delete[] fWorkspace[i]; fWorkspace[i] = NULL;
-                delete fWorkspaceWrapper[i]; fWorkspaceWrapper[i] = NULL;
                 delete fTransformCalculator[i]; fTransformCalculator[i] = NULL;
             }
+            std::lock_guard<std::mutex> lock(fWorkspaceMutex);
+            for(size_t i=0; i<fWorkspaces.size(); i++){delete fWorkspaces[i];}
+            fWorkspaces.clear();
+            fFreeWorkspaces.clear();
         }
 
         virtual bool DoInputOutputDimensionsMatch()
@@ -202,11 +343,16 @@ class HMultidimensionalFastFourierTransform: public HUnaryArrayOperator< std::co
         bool fInitialized;
 
         size_t fDimensionSize[NDIM];
+        size_t fTileWidth;
+        size_t fMinElementsPerTask;
+        size_t fMaxWorkspaceSize;
+        size_t fMaxDimensionSize;
 
         HFastFourierTransform* fTransformCalculator[NDIM];
-        std::complex<double>* fWorkspace[NDIM];
-        HArrayWrapper<std::complex<double>, 1>* fWorkspaceWrapper[NDIM];
 
+        std::mutex fWorkspaceMutex;
+        std::vector< HTransformWorkspace* > fWorkspaces;
+        std::vector< HTransformWorkspace* > fFreeWorkspaces;
 
 };
 
@@ -261,6 +261,18 @@ void HBitReversalPermutation::ComputeBitReversedIndices(unsigned int N, unsigned
     }
 }
 
+unsigned int
+HBitReversalPermutation::ReverseBits(unsigned int x, unsigned int n_bits)
+{
+    unsigned int r = 0;
+    for(unsigned int i=0; i<n_bits; i++)
+    {
+        r = (r << 1) | (x & 1);
+        x >>= 1;
+    }
+    return r;
+}
+
 bool
 HBitReversalPermutation::Factor(unsigned int N, unsigned int n_factors, unsigned int* factors, unsigned int* powers)
 {
@@ -20,15 +20,21 @@ HFastFourierTransform::HFastFourierTransform()
     fInitialized = false;
     fSizeIsPowerOfTwo = false;
     fSizeIsPowerOfThree = false;
+    fSizeIsMixedRadix = false;
+    fSizeUsesCodelets = false;
 
     fN = 0;
     fM = 0;
+    fN1 = 0;
+    fN2 = 0;
+    fNStages = 0;
     fPermutation = NULL;
     fTwiddle = NULL;
     fConjugateTwiddle = NULL;
     fScale = NULL;
     fCirculant = NULL;
     fWorkspace = NULL;
+    fGatherBuffer = NULL;
 }
 
 HFastFourierTransform::~HFastFourierTransform()
@@ -44,6 +50,17 @@ HFastFourierTransform::SetSize(unsigned int N)
         fN = N;
         fSizeIsPowerOfTwo = HBitReversalPermutation::IsPowerOfTwo(N);
         fSizeIsPowerOfThree = HBitReversalPermutation::IsPowerOfBase(N,3);
+        fNStages = 0;
+        if(!fSizeIsPowerOfTwo && !fSizeIsPowerOfThree)
+        {
+            fNStages = HFastFourierTransformUtilities::ComputeMixedRadixFactors(N, fRadices);
+        }
+        fSizeIsMixedRadix = (fNStages != 0);
+        fSizeUsesCodelets = false;
+        if(fSizeIsPowerOfTwo)
+        {
+            fSizeUsesCodelets = HFastFourierTransformUtilities::ComputeSixStepFactors(N, fN1, fN2);
+        }
         fM = HFastFourierTransformUtilities::ComputeBluesteinArraySize(N);
         fInitialized = false;
     }
@@ -61,7 +78,8 @@ HFastFourierTransform::Initialize()
     // std::cout<<"fN = "<<fN<<std::endl;
     // std::cout<<"input size = "<<fInput->GetArraySize()<<std::endl;
     // std::cout<<"output size = "<<fOutput->GetArraySize()<<std::endl;
-    if(fInput->GetArraySize() != fN || fOutput->GetArraySize() != fN)
+    //the plan can also be initialized without input/output arrays, for use with Transform
+    if(fInput != NULL && fOutput != NULL && (fInput->GetArraySize() != fN || fOutput->GetArraySize() != fN) )
     {
         fIsValid = false;
     }
@@ -75,8 +93,7 @@ HFastFourierTransform::Initialize()
         //compute the permutation arrays and twiddle factors
         if(fSizeIsPowerOfTwo)
         {
-            //use radix-2
-            HBitReversalPermutation::ComputeBitReversedIndicesBaseTwo(fN, fPermutation);
+            //use radix-2 (the bit-reversal permutation needs no index table)
             HFastFourierTransformUtilities::ComputeTwiddleFactors(fN, fTwiddle);
             HFastFourierTransformUtilities::ComputeConjugateTwiddleFactors(fN, fConjugateTwiddle);
         }
@@ -89,10 +106,15 @@ HFastFourierTransform::Initialize()
             HFastFourierTransformUtilities::ComputeConjugateTwiddleFactors(fN, fConjugateTwiddle);
         }
 
-        if(!fSizeIsPowerOfThree && !fSizeIsPowerOfTwo)
+        if(fSizeIsMixedRadix)
         {
-            //use Bluestein algorithm
-            HBitReversalPermutation::ComputeBitReversedIndicesBaseTwo(fM, fPermutation);
+            //use mixed-radix, the twiddle factors are for the full length
+            HFastFourierTransformUtilities::ComputeTwiddleFactors(fN, fTwiddle);
+        }
+
+        if(!fSizeIsPowerOfThree && !fSizeIsPowerOfTwo && !fSizeIsMixedRadix)
+        {
+            //use Bluestein algorithm (the DIF/DIT pair needs no permutation)
             HFastFourierTransformUtilities::ComputeTwiddleFactors(fM, fTwiddle);
             HFastFourierTransformUtilities::ComputeConjugateTwiddleFactors(fM, fConjugateTwiddle);
             HFastFourierTransformUtilities::ComputeBluesteinScaleFactors(fN, fScale);
@@ -121,59 +143,109 @@ HFastFourierTransform::ExecuteOperation()
             std::memcpy( (void*) fOutput->GetData(), (void*) fInput->GetData(), fN*sizeof(std::complex<double>) );
         }
 
+        Transform(fOutput->GetData(), fWorkspace);
+    }
+    else
+    {
+        //warning
+        std::cout<<"HFastFourierTransform::ExecuteOperation: Warning, transform not valid. Aborting."<<std::endl;
+    }
+}
 
-        if(!fForward) //for IDFT we conjugate first
-        {
-            std::complex<double>* data = fOutput->GetData();
-            for(unsigned int i=0; i<fN; i++)
-            {
-                data[i] = std::conj(data[i]);
-            }
-        }
+unsigned int
+HFastFourierTransform::GetWorkspaceSize() const
+{
+    if(fSizeIsMixedRadix || fSizeUsesCodelets){return fN;}
+    if(!fSizeIsPowerOfTwo && !fSizeIsPowerOfThree){return fM;}
+    return 0;
+}
 
-        if(fSizeIsPowerOfTwo)
+void
+HFastFourierTransform::Transform(std::complex<double>* data, std::complex<double>* workspace) const
+{
+    if(!fForward) //for IDFT we conjugate first
+    {
+        for(unsigned int i=0; i<fN; i++)
         {
-            //use radix-2
-            HBitReversalPermutation::PermuteArray< std::complex<double> >(fN, fPermutation, fOutput->GetData());
-            HFastFourierTransformUtilities::FFTRadixTwo_DIT(fN, fOutput->GetData(), fTwiddle);
+            data[i] = std::conj(data[i]);
         }
+    }
 
-        if(fSizeIsPowerOfThree)
-        {
-            //use radix-3
-            HBitReversalPermutation::PermuteArray< std::complex<double> >(fN, fPermutation, fOutput->GetData());
-            HFastFourierTransformUtilities::FFTRadixThree(fN, fOutput->GetData(), fTwiddle);
-        }
+    if(fSizeUsesCodelets)
+    {
+        //use the fixed size codelets
+        HFastFourierTransformUtilities::FFTSixStep(fN, fN1, fN2, data, fTwiddle, workspace);
+    }
+    else if(fSizeIsPowerOfTwo)
+    {
+        //use radix-2
+        HBitReversalPermutation::PermuteArrayBlocked< std::complex<double> >(fN, data);
+        HFastFourierTransformUtilities::FFTRadixTwo_DIT(fN, data, fTwiddle);
+    }
 
-        if(!fSizeIsPowerOfThree && !fSizeIsPowerOfTwo)
-        {
-            //use bluestein algorithm for arbitrary N
-            HFastFourierTransformUtilities::FFTBluestein(fN, fM, fOutput->GetData(), fTwiddle, fConjugateTwiddle, fScale, fCirculant, fWorkspace);
-        }
+    if(fSizeIsPowerOfThree)
+    {
+        //use radix-3
+        HBitReversalPermutation::PermuteArray< std::complex<double> >(fN, fPermutation, data);
+        HFastFourierTransformUtilities::FFTRadixThree(fN, data, fTwiddle);
+    }
 
-        if(!fForward) //for IDFT we conjugate again
+    if(fSizeIsMixedRadix)
+    {
+        //use mixed-radix for N with small prime factors (natural order in and out)
+        HFastFourierTransformUtilities::FFTMixedRadix(fN, fNStages, fRadices, data, fTwiddle, workspace);
+    }
+
+    if(!fSizeIsPowerOfThree && !fSizeIsPowerOfTwo && !fSizeIsMixedRadix)
+    {
+        //use bluestein algorithm for arbitrary N
+        HFastFourierTransformUtilities::FFTBluestein(fN, fM, data, fTwiddle, fConjugateTwiddle, fScale, fCirculant, workspace);
+    }
+
+    if(!fForward) //for IDFT we conjugate again
+    {
+        for(unsigned int i=0; i<fN; i++)
         {
-            std::complex<double>* data = fOutput->GetData();
-            for(unsigned int i=0; i<fN; i++)
-            {
-                data[i] = std::conj(data[i]);
-            }
+            data[i] = std::conj(data[i]);
         }
     }
-    else
+}
+
+void
+HFastFourierTransform::Transform(const HArrayView< std::complex<double>, 1 >& data)
+{
+    if(!fIsValid || !fInitialized || data.GetArraySize() != fN)
     {
-        //warning
-        std::cout<<"HFastFourierTransform::ExecuteOperation: Warning, transform not valid. Aborting."<<std::endl;
+        std::cout<<"HFastFourierTransform::Transform: Warning, transform not valid for a view of size "<<data.GetArraySize()<<". Aborting."<<std::endl;
+        return;
     }
+
+    std::complex<double>* ptr = data.GetData();
+    size_t stride = data.GetStride(0);
+    if(stride == 1)
+    {
+        Transform(ptr, fWorkspace);
+        return;
+    }
+
+    if(fGatherBuffer == NULL){fGatherBuffer = new std::complex<double>[fN];}
+    for(unsigned int i=0; i<fN; i++){fGatherBuffer[i] = ptr[i*stride];}
+    Transform(fGatherBuffer, fWorkspace);
+    for(unsigned int i=0; i<fN; i++){ptr[i*stride] = fGatherBuffer[i];}
 }
 
 void
 HFastFourierTransform::AllocateWorkspace()
 {
-    if(!fSizeIsPowerOfTwo && !fSizeIsPowerOfThree)
+    if(fSizeIsMixedRadix)
+    {
+        //stockham transform ping-pongs between the data and a workspace of the same length
+        fTwiddle = new std::complex<double>[fN];
+        fWorkspace = new std::complex<double>[fN];
+    }
+    else if(!fSizeIsPowerOfTwo && !fSizeIsPowerOfThree)
     {
         //can't perform an in-place transform, need workspace
-        fPermutation = new unsigned int[fM];
         fTwiddle = new std::complex<double>[fM];
         fConjugateTwiddle = new std::complex<double>[fM];
         fScale = new std::complex<double>[fN];
@@ -183,8 +255,9 @@ HFastFourierTransform::AllocateWorkspace()
     else
     {
         //can do an in-place transform,
-        //only need space for the permutation array, and twiddle factors
-        fPermutation = new unsigned int[fN];
+        //only need space for the twiddle factors (and the permutation array for radix-3)
+        if(fSizeIsPowerOfThree){fPermutation = new unsigned int[fN];}
+        if(fSizeUsesCodelets){fWorkspace = new std::complex<double>[fN];}
         fTwiddle = new std::complex<double>[fN];
         fConjugateTwiddle = new std::complex<double>[fN];
     }
@@ -199,6 +272,7 @@ HFastFourierTransform::DealocateWorkspace()
     delete[] fScale; fScale = NULL;
     delete[] fCirculant; fCirculant = NULL;
     delete[] fWorkspace; fWorkspace = NULL;
+    delete[] fGatherBuffer; fGatherBuffer = NULL;
 }
 
 }
@@ -1,14 +1,35 @@
 #include "HFastFourierTransformUtilities.hh"
+#include "HFastFourierTransformCodelets.hh"
 
 #include <iostream>
 #include <cstddef>
+#include <cstring>
+#include <algorithm>
 #include <cmath>
+#include <stdint.h>
 
 #define SQRT_THREE_OVER_TWO 0.866025403784438646763723170753
+#define COS_TWO_PI_OVER_FIVE 0.309016994374947424102293417183
+#define COS_FOUR_PI_OVER_FIVE -0.809016994374947424102293417183
+#define SIN_TWO_PI_OVER_FIVE 0.951056516295153572116439333379
+#define SIN_FOUR_PI_OVER_FIVE 0.587785252292473129168705954639
 
 namespace hose
 {
 
+//complex multiplication, without the inf/nan recovery of std::complex operator*
+//(which prevents it from being inlined and vectorized)
+static inline std::complex<double> MultiplyComplex(const std::complex<double>& a, const std::complex<double>& b)
+{
+    return std::complex<double>(a.real()*b.real() - a.imag()*b.imag(), a.real()*b.imag() + a.imag()*b.real());
+}
+
+//multiplication by i
+static inline std::complex<double> MultiplyByI(const std::complex<double>& a)
+{
+    return std::complex<double>(-1.0*a.imag(), a.real());
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //TWIDDLE FACTORS
 
@@ -350,6 +371,403 @@ HFastFourierTransformUtilities::FFTRadixThree(unsigned int N, std::complex<doubl
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+//MIXED-RADIX
+
+unsigned int
+HFastFourierTransformUtilities::ComputeMixedRadixFactors(unsigned int N, unsigned int* radices)
+{
+    if(N < 2){return 0;}
+
+    //first the factors with dedicated butterflies
+    unsigned int factors[4] = {2, 3, 5, 7};
+    unsigned int powers[4];
+    bool complete = HBitReversalPermutation::Factor(N, 4, factors, powers);
+
+    //then any other (small) prime factors, which use the generic odd butterfly
+    unsigned int others[MaxMixedRadixStages];
+    unsigned int n_others = 0;
+    if(!complete)
+    {
+        unsigned int remainder = N;
+        for(unsigned int i=0; i<4; i++)
+        {
+            for(unsigned int j=0; j<powers[i]; j++){remainder /= factors[i];}
+        }
+
+        for(unsigned int f=11; f*f <= remainder; f += 2)
+        {
+            while(remainder % f == 0)
+            {
+                if(f > MaxMixedRadixPrime){return 0;}
+                others[n_others++] = f;
+                remainder /= f;
+            }
+        }
+        if(remainder > 1)
+        {
+            if(remainder > MaxMixedRadixPrime){return 0;}
+            others[n_others++] = remainder;
+        }
+    }
+
+    //pairs of two are combined into radix-4 stages
+    unsigned int n_stages = 0;
+    for(unsigned int j=0; j<powers[0]/2; j++){radices[n_stages++] = 4;}
+    if(powers[0] % 2 == 1){radices[n_stages++] = 2;}
+    for(unsigned int i=1; i<4; i++)
+    {
+        for(unsigned int j=0; j<powers[i]; j++){radices[n_stages++] = factors[i];}
+    }
+    for(unsigned int j=0; j<n_others; j++){radices[n_stages++] = others[j];}
+
+    return n_stages;
+}
+
+void
+HFastFourierTransformUtilities::FFTMixedRadix(unsigned int N,
+                                              unsigned int n_stages,
+                                              const unsigned int* radices,
+                                              std::complex<double>* data,
+                                              const std::complex<double>* twiddle,
+                                              std::complex<double>* workspace)
+{
+    //Stockham autosort, each stage reads from one array and writes (in sorted order) to
+    //the other, a sub-sequence of length n is transformed for each of the s strides
+    //see: "Computational Frameworks for the Fast Fourier Transform", C. Van Loan, SIAM, 1992
+    std::complex<double>* x = data;
+    std::complex<double>* y = workspace;
+    unsigned int n = N;
+    unsigned int s = 1;
+
+    for(unsigned int stage=0; stage<n_stages; stage++)
+    {
+        unsigned int p = radices[stage];
+        switch(p)
+        {
+            case 2: StockhamStageRadixTwo(N, n, s, x, y, twiddle); break;
+            case 3: StockhamStageRadixThree(N, n, s, x, y, twiddle); break;
+            case 4: StockhamStageRadixFour(N, n, s, x, y, twiddle); break;
+            case 5: StockhamStageRadixFive(N, n, s, x, y, twiddle); break;
+            default: StockhamStageRadixOdd(N, p, n, s, x, y, twiddle); break;
+        }
+        n /= p;
+        s *= p;
+        std::swap(x, y);
+    }
+
+    //after an odd number of stages the result is in the workspace
+    if(x != data)
+    {
+        std::memcpy( (void*) data, (void*) x, N*sizeof(std::complex<double>) );
+    }
+}
+
+void
+HFastFourierTransformUtilities::StockhamStageRadixTwo(unsigned int /*N*/, unsigned int n, unsigned int s,
+                                                      const std::complex<double>* x, std::complex<double>* y,
+                                                      const std::complex<double>* twiddle)
+{
+    unsigned int m = n/2;
+    for(unsigned int q=0; q<m; q++)
+    {
+        //the twiddle factor for element k of the butterfly is e^{i*2*pi*q*k/n} = twiddle[q*k*s]
+        std::complex<double> w1 = twiddle[q*s];
+        const std::complex<double>* x0 = x + s*q;
+        const std::complex<double>* x1 = x + s*(q + m);
+        std::complex<double>* y0 = y + s*2*q;
+        std::complex<double>* y1 = y0 + s;
+        for(unsigned int j=0; j<s; j++)
+        {
+            std::complex<double> a0 = x0[j];
+            std::complex<double> a1 = x1[j];
+            y0[j] = a0 + a1;
+            y1[j] = MultiplyComplex(a0 - a1, w1);
+        }
+    }
+}
+
+void
+HFastFourierTransformUtilities::StockhamStageRadixThree(unsigned int /*N*/, unsigned int n, unsigned int s,
+                                                        const std::complex<double>* x, std::complex<double>* y,
+                                                        const std::complex<double>* twiddle)
+{
+    unsigned int m = n/3;
+    for(unsigned int q=0; q<m; q++)
+    {
+        std::complex<double> w1 = twiddle[q*s];
+        std::complex<double> w2 = twiddle[2*q*s];
+        const std::complex<double>* x0 = x + s*q;
+        const std::complex<double>* x1 = x + s*(q + m);
+        const std::complex<double>* x2 = x + s*(q + 2*m);
+        std::complex<double>* y0 = y + s*3*q;
+        std::complex<double>* y1 = y0 + s;
+        std::complex<double>* y2 = y1 + s;
+        for(unsigned int j=0; j<s; j++)
+        {
+            std::complex<double> a0 = x0[j];
+            std::complex<double> a1 = x1[j];
+            std::complex<double> a2 = x2[j];
+            std::complex<double> t0 = a1 + a2;
+            std::complex<double> t1 = a0 - 0.5*t0;
+            std::complex<double> t2 = MultiplyByI( SQRT_THREE_OVER_TWO*(a1 - a2) );
+            y0[j] = a0 + t0;
+            y1[j] = MultiplyComplex(t1 + t2, w1);
+            y2[j] = MultiplyComplex(t1 - t2, w2);
+        }
+    }
+}
+
+void
+HFastFourierTransformUtilities::StockhamStageRadixFour(unsigned int /*N*/, unsigned int n, unsigned int s,
+                                                       const std::complex<double>* x, std::complex<double>* y,
+                                                       const std::complex<double>* twiddle)
+{
+    unsigned int m = n/4;
+    for(unsigned int q=0; q<m; q++)
+    {
+        std::complex<double> w1 = twiddle[q*s];
+        std::complex<double> w2 = twiddle[2*q*s];
+        std::complex<double> w3 = twiddle[3*q*s];
+        const std::complex<double>* x0 = x + s*q;
+        const std::complex<double>* x1 = x + s*(q + m);
+        const std::complex<double>* x2 = x + s*(q + 2*m);
+        const std::complex<double>* x3 = x + s*(q + 3*m);
+        std::complex<double>* y0 = y + s*4*q;
+        std::complex<double>* y1 = y0 + s;
+        std::complex<double>* y2 = y1 + s;
+        std::complex<double>* y3 = y2 + s;
+        for(unsigned int j=0; j<s; j++)
+        {
+            std::complex<double> a0 = x0[j];
+            std::complex<double> a1 = x1[j];
+            std::complex<double> a2 = x2[j];
+            std::complex<double> a3 = x3[j];
+            std::complex<double> t0 = a0 + a2;
+            std::complex<double> t1 = a0 - a2;
+            std::complex<double> t2 = a1 + a3;
+            std::complex<double> t3 = MultiplyByI(a1 - a3);
+            y0[j] = t0 + t2;
+            y1[j] = MultiplyComplex(t1 + t3, w1);
+            y2[j] = MultiplyComplex(t0 - t2, w2);
+            y3[j] = MultiplyComplex(t1 - t3, w3);
+        }
+    }
+}
+
+void
+HFastFourierTransformUtilities::StockhamStageRadixFive(unsigned int /*N*/, unsigned int n, unsigned int s,
+                                                       const std::complex<double>* x, std::complex<double>* y,
+                                                       const std::complex<double>* twiddle)
+{
+    unsigned int m = n/5;
+    for(unsigned int q=0; q<m; q++)
+    {
+        std::complex<double> w1 = twiddle[q*s];
+        std::complex<double> w2 = twiddle[2*q*s];
+        std::complex<double> w3 = twiddle[3*q*s];
+        std::complex<double> w4 = twiddle[4*q*s];
+        const std::complex<double>* x0 = x + s*q;
+        const std::complex<double>* x1 = x + s*(q + m);
+        const std::complex<double>* x2 = x + s*(q + 2*m);
+        const std::complex<double>* x3 = x + s*(q + 3*m);
+        const std::complex<double>* x4 = x + s*(q + 4*m);
+        std::complex<double>* y0 = y + s*5*q;
+        std::complex<double>* y1 = y0 + s;
+        std::complex<double>* y2 = y1 + s;
+        std::complex<double>* y3 = y2 + s;
+        std::complex<double>* y4 = y3 + s;
+        for(unsigned int j=0; j<s; j++)
+        {
+            std::complex<double> a0 = x0[j];
+            std::complex<double> a1 = x1[j];
+            std::complex<double> a2 = x2[j];
+            std::complex<double> a3 = x3[j];
+            std::complex<double> a4 = x4[j];
+
+            //pair the terms symmetric about the middle, a_r*e^{i*phi} + a_{5-r}*e^{-i*phi}
+            std::complex<double> t1 = a1 + a4;
+            std::complex<double> t2 = a2 + a3;
+            std::complex<double> t3 = a1 - a4;
+            std::complex<double> t4 = a2 - a3;
+            std::complex<double> c1 = a0 + COS_TWO_PI_OVER_FIVE*t1 + COS_FOUR_PI_OVER_FIVE*t2;
+            std::complex<double> c2 = a0 + COS_FOUR_PI_OVER_FIVE*t1 + COS_TWO_PI_OVER_FIVE*t2;
+            std::complex<double> s1 = MultiplyByI(SIN_TWO_PI_OVER_FIVE*t3 + SIN_FOUR_PI_OVER_FIVE*t4);
+            std::complex<double> s2 = MultiplyByI(SIN_FOUR_PI_OVER_FIVE*t3 - SIN_TWO_PI_OVER_FIVE*t4);
+
+            y0[j] = a0 + t1 + t2;
+            y1[j] = MultiplyComplex(c1 + s1, w1);
+            y2[j] = MultiplyComplex(c2 + s2, w2);
+            y3[j] = MultiplyComplex(c2 - s2, w3);
+            y4[j] = MultiplyComplex(c1 - s1, w4);
+        }
+    }
+}
+
+void
+HFastFourierTransformUtilities::StockhamStageRadixOdd(unsigned int N, unsigned int p, unsigned int n, unsigned int s,
+                                                      const std::complex<double>* x, std::complex<double>* y,
+                                                      const std::complex<double>* twiddle)
+{
+    //generic butterfly for an odd prime radix p <= MaxMixedRadixPrime, pairing the symmetric terms
+    //b_k = a_0 + sum_{r=1}^{h} cos(2*pi*r*k/p)*(a_r + a_{p-r}) + i*sin(2*pi*r*k/p)*(a_r - a_{p-r})
+    //and b_{p-k} is the same with the sign of the sine terms reversed, h = (p-1)/2
+    const unsigned int max_half = (MaxMixedRadixPrime - 1)/2;
+    unsigned int h = (p - 1)/2;
+    unsigned int m = n/p;
+
+    //e^{i*2*pi*r*k/p} = twiddle[((r*k) mod p)*N/p]
+    double cos_rk[max_half][max_half];
+    double sin_rk[max_half][max_half];
+    for(unsigned int k=1; k<=h; k++)
+    {
+        for(unsigned int r=1; r<=h; r++)
+        {
+            std::complex<double> w = twiddle[ ((r*k) % p)*(N/p) ];
+            cos_rk[k-1][r-1] = w.real();
+            sin_rk[k-1][r-1] = w.imag();
+        }
+    }
+
+    std::complex<double> sums[max_half];
+    std::complex<double> differences[max_half];
+    std::complex<double> w[MaxMixedRadixPrime];
+    for(unsigned int q=0; q<m; q++)
+    {
+        for(unsigned int k=1; k<p; k++){w[k] = twiddle[q*k*s];}
+        for(unsigned int j=0; j<s; j++)
+        {
+            std::complex<double> a0 = x[j + s*q];
+            std::complex<double> b0 = a0;
+            for(unsigned int r=1; r<=h; r++)
+            {
+                std::complex<double> ar = x[j + s*(q + r*m)];
+                std::complex<double> apr = x[j + s*(q + (p - r)*m)];
+                sums[r-1] = ar + apr;
+                differences[r-1] = ar - apr;
+                b0 += sums[r-1];
+            }
+            y[j + s*p*q] = b0;
+
+            for(unsigned int k=1; k<=h; k++)
+            {
+                std::complex<double> c = a0;
+                std::complex<double> d(0.0, 0.0);
+                for(unsigned int r=0; r<h; r++)
+                {
+                    c += cos_rk[k-1][r]*sums[r];
+                    d += sin_rk[k-1][r]*differences[r];
+                }
+                d = MultiplyByI(d);
+                y[j + s*(p*q + k)] = MultiplyComplex(c + d, w[k]);
+                y[j + s*(p*q + p - k)] = MultiplyComplex(c - d, w[p-k]);
+            }
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//Codelets
+
+HFastFourierTransformUtilities::CodeletFunction
+HFastFourierTransformUtilities::GetCodelet(unsigned int N)
+{
+    switch(N)
+    {
+        case 2: return &HFFTCodelet<2>::Apply;
+        case 4: return &HFFTCodelet<4>::Apply;
+        case 8: return &HFFTCodelet<8>::Apply;
+        case 16: return &HFFTCodelet<16>::Apply;
+        case 32: return &HFFTCodelet<32>::Apply;
+        case 64: return &HFFTCodelet<64>::Apply;
+        case 128: return &HFFTCodelet<128>::Apply;
+        case 256: return &HFFTCodelet<256>::Apply;
+        case 512: return &HFFTCodelet<512>::Apply;
+        case 1024: return &HFFTCodelet<1024>::Apply;
+        default: return NULL;
+    }
+}
+
+bool
+HFastFourierTransformUtilities::ComputeSixStepFactors(unsigned int N, unsigned int& N1, unsigned int& N2)
+{
+    N1 = 0;
+    N2 = 0;
+    if(N < MinCodeletSize || !HBitReversalPermutation::IsPowerOfTwo(N)){return false;}
+    if(N <= MaxCodeletSize)
+    {
+        N1 = 1;
+        N2 = N;
+        return true;
+    }
+
+    //as square as possible, so both passes use mid-sized codelets
+    unsigned int p = HBitReversalPermutation::LogBaseTwo(N);
+    N1 = 1u << (p/2);
+    N2 = N/N1;
+    if(N2 > MaxCodeletSize){N1 = 0; N2 = 0; return false;}
+    return true;
+}
+
+void
+HFastFourierTransformUtilities::FFTSixStep(unsigned int N,
+                                           unsigned int N1,
+                                           unsigned int N2,
+                                           std::complex<double>* data,
+                                           const std::complex<double>* twiddle,
+                                           std::complex<double>* workspace)
+{
+    if(N1 == 1)
+    {
+        //a single codelet
+        GetCodelet(N)(data, 1, workspace);
+        std::memcpy(data, workspace, N*sizeof(std::complex<double>) );
+        return;
+    }
+
+    CodeletFunction first = GetCodelet(N1);
+    CodeletFunction second = GetCodelet(N2);
+
+    //with n = N2*n1 + n2 and k = k1 + N1*k2, X[k] = sum_n2 W_N^(n2*k1) W_N2^(n2*k2) sum_n1 W_N1^(n1*k1) x[n]
+    //columns n2 become rows of length N1
+    Transpose(N1, N2, data, workspace);
+    for(unsigned int n2=0; n2<N2; n2++)
+    {
+        std::complex<double>* row = data + n2*N1;
+        first(workspace + n2*N1, 1, row);
+        for(unsigned int k1=1; k1<N1; k1++){row[k1] = MultiplyComplex(row[k1], twiddle[n2*k1]);}
+    }
+
+    //rows k1 of length N2
+    Transpose(N2, N1, data, workspace);
+    for(unsigned int k1=0; k1<N1; k1++){second(workspace + k1*N2, 1, data + k1*N2);}
+
+    //element (k1,k2) to k1 + N1*k2
+    Transpose(N1, N2, data, workspace);
+    std::memcpy(data, workspace, N*sizeof(std::complex<double>) );
+}
+
+void
+HFastFourierTransformUtilities::Transpose(unsigned int rows, unsigned int cols, const std::complex<double>* in, std::complex<double>* out)
+{
+    //16x16 blocks of complex<double> (4kB) for the source and destination both fit in L1
+    const unsigned int block = 16;
+    for(unsigned int i0=0; i0<rows; i0 += block)
+    {
+        unsigned int i1 = std::min(rows, i0 + block);
+        for(unsigned int j0=0; j0<cols; j0 += block)
+        {
+            unsigned int j1 = std::min(cols, j0 + block);
+            for(unsigned int i=i0; i<i1; i++)
+            {
+                for(unsigned int j=j0; j<j1; j++){out[j*rows + i] = in[i*cols + j];}
+            }
+        }
+    }
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //Bluestein Algorithm
 
@@ -374,12 +792,14 @@ HFastFourierTransformUtilities::ComputeBluesteinScaleFactors(unsigned int N, std
 {
     //STEP A
     double theta = M_PI/((double)N);
-    unsigned int i2;
+    uint64_t i2;
     double x;
 
     for(unsigned int i=0; i<N; i++)
     {
-        i2 = i*i % (2*N); //taking the modulus here results in a more accurate DFT/IDFT
+        //taking the modulus here results in a more accurate DFT/IDFT
+        //(in 64 bits, since i*i overflows 32 bits for N > 65536)
+        i2 = ( ( (uint64_t) i )*( (uint64_t) i ) ) % ( 2*( (uint64_t) N ) );
         x = theta*i2;
         scale[i] = std::complex<double>( std::cos(x), std::sin(x) );
     }
@@ -0,0 +1,410 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <ctime>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <complex>
+#include <algorithm>
+#include <getopt.h>
+
+//single header JSON lib
+#include <json.hpp>
+using json = nlohmann::json;
+
+#include "HArrayWrapper.hh"
+#include "HFastFourierTransform.hh"
+#include "HFastFourierTransformUtilities.hh"
+#include "HMultidimensionalFastFourierTransform.hh"
+#include "HTaskScheduler.hh"
+
+#ifdef HOSE_USE_FFTW
+#include "HMultidimensionalFastFourierTransformFFTW.hh"
+#endif
+
+using namespace hose;
+
+/*
+*Throughput and accuracy of the FFT engines over a sweep of sizes, batch counts and thread counts.
+*Each case transforms a batch x N array (out-of-place, so the input is preserved between repetitions):
+*  native   - batch independent 1D transforms of length N, one shared HFastFourierTransform plan,
+*             the rows are split over the threads
+*  multidim - HMultidimensionalFastFourierTransform<2> on the batch x N array (a 1D transform when
+*             batch = 1, otherwise a 2D transform), parallelized by the task scheduler
+*  fftw     - HMultidimensionalFastFourierTransformFFTW<2> on the same array (single threaded, only
+*             when built with HOSE_USE_FFTW)
+*Errors are measured on a sample of output bins against a direct DFT in long double precision,
+*GFLOP/s uses the conventional 5 N log2(N) operation count of a complex transform of N points.
+*All engines are double precision only.
+*/
+
+std::vector<unsigned int> ParseList(const std::string& s)
+{
+    std::vector<unsigned int> values;
+    std::stringstream ss(s);
+    std::string item;
+    while(std::getline(ss, item, ','))
+    {
+        if(item.size() != 0){values.push_back( std::stoul(item) );}
+    }
+    return values;
+}
+
+std::vector<std::string> ParseNames(const std::string& s)
+{
+    std::vector<std::string> names;
+    std::stringstream ss(s);
+    std::string item;
+    while(std::getline(ss, item, ',')){if(item.size() != 0){names.push_back(item);}}
+    return names;
+}
+
+//which algorithm HFastFourierTransform uses for this size
+std::string AlgorithmName(unsigned int N)
+{
+    unsigned int N1, N2;
+    unsigned int radices[HFastFourierTransformUtilities::MaxMixedRadixStages];
+    if(HFastFourierTransformUtilities::ComputeSixStepFactors(N, N1, N2)){return "codelets";}
+    if(HBitReversalPermutation::IsPowerOfTwo(N)){return "radix-2";}
+    if(HBitReversalPermutation::IsPowerOfBase(N,3)){return "radix-3";}
+    if(HFastFourierTransformUtilities::ComputeMixedRadixFactors(N, radices) != 0){return "mixed-radix";}
+    return "bluestein";
+}
+
+//e^{+2 pi i m/N} for m in [0,N)
+std::vector< std::complex<long double> > ReferenceTwiddle(size_t N)
+{
+    std::vector< std::complex<long double> > w(N);
+    for(size_t m=0; m<N; m++)
+    {
+        long double theta = 2.0L*M_PI*( (long double) m )/( (long double) N );
+        w[m] = std::complex<long double>(std::cos(theta), std::sin(theta));
+    }
+    return w;
+}
+
+//max and rms error of a sample of bins (relative to the rms value of the reference), against a direct
+//DFT of each row (rank 1) or of the whole batch x N array (rank 2)
+size_t ReferenceError(const std::vector< std::complex<double> >& in, const std::vector< std::complex<double> >& out,
+                      size_t batch, size_t N, size_t rank, size_t n_bins, double& max_error, double& rms_error)
+{
+    size_t total = batch*N;
+    size_t cost = (rank == 1) ? N : total;
+    //keep the reference at ~2^26 terms
+    n_bins = std::max<size_t>(1, std::min( std::min(n_bins, total), ( (size_t) 1 << 26)/cost ) );
+
+    std::vector< std::complex<long double> > wn = ReferenceTwiddle(N);
+    std::vector< std::complex<long double> > wb = ReferenceTwiddle(batch);
+
+    long double err2 = 0.0;
+    long double norm2 = 0.0;
+    long double max_err = 0.0;
+    size_t step = std::max<size_t>(1, total/n_bins);
+    size_t n_used = 0;
+    for(size_t bin = (step/3) % total; bin < total && n_used < n_bins; bin += step, n_used++)
+    {
+        size_t b = bin/N;
+        size_t k = bin % N;
+        std::complex<long double> sum(0.0, 0.0);
+        if(rank == 1)
+        {
+            const std::complex<double>* row = &(in[b*N]);
+            for(size_t n=0; n<N; n++){sum += std::complex<long double>(row[n].real(), row[n].imag())*wn[(n*k) % N];}
+        }
+        else
+        {
+            for(size_t bb=0; bb<batch; bb++)
+            {
+                std::complex<long double> row_sum(0.0, 0.0);
+                const std::complex<double>* row = &(in[bb*N]);
+                for(size_t n=0; n<N; n++){row_sum += std::complex<long double>(row[n].real(), row[n].imag())*wn[(n*k) % N];}
+                sum += row_sum*wb[(bb*b) % batch];
+            }
+        }
+        std::complex<long double> diff = std::complex<long double>(out[bin].real(), out[bin].imag()) - sum;
+        err2 += std::norm(diff);
+        norm2 += std::norm(sum);
+        max_err = std::max(max_err, std::abs(diff));
+    }
+    long double rms_ref = std::sqrt(norm2/n_used);
+    max_error = (double) (max_err/rms_ref);
+    rms_error = (double) std::sqrt(err2/norm2);
+    return n_used;
+}
+
+//calls the transform repeatedly until min_seconds have passed, returns the time per call
+template< typename XFunctionType >
+double TimeTransform(XFunctionType transform, double min_seconds, size_t& n_reps)
+{
+    transform(); //warm up (and first touch)
+    n_reps = 0;
+    double elapsed = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    do
+    {
+        transform();
+        n_reps++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    while(elapsed < min_seconds);
+    return elapsed/n_reps;
+}
+
+int main(int argc, char** argv)
+{
+    std::string usage =
+    "BenchmarkFastFourierTransform <options>\n"
+    "  -s, --sizes <list>       comma separated transform lengths (default: powers of 2, 3, mixed and primes)\n"
+    "  -b, --batches <list>     comma separated batch counts (default: 1,16)\n"
+    "  -t, --threads <list>     comma separated thread counts (default: 1 and the number of cores)\n"
+    "  -e, --engines <list>     any of native,multidim,fftw (default: all that are built)\n"
+    "  -m, --min-time <sec>     minimum timing duration per case (default: 0.2)\n"
+    "  -p, --max-points <n>     skip cases with batch x size larger than this (default: 4194304)\n"
+    "  -n, --error-bins <n>     number of bins checked against the reference DFT (default: 64)\n"
+    "  -o, --output <file>      write the results as JSON to this file ('-' for stdout)";
+
+    std::vector<unsigned int> sizes = {64, 1024, 4096, 65536, 1048576,     //powers of two
+                                       729, 6561, 59049,                   //powers of three
+                                       1000, 10000, 48000, 100000,         //mixed radix
+                                       1009, 65537};                       //primes (bluestein)
+    std::vector<unsigned int> batches = {1, 16};
+    unsigned int n_cores = std::max<unsigned int>(1, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threads = {1};
+    if(n_cores > 1){threads.push_back(n_cores);}
+    std::vector<std::string> engines = {"native", "multidim"};
+    #ifdef HOSE_USE_FFTW
+    engines.push_back("fftw");
+    #endif
+    double min_seconds = 0.2;
+    size_t max_points = 4194304;
+    size_t n_error_bins = 64;
+    std::string output_file = "";
+
+    static struct option longOptions[] = {{"help", no_argument, 0, 'h'},
+                                          {"sizes", required_argument, 0, 's'},
+                                          {"batches", required_argument, 0, 'b'},
+                                          {"threads", required_argument, 0, 't'},
+                                          {"engines", required_argument, 0, 'e'},
+                                          {"min-time", required_argument, 0, 'm'},
+                                          {"max-points", required_argument, 0, 'p'},
+                                          {"error-bins", required_argument, 0, 'n'},
+                                          {"output", required_argument, 0, 'o'},
+                                          {0, 0, 0, 0}};
+
+    static const char* optString = "hs:b:t:e:m:p:n:o:";
+
+    while(true)
+    {
+        char optId = getopt_long(argc, argv, optString, longOptions, NULL);
+        if(optId == -1){break;}
+        switch(optId)
+        {
+            case('h'):
+                std::cout<<usage<<std::endl;
+                return 0;
+            case('s'):
+                sizes = ParseList(std::string(optarg));
+                break;
+            case('b'):
+                batches = ParseList(std::string(optarg));
+                break;
+            case('t'):
+                threads = ParseList(std::string(optarg));
+                break;
+            case('e'):
+                engines = ParseNames(std::string(optarg));
+                break;
+            case('m'):
+                min_seconds = std::atof(optarg);
+                break;
+            case('p'):
+                max_points = std::atol(optarg);
+                break;
+            case('n'):
+                n_error_bins = std::atol(optarg);
+                break;
+            case('o'):
+                output_file = std::string(optarg);
+                break;
+            default:
+                std::cout<<usage<<std::endl;
+                return 1;
+        }
+    }
+
+    for(size_t i=0; i<engines.size(); i++)
+    {
+        #ifndef HOSE_USE_FFTW
+        if(engines[i] == "fftw"){std::cout<<"fftw engine not available (build with HOSE_USE_FFTW)"<<std::endl; return 1;}
+        #endif
+        if(engines[i] != "native" && engines[i] != "multidim" && engines[i] != "fftw")
+        {
+            std::cout<<"unknown engine: "<<engines[i]<<std::endl;
+            std::cout<<usage<<std::endl;
+            return 1;
+        }
+    }
+
+    std::mt19937 gen(11);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    HTaskScheduler* scheduler = HTaskScheduler::GetInstance();
+
+    json results = json::array();
+    std::cout<<std::left<<std::setw(10)<<"engine"<<std::setw(24)<<"algorithm"<<std::setw(10)<<"N"<<std::setw(7)<<"batch"
+             <<std::setw(8)<<"threads"<<std::setw(11)<<"ns/point"<<std::setw(10)<<"GFLOP/s"<<std::setw(13)<<"max error"<<"rms error"<<std::endl;
+
+    for(size_t t=0; t<threads.size(); t++)
+    {
+        unsigned int n_threads = std::max<unsigned int>(1, threads[t]);
+
+        //the calling thread takes part in ParallelFor, so n_threads - 1 workers
+        if(n_threads > 1)
+        {
+            scheduler->SetNThreads(n_threads - 1);
+            scheduler->Launch();
+        }
+
+        for(size_t s=0; s<sizes.size(); s++)
+        {
+            for(size_t b=0; b<batches.size(); b++)
+            {
+                size_t N = sizes[s];
+                size_t batch = std::max<unsigned int>(1, batches[b]);
+                size_t total = batch*N;
+                if(N < 2 || total > max_points){continue;}
+
+                std::vector< std::complex<double> > in(total);
+                for(size_t i=0; i<total; i++){in[i] = std::complex<double>(noise(gen), noise(gen));}
+                std::vector< std::complex<double> > out(total);
+                size_t dim[2] = {batch, N};
+                HArrayWrapper< std::complex<double>, 2 > in_wrapper(&(in[0]), dim);
+                HArrayWrapper< std::complex<double>, 2 > out_wrapper(&(out[0]), dim);
+
+                for(size_t e=0; e<engines.size(); e++)
+                {
+                    std::string engine = engines[e];
+                    if(engine == "fftw" && n_threads > 1){continue;} //the wrapper is single threaded
+
+                    size_t rank = (engine == "native" || batch == 1) ? 1 : 2;
+                    size_t n_reps = 0;
+                    double seconds = 0.0;
+                    std::fill(out.begin(), out.end(), std::complex<double>(0.0, 0.0));
+
+                    if(engine == "native")
+                    {
+                        HFastFourierTransform plan;
+                        plan.SetSize(N);
+                        plan.SetForward();
+                        plan.Initialize();
+
+                        //contiguous chunks of rows, each with its own workspace
+                        size_t n_chunks = std::min<size_t>(batch, n_threads);
+                        std::vector< std::vector< std::complex<double> > > workspace(n_chunks);
+                        for(size_t c=0; c<n_chunks; c++){workspace[c].resize( std::max<unsigned int>(1, plan.GetWorkspaceSize()) );}
+                        auto transform = [&]()
+                        {
+                            scheduler->ParallelFor(n_chunks, [&](size_t c)
+                            {
+                                size_t first = (c*batch)/n_chunks;
+                                size_t last = ( (c+1)*batch )/n_chunks;
+                                for(size_t row=first; row<last; row++)
+                                {
+                                    std::memcpy(&(out[row*N]), &(in[row*N]), N*sizeof(std::complex<double>) );
+                                    plan.Transform(&(out[row*N]), &(workspace[c][0]));
+                                }
+                            });
+                        };
+                        seconds = TimeTransform(transform, min_seconds, n_reps);
+                    }
+                    else if(engine == "multidim")
+                    {
+                        HMultidimensionalFastFourierTransform<2> fft;
+                        fft.SetForward();
+                        fft.SetInput(&in_wrapper);
+                        fft.SetOutput(&out_wrapper);
+                        fft.Initialize();
+                        seconds = TimeTransform([&](){fft.ExecuteOperation();}, min_seconds, n_reps);
+                    }
+                    #ifdef HOSE_USE_FFTW
+                    else if(engine == "fftw")
+                    {
+                        HMultidimensionalFastFourierTransformFFTW<2> fft;
+                        fft.SetForward();
+                        fft.SetInput(&in_wrapper);
+                        fft.SetOutput(&out_wrapper);
+                        fft.Initialize();
+                        seconds = TimeTransform([&](){fft.ExecuteOperation();}, min_seconds, n_reps);
+                    }
+                    #endif
+
+                    double max_error = 0.0;
+                    double rms_error = 0.0;
+                    size_t n_bins = ReferenceError(in, out, batch, N, rank, n_error_bins, max_error, rms_error);
+
+                    double ns_per_point = 1e9*seconds/total;
+                    double flops = (rank == 1) ? 5.0*total*std::log2( (double) N ) : 5.0*total*std::log2( (double) total );
+                    double gflops = 1e-9*flops/seconds;
+                    std::string algorithm = (engine == "fftw") ? std::string("fftw") : AlgorithmName(N);
+                    if(rank == 2 && engine != "fftw"){algorithm = AlgorithmName(batch) + "/" + algorithm;}
+
+                    std::cout<<std::left<<std::setw(10)<<engine<<std::setw(24)<<algorithm<<std::setw(10)<<N<<std::setw(7)<<batch
+                             <<std::setw(8)<<n_threads<<std::setw(11)<<std::setprecision(4)<<ns_per_point<<std::setw(10)<<gflops
+                             <<std::setw(13)<<max_error<<rms_error<<std::endl;
+
+                    json result;
+                    result["engine"] = engine;
+                    result["algorithm"] = algorithm;
+                    result["size"] = N;
+                    result["batch"] = batch;
+                    result["rank"] = rank;
+                    result["threads"] = n_threads;
+                    result["precision"] = "double";
+                    result["repetitions"] = n_reps;
+                    result["seconds_per_transform"] = seconds;
+                    result["ns_per_point"] = ns_per_point;
+                    result["gflops"] = gflops;
+                    result["max_error"] = max_error;
+                    result["rms_error"] = rms_error;
+                    result["error_bins"] = n_bins;
+                    results.push_back(result);
+                }
+            }
+        }
+
+        if(n_threads > 1){scheduler->Terminate();}
+    }
+
+    if(output_file != "")
+    {
+        json report;
+        std::time_t now = std::time(nullptr);
+        char date[64];
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+        report["benchmark"] = "fast_fourier_transform";
+        report["date"] = std::string(date);
+        report["hardware_concurrency"] = n_cores;
+        report["min_seconds"] = min_seconds;
+        report["results"] = results;
+
+        if(output_file == "-"){std::cout<<report.dump(2)<<std::endl;}
+        else
+        {
+            std::ofstream out_stream(output_file.c_str());
+            if(!out_stream.is_open())
+            {
+                std::cout<<"could not open output file: "<<output_file<<std::endl;
+                return 1;
+            }
+            out_stream<<report.dump(2)<<std::endl;
+        }
+    }
+
+    return 0;
+}
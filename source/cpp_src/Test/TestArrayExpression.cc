@@ -0,0 +1,151 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "HArrayWrapper.hh"
+#include "HArrayExpression.hh"
+#include "HArrayExpressionEngine.hh"
+#include "HTaskScheduler.hh"
+
+using namespace hose;
+
+//largest difference between two arrays, relative to the reference value (or to one, for small values)
+template< typename XValueType >
+double MaxRelativeDifference(const std::vector< XValueType >& a, const std::vector< XValueType >& b)
+{
+    double max_diff = 0.0;
+    for(size_t i=0; i<a.size(); i++)
+    {
+        double scale = std::max(1.0, std::fabs( (double) b[i] ) );
+        max_diff = std::max(max_diff, std::fabs( (double) a[i] - (double) b[i] )/scale );
+    }
+    return max_diff;
+}
+
+template< typename XValueType >
+int CheckExpressions(size_t n, double tolerance, HTaskScheduler* scheduler)
+{
+    int status = 0;
+    std::mt19937 gen(11);
+    std::uniform_real_distribution< double > dist(0.5, 2.0);
+    std::vector< XValueType > va(n), vb(n), vc(n), out(n), ref(n);
+    for(size_t i=0; i<n; i++){va[i] = dist(gen); vb[i] = dist(gen); vc[i] = -dist(gen);}
+
+    size_t dim[2] = {n/4, 4};
+    HArrayWrapper< XValueType, 2 > a(&(va[0]), dim);
+    HArrayWrapper< XValueType, 2 > b(&(vb[0]), dim);
+    HArrayWrapper< XValueType, 2 > c(&(vc[0]), dim);
+    HArrayWrapper< XValueType, 2 > o(&(out[0]), dim);
+
+    //element-wise chain, serial and on the scheduler
+    for(size_t i=0; i<n; i++){ref[i] = std::sqrt( (va[i]*va[i] + vb[i]*vb[i])/2.0 ) + std::fabs(vc[i]) - std::min(va[i], vb[i]);}
+    HArrayExpressionEngine::Assign(o, Sqrt( (a*a + b*b)/2.0 ) + Abs(c) - Min(a, b) );
+    if(MaxRelativeDifference(out, ref) > tolerance){std::cout<<"element-wise chain disagrees with the reference"<<std::endl; status = 1;}
+    std::vector< XValueType > serial = out;
+    HArrayExpressionEngine::Assign(o, Sqrt( (a*a + b*b)/2.0 ) + Abs(c) - Min(a, b), scheduler, 1000);
+    if(out != serial){std::cout<<"threaded evaluation differs from the serial one"<<std::endl; status = 1;}
+
+    //scalar on the left, negation, and a function without a SIMD form
+    for(size_t i=0; i<n; i++){ref[i] = 1.0/va[i] - std::exp(-vb[i]);}
+    HArrayExpressionEngine::Assign(o, 1.0/a - Exp(-b) );
+    if(MaxRelativeDifference(out, ref) > tolerance){std::cout<<"scalar/exp expression disagrees with the reference"<<std::endl; status = 1;}
+
+    //output aliasing an input
+    std::vector< XValueType > va_copy = va;
+    HArrayExpressionEngine::Assign(a, a*3.0 + 1.0, scheduler, 1000);
+    for(size_t i=0; i<n; i++){ref[i] = va_copy[i]*3.0 + 1.0;}
+    if(MaxRelativeDifference(va, ref) > tolerance){std::cout<<"in-place expression disagrees with the reference"<<std::endl; status = 1;}
+
+    //reductions
+    double ref_sum = 0.0;
+    XValueType ref_min = va[0];
+    XValueType ref_max = va[0];
+    for(size_t i=0; i<n; i++){ref_sum += (double) va[i]*vb[i]; ref_min = std::min(ref_min, va[i]); ref_max = std::max(ref_max, va[i]);}
+    double sum = HArrayExpressionEngine::Sum(a*b);
+    double tsum = HArrayExpressionEngine::Sum(a*b, scheduler, 1000);
+    if(std::fabs(sum - ref_sum) > tolerance*std::sqrt( (double) n)*ref_sum || std::fabs(tsum - ref_sum) > tolerance*std::sqrt( (double) n)*ref_sum)
+    {
+        std::cout<<"sum disagrees with the reference: "<<sum<<", "<<tsum<<" != "<<ref_sum<<std::endl; status = 1;
+    }
+    if(HArrayExpressionEngine::Minimum(a) != ref_min || HArrayExpressionEngine::Maximum(a, scheduler, 1000) != ref_max)
+    {
+        std::cout<<"minimum/maximum disagree with the reference"<<std::endl; status = 1;
+    }
+
+    //rebinning (with a remainder) of an expression
+    size_t factor = 7;
+    std::vector< XValueType > rebinned(n/factor), ref_rebinned(n/factor);
+    for(size_t j=0; j<n/factor; j++)
+    {
+        double s = 0.0;
+        for(size_t k=0; k<factor; k++){s += va[j*factor+k] - vb[j*factor+k];}
+        ref_rebinned[j] = s/factor;
+    }
+    HArrayExpressionEngine::Rebin(&(rebinned[0]), rebinned.size(), a - b, factor, true, scheduler, 1000);
+    if(MaxRelativeDifference(rebinned, ref_rebinned) > 100*tolerance){std::cout<<"rebinned expression disagrees with the reference"<<std::endl; status = 1;}
+
+    //a size mismatch leaves the output untouched (and prints an error)
+    std::vector< XValueType > small(n/2, 0);
+    HArrayExpressionEngine::Assign(&(small[0]), small.size(), a + b);
+    for(size_t i=0; i<small.size(); i++){if(small[i] != 0){status = 1; break;}}
+
+    return status;
+}
+
+int main(int argc, char** argv)
+{
+    int status = 0;
+
+    size_t n_iter = 20;
+    if(argc > 1){n_iter = std::atol(argv[1]);}
+
+    HTaskScheduler* scheduler = HTaskScheduler::GetInstance();
+    scheduler->SetNThreads(4);
+    scheduler->Launch();
+
+    //the length is not a multiple of the SIMD width, so the scalar remainder is exercised
+    if(CheckExpressions< float >(40004, 1e-6, scheduler) != 0){std::cout<<"float expressions failed"<<std::endl; status = 1;}
+    if(CheckExpressions< double >(40004, 1e-14, scheduler) != 0){std::cout<<"double expressions failed"<<std::endl; status = 1;}
+
+    //mixed element types are evaluated element by element, in the common type
+    std::vector< float > fx(1001, 2.0f);
+    std::vector< double > dx(1001, 0.25);
+    std::vector< double > mixed(1001);
+    HArrayExpressionEngine::Assign(&(mixed[0]), mixed.size(), HArrayRef(&(fx[0]), fx.size())*HArrayRef(&(dx[0]), dx.size()) );
+    for(size_t i=0; i<mixed.size(); i++){if(mixed[i] != 0.5){std::cout<<"mixed type expression failed"<<std::endl; status = 1; break;}}
+
+    //throughput of a fused expression, against the same arithmetic done with whole-array temporaries
+    size_t n = 1 << 20;
+    std::vector< float > on(n, 1.5f), off(n, 1.25f), result(n), tmp1(n), tmp2(n);
+    auto start = std::chrono::steady_clock::now();
+    for(size_t k=0; k<n_iter; k++)
+    {
+        for(size_t i=0; i<n; i++){tmp1[i] = on[i] - off[i];}
+        for(size_t i=0; i<n; i++){tmp2[i] = tmp1[i]/off[i];}
+        for(size_t i=0; i<n; i++){result[i] = tmp2[i]*10.0f;}
+    }
+    double t_temporaries = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    HArrayTerminal< float > t_on = HArrayRef(&(on[0]), n);
+    HArrayTerminal< float > t_off = HArrayRef(&(off[0]), n);
+    start = std::chrono::steady_clock::now();
+    for(size_t k=0; k<n_iter; k++)
+    {
+        HArrayExpressionEngine::Assign(&(result[0]), n, ( (t_on - t_off)/t_off )*10.0, scheduler);
+    }
+    double t_fused = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if(std::fabs(result[0] - 2.0f) > 1e-6){status = 1;}
+
+    std::cout<<"temporaries: "<<1e-6*n_iter*n/t_temporaries<<" Melements/s, fused: "<<1e-6*n_iter*n/t_fused
+             <<" Melements/s (x"<<t_temporaries/t_fused<<")"<<std::endl;
+
+    scheduler->Terminate();
+
+    if(status == 0){std::cout<<"array expression test passed"<<std::endl;}
+    else{std::cout<<"array expression test failed"<<std::endl;}
+
+    return status;
+}
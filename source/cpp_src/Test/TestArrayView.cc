@@ -0,0 +1,162 @@
+#include <iostream>
+#include <vector>
+#include <complex>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "HArrayWrapper.hh"
+#include "HArrayView.hh"
+#include "HArrayExpression.hh"
+#include "HArrayExpressionEngine.hh"
+#include "HFastFourierTransform.hh"
+#include "HMultidimensionalFastFourierTransform.hh"
+
+using namespace hose;
+
+typedef std::complex<double> complex_t;
+
+double MaxDifference(const std::vector< complex_t >& a, const std::vector< complex_t >& b)
+{
+    double max_diff = 0.0;
+    for(size_t i=0; i<a.size(); i++){max_diff = std::max(max_diff, std::abs(a[i] - b[i]) );}
+    return max_diff;
+}
+
+int main(int argc, char** argv)
+{
+    int status = 0;
+
+    size_t n_iter = 20;
+    if(argc > 1){n_iter = std::atol(argv[1]);}
+
+    //index arithmetic of the views of a 4x5x6 array
+    std::vector< double > values(4*5*6);
+    for(size_t i=0; i<values.size(); i++){values[i] = i;}
+    size_t dim3[3] = {4, 5, 6};
+    HArrayWrapper< double, 3 > arr(&(values[0]), dim3);
+    HArrayView< double, 3 > full(arr);
+    if(!full.IsContiguous() || full.At(2,3,4) != 2*30 + 3*6 + 4){std::cout<<"full view indexing failed"<<std::endl; status = 1;}
+
+    HArrayView< double, 3 > sub = full.Slice(0, 1, 4, 2).Slice(2, 1, 6, 2); //rows 1,3 of dim 0, columns 1,3,5 of dim 2
+    if(sub.GetArrayDimension(0) != 2 || sub.GetArrayDimension(2) != 3 || sub.IsContiguous() || sub.At(1,2,2) != 3*30 + 2*6 + 5)
+    {
+        std::cout<<"sliced view indexing failed"<<std::endl; status = 1;
+    }
+
+    HArrayView< double, 2 > plane = full.Fix(1, 3); //4x6
+    HArrayView< double, 2 > transposed = plane.Transpose(0, 1); //6x4
+    if(plane.At(2,5) != 2*30 + 3*6 + 5 || transposed.At(5,2) != plane.At(2,5)){std::cout<<"fixed/transposed view indexing failed"<<std::endl; status = 1;}
+
+    //ForEach visits the view in row major order
+    std::vector< double > visited;
+    sub.ForEach([&visited](double& x){visited.push_back(x);});
+    size_t k = 0;
+    for(size_t i=0; i<2; i++){for(size_t j=0; j<5; j++){for(size_t l=0; l<3; l++){ if(visited[k++] != sub.At(i,j,l)){status = 1;} }}}
+    if(visited.size() != sub.GetArraySize()){status = 1;}
+
+    //copy a transposed (strided) view into a contiguous one, and read it back through a const view
+    std::vector< double > tvalues(6*4);
+    size_t tdim[2] = {6, 4};
+    HArrayView< double, 2 > tcopy(&(tvalues[0]), tdim);
+    tcopy.CopyFrom(transposed);
+    HArrayView< const double, 2 > ctcopy(tcopy);
+    for(size_t i=0; i<6; i++){for(size_t j=0; j<4; j++){ if(ctcopy.At(i,j) != plane.At(j,i)){status = 1;} }}
+
+    //element-wise expressions read from and write to strided 1D views
+    HArrayView< double, 1 > column = plane.Fix(1, 2); //4 elements, stride 30
+    std::vector< double > out(4);
+    HArrayExpressionEngine::Assign(&(out[0]), out.size(), column*2.0 + 1.0);
+    for(size_t i=0; i<4; i++){if(out[i] != 2.0*plane.At(i,2) + 1.0){status = 1;}}
+    HArrayExpressionEngine::Assign(column, HArrayRef(&(out[0]), out.size()) - 1.0);
+    for(size_t i=0; i<4; i++){if(plane.At(i,2) != out[i] - 1.0){status = 1;}}
+    if(status != 0){std::cout<<"view iteration/expressions failed"<<std::endl;}
+
+    //1D transform of a column of a 2D complex array, in place, against a copy of the column
+    std::mt19937 gen(3);
+    std::normal_distribution< double > dist(0.0, 1.0);
+    size_t rows = 64;
+    size_t cols = 48;
+    std::vector< complex_t > grid(rows*cols);
+    for(size_t i=0; i<grid.size(); i++){grid[i] = complex_t(dist(gen), dist(gen));}
+    size_t gdim[2] = {rows, cols};
+    HArrayView< complex_t, 2 > grid_view(&(grid[0]), gdim);
+
+    HFastFourierTransform fft;
+    fft.SetSize(rows);
+    fft.SetForward();
+    fft.Initialize();
+    std::vector< complex_t > col_copy(rows);
+    std::vector< complex_t > workspace( std::max<unsigned int>(1, fft.GetWorkspaceSize()) );
+    for(size_t i=0; i<rows; i++){col_copy[i] = grid[i*cols + 5];}
+    fft.Transform(&(col_copy[0]), &(workspace[0]));
+    fft.Transform(grid_view.Fix(1, 5));
+    std::vector< complex_t > col_result(rows);
+    for(size_t i=0; i<rows; i++){col_result[i] = grid[i*cols + 5];}
+    double col_diff = MaxDifference(col_result, col_copy);
+    std::cout<<"strided 1D transform max difference = "<<col_diff<<std::endl;
+    if(col_diff > 1e-12){status = 1;}
+
+    //2D transform of a sub-block, and of a transposed sub-block, in place, against contiguous copies
+    size_t bdim[2] = {12, 20};
+    HMultidimensionalFastFourierTransform< 2 > fft2;
+    fft2.SetArrayDimensions(bdim);
+    fft2.SetForward();
+    fft2.Initialize();
+
+    HArrayView< complex_t, 2 > block = grid_view.Slice(0, 8, 8 + 3*bdim[0], 3).Slice(1, 10, 10 + bdim[1]);
+    std::vector< complex_t > block_copy(bdim[0]*bdim[1]);
+    HArrayView< complex_t, 2 > block_copy_view(&(block_copy[0]), bdim);
+    block_copy_view.CopyFrom(block);
+    fft2.Transform(block_copy_view);
+    fft2.Transform(block);
+    std::vector< complex_t > block_result(bdim[0]*bdim[1]);
+    HArrayView< complex_t, 2 >(&(block_result[0]), bdim).CopyFrom(block);
+    double block_diff = MaxDifference(block_result, block_copy);
+
+    size_t tbdim[2] = {bdim[1], bdim[0]};
+    HMultidimensionalFastFourierTransform< 2 > fft2t;
+    fft2t.SetArrayDimensions(tbdim);
+    fft2t.SetBackward();
+    fft2t.Initialize();
+    HArrayView< complex_t, 2 > tblock = block.Transpose(0, 1);
+    std::vector< complex_t > tblock_copy(bdim[0]*bdim[1]);
+    HArrayView< complex_t, 2 > tblock_copy_view(&(tblock_copy[0]), tbdim);
+    tblock_copy_view.CopyFrom(tblock);
+    fft2t.Transform(tblock_copy_view);
+    fft2t.Transform(tblock);
+    std::vector< complex_t > tblock_result(bdim[0]*bdim[1]);
+    HArrayView< complex_t, 2 >(&(tblock_result[0]), tbdim).CopyFrom(tblock);
+    double tblock_diff = MaxDifference(tblock_result, tblock_copy);
+    std::cout<<"strided 2D transform max difference = "<<block_diff<<", transposed = "<<tblock_diff<<std::endl;
+    if(block_diff > 1e-12 || tblock_diff > 1e-12){status = 1;}
+
+    //a view of the wrong shape is refused
+    fft2.Transform(tblock);
+
+    //transforming every column in place, against copying each one out and back
+    auto start = std::chrono::steady_clock::now();
+    for(size_t it=0; it<50*n_iter; it++)
+    {
+        for(size_t c=0; c<cols; c++)
+        {
+            for(size_t i=0; i<rows; i++){col_copy[i] = grid[i*cols + c];}
+            fft.Transform(&(col_copy[0]), &(workspace[0]));
+            for(size_t i=0; i<rows; i++){grid[i*cols + c] = col_copy[i];}
+        }
+    }
+    double t_copy = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for(size_t it=0; it<50*n_iter; it++)
+    {
+        for(size_t c=0; c<cols; c++){fft.Transform(grid_view.Fix(1, c));}
+    }
+    double t_view = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout<<"column transforms, with copies: "<<t_copy<<" s, through views: "<<t_view<<" s"<<std::endl;
+
+    if(status == 0){std::cout<<"array view test passed"<<std::endl;}
+    else{std::cout<<"array view test failed"<<std::endl;}
+
+    return status;
+}
@@ -0,0 +1,63 @@
+#include <iostream>
+#include <vector>
+
+#include "HBackPressurePolicy.hh"
+
+using namespace hose;
+
+//feed a sequence of backlog values through a policy and count how many buffers are accepted
+unsigned int CountAccepted(HBackPressurePolicy& policy, const std::vector< std::size_t >& backlogs)
+{
+    unsigned int n = 0;
+    for(std::size_t i=0; i<backlogs.size(); i++)
+    {
+        if(policy.Accept(backlogs[i])){n++;}
+    }
+    return n;
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    int status = 0;
+
+    //a backlog which ramps up to 5 buffers, and then drains back down to zero
+    std::vector< std::size_t > backlogs = {0, 1, 2, 3, 4, 5, 4, 3, 2, 1, 0, 1};
+
+    HBackPressurePolicy block;
+    unsigned int n_block = CountAccepted(block, backlogs);
+    std::cout<<"block: accepted = "<<n_block<<", dropped = "<<block.GetNDropped()<<std::endl;
+    if(n_block != backlogs.size() || block.GetNDropped() != 0){status = 1;}
+
+    //drops everything at or above a backlog of 3: {3,4,5,4,3}
+    HBackPressurePolicy drop;
+    drop.SetAction(HBackPressureAction::drop);
+    drop.SetBacklogThreshold(3);
+    unsigned int n_drop = CountAccepted(drop, backlogs);
+    std::cout<<"drop: accepted = "<<n_drop<<", dropped = "<<drop.GetNDropped()<<std::endl;
+    if(n_drop != 7 || drop.GetNDropped() != 5){status = 1;}
+
+    //keeps the 1st and 3rd and 5th of the overloaded buffers {3,4,5,4,3}
+    HBackPressurePolicy decimate;
+    decimate.SetAction(HBackPressureAction::decimate);
+    decimate.SetBacklogThreshold(3);
+    decimate.SetDecimationFactor(2);
+    unsigned int n_decimate = CountAccepted(decimate, backlogs);
+    std::cout<<"decimate: accepted = "<<n_decimate<<", dropped = "<<decimate.GetNDropped()<<std::endl;
+    if(n_decimate != 10 || decimate.GetNDropped() != 2){status = 1;}
+
+    //pauses from the first backlog of 3 until the queue is empty again: {3,4,5,4,3,2,1}
+    HBackPressurePolicy pause;
+    pause.SetAction(HBackPressureAction::pause);
+    pause.SetBacklogThreshold(3);
+    unsigned int n_pause = CountAccepted(pause, backlogs);
+    std::cout<<"pause: accepted = "<<n_pause<<", dropped = "<<pause.GetNDropped()<<std::endl;
+    if(n_pause != 5 || pause.GetNDropped() != 7){status = 1;}
+
+    pause.ResetCounters();
+    if(pause.GetNAccepted() != 0 || pause.GetNDropped() != 0){status = 1;}
+
+    if(status == 0){std::cout<<"back pressure policy test passed"<<std::endl;}
+    else{std::cout<<"back pressure policy test failed"<<std::endl;}
+
+    return status;
+}
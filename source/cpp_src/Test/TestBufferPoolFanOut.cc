@@ -0,0 +1,68 @@
+#include <iostream>
+#include <vector>
+
+#include "HBufferAllocatorNew.hh"
+#include "HBufferPool.hh"
+
+using namespace hose;
+
+//hands out buffers from a fan-out pool to one regular and one best-effort consumer
+//and checks that buffers only return to the producer once both are done with them
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    HBufferAllocatorNew<int>* allocator = new HBufferAllocatorNew<int>();
+    HBufferPool<int>* pool = new HBufferPool<int>(allocator);
+    pool->Allocate(4, 16);
+
+    HRegisteredConsumer spectrometer;
+    HRegisteredConsumer dumper;
+    dumper.SetBestEffort(true);
+
+    pool->RegisterConsumer(&spectrometer);
+    pool->RegisterConsumer(&dumper);
+    pool->EnableFanOut();
+    pool->Initialize();
+
+    int status = 0;
+
+    //produce three buffers, the dumper never consumes, so it should only be handed the first
+    for(unsigned int i=0; i<3; i++)
+    {
+        HLinearBuffer<int>* buff = pool->PopProducerBuffer();
+        pool->PushConsumerBuffer(buff);
+    }
+
+    std::cout<<"spectrometer queue size = "<<pool->GetConsumerPoolSize(spectrometer.GetConsumerID())<<std::endl;
+    std::cout<<"dumper queue size = "<<pool->GetConsumerPoolSize(dumper.GetConsumerID())<<std::endl;
+    std::cout<<"dumper skipped buffers = "<<pool->GetNSkippedBuffers(dumper.GetConsumerID())<<std::endl;
+
+    if(pool->GetConsumerPoolSize(spectrometer.GetConsumerID()) != 3){status = 1;}
+    if(pool->GetConsumerPoolSize(dumper.GetConsumerID()) != 1){status = 1;}
+    if(pool->GetNSkippedBuffers(dumper.GetConsumerID()) != 2){status = 1;}
+
+    //spectrometer finishes everything, only the two unshared buffers go back
+    while(pool->GetConsumerPoolSize(spectrometer.GetConsumerID()) != 0)
+    {
+        HLinearBuffer<int>* buff = pool->PopConsumerBuffer(spectrometer.GetConsumerID());
+        pool->PushConsumerBuffer(buff, spectrometer.GetNextConsumerID());
+    }
+
+    std::cout<<"producer queue size = "<<pool->GetProducerPoolSize()<<std::endl;
+    if(pool->GetProducerPoolSize() != 3){status = 1;}
+
+    //now the dumper releases its reference and the last buffer comes home
+    HLinearBuffer<int>* buff = pool->PopConsumerBuffer(dumper.GetConsumerID());
+    pool->PushConsumerBuffer(buff, dumper.GetNextConsumerID());
+
+    std::cout<<"producer queue size = "<<pool->GetProducerPoolSize()<<std::endl;
+    if(pool->GetProducerPoolSize() != 4){status = 1;}
+
+    if(status == 0){std::cout<<"fan-out test passed"<<std::endl;}
+    else{std::cout<<"fan-out test failed"<<std::endl;}
+
+    delete pool;
+    delete allocator;
+
+    return status;
+}
@@ -0,0 +1,68 @@
+#include <iostream>
+#include <vector>
+
+#include "HBufferAllocatorNew.hh"
+#include "HBufferPool.hh"
+
+using namespace hose;
+
+//resizes a buffer pool the way the spectrometer manager does when it is reconfigured, checks
+//that the memory is re-used when it fits, and that a pool with buffers still in use is left alone
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    HBufferAllocatorNew<int>* allocator = new HBufferAllocatorNew<int>();
+    HBufferPool<int>* pool = new HBufferPool<int>(allocator);
+    pool->Allocate(4, 16);
+
+    HRegisteredConsumer consumer;
+    pool->RegisterConsumer(&consumer);
+    pool->Initialize();
+
+    int status = 0;
+
+    //a buffer is still with the consumer, so the pool cannot be changed
+    HLinearBuffer<int>* buff = pool->PopProducerBuffer();
+    int* data = buff->GetData();
+    pool->PushConsumerBuffer(buff);
+    if(pool->IsIdle() || pool->Resize(4, 8)){status = 1;}
+    std::cout<<"resize while in use refused = "<<(status == 0)<<std::endl;
+
+    buff = pool->PopConsumerBuffer(consumer.GetConsumerID());
+    pool->PushConsumerBuffer(buff, consumer.GetNextConsumerID());
+    if(!pool->IsIdle()){status = 1;}
+
+    //shorter buffers fit in the existing memory
+    if(!pool->Resize(4, 8)){status = 1;}
+    bool reused = false;
+    for(unsigned int i=0; i<4; i++)
+    {
+        buff = pool->PopProducerBuffer();
+        if(buff->GetArrayDimension(0) != 8){status = 1;}
+        if(buff->GetData() == data){reused = true;}
+        pool->PushProducerBuffer(buff);
+    }
+    std::cout<<"shrunk buffers re-use the memory = "<<reused<<std::endl;
+    if(!reused){status = 1;}
+
+    //growing back up to the allocated length still re-uses it, beyond that (or a different count) it is replaced
+    if(!pool->Resize(4, 16) || pool->GetNItemsPerChunk() != 16){status = 1;}
+    if(!pool->Resize(6, 32) || pool->GetNChunks() != 6 || pool->GetProducerPoolSize() != 6){status = 1;}
+    buff = pool->PopProducerBuffer();
+    if(buff->GetArrayDimension(0) != 32){status = 1;}
+    buff->GetData()[31] = 1;
+    pool->PushProducerBuffer(buff);
+
+    //a plain re-allocation of an allocated pool
+    pool->Allocate(2, 4);
+    std::cout<<"producer queue size after re-allocation = "<<pool->GetProducerPoolSize()<<std::endl;
+    if(pool->GetProducerPoolSize() != 2 || !pool->IsIdle()){status = 1;}
+
+    if(status == 0){std::cout<<"resize test passed"<<std::endl;}
+    else{std::cout<<"resize test failed"<<std::endl;}
+
+    delete pool;
+    delete allocator;
+
+    return status;
+}
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdio>
+
+#include "HFITSBinaryTableWriter.hh"
+#include "HObservingGeometry.hh"
+
+using namespace hose;
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    int status = 0;
+
+    //values are formatted the way astropy writes them
+    std::string expected[5] = {"1420000000.0", "14.508333333333333", "1E-05", "-0.0", "39062.5"};
+    double values[5] = {1420000000.0, 14.508333333333333, 1e-5, -0.0, 39062.5};
+    for(unsigned int i=0; i<5; i++)
+    {
+        std::string formatted = HFITSBinaryTableWriter::FormatFloatValue(values[i]);
+        if(formatted != expected[i]){std::cout<<"float formatting failed: "<<formatted<<" != "<<expected[i]<<std::endl; status = 1;}
+    }
+
+    std::string card = HFITSBinaryTableWriter::FormatStringCard("CTYPE1", "FREQ");
+    if(card.size() != 80 || card.substr(0, 20) != "CTYPE1  = 'FREQ    '"){std::cout<<"string card formatting failed: "<<card<<std::endl; status = 1;}
+    card = HFITSBinaryTableWriter::FormatIntegerCard("NAXIS2", 40, "length of dimension 2");
+    if(card != "NAXIS2  =                   40 / length of dimension 2                          ")
+    {
+        std::cout<<"integer card formatting failed: "<<card<<std::endl; status = 1;
+    }
+
+    //write a small table, then check the encoding, row count and block padding
+    HFITSBinaryTableWriter writer;
+    int name_col = writer.AddColumn("NAME", "5A");
+    int int_col = writer.AddColumn("SCAN", "1J");
+    int spec_col = writer.AddColumn("SPECTRUM", "3E", "POWER");
+    int time_col = writer.AddColumn("UT", "1D");
+    if(writer.AddColumn("BAD", "1Q") != -1 || writer.GetRowSize() != 5 + 4 + 12 + 8){std::cout<<"column layout failed"<<std::endl; status = 1;}
+
+    std::string filename = "./test_fits_binary_table.fits";
+    size_t n_rows = 7;
+    if(!writer.Open(filename)){return 1;}
+    std::vector< char > row(writer.GetRowSize());
+    for(size_t i=0; i<n_rows; i++)
+    {
+        float spec[3] = {1.5f, -2.0f, (float) i};
+        writer.SetField(&(row[0]), name_col, std::string("W51 long"));
+        writer.SetField(&(row[0]), int_col, (double) (258 + i) );
+        writer.SetField(&(row[0]), spec_col, spec, 3);
+        writer.SetField(&(row[0]), time_col, 0.1 );
+        writer.WriteRows(&(row[0]), 1);
+    }
+    writer.Close();
+
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    std::vector< char > contents( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
+    in.close();
+    std::remove(filename.c_str());
+
+    size_t data_start = 2*2880;
+    if(contents.size() != 3*2880){std::cout<<"file size is not a whole number of blocks: "<<contents.size()<<std::endl; return 1;}
+
+    std::string table_header(&(contents[2880]), 2880);
+    if(table_header.find("NAXIS2  =                    7") == std::string::npos){std::cout<<"row count was not filled in"<<std::endl; status = 1;}
+
+    const unsigned char* last = reinterpret_cast< const unsigned char* >( &(contents[data_start + (n_rows-1)*writer.GetRowSize()]) );
+    unsigned char name_bytes[5] = {'W', '5', '1', ' ', 'l'};
+    unsigned char int_bytes[4] = {0x00, 0x00, 0x01, 0x08}; //264
+    unsigned char float_bytes[4] = {0x3F, 0xC0, 0x00, 0x00}; //1.5
+    unsigned char double_bytes[8] = {0x3F, 0xB9, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9A}; //0.1
+    for(unsigned int i=0; i<5; i++){ if(last[i] != name_bytes[i]){status = 1;} }
+    for(unsigned int i=0; i<4; i++){ if(last[5 + i] != int_bytes[i] || last[9 + i] != float_bytes[i]){status = 1;} }
+    for(unsigned int i=0; i<8; i++){ if(last[21 + i] != double_bytes[i]){status = 1;} }
+    if(status != 0){std::cout<<"big-endian field encoding failed"<<std::endl;}
+    for(size_t i = data_start + n_rows*writer.GetRowSize(); i<contents.size(); i++){ if(contents[i] != 0){std::cout<<"data padding failed"<<std::endl; status = 1; break;} }
+
+    //compare the geometry against astropy (2019-08-05T10:13:20 at Westford, az = 120, el = 45)
+    HObservingGeometry geometry;
+    geometry.SetSiteLocation(-71.48833333, 42.62333333, 131);
+    geometry.SetTime(1565000000.0);
+    double ra, dec;
+    geometry.ConvertAzElToRADec(120.0, 45.0, ra, dec);
+    double lst = geometry.GetLocalMeanSiderealTime();
+    double vbary = geometry.GetBarycentricCorrection(ra, dec);
+    std::cout<<"lst = "<<lst<<" s, ra = "<<ra<<", dec = "<<dec<<", barycentric correction = "<<vbary<<" m/s"<<std::endl;
+    if(std::fabs(lst - 8525.87875675452) > 1.0){std::cout<<"sidereal time failed"<<std::endl; status = 1;}
+    if(std::fabs(ra - 74.12380900517462)*std::cos(dec*M_PI/180.0) > 0.005 || std::fabs(dec - 12.602844875772526) > 0.005){std::cout<<"az/el conversion failed"<<std::endl; status = 1;}
+    if(std::fabs(vbary - 24916.385735166023) > 10.0){std::cout<<"barycentric correction failed"<<std::endl; status = 1;}
+
+    return status;
+}
@@ -0,0 +1,309 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <complex>
+#include <algorithm>
+
+#include "HArrayWrapper.hh"
+#include "HFastFourierTransform.hh"
+#include "HFastFourierTransformUtilities.hh"
+#include "HMultidimensionalFastFourierTransform.hh"
+#include "HTaskScheduler.hh"
+
+using namespace hose;
+
+//relative (rms) error of selected bins of the transform against a direct dft in long double precision
+double DirectDFTError(const std::vector< std::complex<double> >& in, const std::vector< std::complex<double> >& out, size_t n_bins)
+{
+    size_t N = in.size();
+    long double err2 = 0.0;
+    long double norm2 = 0.0;
+    size_t step = std::max<size_t>(1, N/n_bins);
+    for(size_t k=0; k<N; k += step)
+    {
+        std::complex<long double> sum(0.0, 0.0);
+        for(size_t i=0; i<N; i++)
+        {
+            //the (forward) transform uses the e^{+i} kernel
+            long double theta = 2.0L*M_PI*( (long double) ( (i*k) % N ) )/( (long double) N );
+            sum += std::complex<long double>(in[i].real(), in[i].imag())*std::complex<long double>(std::cos(theta), std::sin(theta));
+        }
+        std::complex<long double> diff = std::complex<long double>(out[k].real(), out[k].imag()) - sum;
+        err2 += std::norm(diff);
+        norm2 += std::norm(sum);
+    }
+    return std::sqrt( (double) (err2/norm2) );
+}
+
+int main(int argc, char** argv)
+{
+    int status = 0;
+
+    size_t n_iter = 5;
+    if(argc > 1){n_iter = std::atol(argv[1]);}
+
+    //sizes which match the channel spacing to round frequencies, a few with larger prime
+    //factors (11, 13, 31), and some which still need bluestein (37, 1009, 2*65537)
+    std::vector<unsigned int> sizes = {6, 10, 12, 15, 20, 35, 49, 77, 121, 169, 310, 1000, 1001, 4096, 6561, 10000, 44100, 48000, 96000, 100000, 37, 1009, 131074};
+    std::mt19937 gen(5);
+    std::normal_distribution<double> noise(0.0, 1.0);
+
+    std::cout<<"N, path, error, error (bluestein), time/time (bluestein) (us)"<<std::endl;
+    for(size_t s=0; s<sizes.size(); s++)
+    {
+        unsigned int N = sizes[s];
+        std::vector< std::complex<double> > in(N);
+        for(size_t i=0; i<N; i++){in[i] = std::complex<double>(noise(gen), noise(gen));}
+
+        //the default path for this size
+        std::vector< std::complex<double> > out(N);
+        size_t dim[1] = {N};
+        HArrayWrapper< std::complex<double>, 1 > in_wrapper(&(in[0]), dim);
+        HArrayWrapper< std::complex<double>, 1 > out_wrapper(&(out[0]), dim);
+        HFastFourierTransform fft;
+        fft.SetSize(N);
+        fft.SetForward();
+        fft.SetInput(&in_wrapper);
+        fft.SetOutput(&out_wrapper);
+        fft.Initialize();
+        fft.ExecuteOperation();
+        double error = DirectDFTError(in, out, 64);
+
+        //round trip
+        std::vector< std::complex<double> > back(N);
+        HArrayWrapper< std::complex<double>, 1 > back_wrapper(&(back[0]), dim);
+        HFastFourierTransform ifft;
+        ifft.SetSize(N);
+        ifft.SetBackward();
+        ifft.SetInput(&out_wrapper);
+        ifft.SetOutput(&back_wrapper);
+        ifft.Initialize();
+        ifft.ExecuteOperation();
+        double round_trip = 0.0;
+        for(size_t i=0; i<N; i++){round_trip = std::max(round_trip, std::abs(back[i]/( (double) N ) - in[i]) );}
+
+        auto start = std::chrono::steady_clock::now();
+        for(size_t k=0; k<n_iter; k++){fft.ExecuteOperation();}
+        double t_default = 1e6*std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()/n_iter;
+
+        //the bluestein path for the same size, for comparison
+        unsigned int M = HFastFourierTransformUtilities::ComputeBluesteinArraySize(N);
+        std::vector< std::complex<double> > twiddle(M);
+        std::vector< std::complex<double> > conj_twiddle(M);
+        std::vector< std::complex<double> > scale(N);
+        std::vector< std::complex<double> > circulant(M);
+        std::vector< std::complex<double> > workspace(M);
+        HFastFourierTransformUtilities::ComputeTwiddleFactors(M, &(twiddle[0]));
+        HFastFourierTransformUtilities::ComputeConjugateTwiddleFactors(M, &(conj_twiddle[0]));
+        HFastFourierTransformUtilities::ComputeBluesteinScaleFactors(N, &(scale[0]));
+        HFastFourierTransformUtilities::ComputeBluesteinCirculantVector(N, M, &(twiddle[0]), &(scale[0]), &(circulant[0]));
+        std::vector< std::complex<double> > blue = in;
+        HFastFourierTransformUtilities::FFTBluestein(N, M, &(blue[0]), &(twiddle[0]), &(conj_twiddle[0]), &(scale[0]), &(circulant[0]), &(workspace[0]));
+        double blue_error = DirectDFTError(in, blue, 64);
+
+        start = std::chrono::steady_clock::now();
+        for(size_t k=0; k<n_iter; k++)
+        {
+            blue = in;
+            HFastFourierTransformUtilities::FFTBluestein(N, M, &(blue[0]), &(twiddle[0]), &(conj_twiddle[0]), &(scale[0]), &(circulant[0]), &(workspace[0]));
+        }
+        double t_blue = 1e6*std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()/n_iter;
+
+        unsigned int radices[HFastFourierTransformUtilities::MaxMixedRadixStages];
+        unsigned int n_stages = HFastFourierTransformUtilities::ComputeMixedRadixFactors(N, radices);
+        unsigned int N1, N2;
+        std::cout<<N<<", ";
+        if(HFastFourierTransformUtilities::ComputeSixStepFactors(N, N1, N2)){std::cout<<"codelets "<<N1<<"x"<<N2;}
+        else if(HBitReversalPermutation::IsPowerOfTwo(N)){std::cout<<"radix-2";}
+        else if(HBitReversalPermutation::IsPowerOfBase(N,3)){std::cout<<"radix-3";}
+        else if(n_stages == 0){std::cout<<"bluestein";}
+        else
+        {
+            std::cout<<"mixed-radix ";
+            for(unsigned int i=0; i<n_stages; i++){std::cout<<(i == 0 ? "" : "x")<<radices[i];}
+        }
+        std::cout<<", "<<error<<", "<<blue_error<<", "<<t_default<<"/"<<t_blue<<" (x"<<t_blue/t_default<<")"<<std::endl;
+
+        //check the factorization, and the accuracy of both paths
+        unsigned int product = 1;
+        for(unsigned int i=0; i<n_stages; i++){product *= radices[i];}
+        if(n_stages != 0 && product != N){status = 1;}
+        if(error > 1e-12 || round_trip > 1e-10 || blue_error > 1e-10){status = 1;}
+    }
+
+    //bit-reversal permutation, the cache blocked version (no index table) against the index table
+    std::cout<<"log2(N), time table/blocked permutation (us)"<<std::endl;
+    for(unsigned int p=0; p<=22; p++)
+    {
+        unsigned int N = 1u << p;
+        std::vector< std::complex<double> > a(N);
+        std::vector< float > fa(N);
+        for(size_t i=0; i<N; i++){a[i] = std::complex<double>(i, -1.0*i); fa[i] = i;}
+        std::vector< std::complex<double> > b = a;
+        std::vector< float > fb = fa;
+
+        std::vector< unsigned int > table(N);
+        HBitReversalPermutation::ComputeBitReversedIndicesBaseTwo(N, &(table[0]));
+        HBitReversalPermutation::PermuteArray(N, &(table[0]), &(a[0]));
+        HBitReversalPermutation::PermuteArray(N, &(table[0]), &(fa[0]));
+        HBitReversalPermutation::PermuteArrayBlocked(N, &(b[0]));
+        HBitReversalPermutation::PermuteArrayBlocked(N, &(fb[0]));
+        if(a != b || fa != fb)
+        {
+            std::cout<<"blocked bit-reversal permutation disagrees for N = "<<N<<std::endl;
+            status = 1;
+        }
+
+        if(p >= 10 && p % 2 == 0)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for(size_t k=0; k<n_iter; k++){HBitReversalPermutation::PermuteArray(N, &(table[0]), &(a[0]));}
+            double t_table = 1e6*std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()/n_iter;
+            start = std::chrono::steady_clock::now();
+            for(size_t k=0; k<n_iter; k++){HBitReversalPermutation::PermuteArrayBlocked(N, &(b[0]));}
+            double t_blocked = 1e6*std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()/n_iter;
+            std::cout<<p<<", "<<t_table<<"/"<<t_blocked<<" (x"<<t_table/t_blocked<<")"<<std::endl;
+        }
+    }
+
+    //power of two sizes, the codelets (six-step above MaxCodeletSize) against the generic radix-2 transform
+    std::cout<<"log2(N), N1xN2, error, error (radix-2), time/time (radix-2) (us)"<<std::endl;
+    for(unsigned int p=1; p<=20; p++)
+    {
+        unsigned int N = 1u << p;
+        std::vector< std::complex<double> > in(N);
+        for(size_t i=0; i<N; i++){in[i] = std::complex<double>(noise(gen), noise(gen));}
+
+        HFastFourierTransform fft;
+        fft.SetSize(N);
+        fft.SetForward();
+        fft.Initialize();
+        std::vector< std::complex<double> > workspace( std::max<unsigned int>(1, fft.GetWorkspaceSize()) );
+        std::vector< std::complex<double> > out = in;
+        fft.Transform(&(out[0]), &(workspace[0]));
+        double error = DirectDFTError(in, out, 16);
+
+        std::vector< std::complex<double> > twiddle(N);
+        HFastFourierTransformUtilities::ComputeTwiddleFactors(N, &(twiddle[0]));
+        std::vector< std::complex<double> > radix2 = in;
+        HBitReversalPermutation::PermuteArrayBlocked(N, &(radix2[0]));
+        HFastFourierTransformUtilities::FFTRadixTwo_DIT(N, &(radix2[0]), &(twiddle[0]));
+        double radix2_error = DirectDFTError(in, radix2, 16);
+        if(error > 1e-12 || radix2_error > 1e-12){status = 1;}
+
+        if(p >= 4 && p % 2 == 0)
+        {
+            size_t n_rep = std::max<size_t>(1, n_iter*(1u << 20)/N/16);
+            auto start = std::chrono::steady_clock::now();
+            for(size_t k=0; k<n_rep; k++){fft.Transform(&(out[0]), &(workspace[0]));}
+            double t_codelet = 1e6*std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()/n_rep;
+            start = std::chrono::steady_clock::now();
+            for(size_t k=0; k<n_rep; k++)
+            {
+                HBitReversalPermutation::PermuteArrayBlocked(N, &(radix2[0]));
+                HFastFourierTransformUtilities::FFTRadixTwo_DIT(N, &(radix2[0]), &(twiddle[0]));
+            }
+            double t_radix2 = 1e6*std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()/n_rep;
+
+            unsigned int N1, N2;
+            bool codelets = HFastFourierTransformUtilities::ComputeSixStepFactors(N, N1, N2);
+            std::cout<<p<<", ";
+            if(codelets){std::cout<<N1<<"x"<<N2;}else{std::cout<<"radix-2";}
+            std::cout<<", "<<error<<", "<<radix2_error<<", "<<t_codelet<<"/"<<t_radix2<<" (x"<<t_radix2/t_codelet<<")"<<std::endl;
+        }
+    }
+
+    //multidimensional transform (tiled, and in parallel on the task scheduler) against a 1D transform of each strided row
+    std::cout<<"dimensions, error, round trip error, time serial/parallel (us)"<<std::endl;
+    std::vector< std::vector<size_t> > shapes = { {1, 4096}, {96, 100}, {64, 128}, {2, 1, 3}, {30, 21, 50}, {16, 64, 64} };
+    for(size_t s=0; s<shapes.size(); s++)
+    {
+        size_t dim[3] = {1, 1, 1};
+        for(size_t i=0; i<shapes[s].size(); i++){dim[3 - shapes[s].size() + i] = shapes[s][i];}
+        size_t total = dim[0]*dim[1]*dim[2];
+        std::vector< std::complex<double> > in(total);
+        for(size_t i=0; i<total; i++){in[i] = std::complex<double>(noise(gen), noise(gen));}
+
+        std::vector< std::complex<double> > out(total);
+        std::vector< std::complex<double> > back(total);
+        HArrayWrapper< std::complex<double>, 3 > in_wrapper(&(in[0]), dim);
+        HArrayWrapper< std::complex<double>, 3 > out_wrapper(&(out[0]), dim);
+        HArrayWrapper< std::complex<double>, 3 > back_wrapper(&(back[0]), dim);
+        HMultidimensionalFastFourierTransform<3> fft;
+        fft.SetForward();
+        fft.SetTileWidth(8);
+        fft.SetInput(&in_wrapper);
+        fft.SetOutput(&out_wrapper);
+        fft.Initialize();
+        fft.ExecuteOperation();
+
+        //reference, one dimension at a time through a plain 1D transform
+        std::vector< std::complex<double> > ref = in;
+        for(size_t d=0; d<3; d++)
+        {
+            size_t stride = 1;
+            for(size_t i=d+1; i<3; i++){stride *= dim[i];}
+            std::vector< std::complex<double> > row_in(dim[d]);
+            std::vector< std::complex<double> > row_out(dim[d]);
+            size_t row_dim[1] = {dim[d]};
+            HArrayWrapper< std::complex<double>, 1 > row_in_wrapper(&(row_in[0]), row_dim);
+            HArrayWrapper< std::complex<double>, 1 > row_out_wrapper(&(row_out[0]), row_dim);
+            HFastFourierTransform row_fft;
+            row_fft.SetSize(dim[d]);
+            row_fft.SetForward();
+            row_fft.SetInput(&row_in_wrapper);
+            row_fft.SetOutput(&row_out_wrapper);
+            row_fft.Initialize();
+            for(size_t start=0; start<total; start++)
+            {
+                if( (start/stride) % dim[d] != 0 ){continue;} //not the first element of a row
+                for(size_t i=0; i<dim[d]; i++){row_in[i] = ref[start + i*stride];}
+                row_fft.ExecuteOperation();
+                for(size_t i=0; i<dim[d]; i++){ref[start + i*stride] = row_out[i];}
+            }
+        }
+        double error = 0.0;
+        double norm = 0.0;
+        for(size_t i=0; i<total; i++){error += std::norm(out[i] - ref[i]); norm += std::norm(ref[i]);}
+        error = std::sqrt(error/norm);
+
+        HMultidimensionalFastFourierTransform<3> ifft;
+        ifft.SetBackward();
+        ifft.SetInput(&out_wrapper);
+        ifft.SetOutput(&back_wrapper);
+        ifft.Initialize();
+        ifft.ExecuteOperation();
+        double round_trip = 0.0;
+        for(size_t i=0; i<total; i++){round_trip = std::max(round_trip, std::abs(back[i]/( (double) total ) - in[i]) );}
+
+        //in place, serially and then with the scheduler running
+        auto start = std::chrono::steady_clock::now();
+        for(size_t k=0; k<n_iter; k++){ifft.SetInput(&back_wrapper); ifft.SetOutput(&back_wrapper); ifft.ExecuteOperation();}
+        double t_serial = 1e6*std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()/n_iter;
+
+        HTaskScheduler* scheduler = HTaskScheduler::GetInstance();
+        scheduler->SetNThreads(4);
+        scheduler->Launch();
+        std::vector< std::complex<double> > par(total);
+        HArrayWrapper< std::complex<double>, 3 > par_wrapper(&(par[0]), dim);
+        fft.SetOutput(&par_wrapper);
+        fft.ExecuteOperation();
+        start = std::chrono::steady_clock::now();
+        for(size_t k=0; k<n_iter; k++){ifft.ExecuteOperation();}
+        double t_parallel = 1e6*std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()/n_iter;
+        scheduler->Terminate();
+        if(par != out){status = 1;}
+
+        for(size_t i=0; i<shapes[s].size(); i++){std::cout<<(i == 0 ? "" : "x")<<shapes[s][i];}
+        std::cout<<", "<<error<<", "<<round_trip<<", "<<t_serial<<"/"<<t_parallel<<" (x"<<t_serial/t_parallel<<")"<<std::endl;
+        if(error > 1e-12 || round_trip > 1e-10){status = 1;}
+    }
+
+    if(status == 0){std::cout<<"fast fourier transform test passed"<<std::endl;}
+    else{std::cout<<"fast fourier transform test failed"<<std::endl;}
+
+    return status;
+}
@@ -0,0 +1,85 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "HImpulsiveRFIBlanker.hh"
+
+using namespace hose;
+
+//fill a buffer with gaussian noise about the zero level, and add strong bursts to a few blocks
+template< typename XSampleType >
+void FillBuffer(std::vector< XSampleType >& data, double zero, size_t block_size, const std::vector<size_t>& burst_blocks)
+{
+    std::mt19937 gen(7);
+    std::normal_distribution<double> noise(0.0, 200.0);
+    for(size_t i=0; i<data.size(); i++)
+    {
+        double x = noise(gen);
+        size_t block = i/block_size;
+        for(size_t j=0; j<burst_blocks.size(); j++)
+        {
+            //a short (64 sample) burst in the middle of the block
+            size_t offset = i%block_size;
+            if(block == burst_blocks[j] && offset >= block_size/2 && offset < block_size/2 + 64){x *= 40.0;}
+        }
+        x = std::max(-32768.0, std::min(32767.0, x));
+        data[i] = (XSampleType) (x + zero);
+    }
+}
+
+template< typename XSampleType >
+int RunTest(const char* name, double zero, size_t n_samples, size_t n_iter)
+{
+    int status = 0;
+    size_t block_size = 1024;
+    std::vector<size_t> burst_blocks = {5, 100, 1000};
+
+    std::vector< XSampleType > data(n_samples);
+    FillBuffer(data, zero, block_size, burst_blocks);
+
+    HImpulsiveRFIBlanker< XSampleType > blanker;
+    blanker.SetBlockSize(block_size);
+    blanker.SetThreshold(6.0);
+    size_t n_blanked = blanker.BlankSamples(&(data[0]), data.size());
+
+    //the burst blocks must be zeroed, and (almost) nothing else
+    for(size_t j=0; j<burst_blocks.size(); j++)
+    {
+        size_t start = burst_blocks[j]*block_size;
+        for(size_t i=start; i<start+block_size; i++)
+        {
+            if(data[i] != (XSampleType) zero){status = 1; break;}
+        }
+    }
+    std::cout<<name<<": blanked "<<n_blanked<<" of "<<n_samples<<" samples"<<std::endl;
+    if(n_blanked < burst_blocks.size()*block_size || n_blanked > (burst_blocks.size()+2)*block_size){status = 1;}
+
+    //throughput on clean data
+    FillBuffer(data, zero, block_size, std::vector<size_t>());
+    auto start = std::chrono::steady_clock::now();
+    for(size_t k=0; k<n_iter; k++){n_blanked += blanker.BlankSamples(&(data[0]), data.size());}
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout<<name<<": throughput = "<<1e-6*n_iter*n_samples/seconds<<" Msamples/s per thread"<<std::endl;
+
+    return status;
+}
+
+int main(int argc, char** argv)
+{
+    size_t n_samples = 1 << 22;
+    size_t n_iter = 8;
+    if(argc > 1){n_samples = std::atol(argv[1]);}
+    if(argc > 2){n_iter = std::atol(argv[2]);}
+
+    int status = 0;
+    status |= RunTest< uint16_t >("uint16_t", 32768.0, n_samples, n_iter);
+    status |= RunTest< int16_t >("int16_t", 0.0, n_samples, n_iter);
+
+    if(status == 0){std::cout<<"impulsive rfi blanker test passed"<<std::endl;}
+    else{std::cout<<"impulsive rfi blanker test failed"<<std::endl;}
+
+    return status;
+}
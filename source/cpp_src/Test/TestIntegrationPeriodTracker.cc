@@ -0,0 +1,180 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+#include "HIntegrationPeriodTracker.hh"
+
+using namespace hose;
+
+typedef HIntegrationPeriodTracker::HPeriodKey period_key_t;
+typedef HIntegrationPeriodTracker::HPeriod period_t;
+
+static const size_t kLength = 8; //spectrum length
+static const size_t kNBuffers = 4; //buffers per period
+static const uint64_t kNSamples = 1000; //samples per buffer
+
+//claim the buffer's partial sum, add a flat spectrum of the given value to it and release it
+bool AddBuffer(HIntegrationPeriodTracker& tracker, uint64_t start_sec, uint64_t buffer_index, size_t worker, double value)
+{
+    uint64_t leading_sample_index = buffer_index*kNSamples;
+    period_key_t key = tracker.GetKey(start_sec, 1000000, 'U', 'X', leading_sample_index, kNSamples);
+    period_t* period = nullptr;
+    double* sum = tracker.Claim(key, leading_sample_index, kNSamples, worker, period);
+    if(sum == nullptr){return false;}
+    for(size_t i=0; i<kLength; i++){sum[i] += value;}
+
+    struct HDataAccumulationStruct stat;
+    stat.start_index = leading_sample_index;
+    stat.stop_index = leading_sample_index + kNSamples;
+    stat.sum_x = 0; stat.sum_x2 = 0; stat.count = kNSamples; stat.state_flag = H_NOISE_UNKNOWN;
+    tracker.Release(period, 2, kNSamples, 0, false, stat);
+    return true;
+}
+
+//check a period which has been taken out against the expected status, validity mask and (merged) sum
+bool CheckPeriod(HIntegrationPeriodTracker& tracker, const period_key_t& key, period_t& period, HIntegrationPeriodTracker::HPeriodStatus status,
+                 HIntegrationPeriodTracker::HPeriodStatus expected_status, uint64_t expected_index, const std::vector<uint8_t>& expected_mask, double expected_sum)
+{
+    bool ok = (status == expected_status && key.fPeriodIndex == expected_index && period.fValidityMask == expected_mask);
+    if(status != HIntegrationPeriodTracker::eDiscarded)
+    {
+        size_t n_valid = 0;
+        for(size_t i=0; i<expected_mask.size(); i++){n_valid += expected_mask[i];}
+        double* total = HIntegrationPeriodTracker::MergePartialSums(period);
+        ok = ok && total != nullptr && period.fNBuffersAccumulated == n_valid && period.fNTotalSpectrum == 2*n_valid;
+        for(size_t i=0; ok && i<kLength; i++){ok = (total[i] == expected_sum);}
+        tracker.Recycle(period);
+    }
+    else
+    {
+        ok = ok && period.fPartialSums.size() == 0;
+    }
+    if(!ok){std::cout<<"period "<<expected_index<<" does not match (status "<<status<<", "<<period.fValidityMask.size()<<" buffers covered)"<<std::endl;}
+    return ok;
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    int status = 0;
+    period_key_t key;
+    period_t period;
+    HIntegrationPeriodTracker::HPeriodStatus period_status;
+    std::vector<uint8_t> full(kNBuffers, 1);
+
+    //three periods with their buffers arriving out of order, and spread over three threads
+    {
+        HIntegrationPeriodTracker tracker(kLength, kNBuffers);
+        uint64_t order[12] = {5, 1, 0, 7, 4, 3, 11, 6, 2, 9, 10, 8};
+        std::vector<uint64_t> taken;
+        for(size_t i=0; i<12; i++)
+        {
+            if(!AddBuffer(tracker, 100, order[i], i%3, order[i] + 1)){status = 1;}
+            while( tracker.TakePeriod(100, false, key, period, period_status) )
+            {
+                double expected_sum = 0.0;
+                for(uint64_t b=0; b<kNBuffers; b++){expected_sum += key.fPeriodIndex*kNBuffers + b + 1;}
+                if(!CheckPeriod(tracker, key, period, period_status, HIntegrationPeriodTracker::eComplete, taken.size(), full, expected_sum)){status = 1;}
+                taken.push_back(key.fPeriodIndex);
+            }
+        }
+        if(taken.size() != 3){std::cout<<"out of order: "<<taken.size()<<" periods finished instead of 3"<<std::endl; status = 1;}
+
+        //a buffer from a period which has already been finished is refused
+        if(AddBuffer(tracker, 100, 2, 0, 1.0) || tracker.GetNLateBuffers() != 1 || tracker.GetNMissingSamples() != 0)
+        {
+            std::cout<<"out of order: late buffer not refused, or samples counted as missing"<<std::endl; status = 1;
+        }
+    }
+
+    //a buffer missing from the middle of a period, which is flushed once the next period starts (at most one open),
+    //and one at the end of the stream with only its first two buffers
+    {
+        HIntegrationPeriodTracker tracker(kLength, kNBuffers);
+        tracker.EnablePartialFlush();
+        uint64_t buffers[9] = {0, 2, 3, 4, 5, 6, 7, 8, 9};
+        std::vector<uint64_t> taken;
+        for(size_t i=0; i<9; i++)
+        {
+            AddBuffer(tracker, 100, buffers[i], 0, 1.0);
+            while( tracker.TakePeriod(1, false, key, period, period_status) )
+            {
+                if(taken.size() == 0)
+                {
+                    std::vector<uint8_t> mask = {1, 0, 1, 1};
+                    if(!CheckPeriod(tracker, key, period, period_status, HIntegrationPeriodTracker::ePartial, 0, mask, 3.0)){status = 1;}
+                }
+                else
+                {
+                    if(!CheckPeriod(tracker, key, period, period_status, HIntegrationPeriodTracker::eComplete, 1, full, 4.0)){status = 1;}
+                }
+                taken.push_back(key.fPeriodIndex);
+            }
+        }
+        if(taken.size() != 2 || tracker.GetNMissingSamples() != kNSamples)
+        {
+            std::cout<<"missing buffer: "<<taken.size()<<" periods finished, "<<tracker.GetNMissingSamples()<<" samples missing"<<std::endl; status = 1;
+        }
+
+        //the last period is only covered up to its last buffer
+        std::vector<uint8_t> mask = {1, 1};
+        if( !tracker.TakePeriod(1, true, key, period, period_status)
+            || !CheckPeriod(tracker, key, period, period_status, HIntegrationPeriodTracker::ePartial, 2, mask, 2.0)
+            || tracker.GetNMissingSamples() != kNSamples || tracker.GetNOpenPeriods() != 0 )
+        {
+            std::cout<<"missing buffer: trailing partial period was not flushed"<<std::endl; status = 1;
+        }
+    }
+
+    //the stream changes (new acquisition) in the middle of a period
+    {
+        HIntegrationPeriodTracker tracker(kLength, kNBuffers);
+        tracker.EnablePartialFlush();
+        AddBuffer(tracker, 100, 4, 0, 1.0);
+        AddBuffer(tracker, 100, 5, 1, 1.0);
+        AddBuffer(tracker, 200, 0, 0, 1.0);
+        std::vector<uint8_t> mask = {1, 1};
+        if( !tracker.TakePeriod(100, false, key, period, period_status)
+            || key.fAcquisitionStartSecond != 100
+            || !CheckPeriod(tracker, key, period, period_status, HIntegrationPeriodTracker::ePartial, 1, mask, 2.0) )
+        {
+            std::cout<<"stream change: the old stream's period was not finished"<<std::endl; status = 1;
+        }
+        if( tracker.TakePeriod(100, false, key, period, period_status) ){std::cout<<"stream change: the new period was finished early"<<std::endl; status = 1;}
+        if( AddBuffer(tracker, 100, 6, 0, 1.0) || tracker.GetNLateBuffers() != 1 ){std::cout<<"stream change: late buffer of the old stream not refused"<<std::endl; status = 1;}
+
+        for(uint64_t b=1; b<kNBuffers; b++){AddBuffer(tracker, 200, b, b%2, 1.0);}
+        if( !tracker.TakePeriod(100, false, key, period, period_status) || key.fAcquisitionStartSecond != 200
+            || !CheckPeriod(tracker, key, period, period_status, HIntegrationPeriodTracker::eComplete, 0, full, 4.0) )
+        {
+            std::cout<<"stream change: the new stream's period was not completed"<<std::endl; status = 1;
+        }
+
+        //the start of the new stream does not count as missing data
+        if(tracker.GetNMissingSamples() != 0){std::cout<<"stream change: "<<tracker.GetNMissingSamples()<<" samples missing"<<std::endl; status = 1;}
+    }
+
+    //an incomplete period is discarded rather than flushed when partial flushing is disabled
+    {
+        HIntegrationPeriodTracker tracker(kLength, kNBuffers);
+        uint64_t buffers[4] = {0, 2, 3, 4};
+        for(size_t i=0; i<4; i++){AddBuffer(tracker, 100, buffers[i], 0, 1.0);}
+        std::vector<uint8_t> mask = {1, 0, 1, 1};
+        if( !tracker.TakePeriod(1, false, key, period, period_status)
+            || !CheckPeriod(tracker, key, period, period_status, HIntegrationPeriodTracker::eDiscarded, 0, mask, 0.0)
+            || tracker.GetNDiscardedPeriods() != 1 )
+        {
+            std::cout<<"discard: the incomplete period was not discarded"<<std::endl; status = 1;
+        }
+
+        //its partial sum is re-used (zeroed) by the next period
+        for(uint64_t b=5; b<8; b++){AddBuffer(tracker, 100, b, 0, 1.0);}
+        if( !tracker.TakePeriod(1, false, key, period, period_status)
+            || !CheckPeriod(tracker, key, period, period_status, HIntegrationPeriodTracker::eComplete, 1, full, 4.0) )
+        {
+            std::cout<<"discard: the following period is wrong"<<std::endl; status = 1;
+        }
+    }
+
+    if(status == 0){std::cout<<"all integration period checks passed"<<std::endl;}
+    return status;
+}
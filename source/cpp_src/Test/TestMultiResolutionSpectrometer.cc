@@ -0,0 +1,173 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <complex>
+#include <algorithm>
+#include <thread>
+
+#include "HBufferAllocatorNew.hh"
+#include "HBufferPool.hh"
+#include "HPowerSpectrumAccumulator.hh"
+#include "HMultiResolutionSpectrometer.hh"
+
+using namespace hose;
+
+int main(int argc, char** argv)
+{
+    int status = 0;
+
+    size_t n_iter = 4;
+    if(argc > 1){n_iter = std::atol(argv[1]);}
+
+    //the paired transform must agree with a direct dft of each frame
+    size_t n = 64;
+    std::mt19937 gen(7);
+    std::normal_distribution<double> noise(0.0, 20.0);
+    std::vector<float> frames(3*n);
+    for(size_t i=0; i<frames.size(); i++){frames[i] = noise(gen);}
+
+    std::vector<double> direct(n/2+1, 0.0);
+    for(size_t f=0; f<3; f++)
+    {
+        for(size_t k=0; k<=n/2; k++)
+        {
+            std::complex<double> sum(0.0, 0.0);
+            for(size_t i=0; i<n; i++){sum += ( (double) frames[f*n + i] )*std::polar(1.0, -2.0*M_PI*k*i/( (double) n) );}
+            direct[k] += std::norm(sum);
+        }
+    }
+
+    HPowerSpectrumAccumulator acc;
+    acc.SetFFTSize(n);
+    if(!acc.Initialize()){status = 1;}
+    for(size_t f=0; f<3; f++){acc.AddFrame(&(frames[f*n]));}
+    acc.Flush();
+    double max_error = 0.0;
+    for(size_t k=0; k<=n/2; k++){max_error = std::max(max_error, std::fabs(acc.GetPowerSum()[k] - direct[k])/direct[k]);}
+    std::cout<<"paired transform vs direct dft, max relative error = "<<max_error<<" ("<<acc.GetNSpectra()<<" spectra)"<<std::endl;
+    if(max_error > 1e-6 || acc.GetNSpectra() != 3){status = 1;}
+
+    //a tone in noise, centered on a channel at both resolutions
+    uint64_t sample_rate = 1000000;
+    size_t small_size = 1024;
+    size_t large_size = 8192;
+    size_t tone_channel = 100;
+    double f_tone = tone_channel*( (double) sample_rate )/( (double) small_size );
+    size_t n_samples = 1 << 20;
+    std::vector< uint16_t > data(2*n_samples);
+    for(size_t i=0; i<data.size(); i++)
+    {
+        double t = ( (double) i )/( (double) sample_rate );
+        double x = 100.0*std::cos(2.0*M_PI*f_tone*t) + noise(gen);
+        data[i] = (uint16_t) std::lround(32768.0 + x);
+    }
+
+    HBufferAllocatorNew< uint16_t >* source_allocator = new HBufferAllocatorNew< uint16_t >();
+    HBufferPool< uint16_t >* source_pool = new HBufferPool< uint16_t >(source_allocator);
+    source_pool->Allocate(2, n_samples);
+    HBufferAllocatorNew< float >* small_allocator = new HBufferAllocatorNew< float >();
+    HBufferPool< float >* small_pool = new HBufferPool< float >(small_allocator);
+    small_pool->Allocate(2, small_size/2+1);
+    HBufferAllocatorNew< float >* large_allocator = new HBufferAllocatorNew< float >();
+    HBufferPool< float >* large_pool = new HBufferPool< float >(large_allocator);
+    large_pool->Allocate(2, large_size/2+1);
+
+    HMultiResolutionSpectrometer< uint16_t > spectrometer;
+    spectrometer.SetWindowFunction(2);
+    spectrometer.SetNThreads(2);
+    spectrometer.SetBufferPool(source_pool);
+    if(!spectrometer.AddResolution(small_size, small_pool)){status = 1;}
+    if(!spectrometer.AddResolution(large_size, large_pool)){status = 1;}
+    if(spectrometer.AddResolution(3000, large_pool)){status = 1;} //does not divide 8192, must be rejected
+    HRegisteredConsumer small_writer;
+    HRegisteredConsumer large_writer;
+    small_pool->RegisterConsumer(&small_writer);
+    large_pool->RegisterConsumer(&large_writer);
+    source_pool->Initialize();
+    small_pool->Initialize();
+    large_pool->Initialize();
+
+    spectrometer.StartConsumption();
+    for(size_t b=0; b<2; b++)
+    {
+        HLinearBuffer< uint16_t >* buff = source_pool->PopProducerBuffer();
+        std::copy(data.begin() + b*n_samples, data.begin() + (b+1)*n_samples, buff->GetData());
+        buff->GetMetaData()->SetSampleRate(sample_rate);
+        buff->GetMetaData()->SetLeadingSampleIndex(b*n_samples);
+        source_pool->PushConsumerBuffer(buff);
+    }
+    for(size_t k=0; k<1000 && large_pool->GetConsumerPoolSize(large_writer.GetConsumerID()) < 2; k++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    spectrometer.StopConsumption();
+
+    size_t n_small = small_pool->GetConsumerPoolSize(small_writer.GetConsumerID());
+    size_t n_large = large_pool->GetConsumerPoolSize(large_writer.GetConsumerID());
+    std::cout<<"multi-resolution spectrometer produced "<<n_small<<" + "<<n_large<<" spectra, skipped "<<spectrometer.GetNSkippedBuffers()<<" buffers"<<std::endl;
+    if(n_small != 2 || n_large != 2 || source_pool->GetProducerPoolSize() != 2){status = 1;}
+
+    //each resolution should see the tone at its own channel, and average over all the frames in the buffer
+    HBufferPool< float >* pools[2] = {small_pool, large_pool};
+    HRegisteredConsumer* writers[2] = {&small_writer, &large_writer};
+    size_t sizes[2] = {small_size, large_size};
+    double noise_level[2] = {0.0, 0.0};
+    for(size_t r=0; r<2; r++)
+    {
+        size_t expected = tone_channel*sizes[r]/small_size;
+        while(pools[r]->GetConsumerPoolSize(writers[r]->GetConsumerID()) != 0)
+        {
+            HLinearBuffer< float >* buff = pools[r]->PopConsumerBuffer(writers[r]->GetConsumerID());
+            const HBufferMetaData* meta = buff->GetMetaData();
+            const float* spec = buff->GetData();
+            size_t length = sizes[r]/2+1;
+            size_t peak = std::max_element(spec, spec + length) - spec;
+            std::vector<float> sorted(spec, spec + length);
+            std::sort(sorted.begin(), sorted.end());
+            noise_level[r] = sorted[length/2];
+            std::cout<<"fft size "<<sizes[r]<<": peak channel = "<<peak<<", expected = "<<expected;
+            std::cout<<", tone/noise = "<<10.0*std::log10(spec[peak]/noise_level[r])<<" dB, n spectra = "<<meta->GetNTotalSpectrum()<<std::endl;
+            if(peak != expected || meta->GetPowerSpectrumLength() != length || meta->GetNTotalSpectrum() != n_samples/sizes[r]
+                || meta->GetNTotalSamplesCollected() != n_samples){status = 1;}
+            pools[r]->PushConsumerBuffer(buff, writers[r]->GetNextConsumerID());
+        }
+    }
+
+    //the average noise power per channel scales with the fft size (for white noise)
+    double ratio = noise_level[1]/noise_level[0];
+    std::cout<<"noise level ratio = "<<ratio<<", expected ~"<<large_size/small_size<<std::endl;
+    if(std::fabs(ratio/( (double) (large_size/small_size) ) - 1.0) > 0.1){status = 1;}
+
+    //throughput of the single pass (both resolutions)
+    std::vector<float> x(n_samples);
+    HPowerSpectrumAccumulator small_acc;
+    HPowerSpectrumAccumulator large_acc;
+    small_acc.SetFFTSize(small_size);
+    large_acc.SetFFTSize(large_size);
+    small_acc.Initialize();
+    large_acc.Initialize();
+    auto start = std::chrono::steady_clock::now();
+    for(size_t k=0; k<n_iter; k++)
+    {
+        for(size_t i=0; i<n_samples; i++){x[i] = ( (float) data[i] ) - 32768.0f;}
+        for(size_t offset=0; offset<n_samples; offset += small_size){small_acc.AddFrame(&(x[offset]));}
+        for(size_t offset=0; offset<n_samples; offset += large_size){large_acc.AddFrame(&(x[offset]));}
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout<<"throughput = "<<1e-6*n_iter*n_samples/seconds<<" Msamples/s per thread (fft sizes "<<small_size<<" and "<<large_size<<")"<<std::endl;
+
+    delete source_pool;
+    delete source_allocator;
+    delete small_pool;
+    delete small_allocator;
+    delete large_pool;
+    delete large_allocator;
+
+    if(status == 0){std::cout<<"multi-resolution spectrometer test passed"<<std::endl;}
+    else{std::cout<<"multi-resolution spectrometer test failed"<<std::endl;}
+
+    return status;
+}
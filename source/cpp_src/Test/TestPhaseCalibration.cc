@@ -0,0 +1,225 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <complex>
+#include <algorithm>
+#include <thread>
+#include <string>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "HBufferAllocatorNew.hh"
+#include "HBufferPool.hh"
+#include "HPhaseCalibrationExtractor.hh"
+#include "HPhaseCalibrationMonitor.hh"
+
+using namespace hose;
+
+double PhaseDifference(double a, double b)
+{
+    double d = std::fmod(a - b, 2.0*M_PI);
+    if(d > M_PI){d -= 2.0*M_PI;}
+    if(d < -M_PI){d += 2.0*M_PI;}
+    return d;
+}
+
+int main(int argc, char** argv)
+{
+    int status = 0;
+
+    size_t n_iter = 4;
+    if(argc > 1){n_iter = std::atol(argv[1]);}
+
+    //a comb of tones with known amplitudes and phases (at sample index zero) in noise
+    uint64_t sample_rate = 10000000;
+    uint64_t first_tone = 10000;
+    uint64_t spacing = 1000000;
+    size_t n_tones = 5;
+    size_t n_samples = 1 << 20;
+    uint64_t leading_index = 123457; //the buffer does not start at the beginning of the acquisition
+    std::mt19937 gen(3);
+    std::normal_distribution<double> noise(0.0, 20.0);
+    std::vector<double> amplitude(n_tones);
+    std::vector<double> phase(n_tones);
+    for(size_t t=0; t<n_tones; t++){amplitude[t] = 2.0 + t; phase[t] = -2.5 + 1.1*t;}
+
+    std::vector< uint16_t > data(n_samples);
+    for(size_t i=0; i<n_samples; i++)
+    {
+        double n = (double) (leading_index + i);
+        double x = noise(gen);
+        for(size_t t=0; t<n_tones; t++)
+        {
+            double f = first_tone + t*spacing;
+            x += amplitude[t]*std::cos(2.0*M_PI*std::fmod(f*n, (double) sample_rate)/( (double) sample_rate ) + phase[t]);
+        }
+        data[i] = (uint16_t) std::lround(32768.0 + x);
+    }
+
+    //folding, and phase rotators (forced by limiting the fold length), processed in two pieces and merged
+    for(size_t mode=0; mode<2; mode++)
+    {
+        HPhaseCalibrationExtractor first;
+        HPhaseCalibrationExtractor second;
+        HPhaseCalibrationExtractor* ex[2] = {&first, &second};
+        for(size_t e=0; e<2; e++)
+        {
+            ex[e]->SetSampleRate(sample_rate);
+            ex[e]->SetFirstToneFrequency(first_tone);
+            ex[e]->SetToneSpacing(spacing);
+            if(mode == 1){ex[e]->SetMaxFoldLength(1);}
+            if(!ex[e]->Initialize()){status = 1;}
+        }
+        size_t half = 300001;
+        first.Process(&(data[0]), half, leading_index);
+        second.Process(&(data[half]), n_samples - half, leading_index + half);
+        first.Merge(second);
+
+        std::vector<double> a;
+        std::vector<double> p;
+        first.GetTones(a, p);
+        std::cout<<(mode == 0 ? "folding" : "rotators")<<" (fold length "<<first.GetFoldLength()<<"), "<<first.GetNTones()<<" tones:"<<std::endl;
+        if(first.GetNTones() != n_tones || first.IsFolding() != (mode == 0) || first.GetNSamples() != n_samples){status = 1;}
+        for(size_t t=0; t<std::min(n_tones, first.GetNTones()); t++)
+        {
+            double dp = PhaseDifference(p[t], phase[t]);
+            std::cout<<"  tone "<<first.GetToneFrequency(t)<<" Hz: amplitude = "<<a[t]<<" (expected "<<amplitude[t]<<"), phase error = "<<dp<<" rad"<<std::endl;
+            if(std::fabs(a[t]/amplitude[t] - 1.0) > 0.05 || std::fabs(dp) > 0.05){status = 1;}
+        }
+    }
+
+    //streaming monitor, integrating pairs of buffers, the records are written to a scratch directory
+    char dir_template[] = "/tmp/hose_pcal_XXXXXX";
+    char* dir = mkdtemp(dir_template);
+    if(dir == nullptr){std::cout<<"could not create a scratch directory"<<std::endl; return 1;}
+
+    size_t n_buffers = 4;
+    size_t buffer_length = n_samples/n_buffers;
+    HBufferAllocatorNew< uint16_t >* source_allocator = new HBufferAllocatorNew< uint16_t >();
+    HBufferPool< uint16_t >* source_pool = new HBufferPool< uint16_t >(source_allocator);
+    source_pool->Allocate(n_buffers, buffer_length);
+
+    HPhaseCalibrationMonitor< uint16_t > monitor;
+    monitor.SetFirstToneFrequency(first_tone);
+    monitor.SetToneSpacing(spacing);
+    monitor.SetNTones(n_tones);
+    monitor.SetNBuffersToIntegrate(2);
+    monitor.SetNThreads(2);
+    monitor.SetBufferPool(source_pool);
+    monitor.SetBaseOutputDirectory(std::string(dir));
+    monitor.SetExperimentName("pcal");
+    monitor.SetScanName("test");
+    monitor.InitializeOutputDirectory();
+    source_pool->Initialize();
+
+    monitor.StartConsumption();
+    for(size_t b=0; b<n_buffers; b++)
+    {
+        HLinearBuffer< uint16_t >* buff = source_pool->PopProducerBuffer();
+        std::copy(data.begin() + b*buffer_length, data.begin() + (b+1)*buffer_length, buff->GetData());
+        buff->GetMetaData()->SetSampleRate(sample_rate);
+        buff->GetMetaData()->SetAcquisitionStartSecond(1);
+        buff->GetMetaData()->SetLeadingSampleIndex(leading_index + b*buffer_length);
+        source_pool->PushConsumerBuffer(buff);
+    }
+    for(size_t k=0; k<1000 && monitor.GetNRecordsWritten() < 2; k++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    //a buffer of a period which has already been written must not re-open it, even once a
+    //later acquisition starts (which would write it out again as a partial record)
+    for(uint64_t start_second=1; start_second<3; start_second++)
+    {
+        HLinearBuffer< uint16_t >* buff = nullptr;
+        for(size_t k=0; k<1000 && buff == nullptr; k++)
+        {
+            if(source_pool->GetProducerPoolSize() != 0){buff = source_pool->PopProducerBuffer();}
+            else{std::this_thread::sleep_for(std::chrono::milliseconds(1));}
+        }
+        if(buff == nullptr){status = 1; break;}
+        std::copy(data.begin(), data.begin() + buffer_length, buff->GetData());
+        buff->GetMetaData()->SetSampleRate(sample_rate);
+        buff->GetMetaData()->SetAcquisitionStartSecond(start_second);
+        buff->GetMetaData()->SetLeadingSampleIndex(leading_index);
+        source_pool->PushConsumerBuffer(buff);
+    }
+    for(size_t k=0; k<1000 && monitor.GetNLateBuffers() == 0; k++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    monitor.StopConsumption();
+
+    //buffers 0,1 and 2,3 fall into two periods, each record must hold every tone at the right amplitude and phase
+    std::cout<<"monitor wrote "<<monitor.GetNRecordsWritten()<<" records ("<<monitor.GetNPartialRecords()<<" partial), skipped ";
+    std::cout<<monitor.GetNSkippedBuffers()<<" buffers, "<<monitor.GetNLateBuffers()<<" late"<<std::endl;
+    if(monitor.GetNRecordsWritten() != 2 || monitor.GetNPartialRecords() != 0 || monitor.GetNLateBuffers() != 1){status = 1;}
+    std::string out_dir = monitor.GetCurrentOutputDirectory();
+    DIR* d = opendir(out_dir.c_str());
+    size_t n_files = 0;
+    if(d != nullptr)
+    {
+        struct dirent* entry;
+        while( (entry = readdir(d)) != nullptr )
+        {
+            std::string name(entry->d_name);
+            if(name.size() < 5 || name.substr(name.size() - 5) != ".pcal"){continue;}
+            n_files++;
+            std::ifstream in( (out_dir + "/" + name).c_str() );
+            std::string line;
+            size_t n_tone_lines = 0;
+            while(std::getline(in, line))
+            {
+                if(line.compare(0, 5, "tone=") != 0){continue;}
+                std::stringstream ls(line.substr(5));
+                uint64_t f;
+                double a;
+                double p;
+                ls >> f >> a >> p;
+                size_t t = (f - first_tone)/spacing;
+                if(t < n_tones && std::fabs(a/amplitude[t] - 1.0) > 0.1){status = 1;}
+                if(t < n_tones && std::fabs(PhaseDifference(p*M_PI/180.0, phase[t])) > 0.1){status = 1;}
+                n_tone_lines++;
+            }
+            std::cout<<"  "<<name<<": "<<n_tone_lines<<" tones"<<std::endl;
+            if(n_tone_lines != n_tones){status = 1;}
+            remove( (out_dir + "/" + name).c_str() );
+        }
+        closedir(d);
+    }
+    if(n_files == 0 || n_files != monitor.GetNRecordsWritten()){status = 1;}
+    rmdir(out_dir.c_str());
+    rmdir( (std::string(dir) + "/pcal").c_str() );
+    rmdir(dir);
+
+    delete source_pool;
+    delete source_allocator;
+
+    //throughput, compared with the main spectrum (fft of every sample)
+    for(size_t mode=0; mode<2; mode++)
+    {
+        HPhaseCalibrationExtractor ex;
+        ex.SetSampleRate(sample_rate);
+        ex.SetFirstToneFrequency(first_tone);
+        ex.SetToneSpacing(spacing);
+        if(mode == 1){ex.SetMaxFoldLength(1);}
+        ex.Initialize();
+        auto start = std::chrono::steady_clock::now();
+        for(size_t k=0; k<n_iter; k++){ex.Process(&(data[0]), n_samples, leading_index + k*n_samples);}
+        std::vector<double> a;
+        std::vector<double> p;
+        ex.GetTones(a, p);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout<<(mode == 0 ? "folding" : "rotators")<<" throughput = "<<1e-6*n_iter*n_samples/seconds<<" Msamples/s per thread ("<<ex.GetNTones()<<" tones)"<<std::endl;
+    }
+
+    if(status == 0){std::cout<<"phase calibration test passed"<<std::endl;}
+    else{std::cout<<"phase calibration test failed"<<std::endl;}
+
+    return status;
+}
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <stdint.h>
+
+#include "HSampleConversionKernel.hh"
+
+using namespace hose;
+
+//the fused kernel (and the sums alone) against plain loops, for both sample types, with and without a window, contiguous and strided
+template< typename XSampleType >
+int CheckConversion(const std::vector< XSampleType >& in, const std::vector<float>& window, double zero)
+{
+    int status = 0;
+    size_t lengths[6] = {0, 1, 7, 33, 1000, in.size()};
+    for(size_t l=0; l<6; l++)
+    {
+        size_t n = lengths[l];
+        for(size_t mode=0; mode<3; mode++)
+        {
+            const float* w = (mode == 0) ? nullptr : &(window[0]);
+            size_t stride = (mode == 2) ? 2 : 1;
+            std::vector<float> out(stride*n + 1, -1.0f);
+            double sum = 1.0; //the sums are added to
+            double sum2 = 2.0;
+            HSampleConversionKernel::ConvertAndWindow(&(in[0]), w, &(out[0]), n, &sum, &sum2, stride);
+
+            double ref_sum = 1.0;
+            double ref_sum2 = 2.0;
+            for(size_t i=0; i<n; i++)
+            {
+                double x = ( (double) in[i] ) - zero;
+                ref_sum += x;
+                ref_sum2 += x*x;
+                float expected = (w == nullptr) ? (float) x : w[i]*( (float) x );
+                if(out[i*stride] != expected){status = 1;}
+                if(stride == 2 && out[i*stride + 1] != -1.0f){status = 1;} //the other elements are untouched
+            }
+            if(out[stride*n] != -1.0f){status = 1;} //no write past the end
+            if(sum != ref_sum || sum2 != ref_sum2){status = 1;}
+
+            //the sums alone
+            double msum = 1.0;
+            double msum2 = 2.0;
+            HSampleConversionKernel::Moments(&(in[0]), n, msum, msum2);
+            if(msum != ref_sum || msum2 != ref_sum2){status = 1;}
+        }
+    }
+    return status;
+}
+
+int main(int argc, char** argv)
+{
+    int status = 0;
+
+    size_t n_iter = 20;
+    if(argc > 1){n_iter = std::atol(argv[1]);}
+
+    //include the extreme sample values, and a length which is not a multiple of any vector width
+    size_t n_samples = (1 << 20) + 13;
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> dist(0, 65535);
+    std::vector< uint16_t > u(n_samples);
+    std::vector< int16_t > s(n_samples);
+    for(size_t i=0; i<n_samples; i++){u[i] = dist(gen); s[i] = (int16_t) (dist(gen) - 32768);}
+    u[0] = 0; u[1] = 65535; s[0] = -32768; s[1] = 32767;
+    std::vector<float> window(n_samples);
+    for(size_t i=0; i<n_samples; i++){window[i] = 0.5f - 0.5f*std::cos( (2.0*M_PI*i)/(n_samples - 1.0) );}
+
+    if(CheckConversion(u, window, 32768.0) != 0){std::cout<<"uint16 conversion disagrees with the reference"<<std::endl; status = 1;}
+    if(CheckConversion(s, window, 0.0) != 0){std::cout<<"int16 conversion disagrees with the reference"<<std::endl; status = 1;}
+
+    //the sums stay exact over a long run of full scale samples (the integer lanes are emptied before they overflow)
+    std::vector< uint16_t > full(1 << 22, 65535);
+    std::vector< float > full_out(full.size());
+    double sum = 0.0;
+    double sum2 = 0.0;
+    HSampleConversionKernel::ConvertAndWindow(&(full[0]), nullptr, &(full_out[0]), full.size(), &sum, &sum2);
+    if(sum != 32767.0*full.size() || sum2 != 32767.0*32767.0*full.size()){std::cout<<"full scale sums overflowed"<<std::endl; status = 1;}
+
+    //throughput, against separate passes for the conversion, window and the power statistics
+    std::vector<float> out(n_samples);
+    auto start = std::chrono::steady_clock::now();
+    for(size_t k=0; k<n_iter; k++)
+    {
+        for(size_t i=0; i<n_samples; i++){out[i] = ( (float) u[i] ) - 32768.0f;}
+        for(size_t i=0; i<n_samples; i++){out[i] *= window[i];}
+        sum = 0.0;
+        sum2 = 0.0;
+        for(size_t i=0; i<n_samples; i++){double x = u[i] - 32768.0; sum += x; sum2 += x*x;}
+    }
+    double t_separate = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for(size_t k=0; k<n_iter; k++)
+    {
+        sum = 0.0;
+        sum2 = 0.0;
+        HSampleConversionKernel::ConvertAndWindow(&(u[0]), &(window[0]), &(out[0]), n_samples, &sum, &sum2);
+    }
+    double t_fused = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout<<"separate passes: "<<1e-6*n_iter*n_samples/t_separate<<" Msamples/s, fused: "<<1e-6*n_iter*n_samples/t_fused
+             <<" Msamples/s (x"<<t_separate/t_fused<<")"<<std::endl;
+
+    if(status == 0){std::cout<<"sample conversion test passed"<<std::endl;}
+    else{std::cout<<"sample conversion test failed"<<std::endl;}
+
+    return status;
+}
@@ -0,0 +1,78 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+
+#include "HSpectralKurtosisFlagger.hh"
+
+using namespace hose;
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    int status = 0;
+
+    //averaged spectra made of n_buffers buffers, each the sum of n_spectra_per_buffer spectra
+    size_t n_channels = 4096;
+    size_t n_buffers = 4;
+    size_t n_spectra_per_buffer = 64;
+    uint64_t n_spectra = n_buffers*n_spectra_per_buffer;
+
+    //channels with a steady carrier (sk -> 0) and with an intermittent burst (sk >> 1)
+    size_t cw_channel = 1000;
+    size_t burst_channel = 3000;
+
+    std::mt19937 gen(42);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::uniform_real_distribution<double> phase(0.0, 2.0*M_PI);
+
+    std::vector<float> power(n_channels, 0.0f);
+    std::vector<float> power2(n_channels, 0.0f);
+    for(size_t c=0; c<n_channels; c++)
+    {
+        double s1 = 0.0;
+        double s2 = 0.0;
+        for(size_t k=0; k<n_spectra; k++)
+        {
+            double re = noise(gen);
+            double im = noise(gen);
+            if(c == cw_channel)
+            {
+                double p = phase(gen);
+                re += 10.0*std::cos(p);
+                im += 10.0*std::sin(p);
+            }
+            if(c == burst_channel && k%32 == 0)
+            {
+                re *= 20.0;
+                im *= 20.0;
+            }
+            double pwr = re*re + im*im;
+            s1 += pwr;
+            s2 += pwr*pwr;
+        }
+        //as delivered by the averager
+        power[c] = s1/n_buffers;
+        power2[c] = s2/n_buffers;
+    }
+
+    HSpectralKurtosisFlagger flagger;
+    flagger.SetThresholdSigma(4.0);
+    std::vector< uint8_t > mask;
+    size_t n_flagged = flagger.FlagSpectrum(&(power[0]), &(power2[0]), n_channels, n_spectra, n_buffers, mask);
+
+    std::cout<<"flagged "<<n_flagged<<" of "<<n_channels<<" channels"<<std::endl;
+    std::cout<<"carrier channel flag = "<<(int)mask[cw_channel]<<", burst channel flag = "<<(int)mask[burst_channel]<<std::endl;
+
+    if(mask.size() != n_channels || mask[cw_channel] != 1 || mask[burst_channel] != 1){status = 1;}
+    //at 4 sigma, only a handful of the gaussian noise channels should be (falsely) flagged
+    if(n_flagged > 2 + n_channels/200){status = 1;}
+
+    //with only one spectrum there is nothing to estimate
+    n_flagged = flagger.FlagSpectrum(&(power[0]), &(power2[0]), n_channels, 1, 1, mask);
+    if(n_flagged != 0){status = 1;}
+
+    if(status == 0){std::cout<<"spectral kurtosis test passed"<<std::endl;}
+    else{std::cout<<"spectral kurtosis test failed"<<std::endl;}
+
+    return status;
+}
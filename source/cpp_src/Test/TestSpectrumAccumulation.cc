@@ -0,0 +1,141 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "HSpectrumAccumulationKernel.hh"
+
+using namespace hose;
+
+//the way the averager used to do it: float accumulation, with separate passes for the band power and the average/rebin
+double ThreePassAccumulate(const float* in, float* sum, size_t length, size_t band_low, size_t band_high)
+{
+    for(size_t i=0; i<length; i++){sum[i] += in[i];}
+    double band_power = 0.0;
+    for(size_t i=band_low; i<band_high; i++){band_power += in[i];}
+    return band_power;
+}
+
+void ThreePassNormalize(float* sum, size_t n, float* rebinned, size_t bin_factor, size_t n_bins, size_t length)
+{
+    for(size_t i=0; i<length; i++)
+    {
+        sum[i] = sum[i]/(float)n;
+        if(i/bin_factor < n_bins){rebinned[i/bin_factor] += sum[i];}
+    }
+}
+
+double Seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    int status = 0;
+
+    //power spectrum length and number of spectra in the integration
+    size_t length = 1048577;
+    size_t n_spectra = 256;
+    if(argc > 1){length = std::atol(argv[1]);}
+    if(argc > 2){n_spectra = std::atol(argv[2]);}
+    size_t band_low = length/4;
+    size_t band_high = length/2;
+    size_t n_bins = 256;
+    size_t bin_factor = length/n_bins;
+
+    //a few different input spectra with a large dynamic range
+    std::mt19937 gen(1234);
+    std::exponential_distribution<float> dist(1.0);
+    size_t n_inputs = 4;
+    std::vector< std::vector<float> > inputs(n_inputs, std::vector<float>(length));
+    for(size_t j=0; j<n_inputs; j++)
+    {
+        for(size_t i=0; i<length; i++){inputs[j][i] = 1e6*dist(gen);}
+    }
+
+    //accuracy against a long double reference
+    std::vector<long double> ref(length, 0.0);
+    long double ref_band = 0.0;
+    std::vector<double> sum(length, 0.0);
+    std::vector<float> old_sum(length, 0.0f);
+    double band = 0.0;
+    for(size_t k=0; k<n_spectra; k++)
+    {
+        const float* in = &(inputs[k%n_inputs][0]);
+        band += HSpectrumAccumulationKernel::AccumulateWithBandPower(in, &(sum[0]), length, band_low, band_high);
+        ThreePassAccumulate(in, &(old_sum[0]), length, band_low, band_high);
+        for(size_t i=0; i<length; i++){ref[i] += in[i];}
+        for(size_t i=band_low; i<band_high; i++){ref_band += in[i];}
+    }
+
+    std::vector<float> ave(length);
+    std::vector<float> rebinned(n_bins, 0.0f);
+    HSpectrumAccumulationKernel::Normalize(&(sum[0]), 1.0/(double)n_spectra, &(ave[0]), length, &(rebinned[0]), bin_factor, n_bins);
+
+    double max_err = 0.0;
+    double max_old_err = 0.0;
+    for(size_t i=0; i<length; i++)
+    {
+        double r = ref[i]/n_spectra;
+        max_err = std::max(max_err, (double)std::fabs( (ave[i] - r)/r ) );
+        max_old_err = std::max(max_old_err, (double)std::fabs( (old_sum[i]/n_spectra - r)/r ) );
+    }
+    double band_err = std::fabs( (band - ref_band)/ref_band );
+
+    double rebin_err = 0.0;
+    for(size_t b=0; b<n_bins; b++)
+    {
+        long double r = 0.0;
+        for(size_t i=b*bin_factor; i<(b+1)*bin_factor && i<length; i++){r += ref[i]/n_spectra;}
+        rebin_err = std::max(rebin_err, (double)std::fabs( (rebinned[b] - r)/r ) );
+    }
+
+    std::cout<<"max relative error of average (double accumulation) = "<<max_err<<std::endl;
+    std::cout<<"max relative error of average (float accumulation) = "<<max_old_err<<std::endl;
+    std::cout<<"relative error of band power = "<<band_err<<std::endl;
+    std::cout<<"max relative error of rebinned spectrum = "<<rebin_err<<std::endl;
+    //the result is rounded to float, so it can be no better than that
+    if(max_err > 1e-6 || band_err > 1e-12 || rebin_err > 1e-6){status = 1;}
+
+    //throughput, counting the bytes each method has to move per spectral bin
+    size_t n_iter = 64;
+    float dummy = 0.0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(size_t k=0; k<n_iter; k++)
+    {
+        band += HSpectrumAccumulationKernel::AccumulateWithBandPower( &(inputs[k%n_inputs][0]), &(sum[0]), length, band_low, band_high);
+    }
+    HSpectrumAccumulationKernel::Normalize(&(sum[0]), 1.0/(double)n_iter, &(ave[0]), length, &(rebinned[0]), bin_factor, n_bins);
+    double fused_time = Seconds(start);
+    dummy += ave[length/3];
+
+    start = std::chrono::steady_clock::now();
+    for(size_t k=0; k<n_iter; k++)
+    {
+        band += ThreePassAccumulate( &(inputs[k%n_inputs][0]), &(old_sum[0]), length, band_low, band_high);
+    }
+    ThreePassNormalize(&(old_sum[0]), n_iter, &(rebinned[0]), bin_factor, n_bins, length);
+    double old_time = Seconds(start);
+    dummy += old_sum[length/3];
+
+    //fused: read the spectrum and read/write the double sum once per spectrum
+    double fused_bytes = sizeof(float) + 2*sizeof(double);
+    //three pass: read the spectrum and read/write the float sum, then read a quarter of the spectrum again for the band
+    double old_bytes = sizeof(float) + 2*sizeof(float) + sizeof(float)*( (double)(band_high - band_low)/length );
+
+    double n_bin_updates = (double)n_iter*length;
+    std::cout<<"fused double accumulation: "<<fused_bytes<<" bytes/bin, "<<1e9*fused_time/n_bin_updates<<" ns/bin, "
+             <<1e-9*fused_bytes*n_bin_updates/fused_time<<" GB/s"<<std::endl;
+    std::cout<<"three pass float accumulation: "<<old_bytes<<" bytes/bin, "<<1e9*old_time/n_bin_updates<<" ns/bin, "
+             <<1e-9*old_bytes*n_bin_updates/old_time<<" GB/s"<<std::endl;
+    std::cout<<"(checksum "<<dummy + band<<")"<<std::endl;
+
+    if(status == 0){std::cout<<"spectrum accumulation test passed"<<std::endl;}
+    else{std::cout<<"spectrum accumulation test failed"<<std::endl;}
+
+    return status;
+}
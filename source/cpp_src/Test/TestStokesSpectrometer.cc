@@ -0,0 +1,210 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <complex>
+#include <algorithm>
+#include <thread>
+
+#include "HBufferAllocatorNew.hh"
+#include "HBufferPool.hh"
+#include "HStokesSpectrumAccumulator.hh"
+#include "HStokesSpectrometer.hh"
+
+using namespace hose;
+
+int main(int argc, char** argv)
+{
+    int status = 0;
+
+    size_t n_iter = 4;
+    if(argc > 1){n_iter = std::atol(argv[1]);}
+
+    //the separated spectra must agree with a direct dft of each channel
+    size_t n = 64;
+    std::mt19937 gen(11);
+    std::normal_distribution<double> noise(0.0, 20.0);
+    std::vector<float> x(3*n);
+    std::vector<float> y(3*n);
+    for(size_t i=0; i<x.size(); i++){x[i] = noise(gen); y[i] = 0.5*x[i] + noise(gen);}
+
+    std::vector<double> direct_xx(n/2+1, 0.0);
+    std::vector<double> direct_yy(n/2+1, 0.0);
+    std::vector< std::complex<double> > direct_xy(n/2+1, std::complex<double>(0.0, 0.0));
+    for(size_t f=0; f<3; f++)
+    {
+        for(size_t k=0; k<=n/2; k++)
+        {
+            std::complex<double> sx(0.0, 0.0);
+            std::complex<double> sy(0.0, 0.0);
+            for(size_t i=0; i<n; i++)
+            {
+                std::complex<double> w = std::polar(1.0, -2.0*M_PI*k*i/( (double) n) );
+                sx += ( (double) x[f*n + i] )*w;
+                sy += ( (double) y[f*n + i] )*w;
+            }
+            direct_xx[k] += std::norm(sx);
+            direct_yy[k] += std::norm(sy);
+            direct_xy[k] += sx*std::conj(sy);
+        }
+    }
+
+    HStokesSpectrumAccumulator acc;
+    acc.SetFFTSize(n);
+    if(!acc.Initialize()){status = 1;}
+    for(size_t f=0; f<3; f++){acc.AddFrame(&(x[f*n]), &(y[f*n]));}
+    double max_error = 0.0;
+    for(size_t k=0; k<=n/2; k++)
+    {
+        double scale = std::sqrt(direct_xx[k]*direct_yy[k]);
+        max_error = std::max(max_error, std::fabs(acc.GetXXSum()[k] - direct_xx[k])/direct_xx[k]);
+        max_error = std::max(max_error, std::fabs(acc.GetYYSum()[k] - direct_yy[k])/direct_yy[k]);
+        max_error = std::max(max_error, std::abs(acc.GetXYSum()[k] - direct_xy[k])/scale);
+    }
+    std::cout<<"separated transform vs direct dft, max relative error = "<<max_error<<" ("<<acc.GetNSpectra()<<" spectra)"<<std::endl;
+    if(max_error > 1e-6 || acc.GetNSpectra() != 3){status = 1;}
+
+    //a tone which is in phase (linear polarization at 45 degrees) or 90 degrees out of phase (circular polarization)
+    //between the two channels, the second case in the Y channel is lagging, which gives a negative V
+    uint64_t sample_rate = 1000000;
+    size_t fft_size = 1024;
+    size_t length = fft_size/2+1;
+    size_t tone_channel = 100;
+    double f_tone = tone_channel*( (double) sample_rate )/( (double) fft_size );
+    size_t n_samples = 1 << 18; //per channel, in each buffer
+    size_t n_buffers = 4;
+    size_t n_average = 2;
+    size_t block = 4; //channels are interleaved in blocks of this many samples
+
+    for(size_t mode=0; mode<2; mode++)
+    {
+        double lag = (mode == 0) ? 0.0 : 0.5*M_PI;
+        std::vector< uint16_t > data(2*n_samples*n_buffers);
+        for(size_t i=0; i<n_samples*n_buffers; i++)
+        {
+            double t = ( (double) i )/( (double) sample_rate );
+            double a = 100.0*std::cos(2.0*M_PI*f_tone*t) + noise(gen);
+            double b = 100.0*std::cos(2.0*M_PI*f_tone*t - lag) + noise(gen);
+            size_t offset = 2*block*(i/block) + (i % block);
+            data[offset] = (uint16_t) std::lround(32768.0 + a);
+            data[offset + block] = (uint16_t) std::lround(32768.0 + b);
+        }
+
+        HBufferAllocatorNew< uint16_t >* source_allocator = new HBufferAllocatorNew< uint16_t >();
+        HBufferPool< uint16_t >* source_pool = new HBufferPool< uint16_t >(source_allocator);
+        source_pool->Allocate(n_buffers, 2*n_samples);
+        HBufferAllocatorNew< float >* sink_allocator = new HBufferAllocatorNew< float >();
+        HBufferPool< float >* sink_pool = new HBufferPool< float >(sink_allocator);
+        sink_pool->Allocate(n_buffers, 4*length);
+
+        HStokesSpectrometer< uint16_t > spectrometer;
+        spectrometer.SetFFTSize(fft_size);
+        spectrometer.SetInterleaveBlockSize(block);
+        spectrometer.SetNBuffersToAverage(n_average);
+        spectrometer.SetNThreads(2);
+        spectrometer.SetSourceBufferPool(source_pool);
+        spectrometer.SetSinkBufferPool(sink_pool);
+        HRegisteredConsumer writer;
+        sink_pool->RegisterConsumer(&writer);
+        source_pool->Initialize();
+        sink_pool->Initialize();
+
+        auto push_buffer = [&](size_t b, uint64_t start_second, uint64_t sample_index) -> bool
+        {
+            HLinearBuffer< uint16_t >* buff = nullptr;
+            for(size_t k=0; k<1000 && buff == nullptr; k++)
+            {
+                if(source_pool->GetProducerPoolSize() != 0){buff = source_pool->PopProducerBuffer();}
+                else{std::this_thread::sleep_for(std::chrono::milliseconds(1));}
+            }
+            if(buff == nullptr){return false;}
+            std::copy(data.begin() + 2*b*n_samples, data.begin() + 2*(b+1)*n_samples, buff->GetData());
+            *(buff->GetMetaData()) = HBufferMetaData();
+            buff->GetMetaData()->SetSampleRate(sample_rate);
+            buff->GetMetaData()->SetAcquisitionStartSecond(start_second);
+            buff->GetMetaData()->SetLeadingSampleIndex(sample_index);
+            source_pool->PushConsumerBuffer(buff);
+            return true;
+        };
+
+        spectrometer.StartConsumptionProduction();
+        for(size_t b=0; b<n_buffers; b++)
+        {
+            if( !push_buffer(b, 1, b*n_samples) ){status = 1; break;}
+        }
+        for(size_t k=0; k<1000 && sink_pool->GetConsumerPoolSize(writer.GetConsumerID()) < n_buffers/n_average; k++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        //a buffer of a period which has already been written must not re-open it, even once
+        //a later acquisition starts (which would write it out again as a partial average)
+        if( !push_buffer(0, 1, 0) || !push_buffer(0, 2, 0) ){status = 1;}
+        for(size_t k=0; k<1000 && spectrometer.GetNLateBuffers() == 0; k++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        spectrometer.StopConsumptionProduction();
+
+        size_t n_out = sink_pool->GetConsumerPoolSize(writer.GetConsumerID());
+        std::cout<<"stokes spectrometer produced "<<n_out<<" averages, skipped "<<spectrometer.GetNSkippedBuffers()<<" buffers, ";
+        std::cout<<spectrometer.GetNPartialAverages()<<" partial, "<<spectrometer.GetNLateBuffers()<<" late"<<std::endl;
+        if(n_out != n_buffers/n_average || spectrometer.GetNPartialAverages() != 0 || spectrometer.GetNLateBuffers() != 1){status = 1;}
+
+        while(sink_pool->GetConsumerPoolSize(writer.GetConsumerID()) != 0)
+        {
+            HLinearBuffer< float >* buff = sink_pool->PopConsumerBuffer(writer.GetConsumerID());
+            const HBufferMetaData* meta = buff->GetMetaData();
+            const float* stokes = buff->GetData();
+            const float* si = stokes;
+            const float* sq = stokes + length;
+            const float* su = stokes + 2*length;
+            const float* sv = stokes + 3*length;
+            size_t peak = std::max_element(si, si + length) - si;
+            double i_peak = si[peak];
+            std::cout<<(mode == 0 ? "in phase" : "90 degrees")<<": sample index "<<meta->GetLeadingSampleIndex()<<", peak channel = "<<peak;
+            std::cout<<", Q/I = "<<sq[peak]/i_peak<<", U/I = "<<su[peak]/i_peak<<", V/I = "<<sv[peak]/i_peak<<std::endl;
+
+            double expected_u = (mode == 0) ? 1.0 : 0.0;
+            double expected_v = (mode == 0) ? 0.0 : -1.0;
+            if(peak != tone_channel || std::fabs(sq[peak]/i_peak) > 0.05 || std::fabs(su[peak]/i_peak - expected_u) > 0.05
+                || std::fabs(sv[peak]/i_peak - expected_v) > 0.05){status = 1;}
+            if(meta->GetPowerSpectrumLength() != length || meta->GetNTotalSpectrum() != n_average*n_samples/fft_size
+                || meta->GetLeadingSampleIndex() % (n_average*n_samples) != 0 || meta->GetValidityMask()->size() != n_average){status = 1;}
+            sink_pool->PushConsumerBuffer(buff, writer.GetNextConsumerID());
+        }
+
+        delete source_pool;
+        delete source_allocator;
+        delete sink_pool;
+        delete sink_allocator;
+    }
+
+    //throughput of the de-interleave and transform
+    std::vector<float> a(fft_size);
+    std::vector<float> b(fft_size);
+    std::vector< uint16_t > raw(2*n_samples);
+    for(size_t i=0; i<raw.size(); i++){raw[i] = (uint16_t) std::lround(32768.0 + noise(gen));}
+    HStokesSpectrumAccumulator stokes_acc;
+    stokes_acc.SetFFTSize(fft_size);
+    stokes_acc.Initialize();
+    auto start = std::chrono::steady_clock::now();
+    for(size_t k=0; k<n_iter; k++)
+    {
+        for(size_t offset=0; offset<raw.size(); offset += 2*fft_size)
+        {
+            for(size_t i=0; i<fft_size; i++){a[i] = ( (float) raw[offset + 2*i] ) - 32768.0f; b[i] = ( (float) raw[offset + 2*i + 1] ) - 32768.0f;}
+            stokes_acc.AddFrame(&(a[0]), &(b[0]));
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout<<"throughput = "<<1e-6*n_iter*raw.size()/seconds<<" Msamples/s per thread (both channels, fft size "<<fft_size<<")"<<std::endl;
+
+    if(status == 0){std::cout<<"stokes spectrometer test passed"<<std::endl;}
+    else{std::cout<<"stokes spectrometer test failed"<<std::endl;}
+
+    return status;
+}
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <unistd.h>
+
+#include "HThreadPool.hh"
+#include "HTaskScheduler.hh"
+
+using namespace hose;
+
+//toy stage which has a fixed number of work items to process
+class TestStage: public HThreadPool
+{
+    public:
+        TestStage(unsigned int n_items):fNRemaining(n_items),fNDone(0),fNConcurrent(0),fMaxConcurrent(0){};
+        virtual ~TestStage(){};
+
+        unsigned int GetNDone() const {return fNDone;};
+        unsigned int GetMaxConcurrent() const {return fMaxConcurrent;};
+
+    protected:
+
+        virtual void ExecuteThreadTask() override
+        {
+            int remaining = fNRemaining--;
+            if(remaining > 0)
+            {
+                unsigned int n_concurrent = ++fNConcurrent;
+                unsigned int current_max = fMaxConcurrent;
+                while(n_concurrent > current_max && !fMaxConcurrent.compare_exchange_weak(current_max, n_concurrent)){};
+                usleep(100);
+                fNDone++;
+                fNConcurrent--;
+            }
+            else
+            {
+                fNRemaining++;
+            }
+        }
+
+        virtual bool WorkPresent() override {return fNRemaining > 0;};
+
+        std::atomic<int> fNRemaining;
+        std::atomic<unsigned int> fNDone;
+        std::atomic<unsigned int> fNConcurrent;
+        std::atomic<unsigned int> fMaxConcurrent;
+};
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    int status = 0;
+
+    HTaskScheduler* scheduler = HTaskScheduler::GetInstance();
+    scheduler->SetNThreads(4);
+
+    //two stages sharing the same workers, one limited to a single concurrent task
+    TestStage fast(200);
+    fast.SetUseSharedScheduler(true);
+    fast.SetNThreads(3);
+    fast.SetSchedulerPriority(1);
+
+    TestStage slow(50);
+    slow.SetUseSharedScheduler(true);
+    slow.SetNThreads(1);
+
+    fast.Launch();
+    slow.Launch();
+    fast.SignalTerminateOnComplete();
+    slow.SignalTerminateOnComplete();
+    fast.Join();
+    slow.Join();
+
+    std::cout<<"fast stage: done = "<<fast.GetNDone()<<", max concurrent tasks = "<<fast.GetMaxConcurrent()<<std::endl;
+    std::cout<<"slow stage: done = "<<slow.GetNDone()<<", max concurrent tasks = "<<slow.GetMaxConcurrent()<<std::endl;
+
+    if(fast.GetNDone() != 200 || fast.GetMaxConcurrent() > 3){status = 1;}
+    if(slow.GetNDone() != 50 || slow.GetMaxConcurrent() > 1){status = 1;}
+
+    //fork-join loop
+    std::vector< double > values(10000, 0.0);
+    scheduler->ParallelFor(values.size(), [&values](std::size_t i){values[i] = 2.0*i;});
+    for(std::size_t i=0; i<values.size(); i++)
+    {
+        if(values[i] != 2.0*i){status = 1;}
+    }
+
+    scheduler->Terminate();
+
+    if(status == 0){std::cout<<"task scheduler test passed"<<std::endl;}
+    else{std::cout<<"task scheduler test failed"<<std::endl;}
+
+    return status;
+}
@@ -0,0 +1,83 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+
+#include "HThreadPool.hh"
+
+using namespace hose;
+
+//toy pool which always has work, and counts how many threads are inside a task
+class TestPool: public HThreadPool
+{
+    public:
+        TestPool():fNBusy(0),fNTasks(0),fTaskMicroSeconds(50){};
+        virtual ~TestPool(){};
+
+        unsigned int GetNTasks() const {return fNTasks;};
+        void SetTaskMicroSeconds(unsigned int us){fTaskMicroSeconds = us;};
+
+    protected:
+
+        virtual void ExecuteThreadTask() override
+        {
+            fNBusy++;
+            fNTasks++;
+            usleep(fTaskMicroSeconds);
+            fNBusy--;
+        }
+
+        virtual bool WorkPresent() override {return true;};
+
+        std::atomic<unsigned int> fNBusy;
+        std::atomic<unsigned int> fNTasks;
+        std::atomic<unsigned int> fTaskMicroSeconds;
+};
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    int status = 0;
+
+    TestPool pool;
+    pool.SetNThreads(2);
+    pool.Launch();
+    usleep(10000);
+
+    //grow and shrink the running pool
+    pool.SetNThreads(6);
+    std::cout<<"n threads after growing = "<<pool.GetNThreads()<<std::endl;
+    if(pool.GetNThreads() != 6){status = 1;}
+    usleep(10000);
+
+    pool.SetNThreads(1);
+    std::cout<<"n threads after shrinking = "<<pool.GetNThreads()<<std::endl;
+    if(pool.GetNThreads() != 1){status = 1;}
+
+    unsigned int n_tasks = pool.GetNTasks();
+    usleep(10000);
+    std::cout<<"tasks done after shrinking = "<<pool.GetNTasks() - n_tasks<<std::endl;
+    if(pool.GetNTasks() == n_tasks){status = 1;} //the remaining thread should still be working
+
+    //threads which are retired in the middle of a long task must not hold up another resize
+    pool.SetTaskMicroSeconds(300000);
+    pool.SetNThreads(3);
+    usleep(20000);
+    std::thread shrink( [&pool](){pool.SetNThreads(1);} );
+    usleep(20000);
+    auto start = std::chrono::steady_clock::now();
+    pool.SetNThreads(2);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    shrink.join();
+    std::cout<<"resize while retiring threads took "<<seconds<<" s"<<std::endl;
+    if(seconds > 0.1 || pool.GetNThreads() != 2){status = 1;}
+    pool.SetTaskMicroSeconds(50);
+
+    pool.ForceTermination();
+    pool.Join();
+
+    if(status == 0){std::cout<<"thread pool resize test passed"<<std::endl;}
+    else{std::cout<<"thread pool resize test failed"<<std::endl;}
+
+    return status;
+}
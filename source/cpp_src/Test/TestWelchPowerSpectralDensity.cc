@@ -0,0 +1,160 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <stdint.h>
+
+#include "HTaskScheduler.hh"
+#include "HPowerSpectrumAccumulator.hh"
+#include "HSpectrumFileStructWrapper.hh"
+#include "HWelchPowerSpectralDensity.hh"
+
+using namespace hose;
+
+//largest difference between two spectra, relative to the peak of the reference
+double MaxRelativeDifference(const std::vector< double >& a, const std::vector< double >& b)
+{
+    double peak = *std::max_element(b.begin(), b.end());
+    double max_diff = 0.0;
+    for(size_t k=0; k<a.size(); k++){max_diff = std::max(max_diff, std::fabs(a[k] - b[k])/peak);}
+    return max_diff;
+}
+
+//segment by segment average with a single accumulator
+void ReferenceSpectrum(const std::vector< int16_t >& data, size_t length, size_t overlap, uint64_t n_segments, std::vector< double >& spectrum)
+{
+    HPowerSpectrumAccumulator acc;
+    acc.SetFFTSize(length);
+    acc.SetWindowFunction(2);
+    acc.Initialize();
+    std::vector< float > x(length);
+    for(uint64_t s=0; s<n_segments; s++)
+    {
+        for(size_t i=0; i<length; i++){x[i] = data[s*(length - overlap) + i];}
+        acc.AddFrame(&(x[0]));
+    }
+    acc.Flush();
+    spectrum.resize(acc.GetSpectrumLength());
+    for(size_t k=0; k<spectrum.size(); k++){spectrum[k] = acc.GetPowerSum()[k]/( (double) acc.GetNSpectra() );}
+}
+
+int main(int argc, char** argv)
+{
+    int status = 0;
+
+    size_t n_iter = 4;
+    if(argc > 1){n_iter = std::atol(argv[1]);}
+
+    HTaskScheduler* scheduler = HTaskScheduler::GetInstance();
+    scheduler->SetNThreads(3);
+    scheduler->Launch();
+
+    //a tone centered on channel 100, in noise, written to a raw file
+    uint64_t sample_rate = 1000000;
+    size_t length = 1024;
+    size_t overlap = 384;
+    size_t tone_channel = 100;
+    size_t n_samples = 300007;
+    std::mt19937 gen(5);
+    std::normal_distribution< double > noise(0.0, 40.0);
+    std::vector< int16_t > data(n_samples);
+    for(size_t i=0; i<n_samples; i++)
+    {
+        data[i] = (int16_t) std::lround( 100.0*std::sin(2.0*M_PI*tone_channel*i/( (double) length ) ) + noise(gen) );
+    }
+
+    std::string raw_file = "1500000000_0_UX.bin";
+    std::ofstream out_file(raw_file.c_str(), std::ios::out | std::ios::binary);
+    out_file.write( (const char*) &(data[0]), (std::streamsize) (n_samples*sizeof(int16_t)) );
+    out_file.close();
+
+    uint64_t n_segments = (n_samples - length)/(length - overlap) + 1;
+    std::vector< double > reference;
+    double mean_square = 0.0;
+    ReferenceSpectrum(data, length, overlap, n_segments, reference);
+    uint64_t n_used = (n_segments - 1)*(length - overlap) + length;
+    for(uint64_t i=0; i<n_used; i++){mean_square += ( (double) data[i] )*data[i];}
+    mean_square /= (double) n_used;
+
+    //streamed from the file in chunks which do not line up with the segments, on the scheduler
+    HWelchPowerSpectralDensity< int16_t > welch;
+    welch.SetSegmentLength(length);
+    welch.SetOverlap(overlap);
+    welch.SetWindowFunction(2);
+    welch.SetChunkSize(10007);
+    welch.SetSampleRate(sample_rate);
+    welch.SetTaskScheduler(scheduler);
+    if(!welch.Initialize() || !welch.ProcessFile(raw_file)){status = 1;}
+
+    std::vector< double > streamed;
+    welch.GetAveragedPowerSpectrum(streamed);
+    double stream_diff = MaxRelativeDifference(streamed, reference);
+    std::cout<<"streamed file vs reference, "<<welch.GetNAverages()<<" segments, max difference = "<<stream_diff<<std::endl;
+    if(welch.GetNAverages() != n_segments || stream_diff > 1e-9){status = 1;}
+    size_t peak = std::max_element(streamed.begin(), streamed.end()) - streamed.begin();
+    if(peak != tone_channel){std::cout<<"tone found in channel "<<peak<<std::endl; status = 1;}
+
+    //the density integrates to the mean square of the samples
+    std::vector< double > psd;
+    welch.GetPowerSpectralDensity(psd);
+    double integral = 0.0;
+    for(size_t k=0; k<psd.size(); k++){integral += psd[k]*( (double) sample_rate )/( (double) length );}
+    std::cout<<"integrated density = "<<integral<<", mean square = "<<mean_square<<std::endl;
+    if(std::fabs(integral/mean_square - 1.0) > 0.02){status = 1;}
+
+    //written as a .spec file and read back
+    std::string spec_file = "1500000000_0_UX.spec";
+    if(!welch.WriteToFile(spec_file)){status = 1;}
+    HSpectrumFileStructWrapper< float > spec(spec_file);
+    std::vector< float > spec_data;
+    spec.GetSpectrumData(spec_data);
+    if(spec.GetSpectrumLength() != length/2 + 1 || spec.GetNAverages() != n_segments || spec.GetSampleRate() != sample_rate
+       || spec.GetSampleLength() != welch.GetNSamplesUsed() || spec_data.size() != streamed.size() )
+    {
+        std::cout<<"spectrum file header does not match"<<std::endl; status = 1;
+    }
+    for(size_t k=0; k<spec_data.size() && k<streamed.size(); k++){if(spec_data[k] != (float) streamed[k]){status = 1; break;}}
+    std::remove(spec_file.c_str());
+
+    //blocks of samples passed in one at a time, serially, stopping after a fixed number of averages
+    HWelchPowerSpectralDensity< int16_t > limited;
+    limited.SetSegmentLength(length);
+    limited.SetOverlap(overlap);
+    limited.SetMaxAverages(51);
+    for(size_t start=0; start<n_samples; start += 777){limited.AddSamples(&(data[start]), std::min< size_t >(777, n_samples - start));}
+    std::vector< double > limited_spectrum;
+    ReferenceSpectrum(data, length, overlap, 51, reference);
+    limited.GetAveragedPowerSpectrum(limited_spectrum);
+    double limited_diff = MaxRelativeDifference(limited_spectrum, reference);
+    std::cout<<"limited block stream vs reference, "<<limited.GetNAverages()<<" segments, max difference = "<<limited_diff<<std::endl;
+    if(!limited.IsComplete() || limited.GetNAverages() != 51 || limited_diff > 1e-9){status = 1;}
+
+    //an invalid configuration is refused
+    HWelchPowerSpectralDensity< int16_t > invalid;
+    invalid.SetSegmentLength(length);
+    invalid.SetOverlap(length);
+    if(invalid.Initialize()){status = 1;}
+
+    //throughput of the streamed estimate
+    auto start = std::chrono::steady_clock::now();
+    for(size_t it=0; it<n_iter; it++)
+    {
+        welch.Reset();
+        welch.ProcessFile(raw_file);
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout<<"streamed throughput: "<<1e-6*n_iter*n_samples/elapsed<<" Msamples/s"<<std::endl;
+    std::remove(raw_file.c_str());
+
+    scheduler->Terminate();
+
+    if(status == 0){std::cout<<"welch power spectral density test passed"<<std::endl;}
+    else{std::cout<<"welch power spectral density test failed"<<std::endl;}
+
+    return status;
+}
@@ -0,0 +1,160 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <thread>
+
+#include "HBufferAllocatorNew.hh"
+#include "HBufferPool.hh"
+#include "HZoomDownConverter.hh"
+#include "HZoomSpectrometer.hh"
+
+using namespace hose;
+
+int main(int argc, char** argv)
+{
+    int status = 0;
+
+    uint64_t sample_rate = 1000000;
+    uint64_t center = 250000;
+    size_t decimation = 32;
+    size_t fft_size = 1024;
+    size_t n_iter = 4;
+    if(argc > 1){n_iter = std::atol(argv[1]);}
+
+    //a tone inside the zoom band (+1250 Hz from the center), a stronger one outside of it, and noise
+    double f_in = 251250.0;
+    double f_out = 300000.0;
+    size_t n_samples = 1 << 21;
+
+    std::mt19937 gen(11);
+    std::normal_distribution<double> noise(0.0, 20.0);
+    std::vector< uint16_t > data(n_samples);
+    for(size_t i=0; i<n_samples; i++)
+    {
+        double t = ( (double) i )/( (double) sample_rate );
+        double x = 100.0*std::cos(2.0*M_PI*f_in*t) + 1000.0*std::cos(2.0*M_PI*f_out*t) + noise(gen);
+        data[i] = (uint16_t) std::lround(32768.0 + x);
+    }
+
+    HZoomDownConverter zoom;
+    zoom.SetSampleRate(sample_rate);
+    zoom.SetCenterFrequency(center);
+    zoom.SetDecimationFactor(decimation);
+    zoom.SetNTapsPerPhase(16);
+    zoom.SetFFTSize(fft_size);
+    zoom.SetWindowFunction(1);
+    if(!zoom.Initialize()){status = 1;}
+
+    //process the data as two buffers, to check that the oscillator phase is carried over
+    std::vector<double> power(fft_size, 0.0);
+    size_t half = n_samples/2;
+    size_t n_spectra = zoom.Process(&(data[0]), half, 0, &(power[0]));
+    n_spectra += zoom.Process(&(data[half]), half, half, &(power[0]));
+    std::cout<<"accumulated "<<n_spectra<<" spectra of "<<fft_size<<" channels, channel width = "<<zoom.GetChannelWidth()<<" Hz"<<std::endl;
+    if(n_spectra != 2*zoom.GetNSpectra(half) || n_spectra == 0){status = 1;}
+
+    //the in-band tone should be the peak, at the expected channel
+    size_t peak = 0;
+    for(size_t i=0; i<fft_size; i++){if(power[i] > power[peak]){peak = i;}}
+    size_t expected = fft_size/2 + (size_t) std::lround( (f_in - center)/zoom.GetChannelWidth() );
+    std::cout<<"peak channel = "<<peak<<", expected = "<<expected<<std::endl;
+    if(peak != expected){status = 1;}
+
+    //the out-of-band tone (20 dB stronger) must not alias into the zoom band, so apart from the
+    //in-band tone, every channel should be at the noise level
+    std::vector<double> sorted(power);
+    std::sort(sorted.begin(), sorted.end());
+    double median = sorted[fft_size/2];
+    double max_other = 0.0;
+    for(size_t i=0; i<fft_size; i++)
+    {
+        if( (i + 3 < peak || i > peak + 3) && i > fft_size/16 && i < fft_size - fft_size/16){max_other = std::max(max_other, power[i]);}
+    }
+    std::cout<<"tone/noise = "<<10.0*std::log10(power[peak]/median)<<" dB, max other channel/noise = "<<10.0*std::log10(max_other/median)<<" dB"<<std::endl;
+    if(max_other > 10.0*median){status = 1;}
+
+    //the oscillator phase at high sample rates (10 GS/s, where f*n overflows 64 bits), checked against
+    //the product formed in pieces which are each small enough: a*b = a*(b_hi*2^20 + b_lo)
+    uint64_t fast_rate = 10000000000ULL;
+    uint64_t fast_center = 3100000007ULL;
+    uint64_t fast_index = 123456789012345ULL;
+    uint64_t a = fast_center % fast_rate;
+    uint64_t b = fast_index % fast_rate;
+    uint64_t expected_cycles = ( ( ( (a*(b >> 20)) % fast_rate ) << 20 ) % fast_rate + (a*(b & 0xFFFFF)) % fast_rate ) % fast_rate;
+    if(HOscillatorPhase::MultiplyModulo(fast_center, fast_index, fast_rate) != expected_cycles)
+    {
+        std::cout<<"oscillator phase is wrong at "<<fast_rate<<" Hz sampling"<<std::endl; status = 1;
+    }
+
+    //throughput
+    std::vector<double> scratch(fft_size, 0.0);
+    auto start = std::chrono::steady_clock::now();
+    for(size_t k=0; k<n_iter; k++){zoom.Process(&(data[0]), n_samples, k*n_samples, &(scratch[0]));}
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout<<"throughput = "<<1e-6*n_iter*n_samples/seconds<<" Msamples/s per thread (decimation "<<decimation<<", "<<16*decimation<<" taps)"<<std::endl;
+
+    //now run the same data through the zoom spectrometer stage, as two digitizer buffers
+    HBufferAllocatorNew< uint16_t >* source_allocator = new HBufferAllocatorNew< uint16_t >();
+    HBufferPool< uint16_t >* source_pool = new HBufferPool< uint16_t >(source_allocator);
+    source_pool->Allocate(2, half);
+    HBufferAllocatorNew< float >* sink_allocator = new HBufferAllocatorNew< float >();
+    HBufferPool< float >* sink_pool = new HBufferPool< float >(sink_allocator);
+    sink_pool->Allocate(2, fft_size);
+
+    HZoomSpectrometer< uint16_t > spectrometer;
+    spectrometer.SetCenterFrequency(center);
+    spectrometer.SetDecimationFactor(decimation);
+    spectrometer.SetNTapsPerPhase(16);
+    spectrometer.SetFFTSize(fft_size);
+    spectrometer.SetWindowFunction(1);
+    spectrometer.SetNThreads(2);
+    spectrometer.SetSourceBufferPool(source_pool);
+    spectrometer.SetSinkBufferPool(sink_pool);
+    HRegisteredConsumer writer;
+    sink_pool->RegisterConsumer(&writer);
+    source_pool->Initialize();
+    sink_pool->Initialize();
+
+    spectrometer.StartConsumptionProduction();
+    for(size_t b=0; b<2; b++)
+    {
+        HLinearBuffer< uint16_t >* buff = source_pool->PopProducerBuffer();
+        std::copy(data.begin() + b*half, data.begin() + (b+1)*half, buff->GetData());
+        buff->GetMetaData()->SetSampleRate(sample_rate);
+        buff->GetMetaData()->SetLeadingSampleIndex(b*half);
+        source_pool->PushConsumerBuffer(buff);
+    }
+    for(size_t k=0; k<1000 && sink_pool->GetConsumerPoolSize(writer.GetConsumerID()) < 2; k++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    spectrometer.StopConsumptionProduction();
+
+    size_t n_out = sink_pool->GetConsumerPoolSize(writer.GetConsumerID());
+    std::cout<<"zoom spectrometer produced "<<n_out<<" spectra, skipped "<<spectrometer.GetNSkippedBuffers()<<" buffers"<<std::endl;
+    if(n_out != 2 || source_pool->GetProducerPoolSize() != 2){status = 1;}
+    while(sink_pool->GetConsumerPoolSize(writer.GetConsumerID()) != 0)
+    {
+        HLinearBuffer< float >* buff = sink_pool->PopConsumerBuffer(writer.GetConsumerID());
+        const HBufferMetaData* meta = buff->GetMetaData();
+        const float* spec = buff->GetData();
+        size_t out_peak = std::max_element(spec, spec + fft_size) - spec;
+        if(out_peak != expected || meta->GetPowerSpectrumLength() != fft_size || meta->GetNTotalSpectrum() != zoom.GetNSpectra(half)
+            || meta->GetSampleRate() != sample_rate/decimation){status = 1;}
+        sink_pool->PushConsumerBuffer(buff, writer.GetNextConsumerID());
+    }
+
+    delete source_pool;
+    delete source_allocator;
+    delete sink_pool;
+    delete sink_allocator;
+
+    if(status == 0){std::cout<<"zoom spectrometer test passed"<<std::endl;}
+    else{std::cout<<"zoom spectrometer test failed"<<std::endl;}
+
+    return status;
+}
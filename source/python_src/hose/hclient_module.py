@@ -119,6 +119,18 @@ class hprompt(Cmd):
                 cmd_string += str(high_bin)
                 self.interface.SendRecieveMessage(cmd_string)
 
+    def do_configure(self, args):
+        """Change the fft size, number of gpu/cpu averages and window (while not recording), empty fields are unchanged"""
+        arg_list = args.split("=");
+        if(len(arg_list)) == 2:
+            field_list = arg_list[1].split(":")
+            if(len(field_list) == 4):
+                cmd_string = "configure="
+                cmd_string += ":".join(field_list)
+                self.interface.SendRecieveMessage(cmd_string)
+            else:
+                print( "Error: expected configure=n_fft_pts:n_ave_spectra_gpu:n_ave_spectra_cpu:window_type" )
+
     def parse_record_command(self, args):
         if( len(args) == 1 and args[0] == "?" ):
             cmd_string = "record?"
@@ -98,6 +98,20 @@ class spectrum_file_data(hose_structure_base):
             spec_data.append( struct.unpack(fmt, self.raw_spectrum_data[start:end])[0] )
         return spec_data
 
+    #true if the file holds the four Stokes spectra (I, Q, U, V) from the dual-channel mode
+    def is_stokes(self):
+        flag = bytes(self.header.version_flag)
+        return len(flag) > 5 and flag[5:6] == b'S'
+
+    #splits the data of a Stokes file into the I, Q, U and V spectra (returned as a dictionary of lists)
+    def get_stokes_data(self):
+        spec_data = self.get_spectrum_data()
+        length = len(spec_data)//4
+        stokes = dict()
+        for i, name in enumerate(['I', 'Q', 'U', 'V']):
+            stokes[name] = spec_data[i*length:(i+1)*length]
+        return stokes
+
 
 class noise_power_file_header(hose_structure_base):
     _fields_ = [